@@ -0,0 +1,55 @@
+/*
+A sink plugin appending the bytes written per sample to the file named by
+its options, e.g.
+
+gcc -shared -fPIC -I/usr/include/KrillKounter -o kk-example.so \
+    kk-sink-plugin-example.c
+
+"sinks": [ { "type": "plugin", "path": "/usr/lib/KrillKounter/kk-example.so",
+    "options": "/tmp/kk-example.txt" } ]
+*/
+#include <kk-sink-plugin.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static int init(void** state, const char* options)
+{
+    FILE* file = fopen(options[0] != '\0' ? options : "/dev/stdout", "a");
+    *state = file;
+    return file != NULL ? 0 : -1;
+}
+
+static int on_batch(void* state, const struct kk_device_record* records,
+    size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        fprintf((FILE*)state, "%s %s %lld\n", records[i].device_name,
+            records[i].serial_number,
+            (long long)records[i].delta.write_sectors * 512);
+    return 0;
+}
+
+static int flush(void* state)
+{
+    return fflush((FILE*)state);
+}
+
+static void shutdown(void* state)
+{
+    fclose((FILE*)state);
+}
+
+static const struct kk_sink_plugin plugin = {
+    .abi_version = KK_SINK_PLUGIN_ABI_VERSION,
+    .record_size = sizeof(struct kk_device_record),
+    .name        = "example",
+    .init        = init,
+    .on_batch    = on_batch,
+    .flush       = flush,
+    .shutdown    = shutdown,
+};
+
+const struct kk_sink_plugin* kk_sink_plugin_get(void)
+{
+    return &plugin;
+}
@@ -0,0 +1,34 @@
+#include "cBinaryDump.hh"
+
+#include "../utils/trace-codec.hh"
+#include <algorithm>
+#include <stdint.h>
+
+constexpr guint16 CONST_DUMP_VERSION = 1;
+
+// public functions
+
+void cBinaryDump::appendHeader(std::string* pOutput, guint32 count)
+{
+    pOutput->append("KKDB", 4);
+    TraceCodecPutUint16(pOutput, CONST_DUMP_VERSION);
+    TraceCodecPutUint16(pOutput, 0);
+    TraceCodecPutUint32(pOutput, count);
+}
+
+void cBinaryDump::appendEntry(std::string* pOutput,
+    std::string const & serialNumber, gint64 totalBytesWritten,
+    gint64 selfBytesWritten, gint64 diskSeq, struct sBlockStats const * pStats)
+{
+    guint16 length = std::min<gsize>(serialNumber.size(), UINT16_MAX);
+    TraceCodecPutUint16(pOutput, length);
+    pOutput->append(serialNumber.data(), length);
+    for (auto value : { totalBytesWritten, selfBytesWritten, diskSeq,
+             pStats->readIo, pStats->readMerges, pStats->readSectors,
+             pStats->readTicks, pStats->writeIo, pStats->writeMerges,
+             pStats->writeSectors, pStats->writeTicks, pStats->inFlight,
+             pStats->ioTicks, pStats->timeInQueue, pStats->discardIo,
+             pStats->discardMerges, pStats->discardSectors,
+             pStats->discardTicks })
+        TraceCodecPutUint64(pOutput, value);
+}
@@ -0,0 +1,27 @@
+// cBinaryDump.hh
+#ifndef _CBINARYDUMP_H
+#define _CBINARYDUMP_H
+
+#include "../library/include/structs.hh"
+#include <glib.h>
+#include <string>
+
+/*
+The binary format of "dump binary" and of --merge-format binary.
+
+"KKDB", a guint16 format version (1), a guint16 of flags (0) and a guint32
+device count, then per device a guint16 length and the serial number,
+totalBytesWritten, selfBytesWritten, diskSeq and the 15 counters of
+sBlockStats in the order of its members as gint64, all little endian.
+*/
+class cBinaryDump
+{
+    public:
+        static void appendHeader(std::string* pOutput, guint32 count);
+        static void appendEntry(std::string* pOutput,
+            std::string const & serialNumber, gint64 totalBytesWritten,
+            gint64 selfBytesWritten, gint64 diskSeq,
+            struct sBlockStats const * pStats);
+};
+
+#endif /* _CBINARYDUMP_H */
@@ -0,0 +1,188 @@
+#include "cControlCommands.hh"
+
+#include "cBinaryDump.hh"
+#include "cCsvSink.hh"
+#include <functional>
+#include <stdio.h>
+
+constexpr uint   CONST_SECTOR_SIZE             = 512;
+constexpr gint64 CONST_SECONDS_TO_MICROSECONDS = 1000000;
+
+// constructor
+
+cControlCommands::cControlCommands(cDaemon* pDaemon, cJsonWriter* pWriter)
+    : _pDaemon(pDaemon), _pWriter(pWriter)
+{
+}
+
+// public functions
+
+void cControlCommands::addCommands(cControlServer* pServer)
+{
+    pServer->addCommand("sample",
+        std::bind_front(&cControlCommands::sample, this));
+    pServer->addCommand("flush",
+        std::bind_front(&cControlCommands::flush, this));
+    pServer->addCommand("dump",
+        std::bind_front(&cControlCommands::dump, this));
+    pServer->addCommand("reset",
+        std::bind_front(&cControlCommands::reset, this));
+    pServer->addCommand("metrics",
+        std::bind_front(&cControlCommands::metrics, this));
+    pServer->addCommand("history",
+        std::bind_front(&cControlCommands::history, this));
+}
+
+// private functions
+
+bool cControlCommands::sample(
+    std::string const & argument, std::string* pResponse)
+{
+    _pDaemon->sampleWriters();
+    _pDaemon->sampleDevices();
+    return true; // success
+}
+
+bool cControlCommands::flush(
+    std::string const & argument, std::string* pResponse)
+{
+    _pDaemon->sampleDevices();
+    _pDaemon->persist(true);
+    return true; // success
+}
+
+bool cControlCommands::dump(
+    std::string const & argument, std::string* pResponse)
+{
+    auto devices = _pDaemon->getDevices();
+    if (argument.empty() || argument == "json")
+        return _pWriter->writeJsonString(devices, pResponse);
+    if (argument != "binary")
+    {
+        *pResponse = "format is json or binary";
+        return false; // failure
+    }
+
+    cBinaryDump::appendHeader(pResponse, devices.size());
+    for (auto pDevice : devices)
+    {
+        cBinaryDump::appendEntry(pResponse, pDevice->serialNumber,
+            pDevice->totalBytesWritten, pDevice->selfBytesWritten,
+            pDevice->diskSeq, &pDevice->stats);
+    }
+    return true; // success
+}
+
+bool cControlCommands::reset(
+    std::string const & argument, std::string* pResponse)
+{
+    for (auto pDevice : _pDaemon->getDevices())
+    {
+        if (!argument.empty() && pDevice->serialNumber != argument)
+            continue;
+        if (!_pDaemon->resetWindow(pDevice))
+        {
+            *pResponse = "unable to read " + pDevice->deviceName;
+            return false; // failure
+        }
+        // the histograms are lifetime state and stay
+        pDevice->topWriters.interval.reset();
+    }
+    return true; // success
+}
+
+bool cControlCommands::metrics(
+    std::string const & argument, std::string* pResponse)
+{
+    struct sDeviceEntry* pDevice = nullptr;
+    for (auto pCandidate : _pDaemon->getDevices())
+    {
+        if (pCandidate->serialNumber == argument)
+            pDevice = pCandidate;
+    }
+    if (pDevice == nullptr)
+    {
+        *pResponse = "unknown serial number";
+        return false; // failure
+    }
+
+    // live counters, the in-memory state is left to the sampling timer
+    gint64 diskSeq = 0;
+    struct sBlockStats stats;
+    auto pReader = _pDaemon->getSampleReader();
+    if (!pReader->getDiskSeq(pDevice->deviceName, &diskSeq)
+        || !pReader->getStats(pDevice->deviceName, &stats))
+    {
+        *pResponse = "unable to read " + pDevice->deviceName;
+        return false; // failure
+    }
+
+    // counters restart with the disk sequence
+    struct sBlockStats sampleStats = diskSeq == pDevice->diskSeq
+        ? pDevice->stats : (struct sBlockStats) {};
+    struct sBlockStats windowStats = diskSeq == pDevice->windowDiskSeq
+        ? pDevice->windowStats : (struct sBlockStats) {};
+    auto totalBytesWritten = _computer.totalBytesWritten(CONST_SECTOR_SIZE,
+        stats.writeSectors, sampleStats.writeSectors,
+        pDevice->totalBytesWritten);
+
+    struct sIntervalMetrics metrics;
+    _computer.getIntervalMetrics(
+        &windowStats, &stats, CONST_SECTOR_SIZE, &metrics);
+
+    // "key=value" lines, easy to consume from a shell script
+    auto add = [pResponse](const char* pKey, std::string value) {
+        pResponse->append(pKey).append("=").append(value).append("\n");
+    };
+    add("serialNumber", pDevice->serialNumber);
+    add("devicePath", pDevice->devicePath);
+    add("totalBytesWritten", std::to_string(totalBytesWritten));
+    add("windowSeconds", std::to_string(
+        (_pDaemon->getMonotonicTime() - pDevice->windowStartTime)
+        / CONST_SECONDS_TO_MICROSECONDS));
+    add("readIo", std::to_string(metrics.readIo));
+    add("writeIo", std::to_string(metrics.writeIo));
+    add("readBytes", std::to_string(
+        (stats.readSectors - windowStats.readSectors) * CONST_SECTOR_SIZE));
+    add("writeBytes", std::to_string(
+        (stats.writeSectors - windowStats.writeSectors) * CONST_SECTOR_SIZE));
+    add("discardBytes", std::to_string(
+        (stats.discardSectors - windowStats.discardSectors)
+        * CONST_SECTOR_SIZE));
+    add("readAwaitUs", std::to_string(metrics.readAwaitUs));
+    add("writeAwaitUs", std::to_string(metrics.writeAwaitUs));
+    add("averageRequestSize", std::to_string(metrics.averageRequestSize));
+    add("inFlight", std::to_string(stats.inFlight));
+    if (_pDaemon->isSamplingQueueDepth())
+    {
+        // of the last sample interval
+        auto pDepth = &pDevice->queueDepth;
+        char mean[32];
+        snprintf(mean, sizeof(mean), "%ld.%03ld",
+            (long)(pDepth->meanDepthMilli / 1000),
+            (long)(pDepth->meanDepthMilli % 1000));
+        add("queueDepthMean", mean);
+        add("queueDepthPeak", std::to_string(pDepth->peakDepth));
+        add("queueDepthPolls", std::to_string(pDepth->polls));
+    }
+    return true; // success
+}
+
+bool cControlCommands::history(
+    std::string const & argument, std::string* pResponse)
+{
+    auto pHistorySink = _pDaemon->getHistorySink();
+    if (pHistorySink == nullptr)
+    {
+        *pResponse = "no history sink configured";
+        return false; // failure
+    }
+
+    // the columns of a csv sink, oldest first
+    std::vector<struct sSinkRecord> records;
+    pHistorySink->getRecords(argument, &records);
+    cCsvSink::appendHeader(pResponse);
+    for (auto const & record : records)
+        cCsvSink::appendRecord(record, pResponse);
+    return true; // success
+}
@@ -0,0 +1,37 @@
+// cControlCommands.hh
+#ifndef _CCONTROLCOMMANDS_H
+#define _CCONTROLCOMMANDS_H
+
+#include "../library/cStatComputer.hh"
+#include "cControlServer.hh"
+#include "cDaemon.hh"
+#include "cJsonWriter.hh"
+#include <string>
+
+/*
+The commands of the control socket.
+
+They run on the main loop like the sampling timer, sample, persist and
+reset through the daemon and report from its in-memory state, or from the
+live counters for metrics without touching the sampled state.
+*/
+class cControlCommands
+{
+    public:
+        cControlCommands(cDaemon* pDaemon, cJsonWriter* pWriter);
+        void addCommands(cControlServer* pServer);
+
+    private:
+        cDaemon* _pDaemon;
+        cJsonWriter* _pWriter;
+        cStatComputer _computer;
+
+        bool sample(std::string const & argument, std::string* pResponse);
+        bool flush(std::string const & argument, std::string* pResponse);
+        bool dump(std::string const & argument, std::string* pResponse);
+        bool reset(std::string const & argument, std::string* pResponse);
+        bool metrics(std::string const & argument, std::string* pResponse);
+        bool history(std::string const & argument, std::string* pResponse);
+};
+
+#endif /* _CCONTROLCOMMANDS_H */
@@ -0,0 +1,252 @@
+#include "cControlServer.hh"
+#include "../utils/log-event.hh"
+
+#include <errno.h>
+#include <glib-unix.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+constexpr int CONST_LISTEN_BACKLOG = 8;
+constexpr gsize CONST_MAX_CLIENTS = 16;
+// longest request line, a client sending more is disconnected
+constexpr gsize CONST_MAX_LINE_LENGTH = 1024;
+constexpr GIOCondition CONST_READ_CONDITION
+    = (GIOCondition)(G_IO_IN | G_IO_HUP);
+constexpr GIOCondition CONST_WRITE_CONDITION
+    = (GIOCondition)(G_IO_OUT | G_IO_HUP);
+
+// destructor
+
+cControlServer::~cControlServer() { close(); }
+
+// public functions
+
+bool cControlServer::open(std::string socketPath)
+{
+    struct sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path))
+    {
+        LOG_EVENT(LOG_ERR, "Control socket path too long [%s]\n",
+            socketPath.c_str());
+        return false; // failure
+    }
+    socketPath.copy(address.sun_path, socketPath.size());
+
+    _listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (_listenFd < 0)
+    {
+        LOG_EVENT(LOG_ERR, "Failed to create control socket, %s",
+            strerror(errno));
+        return false; // failure
+    }
+
+    // left behind if the daemon was killed
+    unlink(socketPath.c_str());
+    // only root may sample, flush or reset
+    mode_t previousMask = umask(0077);
+    int result = bind(_listenFd, (struct sockaddr*)&address, sizeof(address));
+    umask(previousMask);
+    if (result < 0 || listen(_listenFd, CONST_LISTEN_BACKLOG) < 0)
+    {
+        LOG_EVENT(LOG_ERR, "Failed to listen on [%s], %s", socketPath.c_str(),
+            strerror(errno));
+        ::close(_listenFd);
+        _listenFd = -1;
+        return false; // failure
+    }
+
+    _socketPath     = socketPath;
+    _listenSourceId = g_unix_fd_add(_listenFd, G_IO_IN, acceptCallback, this);
+    LOG_EVENT(LOG_INFO, "Listening on [%s]\n", socketPath.c_str());
+    return true; // success
+}
+
+void cControlServer::close(void)
+{
+    while (!_clients.empty())
+    {
+        closeClient(_clients.begin()->first);
+    }
+    if (_listenFd >= 0)
+    {
+        g_source_remove(_listenSourceId);
+        ::close(_listenFd);
+        unlink(_socketPath.c_str());
+        _listenFd = -1;
+    }
+}
+
+void cControlServer::addCommand(std::string name, tCommandHandler handler)
+{
+    _commands[name] = handler;
+}
+
+// private functions
+
+gboolean cControlServer::acceptCallback(
+    gint fd, GIOCondition condition, gpointer pUserData)
+{
+    auto pSelf = (cControlServer*)pUserData;
+
+    // non-blocking, responses are sent as the client reads them
+    int clientFd = accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (clientFd < 0)
+    {
+        return true; // keep listening
+    }
+    if (pSelf->_clients.size() >= CONST_MAX_CLIENTS)
+    {
+        LOG_EVENT(LOG_WARNING, "Too many control clients\n");
+        ::close(clientFd);
+        return true; // keep listening
+    }
+
+    pSelf->_clients[clientFd] = {};
+    pSelf->watchClient(clientFd, CONST_READ_CONDITION);
+    return true; // keep listening
+}
+
+gboolean cControlServer::clientCallback(
+    gint fd, GIOCondition condition, gpointer pUserData)
+{
+    auto pSelf = (cControlServer*)pUserData;
+    bool isOpen = condition & G_IO_OUT
+        ? pSelf->flushClient(fd) && pSelf->processInput(fd)
+        : pSelf->readClient(fd);
+    if (!isOpen)
+    {
+        pSelf->closeClient(fd);
+        return true; // already removed
+    }
+
+    // read the next requests once the response is sent
+    auto &client = pSelf->_clients[fd];
+    pSelf->watchClient(fd, client.output.empty()
+        ? CONST_READ_CONDITION : CONST_WRITE_CONDITION);
+    return true; // removed by watchClient() if replaced
+}
+
+bool cControlServer::readClient(int fd)
+{
+    char buffer[CONST_MAX_LINE_LENGTH];
+    ssize_t length = recv(fd, buffer, sizeof(buffer), 0);
+    if (length <= 0)
+    {
+        return length < 0 && errno == EAGAIN; // closed by the client
+    }
+
+    _clients[fd].input.append(buffer, length);
+    return processInput(fd);
+}
+
+bool cControlServer::processInput(int fd)
+{
+    auto &client = _clients[fd];
+    size_t end;
+    while (client.output.empty()
+        && (end = client.input.find('\n')) != std::string::npos)
+    {
+        auto line = client.input.substr(0, end);
+        client.input.erase(0, end + 1);
+        dispatch(fd, line);
+        if (!flushClient(fd))
+        {
+            return false; // failure
+        }
+    }
+    // a partial line, or lines waiting for the response to be read
+    return client.input.find('\n') != std::string::npos
+        || client.input.size() < CONST_MAX_LINE_LENGTH;
+}
+
+void cControlServer::dispatch(int fd, std::string line)
+{
+    if (!line.empty() && line.back() == '\r')
+    {
+        line.pop_back();
+    }
+
+    auto separator = line.find(' ');
+    auto name = line.substr(0, separator);
+    auto argument
+        = separator == std::string::npos ? "" : line.substr(separator + 1);
+
+    std::string response;
+    std::string header;
+    auto command = _commands.find(name);
+    if (command == _commands.end())
+    {
+        header = "ERR unknown command\n";
+    }
+    else if (!command->second(argument, &response))
+    {
+        header = "ERR " + response + "\n";
+        response.clear();
+    }
+    else
+    {
+        header = "OK " + std::to_string(response.size()) + "\n";
+    }
+
+    auto &client = _clients[fd];
+    client.output = std::move(header);
+    client.output.append(response);
+    client.outputOffset = 0;
+}
+
+bool cControlServer::flushClient(int fd)
+{
+    // as much as the socket takes, the rest waits for G_IO_OUT
+    auto &client = _clients[fd];
+    while (client.outputOffset < client.output.size())
+    {
+        ssize_t sent = send(fd, client.output.data() + client.outputOffset,
+            client.output.size() - client.outputOffset, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return errno == EAGAIN; // failure unless the socket is full
+        }
+        client.outputOffset += sent;
+    }
+    client.output.clear();
+    client.outputOffset = 0;
+    return true; // success
+}
+
+void cControlServer::watchClient(int fd, GIOCondition condition)
+{
+    auto &client = _clients[fd];
+    if (client.sourceId != 0 && client.condition == condition)
+    {
+        return;
+    }
+    if (client.sourceId != 0)
+    {
+        g_source_remove(client.sourceId);
+    }
+    client.condition = condition;
+    client.sourceId  = g_unix_fd_add(fd, condition, clientCallback, this);
+}
+
+void cControlServer::closeClient(int fd)
+{
+    auto client = _clients.find(fd);
+    if (client == _clients.end())
+    {
+        return;
+    }
+    if (client->second.sourceId != 0)
+    {
+        g_source_remove(client->second.sourceId);
+    }
+    ::close(fd);
+    _clients.erase(client);
+}
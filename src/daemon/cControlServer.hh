@@ -0,0 +1,61 @@
+// cControlServer.hh
+#ifndef _CCONTROLSERVER_H
+#define _CCONTROLSERVER_H
+
+#include <functional>
+#include <glib.h>
+#include <map>
+#include <string>
+
+/*
+Unix domain control socket.
+
+A request is one line, "<command> [argument]". The response is
+"OK <length>\n" followed by <length> bytes of payload, which may be binary,
+or "ERR <message>\n". A client may send any number of requests on one
+connection. Everything runs on the main loop, so handlers see the same
+state as the sampling timer. Clients are non-blocking: a response the client
+doesn't read yet is kept and sent as the socket drains, and the next request
+is only read once it is gone, so a slow client never holds the main loop.
+*/
+class cControlServer
+{
+    public:
+        // returns false to answer ERR with *pResponse as the message
+        using tCommandHandler = std::function<bool(
+            std::string const & argument, std::string* pResponse)>;
+
+        ~cControlServer();
+        bool open(std::string socketPath);
+        void close(void);
+        void addCommand(std::string name, tCommandHandler handler);
+
+    private:
+        struct sClient
+        {
+                guint sourceId;
+                GIOCondition condition; // watched by sourceId
+                std::string input; // requests not answered yet
+                std::string output; // response not sent yet
+                gsize outputOffset; // bytes of output already sent
+        };
+
+        std::string _socketPath;
+        int _listenFd         = -1;
+        guint _listenSourceId = 0;
+        std::map<std::string, tCommandHandler> _commands;
+        std::map<int, struct sClient> _clients;
+
+        static gboolean acceptCallback(
+            gint fd, GIOCondition condition, gpointer pUserData);
+        static gboolean clientCallback(
+            gint fd, GIOCondition condition, gpointer pUserData);
+        bool readClient(int fd);
+        bool processInput(int fd);
+        void dispatch(int fd, std::string line);
+        bool flushClient(int fd);
+        void watchClient(int fd, GIOCondition condition);
+        void closeClient(int fd);
+};
+
+#endif /* _CCONTROLSERVER_H */
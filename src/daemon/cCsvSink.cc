@@ -0,0 +1,113 @@
+#include "cCsvSink.hh"
+#include "../utils/log-event.hh"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+constexpr gint64 CONST_SECTOR_SIZE = 512;
+constexpr gsize CONST_LINE_SIZE    = 320;
+
+// constructor
+
+cCsvSink::cCsvSink(std::string filePath) : _filePath(filePath) {}
+
+// public functions
+
+bool cCsvSink::open(void)
+{
+    _fd = ::open(_filePath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+        0644);
+    struct stat fileStat;
+    if (_fd < 0 || fstat(_fd, &fileStat) != 0)
+    {
+        LOG_EVENT(LOG_ERR, "Unable to open [%s]: %s\n", _filePath.c_str(),
+            strerror(errno));
+        close();
+        return false; // failure
+    }
+    if (fileStat.st_size > 0)
+        return true; // success
+
+    _text.clear();
+    appendHeader(&_text);
+    return writeText();
+}
+
+bool cCsvSink::write(struct sSinkRecord const * pRecords, gsize count)
+{
+    _text.clear();
+    for (gsize i = 0; i < count; i++)
+        appendRecord(pRecords[i], &_text);
+    return writeText();
+}
+
+bool cCsvSink::flush(void)
+{
+    if (_fd < 0 || fdatasync(_fd) == 0)
+        return true; // success
+    LOG_EVENT(LOG_ERR, "Unable to sync [%s]: %s\n", _filePath.c_str(),
+        strerror(errno));
+    return false; // failure
+}
+
+void cCsvSink::close(void)
+{
+    if (_fd >= 0)
+        ::close(_fd);
+    _fd = -1;
+}
+
+void cCsvSink::appendHeader(std::string* pText)
+{
+    pText->append("realTime,deviceName,serialNumber,diskSeq,interval,"
+        "readIo,writeIo,discardIo,readBytes,writeBytes,discardBytes,"
+        "readAwaitUs,writeAwaitUs,averageRequestSize,ioTicks,inFlight\n");
+}
+
+void cCsvSink::appendRecord(
+    struct sSinkRecord const & record, std::string* pText)
+{
+    auto pSample = &record.sample;
+    auto pDelta  = &record.delta;
+    char line[CONST_LINE_SIZE];
+    auto length = snprintf(line, sizeof(line),
+        "%ld,%s,%s,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld\n",
+        (long)pSample->realTime, pSample->deviceName, pSample->serialNumber,
+        (long)pSample->diskSeq, (long)record.interval, (long)pDelta->readIo,
+        (long)pDelta->writeIo, (long)pDelta->discardIo,
+        (long)(pDelta->readSectors * CONST_SECTOR_SIZE),
+        (long)(pDelta->writeSectors * CONST_SECTOR_SIZE),
+        (long)(pDelta->discardSectors * CONST_SECTOR_SIZE),
+        (long)record.metrics.readAwaitUs, (long)record.metrics.writeAwaitUs,
+        (long)record.metrics.averageRequestSize, (long)pDelta->ioTicks,
+        (long)pDelta->inFlight);
+    if (length > 0)
+        pText->append(line, std::min((gsize)length, sizeof(line) - 1));
+}
+
+// private functions
+
+bool cCsvSink::writeText(void)
+{
+    gsize offset = 0;
+    while (offset < _text.size())
+    {
+        auto written = ::write(_fd, _text.data() + offset,
+            _text.size() - offset);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+        {
+            LOG_EVENT(LOG_ERR, "Unable to append to [%s]: %s\n",
+                _filePath.c_str(), strerror(errno));
+            return false; // failure
+        }
+        offset += written;
+    }
+    return true; // success
+}
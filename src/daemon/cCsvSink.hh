@@ -0,0 +1,35 @@
+// cCsvSink.hh
+#ifndef _CCSVSINK_H
+#define _CCSVSINK_H
+
+#include "cSink.hh"
+#include <glib.h>
+#include <string>
+
+/*
+Appends a line of comma separated values per record to a file, with a
+header line when the file is new. A batch is formatted into a reused buffer
+and appended with a single write.
+*/
+class cCsvSink : public cSink
+{
+    public:
+        explicit cCsvSink(std::string filePath);
+        bool open(void) override;
+        bool write(
+            struct sSinkRecord const * pRecords, gsize count) override;
+        bool flush(void) override;
+        void close(void) override;
+        static void appendHeader(std::string* pText);
+        static void appendRecord(
+            struct sSinkRecord const & record, std::string* pText);
+
+    private:
+        std::string _filePath;
+        std::string _text;
+        int _fd = -1;
+
+        bool writeText(void);
+};
+
+#endif /* _CCSVSINK_H */
@@ -0,0 +1,66 @@
+// cDaemon.hh
+#ifndef _CDAEMON_H
+#define _CDAEMON_H
+
+#include "../library/cStatReader.hh"
+#include "../library/include/structs.hh"
+#include "cHistorySink.hh"
+#include <glib.h>
+#include <string>
+#include <vector>
+
+/*
+The state and the sampling path of the daemon, as used by the commands
+which drive it from outside the main loop code.
+
+The daemon in main.cc implements it on top of its main loop. Everything is
+called on the thread of the main loop.
+*/
+class cDaemon
+{
+    public:
+        virtual ~cDaemon() = default;
+        // the monitored devices, in the order of the config
+        virtual std::vector<struct sDeviceEntry*> getDevices(void) = 0;
+        // the reader of the samples, sysfs unless replaying
+        virtual cStatReader* getSampleReader(void) = 0;
+        // g_get_monotonic_time(), or the virtual clock of a replay
+        virtual gint64 getMonotonicTime(void) = 0;
+        // scans the writing processes and cgroups
+        virtual void sampleWriters(void) = 0;
+        virtual void sampleDevices(void) = 0;
+        virtual void persist(bool force) = 0;
+        // the window of the metrics starts from the live counters
+        virtual bool resetWindow(struct sDeviceEntry* pDevice) = 0;
+        virtual bool isSamplingQueueDepth(void) = 0;
+        // nullptr without a history sink
+        virtual cHistorySink* getHistorySink(void) = 0;
+
+        // replays sample from pReader on a clock which starts at seconds
+        // and only moves with setVirtualTime()
+        virtual void startVirtualClock(cStatReader* pReader, gint64 seconds) = 0;
+        virtual void setVirtualTime(gint64 seconds) = 0;
+        // the stats files, the intervals and the sinks of the config
+        virtual bool loadVirtualConfig(void) = 0;
+        // monitored from now on, restoreDevices() reads its stats file entry
+        virtual void addVirtualDevice(std::string const & devicePath,
+            std::string const & deviceName,
+            std::string const & serialNumber) = 0;
+        // no longer monitored, nor a device of the config
+        virtual void removeDevice(std::string const & devicePath) = 0;
+        // false if the stats file can't be read
+        virtual bool restoreDevices(
+            std::vector<std::string> const & devicePaths) = 0;
+        virtual std::string const & getStatsFilePath(void) = 0;
+        // puts every device on the timer wheel, at its aligned deadline
+        virtual void scheduleSampling(void) = 0;
+        // samples a device added since and puts it on the timer wheel
+        virtual void startSampling(std::string const & devicePath,
+            gint64 now) = 0;
+        virtual bool getNextDeadline(gint64* pDeadline) = 0;
+        virtual void sampleDueDevices(gint64 deadline) = 0;
+        // flushes the sinks and stops their threads
+        virtual void stopSinks(void) = 0;
+};
+
+#endif /* _CDAEMON_H */
@@ -0,0 +1,118 @@
+#include "cEventBus.hh"
+#include "../utils/log-event.hh"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// constructor and destructor
+
+cEventBus::cEventBus(gsize capacity)
+{
+    gsize size = 2;
+    while (size < capacity)
+        size *= 2;
+    _pSlots = std::make_unique<struct sSlot[]>(size);
+    _mask   = size - 1;
+    for (gsize i = 0; i < size; i++)
+        _pSlots[i].sequence.store(i, std::memory_order_relaxed);
+
+    _eventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (_eventFd < 0)
+        LOG_EVENT(LOG_ERR, "Failed to create eventfd, %s\n", strerror(errno));
+}
+
+cEventBus::~cEventBus()
+{
+    if (_eventFd >= 0)
+        close(_eventFd);
+}
+
+// public functions
+
+bool cEventBus::publish(struct sSampleEvent const & event)
+{
+    auto position = _head.load(std::memory_order_relaxed);
+    struct sSlot* pSlot;
+    while (true)
+    {
+        pSlot = &_pSlots[position & _mask];
+        auto sequence = pSlot->sequence.load(std::memory_order_acquire);
+        auto difference = (gint64)(sequence - position);
+        if (difference == 0)
+        {
+            // the slot is free, claim it unless another publisher did
+            if (_head.compare_exchange_weak(
+                    position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (difference < 0)
+        {
+            // not consumed yet since the last lap
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return false; // full
+        }
+        else
+        {
+            position = _head.load(std::memory_order_relaxed);
+        }
+    }
+    pSlot->event = event;
+    pSlot->sequence.store(position + 1, std::memory_order_release);
+
+    // pairs with the fence of wait(), either it sees the event or we see it
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_isWaiting.load(std::memory_order_relaxed))
+        wake();
+    return true; // success
+}
+
+bool cEventBus::consume(struct sSampleEvent* pEvent)
+{
+    auto pSlot = &_pSlots[_tail & _mask];
+    if (pSlot->sequence.load(std::memory_order_acquire) != _tail + 1)
+        return false; // empty
+
+    *pEvent = pSlot->event;
+    pSlot->sequence.store(_tail + _mask + 1, std::memory_order_release);
+    _tail++;
+    return true; // success
+}
+
+void cEventBus::wait(gint64 timeoutMilliseconds)
+{
+    _isWaiting.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto pSlot = &_pSlots[_tail & _mask];
+    if (pSlot->sequence.load(std::memory_order_acquire) == _tail + 1
+        || _eventFd < 0)
+    {
+        _isWaiting.store(false, std::memory_order_relaxed);
+        return;
+    }
+
+    struct pollfd pollFd = { .fd = _eventFd, .events = POLLIN, .revents = 0 };
+    if (poll(&pollFd, 1, timeoutMilliseconds) > 0)
+    {
+        guint64 count;
+        if (read(_eventFd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+            LOG_EVENT(LOG_ERR, "Failed to read eventfd, %s\n",
+                strerror(errno));
+    }
+    _isWaiting.store(false, std::memory_order_relaxed);
+}
+
+void cEventBus::wake(void)
+{
+    guint64 one = 1;
+    if (_eventFd >= 0 && write(_eventFd, &one, sizeof(one)) < 0
+        && errno != EAGAIN)
+        LOG_EVENT(LOG_ERR, "Failed to signal eventfd, %s\n", strerror(errno));
+}
+
+guint64 cEventBus::getDroppedCount(void) const
+{
+    return _dropped.load(std::memory_order_relaxed);
+}
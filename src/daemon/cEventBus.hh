@@ -0,0 +1,48 @@
+// cEventBus.hh
+#ifndef _CEVENTBUS_H
+#define _CEVENTBUS_H
+
+#include "cSink.hh"
+#include <atomic>
+#include <glib.h>
+#include <memory>
+
+/*
+A bounded lock-free ring of sample events, any number of threads publish
+and a single thread consumes.
+
+Publishers claim a slot with a compare and swap of the head and mark it
+ready through its sequence number, they never wait and never allocate: when
+the ring is full the event is dropped and counted. The consumer sleeps on
+an eventfd which publishers only signal while it is waiting.
+*/
+class cEventBus
+{
+    public:
+        // capacity is rounded up to a power of two
+        explicit cEventBus(gsize capacity);
+        ~cEventBus();
+        bool publish(struct sSampleEvent const & event);
+        // consumer side
+        bool consume(struct sSampleEvent* pEvent);
+        void wait(gint64 timeoutMilliseconds);
+        void wake(void);
+        guint64 getDroppedCount(void) const;
+
+    private:
+        struct sSlot
+        {
+                std::atomic<guint64> sequence;
+                struct sSampleEvent event;
+        };
+
+        std::unique_ptr<struct sSlot[]> _pSlots;
+        guint64 _mask;
+        alignas(64) std::atomic<guint64> _head{0}; // next slot to publish
+        alignas(64) guint64 _tail = 0;             // next slot to consume
+        std::atomic<bool> _isWaiting{false};
+        std::atomic<guint64> _dropped{0};
+        int _eventFd = -1;
+};
+
+#endif /* _CEVENTBUS_H */
@@ -0,0 +1,33 @@
+#include "cHistorySink.hh"
+
+// constructor
+
+cHistorySink::cHistorySink(gsize size) : _records(size > 0 ? size : 1) {}
+
+// public functions
+
+bool cHistorySink::write(struct sSinkRecord const * pRecords, gsize count)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (gsize i = 0; i < count; i++)
+    {
+        _records[_next] = pRecords[i];
+        _next = (_next + 1) % _records.size();
+        if (_count < _records.size())
+            _count++;
+    }
+    return true; // success
+}
+
+void cHistorySink::getRecords(std::string const & serialNumber,
+    std::vector<struct sSinkRecord>* pRecords)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto first = (_next + _records.size() - _count) % _records.size();
+    for (gsize i = 0; i < _count; i++)
+    {
+        auto pRecord = &_records[(first + i) % _records.size()];
+        if (serialNumber.empty() || serialNumber == pRecord->sample.serialNumber)
+            pRecords->push_back(*pRecord);
+    }
+}
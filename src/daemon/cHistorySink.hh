@@ -0,0 +1,33 @@
+// cHistorySink.hh
+#ifndef _CHISTORYSINK_H
+#define _CHISTORYSINK_H
+
+#include "cSink.hh"
+#include <glib.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+Keeps the latest records in memory, for the "history" command of the
+control socket. The ring is allocated once, the oldest record is replaced
+by the newest.
+*/
+class cHistorySink : public cSink
+{
+    public:
+        explicit cHistorySink(gsize size);
+        bool write(
+            struct sSinkRecord const * pRecords, gsize count) override;
+        // oldest first, of every device if serialNumber is empty
+        void getRecords(std::string const & serialNumber,
+            std::vector<struct sSinkRecord>* pRecords);
+
+    private:
+        std::mutex _mutex;
+        std::vector<struct sSinkRecord> _records;
+        gsize _next  = 0;
+        gsize _count = 0;
+};
+
+#endif /* _CHISTORYSINK_H */
@@ -0,0 +1,135 @@
+#include "cHookRunner.hh"
+#include "../utils/log-event.hh"
+
+#include <errno.h>
+#include <signal.h>
+#include <spawn.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+// destructor
+
+cHookRunner::~cHookRunner() { stop(); }
+
+// public functions
+
+void cHookRunner::setCommand(std::string command, gint64 intervalUs)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _command    = command;
+    _intervalUs = intervalUs;
+}
+
+bool cHookRunner::submit(std::vector<std::string> environment, gint64 now)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_command.empty() || _stopping)
+        return false; // not run
+
+    // rate limited, and a hook still waiting to start is not replaced
+    if (_pending
+        || (_lastSubmitTime != 0 && now - _lastSubmitTime < _intervalUs))
+    {
+        _suppressed++;
+        return false; // not run
+    }
+
+    environment.push_back("KK_SUPPRESSED=" + std::to_string(_suppressed));
+    _environment    = environment;
+    _suppressed     = 0;
+    _pending        = true;
+    _lastSubmitTime = now;
+
+    // started with the first hook, most configurations never run one
+    if (!_thread.joinable())
+        _thread = std::thread(&cHookRunner::run, this);
+    _wakeup.notify_one();
+    return true; // queued
+}
+
+void cHookRunner::stop(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wakeup.notify_one();
+
+    // a hook which is running or queued is waited for
+    if (_thread.joinable())
+        _thread.join();
+}
+
+// private functions
+
+void cHookRunner::run(void)
+{
+    // signals are left to the main loop
+    sigset_t signals;
+    sigfillset(&signals);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true)
+    {
+        _wakeup.wait(lock, [this] { return _pending || _stopping; });
+        // an event already queued still gets its hook
+        if (!_pending)
+            break;
+
+        auto command     = _command;
+        auto environment = std::move(_environment);
+        _pending         = false;
+
+        lock.unlock();
+        spawn(command, environment);
+        lock.lock();
+    }
+}
+
+void cHookRunner::spawn(
+    std::string command, std::vector<std::string> environment)
+{
+    // the inherited environment, then the event
+    std::vector<char*> envp;
+    for (char** ppVariable = environ; *ppVariable != nullptr; ppVariable++)
+        envp.push_back(*ppVariable);
+    for (auto &variable : environment)
+        envp.push_back(variable.data());
+    envp.push_back(nullptr);
+
+    // the blocked mask of this thread must not leak into the hook
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    sigset_t signals;
+    sigemptyset(&signals);
+    posix_spawnattr_setsigmask(&attributes, &signals);
+    sigfillset(&signals);
+    posix_spawnattr_setsigdefault(&attributes, &signals);
+    posix_spawnattr_setflags(
+        &attributes, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+    const char* pArguments[] = { "/bin/sh", "-c", command.c_str(), nullptr };
+    pid_t pid = 0;
+    int error = posix_spawn(&pid, pArguments[0], nullptr, &attributes,
+        (char* const*)pArguments, envp.data());
+    posix_spawnattr_destroy(&attributes);
+    if (error != 0)
+    {
+        LOG_EVENT(LOG_ERR, "Unable to run hook [%s]: %s\n", command.c_str(),
+            strerror(error));
+        return;
+    }
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+        ;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        LOG_EVENT(LOG_WARNING, "Hook [%s] failed with status %d\n",
+            command.c_str(), status);
+    }
+}
@@ -0,0 +1,44 @@
+// cHookRunner.hh
+#ifndef _CHOOKRUNNER_H
+#define _CHOOKRUNNER_H
+
+#include <condition_variable>
+#include <glib.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+Runs a shell command for events raised on the main loop.
+
+The command runs on a thread of its own, so a slow or hanging hook never
+delays sampling. At most one event waits while a hook is running, and a
+hook starts at most once per interval: events arriving in between are
+counted and the count is passed to the next run as KK_SUPPRESSED.
+*/
+class cHookRunner
+{
+    public:
+        ~cHookRunner();
+        void setCommand(std::string command, gint64 intervalUs);
+        // KEY=value pairs added to the environment of the command
+        bool submit(std::vector<std::string> environment, gint64 now);
+        void stop(void);
+
+    private:
+        std::mutex _mutex;
+        std::condition_variable _wakeup;
+        std::thread _thread;
+        std::string _command;
+        gint64 _intervalUs     = 0;
+        gint64 _lastSubmitTime = 0;
+        bool _pending          = false;
+        bool _stopping         = false;
+        guint64 _suppressed    = 0;
+        std::vector<std::string> _environment;
+        void run(void);
+        void spawn(std::string command, std::vector<std::string> environment);
+};
+
+#endif /* _CHOOKRUNNER_H */
@@ -29,6 +29,30 @@ bool cJsonParser::openJson(std::string jsonPath)
     return true; // success
 }
 
+bool cJsonParser::openJsonData(const gchar* pData, gsize length)
+{
+    if (_parserOpen)
+    {
+        LOG_EVENT(LOG_ERR, "JSON already open");
+        return false; // failure
+    };
+
+    GError* pError = nullptr;
+    _pJsonParser   = json_parser_new();
+
+    json_parser_load_from_data(_pJsonParser, pData, length, &pError);
+    if (pError)
+    {
+        LOG_EVENT(LOG_ERR, "Unable to parse data: %s\n", pError->message);
+        g_error_free(pError);
+        g_object_unref(_pJsonParser);
+        return false; // failure
+    }
+
+    _parserOpen = true;
+    return true; // success
+}
+
 bool cJsonParser::closeJson()
 {
     if (!_parserOpen)
@@ -66,17 +90,14 @@ bool cJsonParser::getDevicesArray(JsonReader* pReader, struct sJsonDevicesConfig
         return false; // failure
     }
 
-    json_array_foreach_element(
-        devicePathArray,
-        [](JsonArray* array, guint index_, JsonNode* element_node,
-            gpointer user_data)
-        {
-            auto config     = (struct sJsonDevicesConfig*)user_data;
-            auto devicePath = json_node_get_string(element_node);
-            if (devicePath != nullptr)
-                config->devices.emplace_back((std::string)devicePath);
-        },
-        pConfig);
+    for (guint i = 0; i < json_array_get_length(devicePathArray); i++)
+    {
+        json_reader_read_element(pReader, i);
+        struct sDeviceMatchConfig matcher = {};
+        if (getDeviceMatcher(pReader, &matcher))
+            pConfig->deviceMatchers.push_back(matcher);
+        json_reader_end_element(pReader);
+    }
     return true; // success
 }
 #else
@@ -107,15 +128,263 @@ bool cJsonParser::getDevicesArray(JsonReader* pReader, struct sJsonDevicesConfig
             return false; // failure
         }
 
-        auto devicePath = json_reader_get_string_value(pReader);
-        if (devicePath != nullptr)
-            pConfig->devices.emplace_back((std::string)devicePath);
+        struct sDeviceMatchConfig matcher = {};
+        if (getDeviceMatcher(pReader, &matcher))
+            pConfig->deviceMatchers.push_back(matcher);
         json_reader_end_element(pReader);
     }
     return true; // success
 }
 #endif
 
+bool cJsonParser::getDeviceMatcher(
+    JsonReader* pReader, struct sDeviceMatchConfig* pMatcher)
+{
+    constexpr std::string_view CONST_REGEX_PREFIX = "regex:";
+
+    // "/dev/sda", "/dev/mmcblk*" or "regex:^/dev/nvme[0-9]+n[0-9]+$"
+    if (json_reader_is_value(pReader))
+    {
+        auto pPattern = json_node_get_string(json_reader_get_value(pReader));
+        if (pPattern == nullptr)
+        {
+            LOG_EVENT(LOG_ERR, "Error parsing 'devices': not a string\n");
+            return false; // failure
+        }
+        pMatcher->pattern = pPattern;
+        if (pMatcher->pattern.starts_with(CONST_REGEX_PREFIX))
+        {
+            pMatcher->pattern.erase(0, CONST_REGEX_PREFIX.size());
+            pMatcher->isRegex = true;
+        }
+        return true; // success
+    }
+
+    // { "match": "/dev/sd*", "transport": "usb", "removable": 1 }
+    if (!json_reader_is_object(pReader))
+    {
+        LOG_EVENT(LOG_ERR, "Error parsing 'devices': invalid entry\n");
+        return false; // failure
+    }
+
+    bool ret = true;
+    gchar** ppMembers = json_reader_list_members(pReader);
+    for (uint i = 0; ppMembers != nullptr && ppMembers[i] != nullptr; i++)
+    {
+        std::string name = ppMembers[i];
+        json_reader_read_member(pReader, name.c_str());
+        auto pNode = json_reader_get_value(pReader);
+        if (pNode == nullptr)
+        {
+            LOG_EVENT(LOG_ERR, "Error parsing 'devices': '%s' is not a "
+                "value\n", name.c_str());
+            json_reader_end_member(pReader);
+            ret = false; // failure
+            break;
+        }
+
+        // numbers and booleans are compared with sysfs as text
+        auto pString = json_node_get_string(pNode);
+        std::string value = pString != nullptr
+            ? (std::string)pString : std::to_string(json_node_get_int(pNode));
+        json_reader_end_member(pReader);
+
+        if (name == "match")
+        {
+            pMatcher->pattern = value;
+        }
+        else if (name == "regex")
+        {
+            pMatcher->pattern = value;
+            pMatcher->isRegex = true;
+        }
+        else if (name == "updateRate")
+        {
+            pMatcher->updateRate = json_node_get_int(pNode);
+        }
+        else
+        {
+            pMatcher->attributes.emplace_back(name, value);
+        }
+    }
+    g_strfreev(ppMembers);
+    return ret;
+}
+
+bool cJsonParser::getSinksArray(
+    JsonReader* pReader, struct sJsonDevicesConfig* pConfig)
+{
+    // optional, [{ "type": "csv", "path": "/var/log/kk.csv" }]
+    json_reader_read_member(pReader, "sinks");
+    if (json_reader_get_error(pReader) != nullptr)
+    {
+        json_reader_end_member(pReader);
+        return true; // no sinks
+    }
+    if (!json_reader_is_array(pReader))
+    {
+        LOG_EVENT(LOG_ERR, "Error parsing 'sinks': not an array\n");
+        json_reader_end_member(pReader);
+        return false; // failure
+    }
+
+    bool ret = true;
+    auto elementCount = json_reader_count_elements(pReader);
+    for (int i = 0; i < elementCount && ret; i++)
+    {
+        json_reader_read_element(pReader, i);
+        struct sSinkConfig sink = {};
+        ret = getSink(pReader, &sink);
+        if (ret)
+            pConfig->sinks.push_back(sink);
+        json_reader_end_element(pReader);
+    }
+    json_reader_end_member(pReader);
+    return ret;
+}
+
+bool cJsonParser::getSink(JsonReader* pReader, struct sSinkConfig* pSink)
+{
+    if (!json_reader_is_object(pReader))
+    {
+        LOG_EVENT(LOG_ERR, "Error parsing 'sinks': invalid entry\n");
+        return false; // failure
+    }
+
+    bool ret = true;
+    gchar** ppMembers = json_reader_list_members(pReader);
+    for (uint i = 0; ppMembers != nullptr && ppMembers[i] != nullptr; i++)
+    {
+        std::string name = ppMembers[i];
+        json_reader_read_member(pReader, name.c_str());
+        auto pNode = json_reader_get_value(pReader);
+        json_reader_end_member(pReader);
+        if (pNode == nullptr)
+        {
+            LOG_EVENT(LOG_ERR, "Error parsing 'sinks': '%s' is not a "
+                "value\n", name.c_str());
+            ret = false; // failure
+            break;
+        }
+
+        auto pString = json_node_get_string(pNode);
+        if (name == "type" || name == "path" || name == "overflow"
+            || name == "options")
+        {
+            if (pString == nullptr)
+            {
+                LOG_EVENT(LOG_ERR, "Error parsing 'sinks': '%s' is not a "
+                    "string\n", name.c_str());
+                ret = false; // failure
+                break;
+            }
+            auto pValue = name == "type" ? &pSink->type
+                : name == "path" ? &pSink->path
+                : name == "options" ? &pSink->options : &pSink->overflow;
+            *pValue = pString;
+        }
+        else if (name == "batchSize")
+            pSink->batchSize = json_node_get_int(pNode);
+        else if (name == "maxDelay")
+            pSink->maxDelay = json_node_get_int(pNode);
+        else if (name == "queueSize")
+            pSink->queueSize = json_node_get_int(pNode);
+        else if (name == "size")
+            pSink->size = json_node_get_int(pNode);
+        else
+            LOG_EVENT(LOG_WARNING, "Ignoring unknown sink member '%s'\n",
+                name.c_str());
+    }
+    g_strfreev(ppMembers);
+    return ret;
+}
+
+bool cJsonParser::getPluginsArray(
+    JsonReader* pReader, struct sJsonDevicesConfig* pConfig)
+{
+    // optional, ["/usr/lib/KrillKounter/telemetry.so"], sinks with defaults
+    json_reader_read_member(pReader, "plugins");
+    if (json_reader_get_error(pReader) != nullptr)
+    {
+        json_reader_end_member(pReader);
+        return true; // no plugins
+    }
+    if (!json_reader_is_array(pReader))
+    {
+        LOG_EVENT(LOG_ERR, "Error parsing 'plugins': not an array\n");
+        json_reader_end_member(pReader);
+        return false; // failure
+    }
+
+    bool ret = true;
+    auto elementCount = json_reader_count_elements(pReader);
+    for (int i = 0; i < elementCount && ret; i++)
+    {
+        json_reader_read_element(pReader, i);
+        auto pPath = json_reader_get_string_value(pReader);
+        if (pPath == nullptr)
+        {
+            LOG_EVENT(LOG_ERR, "Error parsing 'plugins': not a string\n");
+            ret = false; // failure
+        }
+        else
+        {
+            pConfig->sinks.push_back({ .type = "plugin", .path = pPath });
+        }
+        json_reader_end_element(pReader);
+    }
+    json_reader_end_member(pReader);
+    return ret;
+}
+
+bool cJsonParser::getDeviceEntries(
+    std::vector<struct sJsonDeviceEntry>* pDevices, guint* pSkipped)
+{
+    // get all device references
+    std::vector<std::string> serialNumbers;
+    if (!getSerialNumbers(&serialNumbers))
+    {
+        LOG_EVENT(LOG_ERR, "Unable to parse device references from file");
+        return false; // failure
+    }
+
+    // build sJsonDeviceEntry for each device in json file, add to pDevices
+    guint skipped = 0;
+    for (uint i = 0; i < serialNumbers.size(); i++)
+    {
+        struct sJsonDeviceEntry device;
+        bool error = false;
+
+        device.serialNumber = serialNumbers[i];
+        error |= !getFirstSightingDate(device.serialNumber, &device.firstSightingDate);
+        error |= !getPath(device.serialNumber, &device.previousPath);
+        error |= !getStats(device.serialNumber, &device.stats);
+        error |= !getDiskSeq(device.serialNumber, &device.diskSeq);
+        error |= !getTotalBytesWritten(
+            device.serialNumber, &device.totalBytesWritten);
+        error |= !getSelfBytesWritten(
+            device.serialNumber, &device.selfBytesWritten);
+        error |= !getHistograms(device.serialNumber, &device.histograms);
+        error |= !getTopWriters(device.serialNumber, &device.topWriters);
+        error |= !getCgroupIo(device.serialNumber, &device.cgroupIo);
+        error |= !getAnomalies(device.serialNumber, &device.anomalies);
+        error |= !getLastSeenTime(device.serialNumber, &device.lastSeenTime);
+
+        if (error)
+        {
+            LOG_EVENT(LOG_ERR, "Unable to parse serial number: %s\n",
+                serialNumbers[i].c_str());
+            skipped++;
+            continue;
+        }
+        pDevices->push_back(std::move(device));
+    }
+
+    if (pSkipped != nullptr)
+        *pSkipped = skipped;
+    return true; // success
+}
+
 bool cJsonParser::getConfig(struct sJsonDevicesConfig* pConfig)
 {
     GError* pError      = nullptr;
@@ -149,6 +418,36 @@ bool cJsonParser::getConfig(struct sJsonDevicesConfig* pConfig)
     // Optional members
     getValueAsInt(pReader, "updateRate", &pConfig->updateRate);
     getValueAsString(pReader, "statsFilePath", &pConfig->statsFilePath);
+    getValueAsInt(pReader, "sampleInterval", &pConfig->sampleInterval);
+    getValueAsInt(pReader, "persistInterval", &pConfig->persistInterval);
+    getValueAsInt(pReader, "persistDeltaBytes", &pConfig->persistDeltaBytes);
+    getValueAsInt(pReader, "selfWriteSlackBytes",
+        &pConfig->selfWriteSlackBytes);
+    getValueAsInt(pReader, "topWriters", &pConfig->topWriters);
+    gint64 cgroupStats = 0;
+    getValueAsInt(pReader, "cgroupStats", &cgroupStats);
+    pConfig->cgroupStats = cgroupStats != 0;
+    getValueAsString(pReader, "controlSocketPath",
+        &pConfig->controlSocketPath);
+    getValueAsString(pReader, "volatileStatsFilePath",
+        &pConfig->volatileStatsFilePath);
+    getValueAsInt(pReader, "anomalyThreshold", &pConfig->anomalyThreshold);
+    getValueAsString(pReader, "anomalyHook", &pConfig->anomalyHook);
+    getValueAsInt(pReader, "anomalyHookInterval",
+        &pConfig->anomalyHookInterval);
+    getValueAsInt(pReader, "statsFilePatches", &pConfig->statsFilePatches);
+    getValueAsInt(pReader, "retentionDays", &pConfig->retentionDays);
+    getValueAsInt(pReader, "retentionMaxSerials",
+        &pConfig->retentionMaxSerials);
+    getValueAsString(pReader, "archiveFilePath", &pConfig->archiveFilePath);
+    getValueAsInt(pReader, "queueDepthInterval",
+        &pConfig->queueDepthInterval);
+    if (!getSinksArray(pReader, pConfig)
+        || !getPluginsArray(pReader, pConfig))
+    {
+        g_object_unref(pReader);
+        return false; // failure
+    }
 
     g_object_unref(pReader);
     return true; // success
@@ -205,6 +504,108 @@ bool cJsonParser::getTotalBytesWritten(std::string serialNumber, gint64 *pValue)
     return true; // success
 }
 
+bool cJsonParser::getSelfBytesWritten(std::string serialNumber, gint64 *pValue)
+{
+    GError* pError      = nullptr;
+    JsonReader* pReader = json_reader_new(json_parser_get_root(_pJsonParser));
+    pError              = (GError*)json_reader_get_error(pReader);
+    if (pError)
+    {
+        LOG_EVENT(LOG_ERR, "Unable to parse file: %s\n", pError->message);
+        g_error_free(pError);
+        return false; // failure
+    }
+
+    json_reader_read_member(pReader, serialNumber.c_str());
+    pError = (GError*)json_reader_get_error(pReader);
+    if (pError)
+    {
+        LOG_EVENT(LOG_ERR, "Error parsing 'serialNumber': %s\n",
+            pError->message);
+        json_reader_end_member(pReader);
+        g_object_unref(pReader);
+        return false; // failure
+    }
+
+    // optional, older stats files don't have it
+    json_reader_read_member(pReader, "selfBytesWritten");
+    pError = (GError*)json_reader_get_error(pReader);
+    if (pError)
+    {
+        *pValue = 0;
+        json_reader_end_member(pReader);
+        g_object_unref(pReader);
+        return true; // success
+    }
+
+    auto output = json_reader_get_int_value(pReader);
+    pError = (GError*)json_reader_get_error(pReader);
+    if (pError)
+    {
+        LOG_EVENT(LOG_ERR, "Unable to parse 'selfBytesWritten': %s\n",
+            pError->message);
+        json_reader_end_member(pReader);
+        g_object_unref(pReader);
+        return false; // failure
+    }
+
+    *pValue = output;
+
+    g_object_unref(pReader);
+    return true; // success
+}
+
+bool cJsonParser::getLastSeenTime(std::string serialNumber, gint64 *pValue)
+{
+    GError* pError      = nullptr;
+    JsonReader* pReader = json_reader_new(json_parser_get_root(_pJsonParser));
+    pError              = (GError*)json_reader_get_error(pReader);
+    if (pError)
+    {
+        LOG_EVENT(LOG_ERR, "Unable to parse file: %s\n", pError->message);
+        g_error_free(pError);
+        return false; // failure
+    }
+
+    json_reader_read_member(pReader, serialNumber.c_str());
+    pError = (GError*)json_reader_get_error(pReader);
+    if (pError)
+    {
+        LOG_EVENT(LOG_ERR, "Error parsing 'serialNumber': %s\n",
+            pError->message);
+        json_reader_end_member(pReader);
+        g_object_unref(pReader);
+        return false; // failure
+    }
+
+    // optional, stats files from before retention don't have it
+    json_reader_read_member(pReader, "lastSeenTime");
+    pError = (GError*)json_reader_get_error(pReader);
+    if (pError)
+    {
+        *pValue = 0;
+        json_reader_end_member(pReader);
+        g_object_unref(pReader);
+        return true; // success
+    }
+
+    auto output = json_reader_get_int_value(pReader);
+    pError = (GError*)json_reader_get_error(pReader);
+    if (pError)
+    {
+        LOG_EVENT(LOG_ERR, "Unable to parse 'lastSeenTime': %s\n",
+            pError->message);
+        json_reader_end_member(pReader);
+        g_object_unref(pReader);
+        return false; // failure
+    }
+
+    *pValue = output;
+
+    g_object_unref(pReader);
+    return true; // success
+}
+
 bool cJsonParser::getDiskSeq(std::string serialNumber, gint64 *pValue)
 {
     GError* pError      = nullptr;
@@ -470,22 +871,257 @@ bool cJsonParser::getSerialNumbers(std::vector<std::string>* pValue)
         return false; // failure
     }
 
-    for (uint i = 0; i < (uint)json_reader_count_members(pReader); i++)
+    // listed once, the list is a copy of every member name
+    gchar** ppMembers = json_reader_list_members(pReader);
+    for (uint i = 0; ppMembers != nullptr && ppMembers[i] != nullptr; i++)
     {
-        pValue->push_back((std::string)json_reader_list_members(pReader)[i]);
+        std::string_view member = ppMembers[i];
+        if (member.starts_with(CONST_RESERVED_MEMBER_PREFIX))
+        {
+            continue;
+        }
+        pValue->emplace_back(member);
     }
 
+    g_strfreev(ppMembers);
     g_object_unref(pReader);
     return true; // success
 }
 
+bool cJsonParser::getHistograms(
+    std::string serialNumber, struct sDeviceHistograms* pHistograms)
+{
+    GError* pError      = nullptr;
+    JsonReader* pReader = json_reader_new(json_parser_get_root(_pJsonParser));
+    pError              = (GError*)json_reader_get_error(pReader);
+    if (pError)
+    {
+        LOG_EVENT(LOG_ERR, "Unable to parse file: %s\n", pError->message);
+        g_error_free(pError);
+        return false; // failure
+    }
+
+    json_reader_read_member(pReader, serialNumber.c_str());
+    pError = (GError*)json_reader_get_error(pReader);
+    if (pError)
+    {
+        LOG_EVENT(LOG_ERR, "Error parsing 'serialNumber': %s\n",
+            pError->message);
+        json_reader_end_member(pReader);
+        g_object_unref(pReader);
+        return false; // failure
+    }
+
+    // histograms are optional, older stats files don't have them
+    json_reader_read_member(pReader, "histograms");
+    pError = (GError*)json_reader_get_error(pReader);
+    if (pError)
+    {
+        LOG_EVENT(LOG_DEBUG, "No histograms for [%s]\n",
+            serialNumber.c_str());
+        json_reader_end_member(pReader);
+        g_object_unref(pReader);
+        return true; // success
+    }
+
+    int numErrors = 0;
+    if (!getHistogram(pReader, "readAwait", &pHistograms->readAwait))
+    {
+        numErrors++;
+    }
+    if (!getHistogram(pReader, "writeAwait", &pHistograms->writeAwait))
+    {
+        numErrors++;
+    }
+    if (!getHistogram(pReader, "requestSize", &pHistograms->requestSize))
+    {
+        numErrors++;
+    }
+    // only written once the queue depth has been polled
+    json_reader_read_member(pReader, "queueDepth");
+    bool hasQueueDepth = json_reader_get_error(pReader) == nullptr;
+    json_reader_end_member(pReader);
+    if (hasQueueDepth
+        && !getHistogram(pReader, "queueDepth", &pHistograms->queueDepth))
+    {
+        numErrors++;
+    }
+
+    g_object_unref(pReader);
+    return numErrors > 0 ? false : true;
+}
+
+bool cJsonParser::getTopWriters(
+    std::string serialNumber, struct sTopWriters* pTopWriters)
+{
+    GError* pError      = nullptr;
+    JsonReader* pReader = json_reader_new(json_parser_get_root(_pJsonParser));
+    pError              = (GError*)json_reader_get_error(pReader);
+    if (pError)
+    {
+        LOG_EVENT(LOG_ERR, "Unable to parse file: %s\n", pError->message);
+        g_error_free(pError);
+        return false; // failure
+    }
+
+    json_reader_read_member(pReader, serialNumber.c_str());
+    pError = (GError*)json_reader_get_error(pReader);
+    if (pError)
+    {
+        LOG_EVENT(LOG_ERR, "Error parsing 'serialNumber': %s\n",
+            pError->message);
+        json_reader_end_member(pReader);
+        g_object_unref(pReader);
+        return false; // failure
+    }
+
+    // optional, only written once write attribution has run
+    json_reader_read_member(pReader, "topWriters");
+    pError = (GError*)json_reader_get_error(pReader);
+    if (pError)
+    {
+        json_reader_end_member(pReader);
+        g_object_unref(pReader);
+        return true; // success
+    }
+
+    int numErrors = 0;
+    if (!getValueAsString(pReader, "dayDate", &pTopWriters->dayDate))
+    {
+        numErrors++;
+    }
+    if (!getTopK(pReader, "interval", &pTopWriters->interval))
+    {
+        numErrors++;
+    }
+    if (!getTopK(pReader, "day", &pTopWriters->day))
+    {
+        numErrors++;
+    }
+
+    g_object_unref(pReader);
+    return numErrors > 0 ? false : true;
+}
+
+bool cJsonParser::getCgroupIo(std::string serialNumber,
+    std::map<std::string, struct sCgroupIo>* pCgroupIo)
+{
+    GError* pError      = nullptr;
+    JsonReader* pReader = json_reader_new(json_parser_get_root(_pJsonParser));
+    pError              = (GError*)json_reader_get_error(pReader);
+    if (pError)
+    {
+        LOG_EVENT(LOG_ERR, "Unable to parse file: %s\n", pError->message);
+        g_error_free(pError);
+        return false; // failure
+    }
+
+    json_reader_read_member(pReader, serialNumber.c_str());
+    pError = (GError*)json_reader_get_error(pReader);
+    if (pError)
+    {
+        LOG_EVENT(LOG_ERR, "Error parsing 'serialNumber': %s\n",
+            pError->message);
+        json_reader_end_member(pReader);
+        g_object_unref(pReader);
+        return false; // failure
+    }
+
+    // optional, only written once cgroups have been collected
+    json_reader_read_member(pReader, "cgroupIo");
+    pError = (GError*)json_reader_get_error(pReader);
+    if (pError)
+    {
+        json_reader_end_member(pReader);
+        g_object_unref(pReader);
+        return true; // success
+    }
+
+    gchar** ppMembers = json_reader_list_members(pReader);
+    int numErrors = 0;
+    for (int i = 0; ppMembers != nullptr && ppMembers[i] != nullptr; i++)
+    {
+        json_reader_read_member(pReader, ppMembers[i]);
+        gint64 rbytes = 0, wbytes = 0, rios = 0, wios = 0, dbytes = 0;
+        bool valid = getValueAsInt(pReader, "rbytes", &rbytes);
+        valid &= getValueAsInt(pReader, "wbytes", &wbytes);
+        valid &= getValueAsInt(pReader, "rios", &rios);
+        valid &= getValueAsInt(pReader, "wios", &wios);
+        valid &= getValueAsInt(pReader, "dbytes", &dbytes);
+        json_reader_end_member(pReader);
+
+        if (!valid)
+        {
+            numErrors++;
+            continue;
+        }
+        (*pCgroupIo)[ppMembers[i]] = { .rbytes = (guint64)rbytes,
+            .wbytes = (guint64)wbytes,
+            .rios   = (guint64)rios,
+            .wios   = (guint64)wios,
+            .dbytes = (guint64)dbytes };
+    }
+    g_strfreev(ppMembers);
+
+    g_object_unref(pReader);
+    return numErrors > 0 ? false : true;
+}
+
+bool cJsonParser::getAnomalies(
+    std::string serialNumber, struct sAnomalies* pAnomalies)
+{
+    *pAnomalies = {};
+
+    GError* pError      = nullptr;
+    JsonReader* pReader = json_reader_new(json_parser_get_root(_pJsonParser));
+    pError              = (GError*)json_reader_get_error(pReader);
+    if (pError)
+    {
+        LOG_EVENT(LOG_ERR, "Unable to parse file: %s\n", pError->message);
+        g_error_free(pError);
+        return false; // failure
+    }
+
+    json_reader_read_member(pReader, serialNumber.c_str());
+    pError = (GError*)json_reader_get_error(pReader);
+    if (pError)
+    {
+        LOG_EVENT(LOG_ERR, "Error parsing 'serialNumber': %s\n",
+            pError->message);
+        json_reader_end_member(pReader);
+        g_object_unref(pReader);
+        return false; // failure
+    }
+
+    // optional, only written once an anomaly has been detected
+    json_reader_read_member(pReader, "anomalies");
+    pError = (GError*)json_reader_get_error(pReader);
+    if (pError)
+    {
+        json_reader_end_member(pReader);
+        g_object_unref(pReader);
+        return true; // success
+    }
+
+    bool valid = getValueAsInt(pReader, "count", &pAnomalies->count);
+    valid &= getValueAsString(pReader, "lastTime", &pAnomalies->lastTime);
+    valid &= getValueAsString(pReader, "lastMetric", &pAnomalies->lastMetric);
+    valid &= getValueAsInt(pReader, "lastValue", &pAnomalies->lastValue);
+    valid &= getValueAsInt(pReader, "lastMean", &pAnomalies->lastMean);
+    valid &= getValueAsInt(
+        pReader, "lastDeviation", &pAnomalies->lastDeviation);
+
+    g_object_unref(pReader);
+    return valid;
+}
+
 // private function
 
 bool cJsonParser::getValueAsInt(
     JsonReader* pReader, std::string itemName, gint64* pValue)
 {
     json_reader_read_member(pReader, itemName.c_str());
-    int value = (int)json_reader_get_int_value(pReader);
+    gint64 value = json_reader_get_int_value(pReader);
 
     GError* pError = (GError*)json_reader_get_error(pReader);
     if (pError)
@@ -521,4 +1157,96 @@ bool cJsonParser::getValueAsString(
 
     json_reader_end_member(pReader);
     return true; // success
-}
\ No newline at end of file
+}
+
+bool cJsonParser::getHistogram(
+    JsonReader* pReader, std::string histogramName, cHistogram* pHistogram)
+{
+    pHistogram->reset();
+
+    json_reader_read_member(pReader, histogramName.c_str());
+    auto pError = (GError*)json_reader_get_error(pReader);
+    if (pError)
+    {
+        LOG_EVENT(LOG_ERR, "Unable to parse '%s': %s\n",
+            histogramName.c_str(), pError->message);
+        json_reader_end_member(pReader);
+        return false; // failure
+    }
+
+    json_reader_read_member(pReader, "buckets");
+    auto bucketCount = json_reader_count_elements(pReader);
+    for (int i = 0; i < bucketCount; i++)
+    {
+        // each bucket is an [index, count] pair
+        json_reader_read_element(pReader, i);
+        json_reader_read_element(pReader, 0);
+        auto index = json_reader_get_int_value(pReader);
+        bool valid = json_reader_get_error(pReader) == nullptr;
+        json_reader_end_element(pReader);
+        json_reader_read_element(pReader, 1);
+        auto count = json_reader_get_int_value(pReader);
+        valid &= json_reader_get_error(pReader) == nullptr;
+        json_reader_end_element(pReader);
+        json_reader_end_element(pReader);
+
+        if (!valid || !pHistogram->setBucket((guint)index, (guint64)count))
+        {
+            LOG_EVENT(LOG_ERR, "Invalid bucket in '%s'\n",
+                histogramName.c_str());
+            json_reader_end_member(pReader);
+            json_reader_end_member(pReader);
+            return false; // failure
+        }
+    }
+    json_reader_end_member(pReader);
+
+    json_reader_read_member(pReader, "max");
+    pHistogram->setMax((guint64)json_reader_get_int_value(pReader));
+    json_reader_end_member(pReader);
+
+    json_reader_end_member(pReader);
+    return true; // success
+}
+bool cJsonParser::getTopK(
+    JsonReader* pReader, std::string summaryName, cTopK* pTopK)
+{
+    // the configured size is applied by the caller
+    pTopK->setCapacity(cTopK::CONST_MAX_CAPACITY);
+    pTopK->reset();
+
+    json_reader_read_member(pReader, summaryName.c_str());
+    auto count = json_reader_count_elements(pReader);
+    auto pError = (GError*)json_reader_get_error(pReader);
+    if (pError)
+    {
+        LOG_EVENT(LOG_ERR, "Unable to parse '%s': %s\n",
+            summaryName.c_str(), pError->message);
+        json_reader_end_member(pReader);
+        return false; // failure
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        // each writer is a { name, bytes, error } object
+        json_reader_read_element(pReader, i);
+        std::string name;
+        gint64 bytes = 0;
+        gint64 error = 0;
+        bool valid = getValueAsString(pReader, "name", &name);
+        valid &= getValueAsInt(pReader, "bytes", &bytes);
+        valid &= getValueAsInt(pReader, "error", &error);
+        json_reader_end_element(pReader);
+
+        if (!valid || !pTopK->restore(name.c_str(), bytes, error))
+        {
+            LOG_EVENT(LOG_ERR, "Invalid writer in '%s'\n",
+                summaryName.c_str());
+            json_reader_end_member(pReader);
+            return false; // failure
+        }
+    }
+
+    json_reader_end_member(pReader);
+    return true; // success
+}
@@ -4,21 +4,39 @@
 
 #include "../library/include/structs.hh"
 #include <json-glib/json-glib.h>
+#include <map>
 #include <string>
 #include <vector>
 
+// top level members starting with this are not serial numbers
+constexpr std::string_view CONST_RESERVED_MEMBER_PREFIX = "_";
+
 class cJsonParser
 {
     public:
         bool openJson(std::string jsonPath);
+        bool openJsonData(const gchar* pData, gsize length);
         bool closeJson();
         bool getConfig(sJsonDevicesConfig* pConfig);
         bool getTotalBytesWritten(std::string serialNumber, gint64* pValue);
+        bool getSelfBytesWritten(std::string serialNumber, gint64* pValue);
+        bool getLastSeenTime(std::string serialNumber, gint64* pValue);
         bool getDiskSeq(std::string serialNumber, gint64* pValue);
         bool getStats(std::string serialNumber, struct sBlockStats* pStats);
         bool getPath(std::string serialNumber, std::string* pValue);
         bool getFirstSightingDate(std::string serialNumber, std::string* pValue);
         bool getSerialNumbers(std::vector<std::string>* pValue);
+        // entries which fail to parse are skipped and counted in pSkipped
+        bool getDeviceEntries(std::vector<struct sJsonDeviceEntry>* pDevices,
+            guint* pSkipped = nullptr);
+        bool getHistograms(
+            std::string serialNumber, struct sDeviceHistograms* pHistograms);
+        bool getTopWriters(
+            std::string serialNumber, struct sTopWriters* pTopWriters);
+        bool getCgroupIo(std::string serialNumber,
+            std::map<std::string, struct sCgroupIo>* pCgroupIo);
+        bool getAnomalies(
+            std::string serialNumber, struct sAnomalies* pAnomalies);
 
     private:
         bool getValueAsInt(
@@ -26,6 +44,17 @@ class cJsonParser
         bool getValueAsString(
             JsonReader* pReader, std::string itemName, std::string* pValue);
         bool getDevicesArray(JsonReader* pReader, sJsonDevicesConfig* pConfig);
+        bool getDeviceMatcher(
+            JsonReader* pReader, struct sDeviceMatchConfig* pMatcher);
+        bool getSinksArray(
+            JsonReader* pReader, struct sJsonDevicesConfig* pConfig);
+        bool getSink(JsonReader* pReader, struct sSinkConfig* pSink);
+        bool getPluginsArray(
+            JsonReader* pReader, struct sJsonDevicesConfig* pConfig);
+        bool getHistogram(JsonReader* pReader, std::string histogramName,
+            cHistogram* pHistogram);
+        bool getTopK(
+            JsonReader* pReader, std::string summaryName, cTopK* pTopK);
         JsonParser* _pJsonParser;
         int _parserOpen = false;
 };
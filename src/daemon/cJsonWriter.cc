@@ -2,31 +2,40 @@
 
 #include "../utils/log-event.hh"
 #include "cJsonParser.hh"
-#include <fstream>
+#include "cStatsPatcher.hh"
+#include <unistd.h>
 
-// constructor
+// constructor and destructor
 
 cJsonWriter::cJsonWriter() { _pJsonBuilder = json_builder_new(); }
 
+cJsonWriter::~cJsonWriter() { g_object_unref(_pJsonBuilder); }
+
 // public functions
 
-bool cJsonWriter::writeJson(std::string jsonPathInput,
-    std::string jsonPathOutput, std::string serialNumber,
-    std::string firstSightingDate, std::string previousPath,
-    struct sBlockStats* pStats, gint64 diskSeq, gint64 totalBytesWritten)
+bool cJsonWriter::writeJson(std::string const & jsonPathInput,
+    std::string const & jsonPathOutput, std::string const & serialNumber,
+    std::string const & firstSightingDate, std::string const & previousPath,
+    struct sBlockStats* pStats, gint64 diskSeq, gint64 totalBytesWritten,
+    gint64 selfBytesWritten, gint64 lastSeenTime,
+    struct sDeviceHistograms* pHistograms, struct sTopWriters* pTopWriters,
+    std::map<std::string, struct sCgroupIo>* pCgroupIo,
+    struct sAnomalies* pAnomalies)
 {
     json_builder_begin_object(_pJsonBuilder);
 
     // does file already exist
-    std::ifstream f(jsonPathInput.c_str());
-    if (f.good())
+    if (access(jsonPathInput.c_str(), R_OK) == 0)
     {
         // load existing data
         std::vector<struct sJsonDeviceEntry> devices;
+        cPhaseTimer parseTimer(_pSelfStats, cSelfStats::PHASE_JSON_PARSE);
         if (!readExistingJson(jsonPathInput, &devices))
         {
             LOG_EVENT(LOG_ERR, "Unable to read existing json file: %s\n",
                 jsonPathInput.c_str());
+            // the next write would otherwise start inside this object
+            json_builder_reset(_pJsonBuilder);
             return false; // failure
         }
 
@@ -35,10 +44,12 @@ bool cJsonWriter::writeJson(std::string jsonPathInput,
         {
             addEntryToBuilder(devices[i].serialNumber,
                 devices[i].firstSightingDate, devices[i].previousPath,
-                &(devices[i].stats), devices[i].diskSeq, devices[i].totalBytesWritten);
+                &(devices[i].stats), devices[i].diskSeq,
+                devices[i].totalBytesWritten, devices[i].selfBytesWritten,
+                devices[i].lastSeenTime, &(devices[i].histograms),
+                &(devices[i].topWriters), &(devices[i].cgroupIo),
+                &(devices[i].anomalies));
         }
-
-        f.close();
     }
 
     /*
@@ -48,8 +59,15 @@ bool cJsonWriter::writeJson(std::string jsonPathInput,
     via addEntryToBuilder() above, then the values for that entry will be
     overwritten here before any json is generated or written back to disk.
     */
+    cPhaseTimer serialiseTimer(_pSelfStats, cSelfStats::PHASE_SERIALISE);
     addEntryToBuilder(serialNumber, firstSightingDate, previousPath, pStats,
-        diskSeq, totalBytesWritten);
+        diskSeq, totalBytesWritten, selfBytesWritten, lastSeenTime,
+        pHistograms, pTopWriters, pCgroupIo, pAnomalies);
+
+    if (_pSelfStats && _pSelfStats->isEnabled())
+    {
+        addSelfStatsToBuilder();
+    }
 
     json_builder_end_object(_pJsonBuilder);
 
@@ -61,34 +79,151 @@ bool cJsonWriter::writeJson(std::string jsonPathInput,
     if (pRoot == nullptr)
     {
         LOG_EVENT(LOG_ERR, "Unable to get root of _pJsonBuilder");
+        g_object_unref(pGen);
+        json_builder_reset(_pJsonBuilder);
         return false; // failure
     }
     json_generator_set_root(pGen, pRoot);
 
+    gsize length = 0;
+    gchar* pData = json_generator_to_data(pGen, &length);
+    json_node_unref(pRoot);
+    g_object_unref(pGen);
+    json_builder_reset(_pJsonBuilder);
+    serialiseTimer.stop();
+
     // write json string to file
+    cPhaseTimer writeTimer(_pSelfStats, cSelfStats::PHASE_FILE_WRITE);
     GError* pError = nullptr;
-    json_generator_to_file(pGen, jsonPathOutput.c_str(), &pError);
+    if (_fixedWidth)
+    {
+        cStatsPatcher::padFields(std::string_view(pData, length), &_paddedJson);
+        g_file_set_contents(jsonPathOutput.c_str(), _paddedJson.data(),
+            _paddedJson.size(), &pError);
+    }
+    else
+    {
+        g_file_set_contents(jsonPathOutput.c_str(), pData, length, &pError);
+    }
+    g_free(pData);
     if (pError)
     {
         LOG_EVENT(LOG_ERR, "Unable to write json to file [%s]: %s\n",
             jsonPathOutput.c_str(), pError->message);
         g_error_free(pError);
+        return false; // failure
+    }
+
+    return true; // success
+}
+
+bool cJsonWriter::writeJsonString(
+    std::vector<struct sDeviceEntry*> const & devices, std::string* pOutput)
+{
+    // same schema as the stats file, from memory only
+    json_builder_begin_object(_pJsonBuilder);
+    for (auto pDevice : devices)
+    {
+        addEntryToBuilder(pDevice->serialNumber, pDevice->firstSightingDate,
+            pDevice->devicePath, &pDevice->outputStats, pDevice->diskSeq,
+            pDevice->totalBytesWritten, pDevice->selfBytesWritten,
+            pDevice->lastSeenTime, &pDevice->histograms,
+            &pDevice->topWriters, &pDevice->cgroupIo, &pDevice->anomalies);
+    }
+    json_builder_end_object(_pJsonBuilder);
+    return generateString(pOutput);
+}
+
+bool cJsonWriter::writeJsonEntries(
+    std::vector<struct sJsonDeviceEntry>& devices, std::string* pOutput)
+{
+    json_builder_begin_object(_pJsonBuilder);
+    for (auto &device : devices)
+    {
+        addEntryToBuilder(device.serialNumber, device.firstSightingDate,
+            device.previousPath, &device.stats, device.diskSeq,
+            device.totalBytesWritten, device.selfBytesWritten,
+            device.lastSeenTime, &device.histograms, &device.topWriters,
+            &device.cgroupIo, &device.anomalies);
+    }
+    json_builder_end_object(_pJsonBuilder);
+    return generateString(pOutput);
+}
+
+// private functions
+
+bool cJsonWriter::generateString(std::string* pOutput)
+{
+    JsonGenerator* pGen = json_generator_new();
+    json_generator_set_pretty(pGen, true);
+    json_generator_set_indent(pGen, _indentLevel);
+    JsonNode* pRoot = json_builder_get_root(_pJsonBuilder);
+    if (pRoot == nullptr)
+    {
+        LOG_EVENT(LOG_ERR, "Unable to get root of _pJsonBuilder");
         g_object_unref(pGen);
         json_builder_reset(_pJsonBuilder);
         return false; // failure
     }
+    json_generator_set_root(pGen, pRoot);
 
-    // tidy up
+    gsize length = 0;
+    gchar* pData = json_generator_to_data(pGen, &length);
+    pOutput->assign(pData, length);
+    g_free(pData);
+    json_node_unref(pRoot);
     g_object_unref(pGen);
     json_builder_reset(_pJsonBuilder);
-
     return true; // success
 }
 
-// private functions
+void cJsonWriter::addSelfStatsToBuilder(void)
+{
+    json_builder_set_member_name(
+        _pJsonBuilder, CONST_SELF_STATS_MEMBER.data());
+    json_builder_begin_object(_pJsonBuilder);
+
+    gint64 rssBytes = 0;
+    gint64 openFds  = 0;
+    if (_pSelfStats->getResourceUsage(&rssBytes, &openFds))
+    {
+        json_builder_set_member_name(_pJsonBuilder, "rssBytes");
+        json_builder_add_int_value(_pJsonBuilder, rssBytes);
+        json_builder_set_member_name(_pJsonBuilder, "openFds");
+        json_builder_add_int_value(_pJsonBuilder, openFds);
+    }
+    json_builder_set_member_name(_pJsonBuilder, "droppedLogMessages");
+    json_builder_add_int_value(_pJsonBuilder, LogEventGetDropped());
+
+    // - phase latencies in microseconds
+    json_builder_set_member_name(_pJsonBuilder, "phases");
+    json_builder_begin_object(_pJsonBuilder);
+    for (int i = 0; i < cSelfStats::PHASE_COUNT; i++)
+    {
+        auto phase      = (cSelfStats::ePhase)i;
+        auto pHistogram = _pSelfStats->getHistogram(phase);
+        json_builder_set_member_name(
+            _pJsonBuilder, cSelfStats::getPhaseName(phase));
+        json_builder_begin_object(_pJsonBuilder);
+        json_builder_set_member_name(_pJsonBuilder, "count");
+        json_builder_add_int_value(_pJsonBuilder, pHistogram->getCount());
+        json_builder_set_member_name(_pJsonBuilder, "p50Us");
+        json_builder_add_int_value(
+            _pJsonBuilder, pHistogram->getValueAtPercentile(50.0));
+        json_builder_set_member_name(_pJsonBuilder, "p99Us");
+        json_builder_add_int_value(
+            _pJsonBuilder, pHistogram->getValueAtPercentile(99.0));
+        json_builder_set_member_name(_pJsonBuilder, "maxUs");
+        json_builder_add_int_value(_pJsonBuilder, pHistogram->getMax());
+        json_builder_end_object(_pJsonBuilder);
+    }
+    json_builder_end_object(_pJsonBuilder);
+
+    json_builder_end_object(_pJsonBuilder);
+}
 
 bool cJsonWriter::readExistingJson(
-    std::string jsonPath, std::vector<struct sJsonDeviceEntry>* pDevices)
+    std::string const & jsonPath, std::vector<struct sJsonDeviceEntry>* pDevices)
 {
     // open file
     cJsonParser parser;
@@ -98,45 +233,24 @@ bool cJsonWriter::readExistingJson(
         return false; // failure
     }
 
-    // get all device references
-    std::vector<std::string> serialNumbers;
-    if (!parser.getSerialNumbers(&serialNumbers))
+    if (!parser.getDeviceEntries(pDevices))
     {
-        LOG_EVENT(LOG_ERR, "Unable to parse device references from file");
+        parser.closeJson();
         return false; // failure
     }
 
-    // build sJsonDeviceEntry for each device in json file, add to pDevices
-    for (uint i = 0; i < serialNumbers.size(); i++)
-    {
-        struct sJsonDeviceEntry device;
-        bool error = false;
-
-        device.serialNumber = serialNumbers[i];
-        error |= !parser.getFirstSightingDate(device.serialNumber, &device.firstSightingDate);
-        error |= !parser.getPath(device.serialNumber, &device.previousPath);
-        error |= !parser.getStats(device.serialNumber, &device.stats);
-        error |= !parser.getDiskSeq(device.serialNumber, &device.diskSeq);
-        error |= !parser.getTotalBytesWritten(
-            device.serialNumber, &device.totalBytesWritten);
-
-        if (error)
-        {
-            LOG_EVENT(LOG_ERR, "Unable to parse serial number: %s\n",
-                serialNumbers[i].c_str());
-            break;
-        }
-        pDevices->push_back(device);
-    }
-
     parser.closeJson();
 
     return true; // success
 }
 
-void cJsonWriter::addEntryToBuilder(std::string serialNumber,
-    std::string firstSightingDate, std::string previousPath,
-    struct sBlockStats* pStats, gint64 diskSeq, gint64 totalBytesWritten)
+void cJsonWriter::addEntryToBuilder(std::string const & serialNumber,
+    std::string const & firstSightingDate, std::string const & previousPath,
+    struct sBlockStats* pStats, gint64 diskSeq, gint64 totalBytesWritten,
+    gint64 selfBytesWritten, gint64 lastSeenTime,
+    struct sDeviceHistograms* pHistograms, struct sTopWriters* pTopWriters,
+    std::map<std::string, struct sCgroupIo>* pCgroupIo,
+    struct sAnomalies* pAnomalies)
 {
     // serial number
     json_builder_set_member_name(_pJsonBuilder, serialNumber.c_str());
@@ -201,6 +315,137 @@ void cJsonWriter::addEntryToBuilder(std::string serialNumber,
     json_builder_add_int_value(_pJsonBuilder, diskSeq);
     json_builder_set_member_name(_pJsonBuilder, "totalBytesWritten");
     json_builder_add_int_value(_pJsonBuilder, totalBytesWritten);
+    json_builder_set_member_name(_pJsonBuilder, "selfBytesWritten");
+    json_builder_add_int_value(_pJsonBuilder, selfBytesWritten);
+    // - for the retention policy, unknown for entries written before it
+    if (lastSeenTime > 0)
+    {
+        json_builder_set_member_name(_pJsonBuilder, "lastSeenTime");
+        json_builder_add_int_value(_pJsonBuilder, lastSeenTime);
+    }
+    // - per interval histograms
+    json_builder_set_member_name(_pJsonBuilder, "histograms");
+    json_builder_begin_object(_pJsonBuilder);
+    addHistogramToBuilder("readAwait", &pHistograms->readAwait);
+    addHistogramToBuilder("writeAwait", &pHistograms->writeAwait);
+    addHistogramToBuilder("requestSize", &pHistograms->requestSize);
+    if (pHistograms->queueDepth.getCount() > 0)
+        addHistogramToBuilder("queueDepth", &pHistograms->queueDepth);
+    json_builder_end_object(_pJsonBuilder);
+    // - heaviest writing processes, only once attribution has run
+    if (!pTopWriters->dayDate.empty())
+    {
+        json_builder_set_member_name(_pJsonBuilder, "topWriters");
+        json_builder_begin_object(_pJsonBuilder);
+        addTopKToBuilder("interval", &pTopWriters->interval);
+        json_builder_set_member_name(_pJsonBuilder, "dayDate");
+        json_builder_add_string_value(
+            _pJsonBuilder, pTopWriters->dayDate.c_str());
+        addTopKToBuilder("day", &pTopWriters->day);
+        json_builder_end_object(_pJsonBuilder);
+    }
+    // - io per cgroup, only once collected
+    if (!pCgroupIo->empty())
+    {
+        json_builder_set_member_name(_pJsonBuilder, "cgroupIo");
+        json_builder_begin_object(_pJsonBuilder);
+        for (auto const & [cgroupPath, io] : *pCgroupIo)
+        {
+            json_builder_set_member_name(_pJsonBuilder, cgroupPath.c_str());
+            json_builder_begin_object(_pJsonBuilder);
+            json_builder_set_member_name(_pJsonBuilder, "rbytes");
+            json_builder_add_int_value(_pJsonBuilder, io.rbytes);
+            json_builder_set_member_name(_pJsonBuilder, "wbytes");
+            json_builder_add_int_value(_pJsonBuilder, io.wbytes);
+            json_builder_set_member_name(_pJsonBuilder, "rios");
+            json_builder_add_int_value(_pJsonBuilder, io.rios);
+            json_builder_set_member_name(_pJsonBuilder, "wios");
+            json_builder_add_int_value(_pJsonBuilder, io.wios);
+            json_builder_set_member_name(_pJsonBuilder, "dbytes");
+            json_builder_add_int_value(_pJsonBuilder, io.dbytes);
+            json_builder_end_object(_pJsonBuilder);
+        }
+        json_builder_end_object(_pJsonBuilder);
+    }
+    // - last anomaly, only once one has been detected
+    if (pAnomalies->count > 0)
+    {
+        json_builder_set_member_name(_pJsonBuilder, "anomalies");
+        json_builder_begin_object(_pJsonBuilder);
+        json_builder_set_member_name(_pJsonBuilder, "count");
+        json_builder_add_int_value(_pJsonBuilder, pAnomalies->count);
+        json_builder_set_member_name(_pJsonBuilder, "lastTime");
+        json_builder_add_string_value(
+            _pJsonBuilder, pAnomalies->lastTime.c_str());
+        json_builder_set_member_name(_pJsonBuilder, "lastMetric");
+        json_builder_add_string_value(
+            _pJsonBuilder, pAnomalies->lastMetric.c_str());
+        json_builder_set_member_name(_pJsonBuilder, "lastValue");
+        json_builder_add_int_value(_pJsonBuilder, pAnomalies->lastValue);
+        json_builder_set_member_name(_pJsonBuilder, "lastMean");
+        json_builder_add_int_value(_pJsonBuilder, pAnomalies->lastMean);
+        json_builder_set_member_name(_pJsonBuilder, "lastDeviation");
+        json_builder_add_int_value(_pJsonBuilder, pAnomalies->lastDeviation);
+        json_builder_end_object(_pJsonBuilder);
+    }
     // close
     json_builder_end_object(_pJsonBuilder);
 }
+
+void cJsonWriter::addTopKToBuilder(std::string summaryName, cTopK* pTopK)
+{
+    std::array<struct cTopK::sItem, cTopK::CONST_MAX_CAPACITY> items;
+    guint size = 0;
+    pTopK->getItems(&items, &size);
+
+    // heaviest first, bytes over-estimate the true value by at most error
+    json_builder_set_member_name(_pJsonBuilder, summaryName.c_str());
+    json_builder_begin_array(_pJsonBuilder);
+    for (guint i = 0; i < size; i++)
+    {
+        json_builder_begin_object(_pJsonBuilder);
+        json_builder_set_member_name(_pJsonBuilder, "name");
+        json_builder_add_string_value(_pJsonBuilder, items[i].name);
+        json_builder_set_member_name(_pJsonBuilder, "bytes");
+        json_builder_add_int_value(_pJsonBuilder, items[i].count);
+        json_builder_set_member_name(_pJsonBuilder, "error");
+        json_builder_add_int_value(_pJsonBuilder, items[i].error);
+        json_builder_end_object(_pJsonBuilder);
+    }
+    json_builder_end_array(_pJsonBuilder);
+}
+
+void cJsonWriter::addHistogramToBuilder(
+    std::string histogramName, cHistogram* pHistogram)
+{
+    json_builder_set_member_name(_pJsonBuilder, histogramName.c_str());
+    json_builder_begin_object(_pJsonBuilder);
+    // - summary, informational only
+    json_builder_set_member_name(_pJsonBuilder, "count");
+    json_builder_add_int_value(_pJsonBuilder, pHistogram->getCount());
+    json_builder_set_member_name(_pJsonBuilder, "p50");
+    json_builder_add_int_value(
+        _pJsonBuilder, pHistogram->getValueAtPercentile(50.0));
+    json_builder_set_member_name(_pJsonBuilder, "p99");
+    json_builder_add_int_value(
+        _pJsonBuilder, pHistogram->getValueAtPercentile(99.0));
+    json_builder_set_member_name(_pJsonBuilder, "max");
+    json_builder_add_int_value(_pJsonBuilder, pHistogram->getMax());
+    // - non-empty buckets as [index, count] pairs
+    json_builder_set_member_name(_pJsonBuilder, "buckets");
+    json_builder_begin_array(_pJsonBuilder);
+    for (guint i = 0; i < cHistogram::CONST_BUCKET_COUNT; i++)
+    {
+        auto count = pHistogram->getBucket(i);
+        if (count == 0)
+        {
+            continue;
+        }
+        json_builder_begin_array(_pJsonBuilder);
+        json_builder_add_int_value(_pJsonBuilder, i);
+        json_builder_add_int_value(_pJsonBuilder, count);
+        json_builder_end_array(_pJsonBuilder);
+    }
+    json_builder_end_array(_pJsonBuilder);
+    json_builder_end_object(_pJsonBuilder);
+}
@@ -3,29 +3,65 @@
 #define _CJSONWRITER_H
 
 #include "../library/include/structs.hh"
+#include "cSelfStats.hh"
 #include <json-glib/json-glib.h>
+#include <map>
 #include <stdint.h>
 #include <string>
 #include <vector>
 
+constexpr std::string_view CONST_SELF_STATS_MEMBER = "_selfStats";
+
 class cJsonWriter
 {
     public:
         cJsonWriter();
-        bool writeJson(std::string jsonPathInput, std::string jsonPathOutput,
-            std::string serialNumber, std::string firstSightingDate,
-            std::string previousPath, struct sBlockStats* pStats,
-            gint64 diskSeq, gint64 totalBytesWritten);
+        ~cJsonWriter();
+        // owns its builder
+        cJsonWriter(cJsonWriter const &) = delete;
+        cJsonWriter& operator=(cJsonWriter const &) = delete;
+        void setSelfStats(cSelfStats* pSelfStats) { _pSelfStats = pSelfStats; }
+        // pad the counters of written files so cStatsPatcher can update them
+        void setFixedWidth(bool fixedWidth) { _fixedWidth = fixedWidth; }
+        bool writeJson(std::string const & jsonPathInput,
+            std::string const & jsonPathOutput,
+            std::string const & serialNumber,
+            std::string const & firstSightingDate,
+            std::string const & previousPath, struct sBlockStats* pStats,
+            gint64 diskSeq, gint64 totalBytesWritten,
+            gint64 selfBytesWritten, gint64 lastSeenTime,
+            struct sDeviceHistograms* pHistograms,
+            struct sTopWriters* pTopWriters,
+            std::map<std::string, struct sCgroupIo>* pCgroupIo,
+            struct sAnomalies* pAnomalies);
+        bool writeJsonString(std::vector<struct sDeviceEntry*> const & devices,
+            std::string* pOutput);
+        bool writeJsonEntries(std::vector<struct sJsonDeviceEntry>& devices,
+            std::string* pOutput);
 
     private:
         uint _indentLevel = 4;
+        // reused by every write, reset after each one, failed or not
         JsonBuilder* _pJsonBuilder;
-        bool readExistingJson(std::string jsonPath,
+        cSelfStats* _pSelfStats = nullptr;
+        bool _fixedWidth = false;
+        std::string _paddedJson; // reused by every padded write
+        bool generateString(std::string* pOutput);
+        bool readExistingJson(std::string const & jsonPath,
             std::vector<struct sJsonDeviceEntry>* pDevices);
-        void addEntryToBuilder(std::string serialNumber,
-            std::string firstSightingDate, std::string previousPath,
+        void addEntryToBuilder(std::string const & serialNumber,
+            std::string const & firstSightingDate,
+            std::string const & previousPath,
             struct sBlockStats* pStats, gint64 diskSeq,
-            gint64 totalBytesWritten);
+            gint64 totalBytesWritten, gint64 selfBytesWritten,
+            gint64 lastSeenTime, struct sDeviceHistograms* pHistograms,
+            struct sTopWriters* pTopWriters,
+            std::map<std::string, struct sCgroupIo>* pCgroupIo,
+            struct sAnomalies* pAnomalies);
+        void addHistogramToBuilder(
+            std::string histogramName, cHistogram* pHistogram);
+        void addTopKToBuilder(std::string summaryName, cTopK* pTopK);
+        void addSelfStatsToBuilder(void);
 };
 
 #endif /* _CJSONWRITER_H */
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include "cOpenMetricsSink.hh"
+#include "../utils/log-event.hh"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+constexpr gint64 CONST_SECTOR_SIZE = 512;
+
+struct sMetric
+{
+        const char* pName;
+        const char* pType;
+        const char* pHelp;
+        gint64 (*pGetValue)(struct sSinkRecord const & record);
+};
+
+// counters are the totals of the kernel since the device appeared
+static const struct sMetric metrics[] = {
+    { "krillkounter_read_ios", "counter", "Reads completed",
+        [](auto const & record) { return record.sample.stats.readIo; } },
+    { "krillkounter_write_ios", "counter", "Writes completed",
+        [](auto const & record) { return record.sample.stats.writeIo; } },
+    { "krillkounter_discard_ios", "counter", "Discards completed",
+        [](auto const & record) { return record.sample.stats.discardIo; } },
+    { "krillkounter_read_bytes", "counter", "Bytes read",
+        [](auto const & record) {
+            return record.sample.stats.readSectors * CONST_SECTOR_SIZE; } },
+    { "krillkounter_written_bytes", "counter", "Bytes written",
+        [](auto const & record) {
+            return record.sample.stats.writeSectors * CONST_SECTOR_SIZE; } },
+    { "krillkounter_discarded_bytes", "counter", "Bytes discarded",
+        [](auto const & record) {
+            return record.sample.stats.discardSectors * CONST_SECTOR_SIZE; } },
+    { "krillkounter_io_milliseconds", "counter", "Time spent doing I/O",
+        [](auto const & record) { return record.sample.stats.ioTicks; } },
+    { "krillkounter_in_flight", "gauge", "Requests in flight",
+        [](auto const & record) { return record.sample.stats.inFlight; } },
+    { "krillkounter_read_await_microseconds", "gauge",
+        "Average time per read in the last interval",
+        [](auto const & record) { return record.metrics.readAwaitUs; } },
+    { "krillkounter_write_await_microseconds", "gauge",
+        "Average time per write in the last interval",
+        [](auto const & record) { return record.metrics.writeAwaitUs; } },
+};
+
+// constructor
+
+cOpenMetricsSink::cOpenMetricsSink(std::string filePath)
+    : _filePath(filePath), _temporaryPath(filePath + ".tmp")
+{
+}
+
+// public functions
+
+bool cOpenMetricsSink::write(struct sSinkRecord const * pRecords, gsize count)
+{
+    // only the latest record of each device is exposed
+    for (gsize i = 0; i < count; i++)
+    {
+        auto pRecord = &pRecords[i];
+        auto it = _latest.begin();
+        while (it != _latest.end()
+            && strcmp(it->sample.deviceName, pRecord->sample.deviceName) != 0)
+            it++;
+        if (it == _latest.end())
+            _latest.push_back(*pRecord);
+        else
+            *it = *pRecord;
+    }
+
+    _text.clear();
+    for (auto const & metric : metrics)
+    {
+        bool isCounter = strcmp(metric.pType, "counter") == 0;
+        _text.append("# TYPE ").append(metric.pName).append(" ")
+            .append(metric.pType).append("\n");
+        _text.append("# HELP ").append(metric.pName).append(" ")
+            .append(metric.pHelp).append("\n");
+        for (auto const & record : _latest)
+        {
+            _text.append(metric.pName).append(isCounter ? "_total" : "");
+            _text.append("{device=");
+            appendLabel(record.sample.deviceName, &_text);
+            _text.append(",serial=");
+            appendLabel(record.sample.serialNumber, &_text);
+            _text.append("} ")
+                .append(std::to_string(metric.pGetValue(record)))
+                .append("\n");
+        }
+    }
+    _text.append("# EOF\n");
+    return writeFile();
+}
+
+// private functions
+
+void cOpenMetricsSink::appendLabel(std::string const & value, std::string* pText)
+{
+    pText->push_back('"');
+    for (auto character : value)
+    {
+        if (character == '\n')
+        {
+            pText->append("\\n");
+            continue;
+        }
+        if (character == '"' || character == '\\')
+            pText->push_back('\\');
+        pText->push_back(character);
+    }
+    pText->push_back('"');
+}
+
+bool cOpenMetricsSink::writeFile(void)
+{
+    int fd = ::open(_temporaryPath.c_str(),
+        O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool ret = fd >= 0
+        && ::write(fd, _text.data(), _text.size()) == (ssize_t)_text.size();
+    if (fd >= 0 && ::close(fd) != 0)
+        ret = false;
+    if (ret && rename(_temporaryPath.c_str(), _filePath.c_str()) != 0)
+        ret = false;
+    if (!ret)
+        LOG_EVENT(LOG_ERR, "Unable to write [%s]: %s\n", _filePath.c_str(),
+            strerror(errno));
+    return ret;
+}
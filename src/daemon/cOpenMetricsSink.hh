@@ -0,0 +1,34 @@
+// cOpenMetricsSink.hh
+#ifndef _COPENMETRICSSINK_H
+#define _COPENMETRICSSINK_H
+
+#include "cSink.hh"
+#include <glib.h>
+#include <string>
+#include <vector>
+
+/*
+Keeps an OpenMetrics text file with the latest counters of every device,
+e.g. for the textfile collector of the node exporter.
+
+The file is written to a temporary file next to it and renamed over it
+after every batch, so a scraper never reads half of it.
+*/
+class cOpenMetricsSink : public cSink
+{
+    public:
+        explicit cOpenMetricsSink(std::string filePath);
+        bool write(
+            struct sSinkRecord const * pRecords, gsize count) override;
+
+    private:
+        std::string _filePath;
+        std::string _temporaryPath;
+        std::string _text;
+        std::vector<struct sSinkRecord> _latest; // one per device
+
+        static void appendLabel(std::string const & value, std::string* pText);
+        bool writeFile(void);
+};
+
+#endif /* _COPENMETRICSSINK_H */
@@ -0,0 +1,127 @@
+#include "cPluginSink.hh"
+#include "../utils/log-event.hh"
+
+#include <cstddef>
+#include <dlfcn.h>
+
+// records are handed to plugins as they are queued, without a conversion
+#define KK_SAME_OFFSET(record, sample) \
+    (offsetof(struct kk_device_record, record) \
+        == offsetof(struct sSinkRecord, sample))
+static_assert(sizeof(struct kk_device_record) == sizeof(struct sSinkRecord));
+static_assert(sizeof(struct kk_block_stats) == sizeof(struct sBlockStats));
+static_assert(KK_SAME_OFFSET(device_name, sample.deviceName));
+static_assert(KK_SAME_OFFSET(serial_number, sample.serialNumber));
+static_assert(KK_SAME_OFFSET(monotonic_time, sample.monotonicTime));
+static_assert(KK_SAME_OFFSET(real_time, sample.realTime));
+static_assert(KK_SAME_OFFSET(disk_seq, sample.diskSeq));
+static_assert(KK_SAME_OFFSET(stats, sample.stats));
+static_assert(KK_SAME_OFFSET(stats.in_flight, sample.stats.inFlight));
+static_assert(KK_SAME_OFFSET(stats.discard_ticks, sample.stats.discardTicks));
+static_assert(KK_SAME_OFFSET(interval, interval));
+static_assert(KK_SAME_OFFSET(delta, delta));
+static_assert(KK_SAME_OFFSET(read_io, metrics.readIo));
+static_assert(KK_SAME_OFFSET(write_io, metrics.writeIo));
+static_assert(KK_SAME_OFFSET(read_await, metrics.readAwaitUs));
+static_assert(KK_SAME_OFFSET(write_await, metrics.writeAwaitUs));
+static_assert(KK_SAME_OFFSET(request_size, metrics.averageRequestSize));
+
+// constructor and destructor
+
+cPluginSink::cPluginSink(std::string pluginPath, std::string options)
+    : _pluginPath(pluginPath), _options(options)
+{
+}
+
+cPluginSink::~cPluginSink() { close(); }
+
+// public functions
+
+bool cPluginSink::isSupported(void)
+{
+    // the dynamic loader isn't available to a static executable
+#ifdef KK_STATIC
+    return false;
+#else
+    return true;
+#endif
+}
+
+bool cPluginSink::open(void)
+{
+#ifdef KK_STATIC
+    LOG_EVENT(LOG_ERR, "Static build, unable to load [%s]\n",
+        _pluginPath.c_str());
+    return false; // failure
+#else
+    _pHandle = dlopen(_pluginPath.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (_pHandle == nullptr)
+    {
+        LOG_EVENT(LOG_ERR, "Unable to load [%s]: %s\n", _pluginPath.c_str(),
+            dlerror());
+        return false; // failure
+    }
+
+    auto getPlugin = (kk_sink_plugin_get_t)dlsym(
+        _pHandle, KK_SINK_PLUGIN_SYMBOL);
+    _pPlugin = getPlugin != nullptr ? getPlugin() : nullptr;
+    if (_pPlugin == nullptr)
+    {
+        LOG_EVENT(LOG_ERR, "[%s] has no %s()\n", _pluginPath.c_str(),
+            KK_SINK_PLUGIN_SYMBOL);
+        close();
+        return false; // failure
+    }
+    if (_pPlugin->abi_version != KK_SINK_PLUGIN_ABI_VERSION
+        || _pPlugin->record_size != sizeof(struct kk_device_record)
+        || _pPlugin->init == nullptr || _pPlugin->on_batch == nullptr)
+    {
+        LOG_EVENT(LOG_ERR, "[%s] is built for ABI version %u, not %u\n",
+            _pluginPath.c_str(), _pPlugin->abi_version,
+            KK_SINK_PLUGIN_ABI_VERSION);
+        close();
+        return false; // failure
+    }
+    return true; // success
+#endif
+}
+
+bool cPluginSink::start(void)
+{
+    if (_pPlugin->init(&_pState, _options.c_str()) != 0)
+    {
+        LOG_EVENT(LOG_ERR, "Plugin %s [%s] failed to start\n",
+            _pPlugin->name != nullptr ? _pPlugin->name : "",
+            _pluginPath.c_str());
+        return false; // failure
+    }
+    _isStarted = true;
+    return true; // success
+}
+
+bool cPluginSink::write(struct sSinkRecord const * pRecords, gsize count)
+{
+    return _isStarted && _pPlugin->on_batch(_pState,
+        reinterpret_cast<const struct kk_device_record*>(pRecords), count) == 0;
+}
+
+bool cPluginSink::flush(void)
+{
+    if (!_isStarted || _pPlugin->flush == nullptr)
+        return true; // nothing to do
+    return _pPlugin->flush(_pState) == 0;
+}
+
+void cPluginSink::close(void)
+{
+    if (_isStarted && _pPlugin->shutdown != nullptr)
+        _pPlugin->shutdown(_pState);
+    _isStarted = false;
+    _pState    = nullptr;
+    _pPlugin   = nullptr;
+#ifndef KK_STATIC
+    if (_pHandle != nullptr)
+        dlclose(_pHandle);
+#endif
+    _pHandle = nullptr;
+}
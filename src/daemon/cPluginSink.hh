@@ -0,0 +1,39 @@
+// cPluginSink.hh
+#ifndef _CPLUGINSINK_H
+#define _CPLUGINSINK_H
+
+#include "cSink.hh"
+#include "kk-sink-plugin.h"
+#include <glib.h>
+#include <string>
+
+/*
+A sink implemented by a shared object, see kk-sink-plugin.h.
+
+The object is loaded and its ABI checked by open(), on the main thread,
+so a wrong path or version fails the startup. Everything the plugin does
+is called from the thread of the sink, starting with its init.
+*/
+class cPluginSink : public cSink
+{
+    public:
+        cPluginSink(std::string pluginPath, std::string options);
+        ~cPluginSink();
+        static bool isSupported(void);
+        bool open(void) override;
+        bool start(void) override;
+        bool write(
+            struct sSinkRecord const * pRecords, gsize count) override;
+        bool flush(void) override;
+        void close(void) override;
+
+    private:
+        std::string _pluginPath;
+        std::string _options;
+        void* _pHandle = nullptr;
+        const struct kk_sink_plugin* _pPlugin = nullptr;
+        void* _pState = nullptr;
+        bool _isStarted = false;
+};
+
+#endif /* _CPLUGINSINK_H */
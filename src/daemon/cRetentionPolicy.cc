@@ -0,0 +1,135 @@
+#include "cRetentionPolicy.hh"
+
+#include "../utils/log-event.hh"
+#include "cJsonParser.hh"
+#include "cStatsArchive.hh"
+#include "cStatsPatcher.hh"
+#include <algorithm>
+
+constexpr gint64 CONST_SECONDS_PER_DAY = 24 * 3600;
+
+// constructor
+
+cRetentionPolicy::cRetentionPolicy(gint64 retentionDays, gint64 maxSerials)
+    : _retentionDays(retentionDays), _maxSerials(maxSerials)
+{
+}
+
+// public functions
+
+bool cRetentionPolicy::load(std::string const & statsFilePath)
+{
+    cJsonParser parser;
+    _kept.clear();
+    _evicted.clear();
+    if (!parser.openJson(statsFilePath))
+        return false; // failure
+
+    // the file is rewritten from the entries, all of them must be there
+    guint skipped = 0;
+    bool parsed = parser.getDeviceEntries(&_kept, &skipped);
+    parser.closeJson();
+    if (!parsed || skipped > 0)
+    {
+        LOG_EVENT(LOG_ERR, "Unable to read [%s] for retention, %u entries "
+            "failed to parse\n", statsFilePath.c_str(), skipped);
+        _kept.clear();
+        return false; // failure
+    }
+    return true; // success
+}
+
+bool cRetentionPolicy::select(
+    std::vector<std::string> const & activeSerials, gint64 nowSeconds)
+{
+    auto isActive = [&](struct sJsonDeviceEntry const & entry) {
+        return std::find(activeSerials.begin(), activeSerials.end(),
+                   entry.serialNumber)
+            != activeSerials.end();
+    };
+
+    // entries written before retention existed are seen from now on
+    bool stamped = false;
+    for (auto &entry : _kept)
+    {
+        if (entry.lastSeenTime <= 0 && !isActive(entry))
+        {
+            entry.lastSeenTime = nowSeconds;
+            stamped = true;
+        }
+    }
+
+    // the least recently seen are evicted first, the file keeps its order
+    std::vector<gsize> order(_kept.size());
+    for (gsize i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](gsize a, gsize b) {
+        return _kept[a].lastSeenTime < _kept[b].lastSeenTime;
+    });
+    std::vector<bool> isEvicted(_kept.size(), false);
+    gint64 overLimit = _maxSerials > 0
+        ? (gint64)_kept.size() - _maxSerials : 0;
+    for (auto i : order)
+    {
+        bool stale = _retentionDays > 0
+            && nowSeconds - _kept[i].lastSeenTime
+                > _retentionDays * CONST_SECONDS_PER_DAY;
+        if (!isActive(_kept[i]) && (stale || overLimit > 0))
+        {
+            overLimit--;
+            isEvicted[i] = true;
+        }
+    }
+
+    std::vector<struct sJsonDeviceEntry> kept;
+    for (gsize i = 0; i < _kept.size(); i++)
+        (isEvicted[i] ? _evicted : kept).push_back(std::move(_kept[i]));
+    _kept.swap(kept);
+    return !_evicted.empty() || stamped;
+}
+
+bool cRetentionPolicy::archive(std::string const & archiveFilePath)
+{
+    if (_evicted.empty())
+        return true; // nothing to archive
+
+    std::string text;
+    cStatsArchive archive;
+    if (!_writer.writeJsonEntries(_evicted, &text)
+        || !archive.append(archiveFilePath, text))
+    {
+        LOG_EVENT(LOG_ERR, "Unable to archive %zu entries, kept\n",
+            _evicted.size());
+        for (auto &entry : _evicted)
+            _kept.push_back(std::move(entry));
+        _evicted.clear();
+        return false; // failure
+    }
+    LOG_EVENT(LOG_INFO, "Archived %zu stale serial numbers to [%s]\n",
+        _evicted.size(), archiveFilePath.c_str());
+    return true; // success
+}
+
+bool cRetentionPolicy::rewrite(std::string const & statsFilePath, bool isPadded)
+{
+    std::string text;
+    if (!_writer.writeJsonEntries(_kept, &text))
+        return false; // failure
+    if (isPadded)
+    {
+        std::string padded;
+        cStatsPatcher::padFields(text, &padded);
+        text.swap(padded);
+    }
+
+    GError* pWriteError = nullptr;
+    if (!g_file_set_contents(statsFilePath.c_str(), text.data(), text.size(),
+            &pWriteError))
+    {
+        LOG_EVENT(LOG_ERR, "Unable to write [%s]: %s\n",
+            statsFilePath.c_str(), pWriteError->message);
+        g_error_free(pWriteError);
+        return false; // failure
+    }
+    return true; // success
+}
@@ -0,0 +1,43 @@
+// cRetentionPolicy.hh
+#ifndef _CRETENTIONPOLICY_H
+#define _CRETENTIONPOLICY_H
+
+#include "../library/include/structs.hh"
+#include "cJsonWriter.hh"
+#include <glib.h>
+#include <string>
+#include <vector>
+
+/*
+Moves the stale serial numbers of a stats file to its archive.
+
+Entries not seen for retentionDays, then the least recently seen beyond
+maxSerials, are evicted, never those of the monitored devices. Entries
+written before lastSeenTime existed count as seen at the first pass. The
+evicted entries are appended to the archive before the stats file is
+rewritten, so an entry is never lost between the two files, and nothing
+happens unless every entry of the stats file parsed.
+*/
+class cRetentionPolicy
+{
+    public:
+        // 0 disables either limit
+        cRetentionPolicy(gint64 retentionDays, gint64 maxSerials);
+        // false if an entry fails to parse, the file is then left alone
+        bool load(std::string const & statsFilePath);
+        // true if the stats file must be rewritten
+        bool select(std::vector<std::string> const & activeSerials,
+            gint64 nowSeconds);
+        // the evicted entries are kept on failure
+        bool archive(std::string const & archiveFilePath);
+        bool rewrite(std::string const & statsFilePath, bool isPadded);
+
+    private:
+        gint64 _retentionDays;
+        gint64 _maxSerials;
+        std::vector<struct sJsonDeviceEntry> _kept;
+        std::vector<struct sJsonDeviceEntry> _evicted;
+        cJsonWriter _writer;
+};
+
+#endif /* _CRETENTIONPOLICY_H */
@@ -0,0 +1,108 @@
+#include "cSelfStats.hh"
+#include "../utils/log-event.hh"
+
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+// public functions
+
+void cSelfStats::record(ePhase phase, guint64 durationUs)
+{
+    _phases[phase].record(durationUs);
+}
+
+const cHistogram* cSelfStats::getHistogram(ePhase phase) const
+{
+    return &_phases[phase];
+}
+
+bool cSelfStats::getResourceUsage(gint64* pRssBytes, gint64* pOpenFds)
+{
+    // resident pages are the second field of /proc/self/statm
+    auto ifs = std::ifstream("/proc/self/statm");
+    if (ifs.is_open() != true)
+    {
+        LOG_EVENT(LOG_ERR, "Failed to get process memory usage");
+        return false; // failure
+    }
+    gint64 sizePages     = 0;
+    gint64 residentPages = 0;
+    if (!(ifs >> sizePages >> residentPages))
+    {
+        LOG_EVENT(LOG_ERR, "Failed to parse process memory usage");
+        return false; // failure
+    }
+    *pRssBytes = residentPages * sysconf(_SC_PAGESIZE);
+
+    std::error_code error;
+    gint64 openFds = 0;
+    for (auto it = std::filesystem::directory_iterator("/proc/self/fd", error);
+         !error && it != std::filesystem::directory_iterator();
+         it.increment(error))
+    {
+        openFds++;
+    }
+    if (error)
+    {
+        LOG_EVENT(LOG_ERR, "Failed to count open file descriptors");
+        return false; // failure
+    }
+    // the descriptor used to list the directory is not ours to count
+    *pOpenFds = openFds - 1;
+    return true; // success
+}
+
+void cSelfStats::dump(void)
+{
+    if (!_enabled)
+    {
+        LOG_EVENT(LOG_NOTICE, "Self stats are disabled, use --self-stats\n");
+        return;
+    }
+
+    gint64 rssBytes = 0;
+    gint64 openFds  = 0;
+    if (getResourceUsage(&rssBytes, &openFds))
+    {
+        LOG_EVENT(LOG_NOTICE, "Self stats: rss %ld bytes, %ld open fds, "
+            "%lu dropped log messages\n", (long)rssBytes, (long)openFds,
+            LogEventGetDropped());
+    }
+
+    for (int i = 0; i < PHASE_COUNT; i++)
+    {
+        auto pHistogram = &_phases[i];
+        LOG_EVENT(LOG_NOTICE, "Self stats: %s count %lu p50 %luus "
+            "p99 %luus max %luus\n", getPhaseName((ePhase)i),
+            (unsigned long)pHistogram->getCount(),
+            (unsigned long)pHistogram->getValueAtPercentile(50.0),
+            (unsigned long)pHistogram->getValueAtPercentile(99.0),
+            (unsigned long)pHistogram->getMax());
+    }
+}
+
+const char* cSelfStats::getPhaseName(ePhase phase)
+{
+    switch (phase)
+    {
+        case PHASE_IDENTIFY:
+            return "identify";
+        case PHASE_PARSE_STATS_FILE:
+            return "parseStatsFile";
+        case PHASE_GET_DISK_SEQ:
+            return "getDiskSeq";
+        case PHASE_GET_STATS:
+            return "getStats";
+        case PHASE_COMPUTE:
+            return "compute";
+        case PHASE_JSON_PARSE:
+            return "jsonParse";
+        case PHASE_SERIALISE:
+            return "serialise";
+        case PHASE_FILE_WRITE:
+            return "fileWrite";
+        default:
+            return "unknown";
+    }
+}
@@ -0,0 +1,66 @@
+// cSelfStats.hh
+#ifndef _CSELFSTATS_H
+#define _CSELFSTATS_H
+
+#include "../library/cHistogram.hh"
+
+#include <array>
+#include <glib.h>
+
+class cSelfStats
+{
+    public:
+        enum ePhase
+        {
+            PHASE_IDENTIFY,
+            PHASE_PARSE_STATS_FILE,
+            PHASE_GET_DISK_SEQ,
+            PHASE_GET_STATS,
+            PHASE_COMPUTE,
+            PHASE_JSON_PARSE,
+            PHASE_SERIALISE,
+            PHASE_FILE_WRITE,
+            PHASE_COUNT
+        };
+
+        void setEnabled(bool enabled) { _enabled = enabled; }
+        bool isEnabled(void) const { return _enabled; }
+        void record(ePhase phase, guint64 durationUs);
+        const cHistogram* getHistogram(ePhase phase) const;
+        bool getResourceUsage(gint64* pRssBytes, gint64* pOpenFds);
+        void dump(void);
+
+        static const char* getPhaseName(ePhase phase);
+
+    private:
+        bool _enabled = false;
+        std::array<cHistogram, PHASE_COUNT> _phases;
+};
+
+// times the scope it lives in, does nothing if self stats are disabled
+class cPhaseTimer
+{
+    public:
+        cPhaseTimer(cSelfStats* pSelfStats, cSelfStats::ePhase phase)
+            : _pSelfStats(pSelfStats), _phase(phase)
+        {
+            if (_pSelfStats && _pSelfStats->isEnabled())
+                _start = g_get_monotonic_time();
+        }
+        ~cPhaseTimer() { stop(); }
+
+        // record now rather than at the end of the scope
+        void stop(void)
+        {
+            if (_pSelfStats && _pSelfStats->isEnabled() && _start)
+                _pSelfStats->record(_phase, g_get_monotonic_time() - _start);
+            _start = 0;
+        }
+
+    private:
+        cSelfStats* _pSelfStats;
+        cSelfStats::ePhase _phase;
+        gint64 _start = 0;
+};
+
+#endif /* _CSELFSTATS_H */
@@ -0,0 +1,48 @@
+// cSink.hh
+#ifndef _CSINK_H
+#define _CSINK_H
+
+#include "../library/include/structs.hh"
+#include <glib.h>
+
+// a snapshot of the counters, as published by the samplers
+struct sSampleEvent
+{
+        char deviceName[32];
+        char serialNumber[64];
+        gint64 monotonicTime; // microseconds
+        gint64 realTime;      // microseconds since the epoch
+        gint64 diskSeq;
+        struct sBlockStats stats;
+};
+
+// a snapshot with what changed since the previous one of the device
+struct sSinkRecord
+{
+        struct sSampleEvent sample;
+        gint64 interval; // microseconds since the previous sample, 0 if first
+        struct sBlockStats delta; // 0 if first, inFlight is the current value
+        struct sIntervalMetrics metrics;
+};
+
+/*
+An output of the sink pipeline.
+
+Every sink runs on a thread of its own and is handed batches of records in
+the order they were sampled. A sink reports its errors and carries on, the
+records of a failed batch are lost to it but not to the other sinks.
+*/
+class cSink
+{
+    public:
+        virtual ~cSink() = default;
+        virtual bool open(void) { return true; }
+        // on the thread of the sink, before the first batch
+        virtual bool start(void) { return true; }
+        // the records are only valid during the call
+        virtual bool write(struct sSinkRecord const * pRecords, gsize count) = 0;
+        virtual bool flush(void) { return true; }
+        virtual void close(void) {}
+};
+
+#endif /* _CSINK_H */
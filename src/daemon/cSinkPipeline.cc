@@ -0,0 +1,300 @@
+#include "cSinkPipeline.hh"
+#include "../utils/log-event.hh"
+
+#include <chrono>
+#include <signal.h>
+#include <string.h>
+
+constexpr gsize CONST_BUS_CAPACITY      = 4096;
+constexpr gsize CONST_DEFAULT_BATCH     = 64;
+constexpr gint64 CONST_DEFAULT_DELAY_MS = 1000;
+constexpr gsize CONST_DEFAULT_QUEUE     = 1024;
+constexpr gint64 CONST_DISPATCH_WAIT_MS = 1000;
+// longest a "block" sink holds the dispatcher for a record
+constexpr gint64 CONST_BLOCK_WAIT_MS    = 1000;
+constexpr uint CONST_SECTOR_SIZE        = 512;
+
+// counters since pPrevious, false if they started again from zero
+static bool subtractStats(struct sBlockStats const * pStats,
+    struct sBlockStats const * pPrevious, struct sBlockStats* pDelta)
+{
+    if (pStats->readIo < pPrevious->readIo
+        || pStats->writeIo < pPrevious->writeIo
+        || pStats->discardIo < pPrevious->discardIo)
+        return false; // wrapped
+
+    pDelta->readIo         = pStats->readIo - pPrevious->readIo;
+    pDelta->readMerges     = pStats->readMerges - pPrevious->readMerges;
+    pDelta->readSectors    = pStats->readSectors - pPrevious->readSectors;
+    pDelta->readTicks      = pStats->readTicks - pPrevious->readTicks;
+    pDelta->writeIo        = pStats->writeIo - pPrevious->writeIo;
+    pDelta->writeMerges    = pStats->writeMerges - pPrevious->writeMerges;
+    pDelta->writeSectors   = pStats->writeSectors - pPrevious->writeSectors;
+    pDelta->writeTicks     = pStats->writeTicks - pPrevious->writeTicks;
+    pDelta->inFlight       = pStats->inFlight;
+    pDelta->ioTicks        = pStats->ioTicks - pPrevious->ioTicks;
+    pDelta->timeInQueue    = pStats->timeInQueue - pPrevious->timeInQueue;
+    pDelta->discardIo      = pStats->discardIo - pPrevious->discardIo;
+    pDelta->discardMerges  = pStats->discardMerges - pPrevious->discardMerges;
+    pDelta->discardSectors = pStats->discardSectors - pPrevious->discardSectors;
+    pDelta->discardTicks   = pStats->discardTicks - pPrevious->discardTicks;
+    return true; // success
+}
+
+// signals are left to the main loop
+static void blockSignals(void)
+{
+    sigset_t signals;
+    sigfillset(&signals);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+}
+
+// constructor and destructor
+
+cSinkPipeline::cSinkPipeline() : _bus(CONST_BUS_CAPACITY) {}
+
+cSinkPipeline::~cSinkPipeline() { stop(); }
+
+// public functions
+
+bool cSinkPipeline::addSink(
+    std::unique_ptr<cSink> pSink, struct sSinkConfig const & config)
+{
+    if (_isRunning)
+        return false; // failure
+
+    auto pWorker = std::make_unique<struct sWorker>();
+    pWorker->name      = config.type
+        + (config.path.empty() ? "" : " [" + config.path + "]");
+    pWorker->batchSize = config.batchSize > 0
+        ? config.batchSize : CONST_DEFAULT_BATCH;
+    pWorker->maxDelay  = config.maxDelay > 0
+        ? config.maxDelay : CONST_DEFAULT_DELAY_MS;
+    if (config.overflow.empty() || config.overflow == "dropOldest")
+        pWorker->overflow = eOverflow::dropOldest;
+    else if (config.overflow == "dropNewest")
+        pWorker->overflow = eOverflow::dropNewest;
+    else if (config.overflow == "block")
+        pWorker->overflow = eOverflow::block;
+    else
+    {
+        LOG_EVENT(LOG_ERR, "Unknown overflow policy [%s] of sink %s\n",
+            config.overflow.c_str(), pWorker->name.c_str());
+        return false; // failure
+    }
+
+    if (!pSink->open())
+        return false; // failure
+
+    // sized once, the dispatcher and the sink copy records in place
+    pWorker->queue.resize(config.queueSize > 0
+        ? config.queueSize : CONST_DEFAULT_QUEUE);
+    pWorker->batch.reserve(pWorker->batchSize);
+    pWorker->pSink = std::move(pSink);
+    _workers.push_back(std::move(pWorker));
+    return true; // success
+}
+
+bool cSinkPipeline::start(void)
+{
+    if (_isRunning || _workers.empty())
+        return false; // nothing to do
+
+    _isStopping = false;
+    for (auto &pWorker : _workers)
+        pWorker->thread = std::thread(
+            &cSinkPipeline::runWorker, this, pWorker.get());
+    _dispatcher = std::thread(&cSinkPipeline::dispatch, this);
+    _isRunning  = true;
+    return true; // success
+}
+
+bool cSinkPipeline::isRunning(void) const
+{
+    return _isRunning;
+}
+
+bool cSinkPipeline::publish(struct sSampleEvent const & event)
+{
+    return _bus.publish(event);
+}
+
+void cSinkPipeline::stop(void)
+{
+    if (!_isRunning)
+        return;
+
+    // the dispatcher drains the bus before it returns
+    _isStopping = true;
+    _bus.wake();
+    _dispatcher.join();
+
+    for (auto &pWorker : _workers)
+    {
+        {
+            std::lock_guard<std::mutex> lock(pWorker->mutex);
+            pWorker->isStopping = true;
+        }
+        pWorker->wakeup.notify_one();
+        pWorker->thread.join();
+        if (pWorker->dropped > 0)
+            LOG_EVENT(LOG_WARNING, "Sink %s dropped %lu records\n",
+                pWorker->name.c_str(), (gulong)pWorker->dropped);
+    }
+    if (_bus.getDroppedCount() > 0)
+        LOG_EVENT(LOG_WARNING, "Sink pipeline dropped %lu samples\n",
+            (gulong)_bus.getDroppedCount());
+    _workers.clear();
+    _devices.clear();
+    _isRunning = false;
+}
+
+// private functions
+
+void cSinkPipeline::dispatch(void)
+{
+    blockSignals();
+    struct sSampleEvent event;
+    struct sSinkRecord record;
+    while (true)
+    {
+        // read before consuming, so nothing published before stop() is left
+        bool isStopping = _isStopping;
+        while (_bus.consume(&event))
+        {
+            compute(event, &record);
+            for (auto &pWorker : _workers)
+                enqueue(pWorker.get(), record);
+        }
+        if (isStopping)
+            break;
+        _bus.wait(CONST_DISPATCH_WAIT_MS);
+    }
+}
+
+void cSinkPipeline::compute(
+    struct sSampleEvent const & event, struct sSinkRecord* pRecord)
+{
+    pRecord->sample   = event;
+    pRecord->interval = 0;
+    pRecord->delta    = { .inFlight = event.stats.inFlight };
+    pRecord->metrics  = {};
+
+    struct sDeviceState* pDevice = nullptr;
+    for (auto &device : _devices)
+    {
+        if (strcmp(device.deviceName, event.deviceName) == 0)
+        {
+            pDevice = &device;
+            break;
+        }
+    }
+    if (pDevice == nullptr)
+    {
+        // the first sample of the device only takes the baseline
+        _devices.push_back({});
+        pDevice = &_devices.back();
+        memcpy(pDevice->deviceName, event.deviceName,
+            sizeof(pDevice->deviceName));
+    }
+    else if (pDevice->diskSeq == event.diskSeq
+        && subtractStats(&event.stats, &pDevice->stats, &pRecord->delta))
+    {
+        pRecord->interval = event.monotonicTime - pDevice->monotonicTime;
+        _computer.getIntervalMetrics(&pDevice->stats,
+            &pRecord->sample.stats, CONST_SECTOR_SIZE, &pRecord->metrics);
+    }
+
+    pDevice->diskSeq       = event.diskSeq;
+    pDevice->monotonicTime = event.monotonicTime;
+    pDevice->stats         = event.stats;
+}
+
+void cSinkPipeline::enqueue(
+    struct sWorker* pWorker, struct sSinkRecord const & record)
+{
+    std::unique_lock<std::mutex> lock(pWorker->mutex);
+    auto size = pWorker->queue.size();
+    if (pWorker->count == size)
+    {
+        switch (pWorker->overflow)
+        {
+            case eOverflow::block:
+                pWorker->wakeup.notify_one();
+                if (pWorker->isStalled
+                    || !pWorker->space.wait_for(lock,
+                        std::chrono::milliseconds(CONST_BLOCK_WAIT_MS),
+                        [pWorker, size]() { return pWorker->count < size; }))
+                {
+                    if (!pWorker->isStalled)
+                        LOG_EVENT(LOG_WARNING, "Sink %s is stalled\n",
+                            pWorker->name.c_str());
+                    pWorker->isStalled = true;
+                    pWorker->dropped++;
+                    return;
+                }
+                break;
+            case eOverflow::dropNewest:
+                pWorker->dropped++;
+                return;
+            case eOverflow::dropOldest:
+                pWorker->first = (pWorker->first + 1) % size;
+                pWorker->count--;
+                pWorker->dropped++;
+                break;
+        }
+    }
+
+    pWorker->isStalled = false;
+    pWorker->queue[(pWorker->first + pWorker->count) % size] = record;
+    pWorker->count++;
+    if (pWorker->count >= pWorker->batchSize)
+        pWorker->wakeup.notify_one();
+}
+
+void cSinkPipeline::runWorker(struct sWorker* pWorker)
+{
+    blockSignals();
+    auto maxDelay = std::chrono::milliseconds(pWorker->maxDelay);
+    auto size     = pWorker->queue.size();
+    // a sink which fails to start only empties its queue
+    bool isStarted = pWorker->pSink->start();
+    std::unique_lock<std::mutex> lock(pWorker->mutex);
+    while (true)
+    {
+        // a full batch, or whatever is there once the delay is over
+        pWorker->wakeup.wait_for(lock, maxDelay, [pWorker]() {
+            return pWorker->isStopping
+                || pWorker->count >= pWorker->batchSize;
+        });
+
+        pWorker->batch.clear();
+        while (pWorker->count > 0
+            && pWorker->batch.size() < pWorker->batchSize)
+        {
+            pWorker->batch.push_back(pWorker->queue[pWorker->first]);
+            pWorker->first = (pWorker->first + 1) % size;
+            pWorker->count--;
+        }
+        if (!isStarted)
+        {
+            pWorker->dropped += pWorker->batch.size();
+            pWorker->batch.clear();
+        }
+        bool isDone = pWorker->isStopping && pWorker->count == 0;
+        lock.unlock();
+        pWorker->space.notify_one();
+
+        // the sink works on its own copy, the queue is free again
+        if (!pWorker->batch.empty()
+            && !pWorker->pSink->write(
+                pWorker->batch.data(), pWorker->batch.size()))
+            LOG_EVENT(LOG_ERR, "Sink %s lost %lu records\n",
+                pWorker->name.c_str(), (gulong)pWorker->batch.size());
+        if (isDone)
+            break;
+        lock.lock();
+    }
+    pWorker->pSink->flush();
+    pWorker->pSink->close();
+}
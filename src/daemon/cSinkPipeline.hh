@@ -0,0 +1,91 @@
+// cSinkPipeline.hh
+#ifndef _CSINKPIPELINE_H
+#define _CSINKPIPELINE_H
+
+#include "../library/cStatComputer.hh"
+#include "../library/include/structs.hh"
+#include "cEventBus.hh"
+#include "cSink.hh"
+#include <atomic>
+#include <condition_variable>
+#include <glib.h>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+Carries the samples of the main loop to any number of sinks.
+
+Samplers publish to a cEventBus and return at once. A dispatcher thread
+consumes the bus, computes the deltas and interval metrics of every sample
+from the previous one of its device, and hands the records to the sinks.
+Each sink has a thread and a bounded queue of its own, and takes its
+records in batches of batchSize, or whatever is queued after maxDelay.
+What happens when a queue is full is the overflow policy of the sink:
+"dropOldest" and "dropNewest" count the lost records, "block" waits up to
+a second for the sink to make room, then counts the record as dropped.
+A sink which didn't make room in time drops without waiting until it
+does, so a hung sink holds the other sinks once, never the samplers.
+*/
+class cSinkPipeline
+{
+    public:
+        cSinkPipeline();
+        ~cSinkPipeline();
+        // sinks are added before start()
+        bool addSink(
+            std::unique_ptr<cSink> pSink, struct sSinkConfig const & config);
+        bool start(void);
+        bool isRunning(void) const;
+        // from any thread, false if the event was dropped
+        bool publish(struct sSampleEvent const & event);
+        // delivers what was published, then flushes and closes the sinks
+        void stop(void);
+
+    private:
+        enum class eOverflow { dropOldest, dropNewest, block };
+        struct sWorker
+        {
+                std::unique_ptr<cSink> pSink;
+                std::string name;
+                gsize batchSize;
+                gint64 maxDelay; // milliseconds
+                eOverflow overflow;
+                std::thread thread;
+                std::mutex mutex;
+                std::condition_variable wakeup; // records or stopping
+                std::condition_variable space;  // for "block"
+                std::vector<struct sSinkRecord> queue; // a ring
+                gsize first = 0;
+                gsize count = 0;
+                std::vector<struct sSinkRecord> batch;
+                guint64 dropped = 0;
+                bool isStalled = false; // "block" timed out, drop at once
+                bool isStopping = false;
+        };
+        struct sDeviceState
+        {
+                char deviceName[32];
+                gint64 diskSeq;
+                gint64 monotonicTime;
+                struct sBlockStats stats;
+        };
+
+        cEventBus _bus;
+        std::vector<std::unique_ptr<struct sWorker>> _workers;
+        std::vector<struct sDeviceState> _devices;
+        cStatComputer _computer;
+        std::thread _dispatcher;
+        std::atomic<bool> _isStopping{false};
+        bool _isRunning = false;
+
+        void dispatch(void);
+        void compute(
+            struct sSampleEvent const & event, struct sSinkRecord* pRecord);
+        void enqueue(
+            struct sWorker* pWorker, struct sSinkRecord const & record);
+        void runWorker(struct sWorker* pWorker);
+};
+
+#endif /* _CSINKPIPELINE_H */
@@ -0,0 +1,70 @@
+#include "cSoakReader.hh"
+
+#include <algorithm>
+
+// the workload of the synthetic devices, 4 KiB requests taking 250 us
+constexpr gint64 CONST_SECTORS_PER_IO          = 8;
+constexpr gint64 CONST_IO_PER_MILLISECOND      = 4;
+constexpr gint64 CONST_IO_PER_MERGE            = 8;
+constexpr gint64 CONST_MILLISECONDS_PER_SECOND = 1000;
+
+// public functions
+
+void cSoakReader::setTime(gint64 time)
+{
+    _time = time;
+}
+
+void cSoakReader::plug(
+    std::string const & deviceName, gint64 diskSeq, gint64 rate)
+{
+    _devices[deviceName] = { .diskSeq = diskSeq, .plugTime = _time,
+        .rate = rate };
+}
+
+void cSoakReader::unplug(std::string const & deviceName)
+{
+    _devices.erase(deviceName);
+}
+
+bool cSoakReader::getStats(
+    std::string const & deviceName, struct sBlockStats* pStats)
+{
+    auto device = _devices.find(deviceName);
+    if (device == _devices.end())
+        return false; // failure
+
+    // the counters a device busy at a constant rate would have
+    auto elapsed = std::max<gint64>(_time - device->second.plugTime, 0);
+    auto writeIo = elapsed * device->second.rate;
+    auto readIo  = writeIo / 4;
+    *pStats = {};
+    pStats->readIo       = readIo;
+    pStats->readMerges   = readIo / CONST_IO_PER_MERGE;
+    pStats->readSectors  = readIo * CONST_SECTORS_PER_IO;
+    pStats->readTicks    = readIo / CONST_IO_PER_MILLISECOND;
+    pStats->writeIo      = writeIo;
+    pStats->writeMerges  = writeIo / CONST_IO_PER_MERGE;
+    pStats->writeSectors = writeIo * CONST_SECTORS_PER_IO;
+    pStats->writeTicks   = writeIo / CONST_IO_PER_MILLISECOND;
+    pStats->inFlight     = elapsed % 3;
+    pStats->timeInQueue  = pStats->readTicks + pStats->writeTicks;
+    pStats->ioTicks      = std::min(
+        pStats->timeInQueue, elapsed * CONST_MILLISECONDS_PER_SECOND);
+    return true; // success
+}
+
+bool cSoakReader::getDiskSeq(std::string const & deviceName, gint64* pSeq)
+{
+    auto device = _devices.find(deviceName);
+    if (device == _devices.end())
+        return false; // failure
+
+    *pSeq = device->second.diskSeq;
+    return true; // success
+}
+
+bool cSoakReader::hasDevice(std::string const & deviceName)
+{
+    return _devices.find(deviceName) != _devices.end();
+}
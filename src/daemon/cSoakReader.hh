@@ -0,0 +1,43 @@
+// cSoakReader.hh
+#ifndef _CSOAKREADER_H
+#define _CSOAKREADER_H
+
+#include "../library/cStatReader.hh"
+#include "../library/include/structs.hh"
+#include <glib.h>
+#include <map>
+#include <string>
+
+/*
+Synthetic block devices for --soak, standing in for sysfs.
+
+Devices are plugged and unplugged at will. Their counters only depend on the
+time they have been plugged for and their rate, so the reader answers any
+time set with setTime() without holding more than one entry per device.
+*/
+class cSoakReader : public cStatReader
+{
+    public:
+        void setTime(gint64 time);
+        // rate is in writes per second, a quarter of it in reads
+        void plug(std::string const & deviceName, gint64 diskSeq, gint64 rate);
+        void unplug(std::string const & deviceName);
+
+        bool getStats(std::string const & deviceName,
+            struct sBlockStats* pStats) override;
+        bool getDiskSeq(std::string const & deviceName, gint64* pSeq) override;
+        bool hasDevice(std::string const & deviceName) override;
+
+    private:
+        struct sSoakDevice
+        {
+                gint64 diskSeq;
+                gint64 plugTime; // seconds
+                gint64 rate;
+        };
+
+        gint64 _time = 0; // seconds
+        std::map<std::string, struct sSoakDevice, std::less<>> _devices;
+};
+
+#endif /* _CSOAKREADER_H */
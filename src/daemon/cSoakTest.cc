@@ -0,0 +1,206 @@
+#include "cSoakTest.hh"
+
+#include "../library/cHistogram.hh"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+// converts g_get_monotonic_time() units to milliseconds
+constexpr gint64 CONST_MILLISECONDS_TO_MICROSECONDS = 1000;
+constexpr gint64 CONST_SECONDS_TO_MICROSECONDS = 1000000;
+constexpr gint64 CONST_SECONDS_PER_DAY = 24 * 3600;
+// devices kept plugged, one is replaced every churn
+constexpr guint  CONST_SOAK_DEVICES = 4;
+constexpr guint64 CONST_SOAK_CHURN_TICKS = 100;
+// serial numbers of the soak, the stats file stops growing once all are seen
+constexpr guint  CONST_SOAK_SERIALS = 64;
+constexpr guint  CONST_SOAK_CHECKPOINTS = 10;
+// checkpoints after the stats file stopped growing a soak needs to judge
+constexpr guint  CONST_SOAK_MIN_JUDGED_CHECKPOINTS = 3;
+// growth a soak tolerates between its first and last judged checkpoints
+constexpr gint64 CONST_SOAK_RSS_SLACK_BYTES = 1024 * 1024;
+// descriptors a sink thread or a persist holds open for a moment
+constexpr gint64 CONST_SOAK_FD_SLACK = 2;
+
+// public functions
+
+bool cSoakTest::run(guint64 ticks)
+{
+    // the stats file holds every serial number once the last new one is
+    // plugged, growth is only judged at the checkpoints after it
+    guint64 warmTick = (CONST_SOAK_SERIALS - CONST_SOAK_DEVICES)
+        * CONST_SOAK_CHURN_TICKS;
+    auto checkpointTicks = std::max<guint64>(ticks / CONST_SOAK_CHECKPOINTS, 1);
+    auto judgedCount = ticks / checkpointTicks
+        - std::min<guint64>(warmTick / checkpointTicks, ticks / checkpointTicks);
+    if (judgedCount < CONST_SOAK_MIN_JUDGED_CHECKPOINTS)
+    {
+        std::cerr << "Too few checkpoints after tick " << warmTick
+                  << " to judge growth, soak for more ticks\n";
+        return false; // failure
+    }
+
+    // the sampling path of the daemon, fed by synthetic devices on a clock
+    // which jumps from deadline to deadline
+    _startTime = g_get_real_time() / CONST_SECONDS_TO_MICROSECONDS;
+    _pDaemon->startVirtualClock(&_reader, _startTime);
+    _reader.setTime(_startTime);
+
+    if (!_pDaemon->loadVirtualConfig())
+        return false; // failure
+
+    guint64 plugCount = 0;
+    std::vector<std::string> devicePaths;
+    for (guint slot = 0; slot < CONST_SOAK_DEVICES; slot++)
+        devicePaths.push_back(plugDevice(slot, plugCount++));
+    if (!_pDaemon->restoreDevices(devicePaths))
+        return false; // failure
+    _pDaemon->sampleDevices();
+    _pDaemon->persist(false);
+
+    bool isWarm = false;
+    std::vector<struct sCheckpoint> checkpoints;
+    cHistogram latencies;
+    std::cout << "tick\tday\trssKiB\tfds\tp50us\tp99us\tmaxus\tstatsBytes\n";
+
+    auto wallStartTime = g_get_monotonic_time();
+    auto now           = _startTime;
+    _pDaemon->scheduleSampling();
+    guint64 tick = 0;
+    gint64 deadline;
+    while (tick < ticks && _pDaemon->getNextDeadline(&deadline))
+    {
+        now = deadline;
+        _reader.setTime(now);
+        _pDaemon->setVirtualTime(now);
+        auto tickStartTime = g_get_monotonic_time();
+        _pDaemon->sampleDueDevices(now);
+        latencies.record(g_get_monotonic_time() - tickStartTime);
+        tick++;
+
+        // replace the longest plugged device, as a user swapping cards
+        if (tick % CONST_SOAK_CHURN_TICKS == 0)
+        {
+            guint slot = plugCount % CONST_SOAK_DEVICES;
+            unplugDevice(slot);
+            auto devicePath = plugDevice(slot, plugCount++);
+            if (plugCount == CONST_SOAK_SERIALS)
+                isWarm = true;
+            if (!_pDaemon->restoreDevices({ devicePath }))
+                return false; // failure
+            _pDaemon->startSampling(devicePath, now);
+        }
+
+        if (tick % checkpointTicks == 0)
+        {
+            struct sCheckpoint checkpoint = { .tick = tick };
+            if (!_pSelfStats->getResourceUsage(
+                    &checkpoint.rssBytes, &checkpoint.openFds))
+                return false; // failure
+            checkpoint.latencyP50 = latencies.getValueAtPercentile(50.0);
+            checkpoint.latencyP99 = latencies.getValueAtPercentile(99.0);
+            checkpoint.latencyMax = latencies.getMax();
+            std::error_code error;
+            auto size = std::filesystem::file_size(
+                _pDaemon->getStatsFilePath(), error);
+            checkpoint.statsFileBytes = error ? 0 : (gint64)size;
+            printCheckpoint(checkpoint, now);
+            checkpoints.push_back(checkpoint);
+            latencies.reset();
+        }
+    }
+
+    // as when the daemon is stopped
+    _pDaemon->sampleDevices();
+    _pDaemon->persist(true);
+    _pDaemon->stopSinks();
+
+    std::cout << "Soaked " << tick << " ticks, "
+              << (now - _startTime) / CONST_SECONDS_PER_DAY
+              << " days, " << plugCount << " plugs in "
+              << (g_get_monotonic_time() - wallStartTime)
+            / CONST_MILLISECONDS_TO_MICROSECONDS
+              << " ms\n";
+
+    std::vector<gint64> rssBytes;
+    std::vector<gint64> openFds;
+    std::vector<gint64> latencyP50;
+    for (auto const & checkpoint : checkpoints)
+    {
+        if (!isWarm || checkpoint.tick <= warmTick)
+            continue;
+        rssBytes.push_back(checkpoint.rssBytes);
+        openFds.push_back(checkpoint.openFds);
+        latencyP50.push_back(checkpoint.latencyP50);
+    }
+    if (rssBytes.size() < CONST_SOAK_MIN_JUDGED_CHECKPOINTS)
+    {
+        std::cerr << "Too few checkpoints after tick " << warmTick
+                  << " to judge growth, soak for more ticks\n";
+        return false; // failure
+    }
+
+    // a leak grows at every checkpoint, a warm up or a spike does not
+    bool isPassed = true;
+    if (isGrowing(rssBytes, CONST_SOAK_RSS_SLACK_BYTES))
+    {
+        std::cerr << "RSS grew at every checkpoint\n";
+        isPassed = false;
+    }
+    if (isGrowing(openFds, CONST_SOAK_FD_SLACK))
+    {
+        std::cerr << "Open file descriptors grew at every checkpoint\n";
+        isPassed = false;
+    }
+    if (isGrowing(latencyP50, latencyP50.front()))
+    {
+        std::cerr << "Median tick latency grew at every checkpoint\n";
+        isPassed = false;
+    }
+    return isPassed;
+}
+
+// private functions
+
+// every plug is a new disk to the kernel, with the next serial number
+std::string cSoakTest::plugDevice(guint slot, guint64 plugCount)
+{
+    auto deviceName = "soak" + std::to_string(slot);
+    auto devicePath = "/dev/" + deviceName;
+    _reader.plug(deviceName, plugCount + 1, (plugCount % 7 + 1) * 10);
+    _pDaemon->addVirtualDevice(devicePath, deviceName,
+        "SOAK-" + std::to_string(plugCount % CONST_SOAK_SERIALS));
+    return devicePath;
+}
+
+void cSoakTest::unplugDevice(guint slot)
+{
+    auto deviceName = "soak" + std::to_string(slot);
+    _reader.unplug(deviceName);
+    _pDaemon->removeDevice("/dev/" + deviceName);
+}
+
+void cSoakTest::printCheckpoint(struct sCheckpoint const & checkpoint,
+    gint64 now)
+{
+    std::cout << checkpoint.tick << "\t"
+              << (now - _startTime) / CONST_SECONDS_PER_DAY
+              << "\t" << checkpoint.rssBytes / 1024
+              << "\t" << checkpoint.openFds
+              << "\t" << checkpoint.latencyP50
+              << "\t" << checkpoint.latencyP99
+              << "\t" << checkpoint.latencyMax
+              << "\t" << checkpoint.statsFileBytes << "\n";
+}
+
+// true if no value is below the previous one and the last one exceeds the
+// first one by more than slack
+bool cSoakTest::isGrowing(std::vector<gint64> const & values, gint64 slack)
+{
+    for (gsize i = 1; i < values.size(); i++)
+    {
+        if (values[i] < values[i - 1])
+            return false;
+    }
+    return values.size() > 1 && values.back() - values.front() > slack;
+}
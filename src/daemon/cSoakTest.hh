@@ -0,0 +1,51 @@
+// cSoakTest.hh
+#ifndef _CSOAKTEST_H
+#define _CSOAKTEST_H
+
+#include "cDaemon.hh"
+#include "cSelfStats.hh"
+#include "cSoakReader.hh"
+#include <glib.h>
+#include <string>
+#include <vector>
+
+/*
+Soaks the sampling path of the daemon, for --soak.
+
+Synthetic devices are sampled on a virtual clock which jumps from one
+sampling deadline to the next, one of them is replaced every churn. The
+resources and the tick latencies are printed at checkpoints, a leak is a
+growth at every checkpoint once the stats file holds every serial number.
+*/
+class cSoakTest
+{
+    public:
+        cSoakTest(cDaemon* pDaemon, cSelfStats* pSelfStats)
+            : _pDaemon(pDaemon), _pSelfStats(pSelfStats) {}
+        bool run(guint64 ticks);
+
+    private:
+        // resources and sampling latencies, at a checkpoint
+        struct sCheckpoint
+        {
+                guint64 tick;
+                gint64 rssBytes;
+                gint64 openFds;
+                gint64 latencyP50; // microseconds, of the ticks since the last one
+                gint64 latencyP99;
+                gint64 latencyMax;
+                gint64 statsFileBytes;
+        };
+
+        cDaemon* _pDaemon;
+        cSelfStats* _pSelfStats;
+        cSoakReader _reader;
+        gint64 _startTime = 0; // seconds
+
+        std::string plugDevice(guint slot, guint64 plugCount);
+        void unplugDevice(guint slot);
+        void printCheckpoint(struct sCheckpoint const & checkpoint, gint64 now);
+        static bool isGrowing(std::vector<gint64> const & values, gint64 slack);
+};
+
+#endif /* _CSOAKTEST_H */
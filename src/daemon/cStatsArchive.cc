@@ -0,0 +1,196 @@
+#include "cStatsArchive.hh"
+#include "../utils/log-event.hh"
+#include "cJsonParser.hh"
+#include "cJsonWriter.hh"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <string.h>
+#include <unistd.h>
+#ifdef KK_ZLIB
+#include <zlib.h>
+#endif
+
+// gzip framing for deflate and inflate, +32 detects it when inflating
+constexpr int CONST_GZIP_WINDOW_BITS = 15 + 16;
+constexpr int CONST_AUTO_WINDOW_BITS = 15 + 32;
+constexpr gsize CONST_READ_CHUNK_BYTES = 64 * 1024;
+
+// public functions
+
+bool cStatsArchive::isSupported(void)
+{
+#ifdef KK_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool cStatsArchive::append(
+    std::string const & archivePath, std::string const & text)
+{
+#ifdef KK_ZLIB
+    z_stream stream = {};
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED,
+            CONST_GZIP_WINDOW_BITS, 8, Z_DEFAULT_STRATEGY)
+        != Z_OK)
+    {
+        LOG_EVENT(LOG_ERR, "Unable to compress for [%s]\n",
+            archivePath.c_str());
+        return false; // failure
+    }
+    std::string member(deflateBound(&stream, text.size()), '\0');
+    stream.next_in   = (Bytef*)text.data();
+    stream.avail_in  = text.size();
+    stream.next_out  = (Bytef*)member.data();
+    stream.avail_out = member.size();
+    int result = deflate(&stream, Z_FINISH);
+    member.resize(member.size() - stream.avail_out);
+    deflateEnd(&stream);
+    if (result != Z_STREAM_END)
+    {
+        LOG_EVENT(LOG_ERR, "Unable to compress for [%s]\n",
+            archivePath.c_str());
+        return false; // failure
+    }
+
+    // a single write, a power loss tears at most this member
+    int fd = open(archivePath.c_str(),
+        O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    bool ret = fd >= 0
+        && write(fd, member.data(), member.size()) == (ssize_t)member.size()
+        && fdatasync(fd) == 0;
+    if (!ret)
+        LOG_EVENT(LOG_ERR, "Unable to append to [%s]: %s\n",
+            archivePath.c_str(), strerror(errno));
+    if (fd >= 0)
+        close(fd);
+    return ret;
+#else
+    LOG_EVENT(LOG_ERR, "Built without zlib, unable to write [%s]\n",
+        archivePath.c_str());
+    return false; // failure
+#endif
+}
+
+bool cStatsArchive::lookup(std::string const & archivePath,
+    std::string const & serialNumber,
+    std::vector<struct sJsonDeviceEntry>* pEntries)
+{
+#ifdef KK_ZLIB
+    int fd = open(archivePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        LOG_EVENT(LOG_ERR, "Unable to open [%s]: %s\n", archivePath.c_str(),
+            strerror(errno));
+        return false; // failure
+    }
+
+    z_stream stream = {};
+    if (inflateInit2(&stream, CONST_AUTO_WINDOW_BITS) != Z_OK)
+    {
+        close(fd);
+        return false; // failure
+    }
+
+    // inflated member by member, only one stats file is held at a time
+    std::string input(CONST_READ_CHUNK_BYTES, '\0');
+    std::string output(CONST_READ_CHUNK_BYTES, '\0');
+    std::string member;
+    bool ret = true;
+    bool torn = false;
+    while (ret)
+    {
+        if (stream.avail_in == 0)
+        {
+            auto count = read(fd, input.data(), input.size());
+            if (count < 0)
+            {
+                LOG_EVENT(LOG_ERR, "Unable to read [%s]: %s\n",
+                    archivePath.c_str(), strerror(errno));
+                ret = false;
+                break;
+            }
+            if (count == 0)
+            {
+                torn = !member.empty() || stream.total_in > 0;
+                break;
+            }
+            stream.next_in  = (Bytef*)input.data();
+            stream.avail_in = count;
+        }
+
+        stream.next_out  = (Bytef*)output.data();
+        stream.avail_out = output.size();
+        int result = inflate(&stream, Z_NO_FLUSH);
+        member.append(output.data(), output.size() - stream.avail_out);
+        if (result == Z_STREAM_END)
+        {
+            ret = lookupMember(member, serialNumber, pEntries);
+            member.clear();
+            inflateReset(&stream);
+        }
+        else if (result != Z_OK && result != Z_BUF_ERROR)
+        {
+            torn = true;
+            break;
+        }
+    }
+    inflateEnd(&stream);
+    close(fd);
+
+    if (torn)
+        LOG_EVENT(LOG_WARNING, "[%s] ends with a torn entry, ignored\n",
+            archivePath.c_str());
+    return ret;
+#else
+    LOG_EVENT(LOG_ERR, "Built without zlib, unable to read [%s]\n",
+        archivePath.c_str());
+    return false; // failure
+#endif
+}
+
+bool cStatsArchive::printLookup(
+    std::string const & archivePath, std::string const & serialNumber)
+{
+    std::vector<struct sJsonDeviceEntry> entries;
+    if (!lookup(archivePath, serialNumber, &entries))
+        return false; // failure
+
+    // oldest first, as they were archived
+    cJsonWriter writer;
+    for (auto &entry : entries)
+    {
+        std::vector<struct sJsonDeviceEntry> document = { entry };
+        std::string output;
+        if (!writer.writeJsonEntries(document, &output))
+            return false; // failure
+        std::cout << output << "\n";
+    }
+    std::cerr << entries.size() << " archived entries of [" << serialNumber
+              << "] in [" << archivePath << "]\n";
+    return true; // success
+}
+
+// private functions
+
+bool cStatsArchive::lookupMember(std::string const & member,
+    std::string const & serialNumber,
+    std::vector<struct sJsonDeviceEntry>* pEntries)
+{
+    cJsonParser parser;
+    std::vector<struct sJsonDeviceEntry> devices;
+    if (!parser.openJsonData(member.data(), member.size()))
+        return false; // failure
+    bool ret = parser.getDeviceEntries(&devices);
+    parser.closeJson();
+
+    for (auto &device : devices)
+    {
+        if (device.serialNumber == serialNumber)
+            pEntries->push_back(std::move(device));
+    }
+    return ret;
+}
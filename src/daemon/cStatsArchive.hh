@@ -0,0 +1,40 @@
+// cStatsArchive.hh
+#ifndef _CSTATSARCHIVE_H
+#define _CSTATSARCHIVE_H
+
+#include "../library/include/structs.hh"
+#include <glib.h>
+#include <string>
+#include <vector>
+
+/*
+Append-only archive of the stats file entries evicted by the retention
+policy.
+
+Every append() adds one gzip member holding a stats file with the evicted
+entries. Concatenated gzip members are a valid gzip file, so the archive
+reads as these stats files one after the other, e.g. with zcat. Appending
+never reads the archive, only lookup() does, inflating it member by member.
+A member torn by a power loss ends the lookup with a warning.
+*/
+class cStatsArchive
+{
+    public:
+        // built with zlib, otherwise appends and lookups fail
+        static bool isSupported(void);
+        bool append(std::string const & archivePath, std::string const & text);
+        bool lookup(std::string const & archivePath,
+            std::string const & serialNumber,
+            std::vector<struct sJsonDeviceEntry>* pEntries);
+        // each entry as a stats file on standard output, a count on
+        // standard error
+        bool printLookup(
+            std::string const & archivePath, std::string const & serialNumber);
+
+    private:
+        bool lookupMember(std::string const & member,
+            std::string const & serialNumber,
+            std::vector<struct sJsonDeviceEntry>* pEntries);
+};
+
+#endif /* _CSTATSARCHIVE_H */
@@ -0,0 +1,308 @@
+#include "cStatsMerger.hh"
+
+#include "../utils/log-event.hh"
+#include "cBinaryDump.hh"
+#include "cJsonWriter.hh"
+#include <algorithm>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+// converts g_get_monotonic_time() units to milliseconds
+constexpr gint64 CONST_MILLISECONDS_TO_MICROSECONDS = 1000;
+
+// public functions
+
+bool cStatsMerger::merge(std::string directory, guint workerCount,
+    std::vector<struct sJsonDeviceEntry>* pDevices)
+{
+    if (!findFiles(directory))
+        return false; // failure
+
+    // contiguous blocks, so stealing from the back splits the remainder
+    workerCount = std::clamp(workerCount, 1u, std::max(1u, getFileCount()));
+    _workers.clear();
+    for (guint i = 0; i < workerCount; i++)
+        _workers.push_back(std::make_unique<struct sWorker>());
+    for (guint i = 0; i < getFileCount(); i++)
+        _workers[(guint64)i * workerCount / getFileCount()]->files.push_back(i);
+
+    std::vector<std::thread> threads;
+    for (guint i = 1; i < workerCount; i++)
+        threads.emplace_back(&cStatsMerger::runWorker, this, i);
+    runWorker(0);
+    for (auto &thread : threads)
+        thread.join();
+
+    _failedCount  = 0;
+    _undatedCount = 0;
+    for (auto &pWorker : _workers)
+    {
+        _failedCount  += pWorker->failedCount;
+        _undatedCount += pWorker->undatedCount;
+    }
+
+    reduce();
+
+    // ordered by serial number, so merges of the same files are identical
+    auto &entries = _workers[0]->entries;
+    pDevices->clear();
+    pDevices->reserve(entries.size());
+    for (auto &[serialNumber, entry] : entries)
+        pDevices->push_back(std::move(entry));
+    std::sort(pDevices->begin(), pDevices->end(),
+        [](struct sJsonDeviceEntry const & a,
+            struct sJsonDeviceEntry const & b) {
+            return a.serialNumber < b.serialNumber;
+        });
+    _workers.clear();
+    return true; // success
+}
+
+bool cStatsMerger::mergeTo(std::string directory, std::string const & format,
+    std::string const & outputPath)
+{
+    if (format != "json" && format != "binary")
+    {
+        std::cerr << "merge format is json or binary\n";
+        return false; // failure
+    }
+
+    auto startTime = g_get_monotonic_time();
+    std::vector<struct sJsonDeviceEntry> devices;
+    if (!merge(directory, std::thread::hardware_concurrency(), &devices))
+        return false; // failure
+
+    std::string output;
+    if (format == "json")
+    {
+        cJsonWriter writer;
+        if (!writer.writeJsonEntries(devices, &output))
+            return false; // failure
+    }
+    else
+    {
+        cBinaryDump::appendHeader(&output, devices.size());
+        for (auto &device : devices)
+        {
+            cBinaryDump::appendEntry(&output, device.serialNumber,
+                device.totalBytesWritten, device.selfBytesWritten,
+                device.diskSeq, &device.stats);
+        }
+    }
+
+    if (outputPath.empty())
+    {
+        std::cout.write(output.data(), output.size());
+        std::cout.flush();
+    }
+    else
+    {
+        GError* pWriteError = nullptr;
+        if (!g_file_set_contents(outputPath.c_str(), output.data(),
+                output.size(), &pWriteError))
+        {
+            std::cerr << "Unable to write " << outputPath << ": "
+                      << pWriteError->message << "\n";
+            g_error_free(pWriteError);
+            return false; // failure
+        }
+    }
+
+    std::cerr << "Merged " << getFileCount() << " files ("
+              << getFailedCount() << " skipped), " << devices.size()
+              << " serial numbers, " << getUndatedCount()
+              << " without a first sighting date, in "
+              << (g_get_monotonic_time() - startTime)
+            / CONST_MILLISECONDS_TO_MICROSECONDS
+              << " ms\n";
+    return true; // success
+}
+
+// private functions
+
+bool cStatsMerger::findFiles(std::string directory)
+{
+    std::error_code error;
+    _paths.clear();
+    for (auto it = std::filesystem::recursive_directory_iterator(
+             directory, error);
+        !error && it != std::filesystem::recursive_directory_iterator();
+        it.increment(error))
+    {
+        if (it->is_regular_file(error) && it->path().extension() == ".json")
+            _paths.push_back(it->path());
+    }
+    if (error)
+    {
+        LOG_EVENT(LOG_ERR, "Unable to list [%s]: %s\n", directory.c_str(),
+            error.message().c_str());
+        return false; // failure
+    }
+    return true; // success
+}
+
+bool cStatsMerger::takeFile(guint workerIndex, guint* pFile)
+{
+    // own files from the front
+    auto pWorker = _workers[workerIndex].get();
+    {
+        std::lock_guard<std::mutex> lock(pWorker->mutex);
+        if (!pWorker->files.empty())
+        {
+            *pFile = pWorker->files.front();
+            pWorker->files.pop_front();
+            return true; // taken
+        }
+    }
+
+    // then steal from the back of the others, starting with the next one
+    for (guint i = 1; i < _workers.size(); i++)
+    {
+        auto pVictim = _workers[(workerIndex + i) % _workers.size()].get();
+        std::lock_guard<std::mutex> lock(pVictim->mutex);
+        if (!pVictim->files.empty())
+        {
+            *pFile = pVictim->files.back();
+            pVictim->files.pop_back();
+            return true; // stolen
+        }
+    }
+    return false; // all files taken
+}
+
+void cStatsMerger::runWorker(guint workerIndex)
+{
+    auto pWorker = _workers[workerIndex].get();
+    guint file   = 0;
+    while (takeFile(workerIndex, &file))
+    {
+        if (!parseFile(pWorker, _paths[file]))
+        {
+            LOG_EVENT(LOG_WARNING, "Skipping [%s]\n", _paths[file].c_str());
+            pWorker->failedCount++;
+        }
+    }
+}
+
+bool cStatsMerger::parseFile(
+    struct sWorker* pWorker, std::string const & path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false; // failure
+
+    // the buffer only grows, most files need no allocation
+    struct stat status;
+    bool valid = fstat(fd, &status) == 0;
+    gsize length = 0;
+    if (valid)
+    {
+        pWorker->buffer.resize(status.st_size);
+        while (length < pWorker->buffer.size())
+        {
+            auto count = read(fd, pWorker->buffer.data() + length,
+                pWorker->buffer.size() - length);
+            if (count <= 0)
+                break;
+            length += count;
+        }
+    }
+    close(fd);
+    if (!valid)
+        return false; // failure
+
+    // the devices vector keeps its capacity from the previous file
+    if (!pWorker->parser.openJsonData(pWorker->buffer.data(), length))
+        return false; // failure
+    pWorker->devices.clear();
+    valid = pWorker->parser.getDeviceEntries(&pWorker->devices);
+    pWorker->parser.closeJson();
+    if (!valid)
+        return false; // failure
+
+    for (auto &device : pWorker->devices)
+    {
+        // e.g. "14-11-Y 22:13:20" of builds without std::format
+        if (getSightingKey(device.firstSightingDate) == G_MAXINT64)
+        {
+            LOG_EVENT(LOG_WARNING, "Unable to parse firstSightingDate [%s] "
+                "of [%s] in [%s]\n", device.firstSightingDate.c_str(),
+                device.serialNumber.c_str(), path.c_str());
+            pWorker->undatedCount++;
+        }
+        mergeEntry(&pWorker->entries, std::move(device));
+    }
+    return true; // success
+}
+
+void cStatsMerger::reduce(void)
+{
+    // the entries of worker i + step are merged into worker i
+    for (guint step = 1; step < _workers.size(); step *= 2)
+    {
+        std::vector<std::thread> threads;
+        for (guint i = 0; i + step < _workers.size(); i += 2 * step)
+        {
+            threads.emplace_back([this, i, step]() {
+                auto &source = _workers[i + step]->entries;
+                for (auto &[serialNumber, entry] : source)
+                    mergeEntry(&_workers[i]->entries, std::move(entry));
+                source.clear();
+            });
+        }
+        for (auto &thread : threads)
+            thread.join();
+    }
+}
+
+void cStatsMerger::mergeEntry(
+    tEntries* pEntries, struct sJsonDeviceEntry&& entry)
+{
+    auto it = pEntries->find(entry.serialNumber);
+    if (it == pEntries->end())
+    {
+        auto serialNumber = entry.serialNumber;
+        pEntries->emplace(serialNumber, std::move(entry));
+        return;
+    }
+
+    // the first sighting is the earliest of all hosts
+    auto firstSightingDate = getSightingKey(entry.firstSightingDate)
+            < getSightingKey(it->second.firstSightingDate)
+        ? entry.firstSightingDate : it->second.firstSightingDate;
+    // and the last time any of them saw it
+    auto lastSeenTime = std::max(entry.lastSeenTime, it->second.lastSeenTime);
+    if (isNewer(entry, it->second))
+        it->second = std::move(entry);
+    it->second.firstSightingDate = firstSightingDate;
+    it->second.lastSeenTime      = lastSeenTime;
+}
+
+bool cStatsMerger::isNewer(
+    struct sJsonDeviceEntry const & a, struct sJsonDeviceEntry const & b)
+{
+    // diskSeq counts per host, so the host which saw the card last wins,
+    // then the most bytes written
+    if (a.lastSeenTime != b.lastSeenTime)
+        return a.lastSeenTime > b.lastSeenTime;
+    return a.totalBytesWritten > b.totalBytesWritten;
+}
+
+gint64 cStatsMerger::getSightingKey(std::string const & date)
+{
+    // "DD-MM-YYYY HH:MM:SS", sortable as YYYYMMDDHHMMSS
+    int day = 0, month = 0, year = 0, hour = 0, minute = 0, second = 0;
+    if (sscanf(date.c_str(), "%d-%d-%d %d:%d:%d", &day, &month, &year,
+            &hour, &minute, &second) != 6
+        || day < 1 || day > 31 || month < 1 || month > 12)
+    {
+        return G_MAXINT64; // unknown, any valid date is earlier
+    }
+    return ((((year * 100LL + month) * 100 + day) * 100 + hour) * 100
+        + minute) * 100 + second;
+}
@@ -0,0 +1,71 @@
+// cStatsMerger.hh
+#ifndef _CSTATSMERGER_H
+#define _CSTATSMERGER_H
+
+#include "../library/include/structs.hh"
+#include "cJsonParser.hh"
+#include <deque>
+#include <glib.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+Merges the stats files of a fleet into one entry per serial number.
+
+The files are parsed by a pool of workers. Each worker owns a deque of
+files, takes from its front and steals from the back of another deque
+once its own is empty, so a few large files don't leave the others idle.
+A worker reads every file into a buffer and parses it with a parser, both
+reused for the next file, and keeps its own entries by serial number. The per-worker entries are then
+reduced pairwise in a tree, the pairs of each round in parallel.
+*/
+class cStatsMerger
+{
+    public:
+        bool merge(std::string directory, guint workerCount,
+            std::vector<struct sJsonDeviceEntry>* pDevices);
+        // merges on a thread per core and writes the result as "json" or
+        // "binary" to outputPath, standard output if empty, with a summary
+        // on standard error
+        bool mergeTo(std::string directory, std::string const & format,
+            std::string const & outputPath);
+        guint getFileCount(void) const { return _paths.size(); }
+        guint getFailedCount(void) const { return _failedCount; }
+        // entries whose firstSightingDate isn't a date, any other is earlier
+        guint getUndatedCount(void) const { return _undatedCount; }
+
+    private:
+        using tEntries = std::unordered_map<std::string, struct sJsonDeviceEntry>;
+
+        struct sWorker
+        {
+                std::mutex mutex;
+                std::deque<guint> files; // indices into _paths
+                std::string buffer;      // contents of the current file
+                cJsonParser parser;
+                std::vector<struct sJsonDeviceEntry> devices;
+                tEntries entries;
+                guint failedCount = 0;
+                guint undatedCount = 0;
+        };
+
+        std::vector<std::string> _paths;
+        std::vector<std::unique_ptr<struct sWorker>> _workers;
+        guint _failedCount = 0;
+        guint _undatedCount = 0;
+        bool findFiles(std::string directory);
+        bool takeFile(guint workerIndex, guint* pFile);
+        void runWorker(guint workerIndex);
+        bool parseFile(struct sWorker* pWorker, std::string const & path);
+        void reduce(void);
+        static void mergeEntry(
+            tEntries* pEntries, struct sJsonDeviceEntry&& entry);
+        static bool isNewer(struct sJsonDeviceEntry const & a,
+            struct sJsonDeviceEntry const & b);
+        static gint64 getSightingKey(std::string const & date);
+};
+
+#endif /* _CSTATSMERGER_H */
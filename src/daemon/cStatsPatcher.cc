@@ -0,0 +1,266 @@
+#include "cStatsPatcher.hh"
+#include "../utils/log-event.hh"
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// previousStats members, then those of the entry itself
+constexpr guint CONST_STATS_FIELD_COUNT = 15;
+constexpr std::array<std::string_view, cStatsPatcher::CONST_FIELD_COUNT>
+    CONST_FIELD_NAMES = { "readIo", "readMerges", "readSectors", "readTicks",
+        "writeIo", "writeMerges", "writeSectors", "writeTicks", "inFlight",
+        "ioTicks", "timeInQueue", "discardIo", "discardMerges",
+        "discardSectors", "discardTicks", "diskSeq", "totalBytesWritten",
+        "selfBytesWritten" };
+
+// destructor
+
+cStatsPatcher::~cStatsPatcher() { close(); }
+
+// public functions
+
+bool cStatsPatcher::load(std::string statsFilePath)
+{
+    close();
+
+    gchar* pContents   = nullptr;
+    gsize length       = 0;
+    GError* pFileError = nullptr;
+    if (!g_file_get_contents(
+            statsFilePath.c_str(), &pContents, &length, &pFileError))
+    {
+        LOG_EVENT(LOG_ERR, "Unable to read [%s]: %s\n", statsFilePath.c_str(),
+            pFileError->message);
+        g_error_free(pFileError);
+        return false; // failure
+    }
+    std::string text(pContents, length);
+    g_free(pContents);
+    scan(text, &_entries, nullptr);
+
+    _fd = open(statsFilePath.c_str(), O_WRONLY | O_CLOEXEC);
+    struct stat status;
+    if (_fd < 0 || fstat(_fd, &status) != 0)
+    {
+        LOG_EVENT(LOG_ERR, "Unable to open [%s]: %s\n", statsFilePath.c_str(),
+            strerror(errno));
+        close();
+        return false; // failure
+    }
+    _path   = statsFilePath;
+    _device = status.st_dev;
+    _inode  = status.st_ino;
+    return true; // success
+}
+
+bool cStatsPatcher::patch(std::string const & serialNumber,
+    std::string const & previousPath, struct sBlockStats* pStats,
+    gint64 diskSeq, gint64 totalBytesWritten, gint64 selfBytesWritten)
+{
+    if (_fd < 0)
+        return false; // not loaded
+
+    // the file was replaced, e.g. by a checkpoint of the volatile file
+    struct stat status;
+    if (stat(_path.c_str(), &status) != 0 || status.st_dev != _device
+        || status.st_ino != _inode)
+    {
+        close();
+        return false; // needs a full write
+    }
+
+    auto it = _entries.find(serialNumber);
+    if (it == _entries.end() || it->second.fieldCount != CONST_FIELD_COUNT
+        || it->second.previousPath != previousPath)
+    {
+        return false; // needs a full write
+    }
+
+    const std::array<gint64, CONST_FIELD_COUNT> values = { pStats->readIo,
+        pStats->readMerges, pStats->readSectors, pStats->readTicks,
+        pStats->writeIo, pStats->writeMerges, pStats->writeSectors,
+        pStats->writeTicks, pStats->inFlight, pStats->ioTicks,
+        pStats->timeInQueue, pStats->discardIo, pStats->discardMerges,
+        pStats->discardSectors, pStats->discardTicks, diskSeq,
+        totalBytesWritten, selfBytesWritten };
+
+    auto pEntry = &it->second;
+    for (guint i = 0; i < CONST_FIELD_COUNT; i++)
+    {
+        if (values[i] == pEntry->values[i])
+            continue;
+
+        char field[CONST_FIELD_WIDTH + 1];
+        snprintf(field, sizeof(field), "%*lld", (int)CONST_FIELD_WIDTH,
+            (long long)values[i]);
+        if (pwrite(_fd, field, CONST_FIELD_WIDTH, pEntry->offsets[i])
+            != CONST_FIELD_WIDTH)
+        {
+            LOG_EVENT(LOG_ERR, "Unable to patch [%s]: %s\n", _path.c_str(),
+                strerror(errno));
+            close();
+            return false; // needs a full write
+        }
+        pEntry->values[i] = values[i];
+        _dirty = true;
+    }
+    return true; // success
+}
+
+bool cStatsPatcher::sync(void)
+{
+    if (_fd < 0 || !_dirty)
+        return true; // nothing written
+
+    _dirty = false;
+    _patchCount++;
+    if (fdatasync(_fd) != 0)
+    {
+        LOG_EVENT(LOG_ERR, "Unable to sync [%s]: %s\n", _path.c_str(),
+            strerror(errno));
+        return false; // failure
+    }
+    return true; // success
+}
+
+void cStatsPatcher::close(void)
+{
+    if (_fd >= 0)
+    {
+        sync();
+        ::close(_fd);
+    }
+    _fd         = -1;
+    _patchCount = 0;
+    _entries.clear();
+}
+
+void cStatsPatcher::padFields(std::string_view text, std::string* pPadded)
+{
+    pPadded->clear();
+    pPadded->reserve(text.size() + text.size() / 4);
+    scan(text, nullptr, pPadded);
+}
+
+// private functions
+
+void cStatsPatcher::scan(std::string_view text,
+    std::map<std::string, struct sEntry>* pEntries, std::string* pPadded)
+{
+    std::vector<char> containers;  // '{' or '[' of every open container
+    std::vector<std::string> keys; // current member name per container
+    gsize copied = 0;              // text already copied to pPadded
+
+    gsize i = 0;
+    while (i < text.size())
+    {
+        char c = text[i];
+        if (c == '"')
+        {
+            gsize end = i + 1;
+            while (end < text.size() && text[end] != '"')
+                end += text[end] == '\\' ? 2 : 1;
+            gsize next = end + 1;
+            while (next < text.size() && isspace((unsigned char)text[next]))
+                next++;
+
+            // a member name is followed by a colon
+            if (!containers.empty() && containers.back() == '{'
+                && next < text.size() && text[next] == ':')
+            {
+                keys.back() = text.substr(i + 1, end - i - 1);
+            }
+            else if (pEntries != nullptr && containers.size() == 2
+                && keys[1] == "previousPath")
+            {
+                (*pEntries)[keys[0]].previousPath
+                    = text.substr(i + 1, end - i - 1);
+            }
+            i = end + 1;
+            continue;
+        }
+        if (c == '{' || c == '[')
+        {
+            containers.push_back(c);
+            keys.emplace_back();
+            i++;
+            continue;
+        }
+        if (c == '}' || c == ']')
+        {
+            if (!containers.empty())
+            {
+                containers.pop_back();
+                keys.pop_back();
+            }
+            i++;
+            continue;
+        }
+        if (c != '-' && !isdigit((unsigned char)c))
+        {
+            i++;
+            continue;
+        }
+
+        gsize end = i;
+        while (end < text.size()
+            && (isdigit((unsigned char)text[end]) || text[end] == '-'
+                || text[end] == '+' || text[end] == '.' || text[end] == 'e'
+                || text[end] == 'E'))
+            end++;
+        int index = containers.empty() || containers.back() != '{'
+                || keys[0].starts_with("_")
+            ? -1
+            : getFieldIndex(containers.size(), keys.size() > 1 ? keys[1] : "",
+                keys.back());
+        gsize length = end - i;
+
+        if (index >= 0 && pPadded != nullptr && length < CONST_FIELD_WIDTH)
+        {
+            pPadded->append(text, copied, i - copied);
+            pPadded->append(CONST_FIELD_WIDTH - length, ' ');
+            copied = i;
+        }
+
+        // the field ends with the number, separated from the colon
+        gsize start = end - CONST_FIELD_WIDTH;
+        if (index >= 0 && pEntries != nullptr && end > CONST_FIELD_WIDTH
+            && text.find_first_not_of(' ', start - 1) >= i)
+        {
+            auto pEntry = &(*pEntries)[keys[0]];
+            if (pEntry->fieldCount == 0)
+                pEntry->offsets.fill(-1);
+            if (pEntry->offsets[index] < 0)
+                pEntry->fieldCount++;
+            pEntry->offsets[index] = start;
+            // JSON never ends with a number, strtoll() stops within the view
+            pEntry->values[index]  = strtoll(text.data() + i, nullptr, 10);
+        }
+        i = end;
+    }
+
+    if (pPadded != nullptr)
+        pPadded->append(text, copied, std::string::npos);
+}
+
+int cStatsPatcher::getFieldIndex(
+    guint depth, std::string const & section, std::string const & name)
+{
+    // previousStats of an entry, or a member of the entry
+    guint first = depth == 3 && section == "previousStats" ? 0
+        : depth == 2 ? CONST_STATS_FIELD_COUNT : CONST_FIELD_COUNT;
+    guint last = depth == 3 ? CONST_STATS_FIELD_COUNT : CONST_FIELD_COUNT;
+    for (guint i = first; i < last; i++)
+    {
+        if (CONST_FIELD_NAMES[i] == name)
+            return i;
+    }
+    return -1; // not a counter
+}
@@ -0,0 +1,66 @@
+// cStatsPatcher.hh
+#ifndef _CSTATSPATCHER_H
+#define _CSTATSPATCHER_H
+
+#include "../library/include/structs.hh"
+#include <array>
+#include <glib.h>
+#include <map>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+
+/*
+Updates the counters of a stats file in place.
+
+A stats file written with padFields() holds the counters of previousStats,
+diskSeq, totalBytesWritten and selfBytesWritten right-aligned in fields of
+CONST_FIELD_WIDTH characters, which is still valid JSON. load() records the
+offset of every field per serial number, patch() then overwrites only the
+fields whose value changed with pwrite() and sync() makes them durable with
+a single fdatasync(). Anything else in the file, e.g. the histograms, is
+only updated when the file is written in full again.
+*/
+class cStatsPatcher
+{
+    public:
+        static constexpr guint CONST_FIELD_WIDTH = 20; // any gint64
+        static constexpr guint CONST_FIELD_COUNT = 18;
+
+        ~cStatsPatcher();
+        bool load(std::string statsFilePath);
+        bool patch(std::string const & serialNumber,
+            std::string const & previousPath, struct sBlockStats* pStats,
+            gint64 diskSeq, gint64 totalBytesWritten, gint64 selfBytesWritten);
+        bool sync(void);
+        void close(void);
+        // patched writes made durable since load()
+        guint getPatchCount(void) const { return _patchCount; }
+
+        // the generated text of cJsonWriter with the counters padded
+        static void padFields(std::string_view text, std::string* pPadded);
+
+    private:
+        struct sEntry
+        {
+                std::string previousPath;
+                std::array<gint64, CONST_FIELD_COUNT> offsets;
+                std::array<gint64, CONST_FIELD_COUNT> values;
+                guint fieldCount;
+        };
+
+        std::string _path;
+        int _fd        = -1;
+        dev_t _device  = 0;
+        ino_t _inode   = 0;
+        bool _dirty    = false;
+        guint _patchCount = 0; // syncs since load()
+        std::map<std::string, struct sEntry> _entries;
+        static void scan(std::string_view text,
+            std::map<std::string, struct sEntry>* pEntries,
+            std::string* pPadded);
+        static int getFieldIndex(guint depth, std::string const & section,
+            std::string const & name);
+};
+
+#endif /* _CSTATSPATCHER_H */
@@ -0,0 +1,182 @@
+#include "cTimerWheel.hh"
+
+#include <algorithm>
+
+// beyond this many ticks a catch up rebuilds the wheel instead
+constexpr gint64 CONST_MAX_CATCH_UP_TICKS
+    = (gint64)cTimerWheel::CONST_SLOTS * cTimerWheel::CONST_SLOTS;
+
+static gint64 getLevelRange(guint level)
+{
+    return (gint64)1 << (cTimerWheel::CONST_SLOT_BITS * (level + 1));
+}
+
+static guint getSlot(gint64 time, guint level)
+{
+    return (time >> (cTimerWheel::CONST_SLOT_BITS * level))
+        & (cTimerWheel::CONST_SLOTS - 1);
+}
+
+// public functions
+
+void cTimerWheel::reset(gint64 now)
+{
+    for (auto &level : _slots)
+    {
+        for (auto &slot : level)
+        {
+            slot.clear();
+        }
+    }
+    _now = now;
+}
+
+void cTimerWheel::reserve(guint timerCount)
+{
+    for (auto &level : _slots)
+    {
+        for (auto &slot : level)
+        {
+            slot.reserve(timerCount);
+        }
+    }
+    _cascaded.reserve(timerCount);
+}
+
+void cTimerWheel::add(std::string key, gint64 deadline)
+{
+    // overdue timers expire on the next tick
+    place({ .key = std::move(key), .deadline = deadline }, 1);
+}
+
+void cTimerWheel::remove(std::string key)
+{
+    for (auto &level : _slots)
+    {
+        for (auto &slot : level)
+        {
+            std::erase_if(slot,
+                [&key](struct sTimer const & timer) { return timer.key == key; });
+        }
+    }
+}
+
+bool cTimerWheel::getNextDeadline(gint64* pDeadline) const
+{
+    // the first non-empty slot of each level holds that level's earliest
+    bool found = false;
+    for (guint level = 0; level < CONST_LEVELS; level++)
+    {
+        for (guint i = 1; i <= CONST_SLOTS; i++)
+        {
+            auto time = _now + ((gint64)i << (CONST_SLOT_BITS * level));
+            auto const & slot = _slots[level][getSlot(time, level)];
+            if (slot.empty())
+            {
+                continue;
+            }
+            for (auto const & timer : slot)
+            {
+                if (!found || timer.deadline < *pDeadline)
+                {
+                    *pDeadline = timer.deadline;
+                    found      = true;
+                }
+            }
+            break;
+        }
+    }
+    return found;
+}
+
+void cTimerWheel::advance(gint64 now, std::vector<std::string>* pDue)
+{
+    pDue->clear();
+
+    // e.g. after a suspend, everything is due at once
+    if (now - _now > CONST_MAX_CATCH_UP_TICKS)
+    {
+        std::vector<struct sTimer> timers;
+        for (auto &level : _slots)
+        {
+            for (auto &slot : level)
+            {
+                timers.insert(timers.end(), slot.begin(), slot.end());
+                slot.clear();
+            }
+        }
+        _now = now;
+        for (auto &timer : timers)
+        {
+            if (timer.deadline <= now)
+            {
+                pDue->push_back(std::move(timer.key));
+            }
+            else
+            {
+                place(std::move(timer), 1);
+            }
+        }
+        return;
+    }
+
+    while (_now < now)
+    {
+        _now++;
+
+        // higher levels first, their timers may land in a lower block
+        for (guint level = CONST_LEVELS - 1; level > 0; level--)
+        {
+            if ((_now & (getLevelRange(level - 1) - 1)) == 0)
+            {
+                cascade(level);
+            }
+        }
+
+        auto &slot = _slots[0][getSlot(_now, 0)];
+        for (auto &timer : slot)
+        {
+            pDue->push_back(std::move(timer.key));
+        }
+        slot.clear();
+    }
+}
+
+gint64 cTimerWheel::getAlignedDeadline(gint64 now, gint64 interval)
+{
+    interval = std::max<gint64>(interval, 1);
+    return (now / interval + 1) * interval;
+}
+
+// private functions
+
+void cTimerWheel::place(struct sTimer&& timer, gint64 minimumDelta)
+{
+    auto delta = std::max<gint64>(timer.deadline - _now, minimumDelta);
+
+    guint level = 0;
+    while (level < CONST_LEVELS - 1 && delta >= getLevelRange(level))
+    {
+        level++;
+    }
+    // too far ahead, parked in the last slot and placed again from there
+    auto time = _now + std::min(delta, getLevelRange(level) - 1);
+    _slots[level][getSlot(time, level)].push_back(std::move(timer));
+}
+
+void cTimerWheel::cascade(guint level)
+{
+    // moved out element by element, both vectors keep their capacity
+    auto &slot = _slots[level][getSlot(_now, level)];
+    _cascaded.clear();
+    for (auto &timer : slot)
+    {
+        _cascaded.push_back(std::move(timer));
+    }
+    slot.clear();
+    // a timer due now lands in the level 0 slot expired next
+    for (auto &timer : _cascaded)
+    {
+        place(std::move(timer), 0);
+    }
+}
@@ -0,0 +1,55 @@
+// cTimerWheel.hh
+#ifndef _CTIMERWHEEL_H
+#define _CTIMERWHEEL_H
+
+#include <array>
+#include <glib.h>
+#include <string>
+#include <vector>
+
+/*
+Hierarchical timer wheel with a resolution of one second.
+
+Level 0 has a slot per second for the next CONST_SLOTS seconds, every
+further level covers CONST_SLOTS times the range of the one below. Timers
+move down a level when the wheel reaches the block they fall due in, so
+adding, cascading and expiring are O(1) per timer. The owner sleeps until
+getNextDeadline() with a single OS timer and collects every timer due at
+that second in one call to advance(). Keys are moved rather than copied,
+so once the slots are reserved a timer re-added after expiring allocates
+nothing.
+*/
+class cTimerWheel
+{
+    public:
+        static constexpr guint CONST_SLOT_BITS = 6;
+        static constexpr guint CONST_SLOTS     = 1 << CONST_SLOT_BITS;
+        static constexpr guint CONST_LEVELS    = 4; // about 194 days
+
+        void reset(gint64 now);
+        // room for timerCount timers in every slot, none is allocated later
+        void reserve(guint timerCount);
+        void add(std::string key, gint64 deadline);
+        void remove(std::string key);
+        bool getNextDeadline(gint64* pDeadline) const;
+        void advance(gint64 now, std::vector<std::string>* pDue);
+
+        // next multiple of interval after now, so units sample in step
+        static gint64 getAlignedDeadline(gint64 now, gint64 interval);
+
+    private:
+        struct sTimer
+        {
+                std::string key;
+                gint64 deadline; // seconds, same clock as now
+        };
+
+        std::array<std::array<std::vector<struct sTimer>, CONST_SLOTS>,
+            CONST_LEVELS> _slots;
+        std::vector<struct sTimer> _cascaded; // reused by every cascade
+        gint64 _now = 0;
+        void place(struct sTimer&& timer, gint64 minimumDelta);
+        void cascade(guint level);
+};
+
+#endif /* _CTIMERWHEEL_H */
@@ -0,0 +1,331 @@
+#include "cTraceDecoder.hh"
+#include "cTraceRecorder.hh"
+#include "../utils/log-event.hh"
+#include "../utils/trace-codec.hh"
+
+#include <algorithm>
+#include <array>
+#include <errno.h>
+#include <set>
+#include <stdio.h>
+#include <string.h>
+
+// a corrupt size is not allowed to exhaust memory
+constexpr guint32 CONST_MAX_CHUNK_BYTES = 64 * 1024 * 1024;
+constexpr gint64 CONST_MILLISECONDS_TO_MICROSECONDS = 1000;
+constexpr gint64 CONST_SECONDS_TO_MICROSECONDS      = 1000000;
+
+constexpr const char* CONST_STAT_NAMES[] = { "readIo", "readMerges",
+    "readSectors", "readTicks", "writeIo", "writeMerges", "writeSectors",
+    "writeTicks", "inFlight", "ioTicks", "timeInQueue", "discardIo",
+    "discardMerges", "discardSectors", "discardTicks" };
+
+static std::array<gint64, std::size(CONST_STAT_NAMES)> getStatValues(
+    struct sBlockStats const & stats)
+{
+    return { stats.readIo, stats.readMerges, stats.readSectors,
+        stats.readTicks, stats.writeIo, stats.writeMerges, stats.writeSectors,
+        stats.writeTicks, stats.inFlight, stats.ioTicks, stats.timeInQueue,
+        stats.discardIo, stats.discardMerges, stats.discardSectors,
+        stats.discardTicks };
+}
+
+static std::string escapeJson(std::string const & text)
+{
+    std::string escaped;
+    for (unsigned char character : text)
+    {
+        if (character == '"' || character == '\\')
+        {
+            escaped += '\\';
+            escaped += character;
+        }
+        else if (character < 0x20)
+        {
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", character);
+            escaped += code;
+        }
+        else
+        {
+            escaped += character;
+        }
+    }
+    return escaped;
+}
+
+static std::string formatTime(gint64 realTime)
+{
+    char time[32];
+    snprintf(time, sizeof(time), "%lld.%03lld",
+        (long long)(realTime / CONST_SECONDS_TO_MICROSECONDS),
+        (long long)(realTime % CONST_SECONDS_TO_MICROSECONDS
+            / CONST_MILLISECONDS_TO_MICROSECONDS));
+    return time;
+}
+
+// public functions
+
+cTraceDecoder::~cTraceDecoder()
+{
+    if (_pFile)
+        fclose(_pFile);
+}
+
+bool cTraceDecoder::open(std::string tracePath)
+{
+    if (_pFile)
+        fclose(_pFile);
+    _pFile = fopen(tracePath.c_str(), "rb");
+    if (_pFile == nullptr)
+    {
+        LOG_EVENT(LOG_ERR, "Failed to open [%s], %s", tracePath.c_str(),
+            strerror(errno));
+        return false; // failure
+    }
+    _tracePath  = tracePath;
+    _offset     = 0;
+    _isFinished = false;
+    return true; // success
+}
+
+bool cTraceDecoder::isFinished(void) { return _isFinished; }
+
+bool cTraceDecoder::readChunk(std::vector<struct sTraceRecord>* pRecords)
+{
+    pRecords->clear();
+
+    guint8 header[cTraceRecorder::CONST_HEADER_BYTES];
+    auto length = fread(header, 1, sizeof(header), _pFile);
+    if (length == 0)
+    {
+        _isFinished = true;
+        return true; // success, end of the trace
+    }
+    if (length != sizeof(header)
+        || TraceCodecGetUint32(header) != cTraceRecorder::CONST_CHUNK_MAGIC)
+    {
+        LOG_EVENT(LOG_ERR, "No trace chunk at offset %llu\n",
+            (unsigned long long)_offset);
+        return false; // failure
+    }
+
+    auto chunkSize    = TraceCodecGetUint32(header + 4);
+    auto payloadBytes = TraceCodecGetUint32(header + 8);
+    auto crc          = TraceCodecGetUint32(header + 12);
+    if (chunkSize > CONST_MAX_CHUNK_BYTES
+        || payloadBytes > chunkSize - sizeof(header))
+    {
+        LOG_EVENT(LOG_ERR, "Corrupt trace chunk header at offset %llu\n",
+            (unsigned long long)_offset);
+        return false; // failure
+    }
+
+    std::vector<guint8> chunk(chunkSize - sizeof(header));
+    if (fread(chunk.data(), 1, chunk.size(), _pFile) != chunk.size())
+    {
+        // the last chunk may be cut short by a power loss
+        LOG_EVENT(LOG_WARNING, "Trace chunk at offset %llu is truncated\n",
+            (unsigned long long)_offset);
+        _isFinished = true;
+        return true; // success
+    }
+
+    auto offset = _offset;
+    _offset += chunkSize;
+    if (TraceCodecCrc32(chunk.data(), payloadBytes) != crc)
+    {
+        LOG_EVENT(LOG_WARNING, "Skipping trace chunk at offset %llu, bad CRC\n",
+            (unsigned long long)offset);
+        return true; // success, the following chunks are still readable
+    }
+    if (!decodePayload(chunk.data(), chunk.data() + payloadBytes, pRecords))
+    {
+        LOG_EVENT(LOG_ERR, "Corrupt trace chunk at offset %llu\n",
+            (unsigned long long)offset);
+        pRecords->clear();
+        return false; // failure
+    }
+    return true; // success
+}
+
+bool cTraceDecoder::decode(std::string format, std::ostream &output)
+{
+    if (format != "csv" && format != "json" && format != "trace")
+    {
+        LOG_EVENT(LOG_ERR, "Unknown trace format [%s]\n", format.c_str());
+        return false; // failure
+    }
+
+    // the replay format declares every device before the first sample
+    std::vector<struct sTraceRecord> records;
+    if (format == "trace")
+    {
+        std::set<std::pair<std::string, std::string>> devices;
+        while (!_isFinished)
+        {
+            if (!readChunk(&records))
+                return false; // failure
+            for (auto const & record : records)
+                devices.insert({ record.deviceName, record.serialNumber });
+        }
+        for (auto const & [deviceName, serialNumber] : devices)
+            output << "device " << deviceName << " "
+                   << (serialNumber.empty() ? "-" : serialNumber) << "\n";
+        if (!open(_tracePath))
+            return false; // failure
+    }
+    else if (format == "csv")
+    {
+        output << "time,monotonicTime,deviceName,serialNumber,diskSeq";
+        for (auto pName : CONST_STAT_NAMES)
+            output << "," << pName;
+        output << "\n";
+    }
+    else
+    {
+        output << "[";
+    }
+
+    bool isFirst = true;
+    while (!_isFinished)
+    {
+        if (!readChunk(&records))
+            return false; // failure
+        for (auto &record : records)
+        {
+            auto values = getStatValues(record.stats);
+            if (format == "trace")
+            {
+                // whole seconds, the resolution of the replay clock
+                output << record.realTime / CONST_SECONDS_TO_MICROSECONDS
+                       << " " << record.deviceName << " " << record.diskSeq;
+                for (auto value : values)
+                    output << " " << value;
+            }
+            else if (format == "csv")
+            {
+                output << formatTime(record.realTime) << ","
+                       << record.monotonicTime << "," << record.deviceName
+                       << "," << record.serialNumber << "," << record.diskSeq;
+                for (auto value : values)
+                    output << "," << value;
+            }
+            else
+            {
+                output << (isFirst ? "\n" : ",\n") << "{\"time\":"
+                       << formatTime(record.realTime) << ",\"monotonicTime\":"
+                       << record.monotonicTime << ",\"deviceName\":\""
+                       << escapeJson(record.deviceName)
+                       << "\",\"serialNumber\":\""
+                       << escapeJson(record.serialNumber)
+                       << "\",\"diskSeq\":" << record.diskSeq;
+                for (guint i = 0; i < std::size(CONST_STAT_NAMES); i++)
+                    output << ",\"" << CONST_STAT_NAMES[i] << "\":" << values[i];
+                output << "}";
+            }
+            if (format != "json")
+                output << "\n";
+            isFirst = false;
+        }
+    }
+    if (format == "json")
+        output << "\n]\n";
+    return true; // success
+}
+
+// private functions
+
+bool cTraceDecoder::decodePayload(const guint8* pData, const guint8* pEnd,
+    std::vector<struct sTraceRecord>* pRecords)
+{
+    guint64 realTimeBase, monotonicTimeBase, deviceCount;
+    if (!TraceCodecGetVarint(&pData, pEnd, &realTimeBase)
+        || !TraceCodecGetVarint(&pData, pEnd, &monotonicTimeBase)
+        || !TraceCodecGetVarint(&pData, pEnd, &deviceCount))
+        return false; // failure
+
+    auto getString = [&pData, pEnd](std::string* pValue) {
+        guint64 length;
+        if (!TraceCodecGetVarint(&pData, pEnd, &length)
+            || length > (guint64)(pEnd - pData))
+            return false; // failure
+        pValue->assign((const char*)pData, length);
+        pData += length;
+        return true; // success
+    };
+
+    for (guint64 device = 0; device < deviceCount; device++)
+    {
+        std::string deviceName, serialNumber;
+        guint64 sampleCount;
+        if (!getString(&deviceName) || !getString(&serialNumber)
+            || !TraceCodecGetVarint(&pData, pEnd, &sampleCount)
+            || sampleCount > (guint64)(pEnd - pData))
+            return false; // failure
+
+        std::array<std::vector<gint64>, cTraceRecorder::CONST_COLUMNS> columns;
+        for (auto &values : columns)
+        {
+            guint64 length;
+            if (!TraceCodecGetVarint(&pData, pEnd, &length)
+                || length > (guint64)(pEnd - pData))
+                return false; // failure
+            const guint8* pColumn    = pData;
+            const guint8* pColumnEnd = pData + length;
+            pData += length;
+
+            // changes of the delta, and runs of unchanged deltas
+            gint64 value = 0;
+            gint64 delta = 0;
+            values.reserve(sampleCount);
+            while (values.size() < sampleCount)
+            {
+                guint64 token, zigZag;
+                if (!TraceCodecGetVarint(&pColumn, pColumnEnd, &token))
+                    return false; // failure
+                if (token == 1)
+                {
+                    if (!TraceCodecGetVarint(&pColumn, pColumnEnd, &zigZag))
+                        return false; // failure
+                }
+                else if (token & 1)
+                {
+                    auto run = token >> 1;
+                    if (run > sampleCount - values.size())
+                        return false; // failure
+                    for (guint64 i = 0; i < run; i++)
+                        values.push_back(value += delta);
+                    continue;
+                }
+                else
+                {
+                    zigZag = token >> 1;
+                }
+                delta += TraceCodecUnZigZag(zigZag);
+                values.push_back(value += delta);
+            }
+        }
+
+        for (guint64 i = 0; i < sampleCount; i++)
+        {
+            auto c = [&columns, i](guint column) { return columns[column][i]; };
+            pRecords->push_back({ .deviceName = deviceName,
+                .serialNumber = serialNumber,
+                .monotonicTime = (gint64)monotonicTimeBase
+                    / CONST_MILLISECONDS_TO_MICROSECONDS + c(0),
+                .realTime = (gint64)realTimeBase
+                    + c(0) * CONST_MILLISECONDS_TO_MICROSECONDS,
+                .diskSeq = c(1),
+                .stats = { c(2), c(3), c(4), c(5), c(6), c(7), c(8), c(9),
+                    c(10), c(11), c(12), c(13), c(14), c(15), c(16) } });
+        }
+    }
+
+    // devices are stored one after the other, samples are read in time order
+    std::stable_sort(pRecords->begin(), pRecords->end(),
+        [](auto const & a, auto const & b) {
+            return a.monotonicTime < b.monotonicTime;
+        });
+    return true; // success
+}
@@ -0,0 +1,45 @@
+// cTraceDecoder.hh
+#ifndef _CTRACEDECODER_H
+#define _CTRACEDECODER_H
+
+#include "../library/include/structs.hh"
+#include <glib.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct sTraceRecord
+{
+        std::string deviceName;
+        std::string serialNumber;
+        gint64 monotonicTime; // milliseconds
+        gint64 realTime;      // microseconds
+        gint64 diskSeq;
+        struct sBlockStats stats;
+};
+
+/*
+Reads the binary traces written by cTraceRecorder back, a chunk at a time.
+A chunk failing its CRC is reported and skipped.
+*/
+class cTraceDecoder
+{
+    public:
+        ~cTraceDecoder();
+        bool open(std::string tracePath);
+        bool readChunk(std::vector<struct sTraceRecord>* pRecords);
+        bool isFinished(void);
+        // "csv", "json" or "trace" (the text format of --replay)
+        bool decode(std::string format, std::ostream &output);
+
+    private:
+        FILE* _pFile = nullptr;
+        std::string _tracePath;
+        guint64 _offset = 0;
+        bool _isFinished = false;
+
+        bool decodePayload(const guint8* pData, const guint8* pEnd,
+            std::vector<struct sTraceRecord>* pRecords);
+};
+
+#endif /* _CTRACEDECODER_H */
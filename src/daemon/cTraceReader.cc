@@ -0,0 +1,188 @@
+#include "cTraceReader.hh"
+#include "../utils/log-event.hh"
+
+#include <sstream>
+#include <stdlib.h>
+#include <string.h>
+
+constexpr guint CONST_STAT_FIELDS = 15;
+
+// public functions
+
+bool cTraceReader::open(std::string tracePath)
+{
+    _trace.open(tracePath);
+    if (!_trace.is_open())
+    {
+        LOG_EVENT(LOG_ERR, "Unable to open trace [%s]\n", tracePath.c_str());
+        return false; // failure
+    }
+
+    // the device declarations, up to the first sample
+    std::string line;
+    while (readLine(&line))
+    {
+        std::istringstream fields(line);
+        std::string keyword;
+        fields >> keyword;
+        if (keyword != "device")
+        {
+            if (!parseSample(line))
+                return false; // failure
+            break;
+        }
+
+        struct sTraceDevice device;
+        fields >> device.deviceName >> device.serialNumber >> device.devicePath;
+        if (device.serialNumber.empty())
+        {
+            LOG_EVENT(LOG_ERR, "Trace line %u: device without serial number\n",
+                _lineNumber);
+            return false; // failure
+        }
+        if (device.serialNumber == "-")
+            device.serialNumber.clear();
+        if (device.devicePath.empty())
+            device.devicePath = "/dev/" + device.deviceName;
+        _devices.push_back(device);
+        _samples[device.deviceName] = {};
+    }
+
+    if (_devices.empty() || !_hasPending)
+    {
+        LOG_EVENT(LOG_ERR, "Trace [%s] has no devices or no samples\n",
+            tracePath.c_str());
+        return false; // failure
+    }
+    return true; // success
+}
+
+bool cTraceReader::advance(gint64 time)
+{
+    while (_hasPending && _pendingTime <= time)
+    {
+        _samples[_pendingName] = _pendingSample;
+        _sampleCount++;
+        if (!readSample())
+            return false; // failure
+    }
+    return true; // success
+}
+
+bool cTraceReader::isFinished(void) { return !_hasPending; }
+
+gint64 cTraceReader::getStartTime(void) { return _pendingTime; }
+
+guint64 cTraceReader::getSampleCount(void) { return _sampleCount; }
+
+std::vector<struct sTraceDevice> const & cTraceReader::getDevices(void)
+{
+    return _devices;
+}
+
+bool cTraceReader::getStats(
+    std::string const & deviceName, struct sBlockStats* pStats)
+{
+    auto sample = _samples.find(deviceName);
+    if (sample == _samples.end() || !sample->second.isPresent)
+        return false; // failure
+
+    *pStats = sample->second.stats;
+    return true; // success
+}
+
+bool cTraceReader::getDiskSeq(std::string const & deviceName, gint64* pSeq)
+{
+    auto sample = _samples.find(deviceName);
+    if (sample == _samples.end() || !sample->second.isPresent)
+        return false; // failure
+
+    *pSeq = sample->second.diskSeq;
+    return true; // success
+}
+
+bool cTraceReader::hasDevice(std::string const & deviceName)
+{
+    auto sample = _samples.find(deviceName);
+    return sample != _samples.end() && sample->second.isPresent;
+}
+
+// private functions
+
+bool cTraceReader::readLine(std::string* pLine)
+{
+    while (std::getline(_trace, *pLine))
+    {
+        _lineNumber++;
+        auto start = pLine->find_first_not_of(" \t");
+        if (start != std::string::npos && (*pLine)[start] != '#')
+            return true; // success
+    }
+    return false; // end of the trace
+}
+
+bool cTraceReader::readSample(void)
+{
+    if (!readLine(&_line))
+    {
+        _hasPending = false;
+        return true; // end of the trace
+    }
+    return parseSample(_line);
+}
+
+bool cTraceReader::parseSample(std::string const & line)
+{
+    // strtoll rather than streams, a year of samples is parsed per run
+    const char* pText = line.c_str();
+    char* pEnd;
+    auto time = strtoll(pText, &pEnd, 10);
+    if (pEnd == pText)
+    {
+        LOG_EVENT(LOG_ERR, "Trace line %u: missing time\n", _lineNumber);
+        return false; // failure
+    }
+    if (_sampleCount > 0 && time < _pendingTime)
+    {
+        LOG_EVENT(LOG_ERR, "Trace line %u: time goes backwards\n", _lineNumber);
+        return false; // failure
+    }
+
+    pText = pEnd + strspn(pEnd, " \t");
+    std::string_view name(pText, strcspn(pText, " \t"));
+    if (!_samples.contains(name))
+    {
+        LOG_EVENT(LOG_ERR, "Trace line %u: undeclared device [%.*s]\n",
+            _lineNumber, (int)name.size(), name.data());
+        return false; // failure
+    }
+    pText += name.size();
+
+    struct sTraceSample sample = {};
+    if (std::string_view(pText + strspn(pText, " \t")) != "removed")
+    {
+        gint64 values[CONST_STAT_FIELDS + 1];
+        for (guint i = 0; i < CONST_STAT_FIELDS + 1; i++)
+        {
+            values[i] = strtoll(pText, &pEnd, 10);
+            if (pEnd == pText)
+            {
+                LOG_EVENT(LOG_ERR, "Trace line %u: expected diskseq and %u "
+                    "stat fields\n", _lineNumber, CONST_STAT_FIELDS);
+                return false; // failure
+            }
+            pText = pEnd;
+        }
+        sample.isPresent = true;
+        sample.diskSeq   = values[0];
+        sample.stats     = { values[1], values[2], values[3], values[4],
+            values[5], values[6], values[7], values[8], values[9], values[10],
+            values[11], values[12], values[13], values[14], values[15] };
+    }
+
+    _hasPending    = true;
+    _pendingTime   = time;
+    _pendingName   = name;
+    _pendingSample = sample;
+    return true; // success
+}
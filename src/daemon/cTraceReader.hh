@@ -0,0 +1,75 @@
+// cTraceReader.hh
+#ifndef _CTRACEREADER_H
+#define _CTRACEREADER_H
+
+#include "../library/cStatReader.hh"
+#include "../library/include/structs.hh"
+#include <fstream>
+#include <glib.h>
+#include <map>
+#include <string>
+#include <vector>
+
+struct sTraceDevice
+{
+        std::string deviceName;
+        std::string serialNumber;
+        std::string devicePath;
+};
+
+/*
+Replays block device samples recorded in a text trace.
+
+    # comment
+    device <name> <serial number> [path]
+    <seconds> <name> <diskseq> <the fields of /sys/block/<name>/stat>
+    <seconds> <name> removed
+
+Devices are declared before their first sample, "-" stands for an empty
+serial number. Samples are ordered by time. advance() applies every sample up to the given time, the reader
+then answers as sysfs would have at that time. The trace is streamed,
+only the latest sample of each device is held.
+*/
+class cTraceReader : public cStatReader
+{
+    public:
+        bool open(std::string tracePath);
+        bool advance(gint64 time);
+        bool isFinished(void);
+        gint64 getStartTime(void);
+        guint64 getSampleCount(void);
+        std::vector<struct sTraceDevice> const & getDevices(void);
+
+        bool getStats(std::string const & deviceName,
+            struct sBlockStats* pStats) override;
+        bool getDiskSeq(std::string const & deviceName, gint64* pSeq) override;
+        bool hasDevice(std::string const & deviceName) override;
+
+    private:
+        struct sTraceSample
+        {
+                gint64 diskSeq;
+                struct sBlockStats stats;
+                bool isPresent;
+        };
+
+        std::ifstream _trace;
+        guint _lineNumber = 0;
+        guint64 _sampleCount = 0;
+        std::vector<struct sTraceDevice> _devices;
+        // by device name, looked up with views of the line
+        std::map<std::string, struct sTraceSample, std::less<>> _samples;
+        std::string _line; // reused by every sample
+
+        // the first sample after the time advanced to
+        bool _hasPending = false;
+        gint64 _pendingTime = 0;
+        std::string _pendingName;
+        struct sTraceSample _pendingSample;
+
+        bool readLine(std::string* pLine);
+        bool readSample(void);
+        bool parseSample(std::string const & line);
+};
+
+#endif /* _CTRACEREADER_H */
@@ -0,0 +1,206 @@
+#include "cTraceRecorder.hh"
+#include "../utils/log-event.hh"
+#include "../utils/trace-codec.hh"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+// a varint takes at most 10 bytes, a sample adds a run and a value per
+// column, or a run, an escape and a value
+constexpr gsize CONST_MAX_VARINT_BYTES = 10;
+constexpr gsize CONST_MAX_SAMPLE_BYTES
+    = cTraceRecorder::CONST_COLUMNS * 3 * CONST_MAX_VARINT_BYTES;
+constexpr gint64 CONST_MILLISECONDS_TO_MICROSECONDS = 1000;
+
+// public functions
+
+cTraceRecorder::~cTraceRecorder() { close(); }
+
+bool cTraceRecorder::open(std::string tracePath, guint chunkBytes)
+{
+    if (chunkBytes < CONST_MIN_CHUNK_BYTES)
+    {
+        LOG_EVENT(LOG_ERR, "Trace chunks are at least %u bytes\n",
+            CONST_MIN_CHUNK_BYTES);
+        return false; // failure
+    }
+
+    // appended to, a restarted daemon continues the same trace
+    _fd = ::open(tracePath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+        0644);
+    if (_fd < 0)
+    {
+        LOG_EVENT(LOG_ERR, "Failed to open [%s], %s", tracePath.c_str(),
+            strerror(errno));
+        return false; // failure
+    }
+    _chunkBytes = chunkBytes;
+    _payload.reserve(chunkBytes);
+    _chunk.reserve(chunkBytes);
+    return true; // success
+}
+
+bool cTraceRecorder::isOpen(void) { return _fd >= 0; }
+
+bool cTraceRecorder::record(std::string const & deviceName,
+    std::string const & serialNumber, gint64 monotonicTime, gint64 realTime,
+    gint64 diskSeq, struct sBlockStats* pStats)
+{
+    if (_fd < 0)
+        return false; // failure
+
+    auto pDevice = _devices.begin();
+    auto pEnd    = _devices.begin() + _deviceCount;
+    while (pDevice != pEnd && (pDevice->deviceName != deviceName
+            || pDevice->serialNumber != serialNumber))
+        pDevice++;
+
+    // a new device adds its names, a length and a last run per column
+    gsize sampleBytes = CONST_MAX_SAMPLE_BYTES;
+    if (pDevice == pEnd)
+        sampleBytes += deviceName.size() + serialNumber.size()
+            + (2 * CONST_COLUMNS + 3) * CONST_MAX_VARINT_BYTES;
+    if (_deviceCount > 0
+        && CONST_HEADER_BYTES + _payloadBytes + sampleBytes > _chunkBytes)
+    {
+        if (!flush())
+            return false; // failure
+        pDevice = pEnd = _devices.begin();
+    }
+
+    if (_deviceCount == 0)
+    {
+        _realTimeBase      = realTime;
+        _monotonicTimeBase = monotonicTime;
+        _payloadBytes      = 3 * CONST_MAX_VARINT_BYTES;
+    }
+    if (pDevice == pEnd)
+    {
+        if (_deviceCount == _devices.size())
+            _devices.emplace_back();
+        pDevice = _devices.begin() + _deviceCount++;
+
+        // assigned, the strings keep their capacity
+        pDevice->deviceName   = deviceName;
+        pDevice->serialNumber = serialNumber;
+        pDevice->sampleCount  = 0;
+        for (auto &column : pDevice->columns)
+        {
+            column.previousValue = 0;
+            column.previousDelta = 0;
+            column.zeroRun       = 0;
+            column.bytes.clear();
+        }
+    }
+
+    // same order as the fields of sBlockStats
+    gint64 values[CONST_COLUMNS] = {
+        monotonicTime / CONST_MILLISECONDS_TO_MICROSECONDS
+            - _monotonicTimeBase / CONST_MILLISECONDS_TO_MICROSECONDS,
+        diskSeq, pStats->readIo, pStats->readMerges, pStats->readSectors,
+        pStats->readTicks, pStats->writeIo, pStats->writeMerges,
+        pStats->writeSectors, pStats->writeTicks, pStats->inFlight,
+        pStats->ioTicks, pStats->timeInQueue, pStats->discardIo,
+        pStats->discardMerges, pStats->discardSectors, pStats->discardTicks };
+    for (guint i = 0; i < CONST_COLUMNS; i++)
+    {
+        auto before = pDevice->columns[i].bytes.size();
+        encode(&pDevice->columns[i], values[i]);
+        _payloadBytes += pDevice->columns[i].bytes.size() - before;
+    }
+    pDevice->sampleCount++;
+    _payloadBytes += sampleBytes - CONST_MAX_SAMPLE_BYTES;
+    return true; // success
+}
+
+bool cTraceRecorder::flush(void)
+{
+    if (_fd < 0 || _deviceCount == 0)
+        return true; // success, nothing to write
+
+    _payload.clear();
+    TraceCodecPutVarint(&_payload, _realTimeBase);
+    TraceCodecPutVarint(&_payload, _monotonicTimeBase);
+    TraceCodecPutVarint(&_payload, _deviceCount);
+    for (gsize i = 0; i < _deviceCount; i++)
+    {
+        auto &device = _devices[i];
+        TraceCodecPutVarint(&_payload, device.deviceName.size());
+        _payload += device.deviceName;
+        TraceCodecPutVarint(&_payload, device.serialNumber.size());
+        _payload += device.serialNumber;
+        TraceCodecPutVarint(&_payload, device.sampleCount);
+        for (auto &column : device.columns)
+        {
+            // the values after the last one are all zero
+            if (column.zeroRun > 0)
+                TraceCodecPutVarint(&column.bytes, column.zeroRun << 1 | 1);
+            TraceCodecPutVarint(&_payload, column.bytes.size());
+            _payload += column.bytes;
+        }
+    }
+    _deviceCount  = 0;
+    _payloadBytes = 0;
+
+    // whole chunks only, the file grows by erase blocks
+    _chunk.clear();
+    auto chunkSize = (CONST_HEADER_BYTES + _payload.size() + _chunkBytes - 1)
+        / _chunkBytes * _chunkBytes;
+    TraceCodecPutUint32(&_chunk, CONST_CHUNK_MAGIC);
+    TraceCodecPutUint32(&_chunk, chunkSize);
+    TraceCodecPutUint32(&_chunk, _payload.size());
+    TraceCodecPutUint32(&_chunk, TraceCodecCrc32(_payload.data(), _payload.size()));
+    _chunk += _payload;
+    _chunk.resize(chunkSize, '\0');
+
+    if (write(_fd, _chunk.data(), _chunk.size()) != (ssize_t)_chunk.size()
+        || fdatasync(_fd) != 0)
+    {
+        LOG_EVENT(LOG_ERR, "Failed to write trace chunk, %s", strerror(errno));
+        return false; // failure
+    }
+    return true; // success
+}
+
+void cTraceRecorder::close(void)
+{
+    if (_fd < 0)
+        return;
+    flush();
+    ::close(_fd);
+    _fd = -1;
+}
+
+// private functions
+
+void cTraceRecorder::encode(struct sColumn* pColumn, gint64 value)
+{
+    // steady rates and idle counters give a delta-of-delta of zero
+    gint64 delta      = value - pColumn->previousValue;
+    gint64 deltaDelta = delta - pColumn->previousDelta;
+    pColumn->previousValue = value;
+    pColumn->previousDelta = delta;
+    if (deltaDelta == 0)
+    {
+        pColumn->zeroRun++;
+        return;
+    }
+
+    // the low bit tells a run of zeros from a value, an empty run escapes
+    // values too large to be shifted
+    if (pColumn->zeroRun > 0)
+        TraceCodecPutVarint(&pColumn->bytes, pColumn->zeroRun << 1 | 1);
+    pColumn->zeroRun = 0;
+    auto zigZag = TraceCodecZigZag(deltaDelta);
+    if (zigZag >> 63)
+    {
+        TraceCodecPutVarint(&pColumn->bytes, 1);
+        TraceCodecPutVarint(&pColumn->bytes, zigZag);
+    }
+    else
+    {
+        TraceCodecPutVarint(&pColumn->bytes, zigZag << 1);
+    }
+}
@@ -0,0 +1,74 @@
+// cTraceRecorder.hh
+#ifndef _CTRACERECORDER_H
+#define _CTRACERECORDER_H
+
+#include "../library/include/structs.hh"
+#include <array>
+#include <glib.h>
+#include <string>
+#include <vector>
+
+/*
+Records raw samples to a compact binary trace, see "Recording a Trace" in
+README.md for the layout.
+
+Samples are encoded as they arrive into one byte stream per column and
+device: the time in milliseconds, diskseq and the 15 counters. Each
+stream holds the zig-zag varint delta-of-delta of its values, runs of
+zeros are stored as their length, so a device whose counters don't move
+costs about a byte per sample for its time. A chunk is appended to the
+file, padded to the chunk size, once the next sample may not fit. The
+buffers are kept from chunk to chunk, so recording allocates nothing once
+they have grown to the size of a chunk.
+*/
+class cTraceRecorder
+{
+    public:
+        static constexpr guint32 CONST_CHUNK_MAGIC  = 0x3154544b; // "KTT1"
+        static constexpr guint CONST_HEADER_BYTES   = 16;
+        static constexpr guint CONST_COLUMNS        = 17;
+        static constexpr guint CONST_MIN_CHUNK_BYTES = 4096;
+
+        ~cTraceRecorder();
+        bool open(std::string tracePath, guint chunkBytes);
+        bool isOpen(void);
+        bool record(std::string const & deviceName,
+            std::string const & serialNumber,
+            gint64 monotonicTime, gint64 realTime, gint64 diskSeq,
+            struct sBlockStats* pStats);
+        bool flush(void);
+        void close(void);
+
+    private:
+        struct sColumn
+        {
+                gint64 previousValue;
+                gint64 previousDelta;
+                guint64 zeroRun;
+                std::string bytes;
+        };
+
+        struct sDeviceColumns
+        {
+                std::string deviceName;
+                std::string serialNumber;
+                guint64 sampleCount;
+                std::array<struct sColumn, CONST_COLUMNS> columns;
+        };
+
+        int _fd = -1;
+        guint _chunkBytes = 0;
+        gint64 _realTimeBase = 0;      // microseconds, first sample of the chunk
+        gint64 _monotonicTimeBase = 0; // microseconds, first sample of the chunk
+        gsize _payloadBytes = 0;       // upper bound of the encoded chunk
+        // the first _deviceCount are in the chunk, the others are kept with
+        // their buffers for the next chunks
+        std::vector<struct sDeviceColumns> _devices;
+        gsize _deviceCount = 0;
+        std::string _payload; // reused by every chunk
+        std::string _chunk;
+
+        void encode(struct sColumn* pColumn, gint64 value);
+};
+
+#endif /* _CTRACERECORDER_H */
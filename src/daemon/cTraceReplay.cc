@@ -0,0 +1,103 @@
+#include "cTraceReplay.hh"
+
+#include <iostream>
+#include <sstream>
+
+// converts g_get_monotonic_time() units to milliseconds
+constexpr gint64 CONST_MILLISECONDS_TO_MICROSECONDS = 1000;
+
+// public functions
+
+bool cTraceReplay::run(std::string const & tracePath)
+{
+    if (!_reader.open(tracePath))
+        return false; // failure
+
+    // the sampling path of the daemon, fed by the trace and its clock
+    auto startTime = _reader.getStartTime();
+    _pDaemon->startVirtualClock(&_reader, startTime);
+    if (!_reader.advance(startTime))
+        return false; // failure
+
+    if (!_pDaemon->loadVirtualConfig())
+        return false; // failure
+
+    std::vector<std::string> devicePaths;
+    for (auto const & device : _reader.getDevices())
+    {
+        _pDaemon->addVirtualDevice(device.devicePath, device.deviceName,
+            device.serialNumber);
+        devicePaths.push_back(device.devicePath);
+    }
+    if (!_pDaemon->restoreDevices(devicePaths))
+        return false; // failure
+    _pDaemon->sampleDevices();
+    _pDaemon->persist(false);
+
+    // jump from deadline to deadline until the trace runs out
+    auto wallStartTime = g_get_monotonic_time();
+    auto now           = startTime;
+    _pDaemon->scheduleSampling();
+    gint64 deadline;
+    while (!_reader.isFinished() && _pDaemon->getNextDeadline(&deadline))
+    {
+        if (!_reader.advance(deadline))
+            return false; // failure
+        now = deadline;
+        _pDaemon->setVirtualTime(now);
+        _pDaemon->sampleDueDevices(now);
+    }
+
+    // as when the daemon is stopped
+    _pDaemon->sampleDevices();
+    _pDaemon->persist(true);
+    _pDaemon->stopSinks();
+
+    std::cout << "Replayed " << _reader.getSampleCount() << " samples, "
+              << now - startTime << " s in "
+              << (g_get_monotonic_time() - wallStartTime)
+            / CONST_MILLISECONDS_TO_MICROSECONDS
+              << " ms\n";
+    return true; // success
+}
+
+bool cTraceReplay::compareWithGolden(
+    std::string const & statsFilePath, std::string const & goldenPath)
+{
+    gchar* pStats  = nullptr;
+    gchar* pGolden = nullptr;
+    GError* pFileError = nullptr;
+    if (!g_file_get_contents(statsFilePath.c_str(), &pStats, nullptr,
+            &pFileError)
+        || !g_file_get_contents(goldenPath.c_str(), &pGolden, nullptr,
+            &pFileError))
+    {
+        std::cout << "Unable to compare: " << pFileError->message << "\n";
+        g_error_free(pFileError);
+        g_free(pStats);
+        return false; // failure
+    }
+
+    // the first line which differs is enough to start looking
+    std::istringstream stats(pStats);
+    std::istringstream golden(pGolden);
+    g_free(pStats);
+    g_free(pGolden);
+    std::string statsLine;
+    std::string goldenLine;
+    for (guint line = 1;; line++)
+    {
+        bool hasStatsLine  = (bool)std::getline(stats, statsLine);
+        bool hasGoldenLine = (bool)std::getline(golden, goldenLine);
+        if (!hasStatsLine && !hasGoldenLine)
+            break;
+        if (hasStatsLine != hasGoldenLine || statsLine != goldenLine)
+        {
+            std::cout << "Differs from [" << goldenPath << "] at line " << line
+                      << "\n- " << goldenLine << "\n+ " << statsLine << "\n";
+            return false; // failure
+        }
+    }
+    std::cout << "Matches [" << goldenPath << "]\n";
+    return true; // success
+}
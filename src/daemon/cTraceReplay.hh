@@ -0,0 +1,30 @@
+// cTraceReplay.hh
+#ifndef _CTRACEREPLAY_H
+#define _CTRACEREPLAY_H
+
+#include "cDaemon.hh"
+#include "cTraceReader.hh"
+#include <string>
+
+/*
+Replays a trace through the sampling path of the daemon, for --replay.
+
+The daemon samples from the trace on a virtual clock which jumps from one
+sampling deadline to the next, so a recorded year replays in seconds. The
+stats file it leaves can be compared with a golden one.
+*/
+class cTraceReplay
+{
+    public:
+        explicit cTraceReplay(cDaemon* pDaemon) : _pDaemon(pDaemon) {}
+        bool run(std::string const & tracePath);
+        // prints the first line which differs
+        static bool compareWithGolden(
+            std::string const & statsFilePath, std::string const & goldenPath);
+
+    private:
+        cDaemon* _pDaemon;
+        cTraceReader _reader;
+};
+
+#endif /* _CTRACEREPLAY_H */
@@ -0,0 +1,247 @@
+#include "cWatchView.hh"
+#include "../utils/alloc-count.hh"
+#include "../utils/log-event.hh"
+
+#include <algorithm>
+#include <errno.h>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+constexpr uint CONST_SECTOR_SIZE     = 512;
+constexpr gsize CONST_LINE_SIZE      = 160;
+constexpr double CONST_BYTES_PER_MB  = 1024.0 * 1024.0;
+// shortest refresh, the kernel updates the counters every tick
+constexpr gint64 CONST_MIN_INTERVAL_MILLISECONDS    = 50;
+constexpr gint64 CONST_MILLISECONDS_TO_MICROSECONDS = 1000;
+constexpr gint64 CONST_SECONDS_TO_MICROSECONDS      = 1000000;
+// home and clear screen, only when writing to a terminal
+constexpr std::string_view CONST_CLEAR_SCREEN = "\033[H\033[J";
+
+// public functions
+
+void cWatchView::addDevice(std::string const & deviceName,
+    std::string const & serialNumber, gint64 totalBytesWritten)
+{
+    _devices.push_back({ .deviceName = deviceName,
+        .serialNumber = serialNumber,
+        .totalBytesWritten = totalBytesWritten });
+}
+
+void cWatchView::addAllDisks(void)
+{
+    std::vector<std::string> deviceNames;
+    for (auto const & entry : std::filesystem::directory_iterator("/sys/block"))
+        deviceNames.push_back(entry.path().filename());
+    std::sort(deviceNames.begin(), deviceNames.end());
+    for (auto const & deviceName : deviceNames)
+        addDevice(deviceName, "", -1);
+}
+
+bool cWatchView::open(gint64 monotonicTime)
+{
+    _previousTime = monotonicTime;
+    _isTerminal   = isatty(STDOUT_FILENO);
+
+    // a header, a line per device and the escape codes
+    _frame.reserve((_devices.size() + 2) * CONST_LINE_SIZE
+        + CONST_CLEAR_SCREEN.size());
+    if (!readDevices())
+        return false; // failure
+    for (auto &device : _devices)
+        device.firstWriteSectors = device.previousStats.writeSectors;
+    return true; // success
+}
+
+bool cWatchView::renderFrame(gint64 monotonicTime)
+{
+    auto elapsedMilliseconds = (monotonicTime - _previousTime) / 1000.0;
+    _previousTime = monotonicTime;
+    if (!_reader.getAllStats(&_disks))
+        return false; // failure
+    double seconds = elapsedMilliseconds > 0 ? elapsedMilliseconds / 1000 : 1;
+
+    _frame.clear();
+    if (_isTerminal)
+        _frame.append(CONST_CLEAR_SCREEN);
+    appendLine("%-12s %9s %9s %8s %8s %8s %8s %6s %10s  %s\n", "Device",
+        "r/s", "w/s", "rMB/s", "wMB/s", "r_await", "w_await", "%util",
+        "written", "serial");
+
+    for (auto &device : _devices)
+    {
+        auto pDisk = _disks.begin();
+        while (pDisk != _disks.end()
+            && strcmp(pDisk->deviceName, device.deviceName.c_str()) != 0)
+            pDisk++;
+        if (pDisk == _disks.end())
+        {
+            if (device.isPresent)
+                foldWrites(&device);
+            device.isPresent = false;
+            appendLine("%-12s %9s\n", device.deviceName.c_str(), "removed");
+            continue;
+        }
+
+        auto pStats = &pDisk->stats;
+        if (!device.isPresent)
+        {
+            // (re)appeared, this frame only takes the baseline
+            device.previousStats     = *pStats;
+            device.firstWriteSectors = pStats->writeSectors;
+            device.isPresent         = true;
+        }
+        else if (pStats->writeSectors < device.previousStats.writeSectors
+            || pStats->readIo < device.previousStats.readIo)
+        {
+            // the counters start from zero again
+            foldWrites(&device);
+            device.previousStats = {};
+        }
+
+        struct sIntervalMetrics metrics;
+        _computer.getIntervalMetrics(&device.previousStats, pStats,
+            CONST_SECTOR_SIZE, &metrics);
+        auto pPrevious  = &device.previousStats;
+        auto readBytes  = (pStats->readSectors - pPrevious->readSectors)
+            * CONST_SECTOR_SIZE;
+        auto writeBytes = (pStats->writeSectors - pPrevious->writeSectors)
+            * CONST_SECTOR_SIZE;
+        auto utilisation = elapsedMilliseconds > 0
+            ? (pStats->ioTicks - pPrevious->ioTicks) * 100.0
+                / elapsedMilliseconds
+            : 0;
+
+        char written[16] = "-";
+        if (device.totalBytesWritten >= 0)
+            formatBytes(device.totalBytesWritten
+                    + (pStats->writeSectors - device.firstWriteSectors)
+                        * CONST_SECTOR_SIZE,
+                written, sizeof(written));
+
+        appendLine("%-12s %9.1f %9.1f %8.2f %8.2f %8.2f %8.2f %6.1f %10s  %s\n",
+            device.deviceName.c_str(), metrics.readIo / seconds,
+            metrics.writeIo / seconds, readBytes / CONST_BYTES_PER_MB / seconds,
+            writeBytes / CONST_BYTES_PER_MB / seconds,
+            metrics.readAwaitUs / 1000.0, metrics.writeAwaitUs / 1000.0,
+            utilisation > 100 ? 100.0 : utilisation, written,
+            device.serialNumber.c_str());
+        device.previousStats = *pStats;
+    }
+    // frames piped to a file are separated by an empty line
+    if (!_isTerminal)
+        _frame.push_back('\n');
+
+    gsize offset = 0;
+    while (offset < _frame.size())
+    {
+        auto count = write(STDOUT_FILENO, _frame.data() + offset,
+            _frame.size() - offset);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return false; // failure, e.g. the pipe was closed
+        offset += count;
+    }
+    return true; // success
+}
+
+bool cWatchView::run(gint64 intervalMilliseconds,
+    std::function<void(unsigned long allocations)> onFrame)
+{
+    if (intervalMilliseconds < CONST_MIN_INTERVAL_MILLISECONDS)
+    {
+        std::cerr << "--watch refreshes every "
+                  << CONST_MIN_INTERVAL_MILLISECONDS << " ms at most\n";
+        return false; // failure
+    }
+
+    // refreshed on a fixed cadence, a late frame doesn't shift the next ones
+    auto interval = intervalMilliseconds * CONST_MILLISECONDS_TO_MICROSECONDS;
+    auto deadline = g_get_monotonic_time();
+    if (!open(deadline))
+        return false; // failure
+    while (true)
+    {
+        deadline += interval;
+        auto now = g_get_monotonic_time();
+        if (now > deadline)
+            deadline = now;
+        struct timespec wakeup = {
+            .tv_sec  = deadline / CONST_SECONDS_TO_MICROSECONDS,
+            .tv_nsec = (deadline % CONST_SECONDS_TO_MICROSECONDS) * 1000 };
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, nullptr)
+            == EINTR)
+            ;
+
+        auto allocationsBefore = AllocCountGet();
+        if (!renderFrame(g_get_monotonic_time()))
+            return false; // failure
+        onFrame(AllocCountGet() - allocationsBefore);
+    }
+}
+
+// private functions
+
+bool cWatchView::readDevices(void)
+{
+    if (!_reader.getAllStats(&_disks))
+        return false; // failure
+
+    for (auto &device : _devices)
+    {
+        device.isPresent = false;
+        for (auto const & disk : _disks)
+        {
+            if (device.deviceName == disk.deviceName)
+            {
+                device.previousStats = disk.stats;
+                device.isPresent     = true;
+            }
+        }
+        if (!device.isPresent)
+            LOG_EVENT(LOG_WARNING, "[%s] is not in /proc/diskstats\n",
+                device.deviceName.c_str());
+    }
+    return true; // success
+}
+
+void cWatchView::foldWrites(struct sDevice* pDevice)
+{
+    // the bytes written while the counters were valid stay in the total
+    if (pDevice->totalBytesWritten >= 0)
+        pDevice->totalBytesWritten += (pDevice->previousStats.writeSectors
+            - pDevice->firstWriteSectors) * CONST_SECTOR_SIZE;
+    pDevice->firstWriteSectors = 0;
+}
+
+void cWatchView::appendLine(const char* pFormat, ...)
+{
+    char line[CONST_LINE_SIZE];
+    va_list args;
+    va_start(args, pFormat);
+    auto length = vsnprintf(line, sizeof(line), pFormat, args);
+    va_end(args);
+    if (length < 0)
+        return;
+    _frame.append(line, std::min((gsize)length, sizeof(line) - 1));
+}
+
+void cWatchView::formatBytes(gint64 bytes, char* pText, gsize size)
+{
+    static const char* units[] = { "B", "KiB", "MiB", "GiB", "TiB", "PiB" };
+    double value = bytes;
+    guint unit = 0;
+    while (value >= 1024 && unit + 1 < std::size(units))
+    {
+        value /= 1024;
+        unit++;
+    }
+    snprintf(pText, size, unit == 0 ? "%.0f %s" : "%.2f %s", value,
+        units[unit]);
+}
@@ -0,0 +1,62 @@
+// cWatchView.hh
+#ifndef _CWATCHVIEW_H
+#define _CWATCHVIEW_H
+
+#include "../library/cStatComputer.hh"
+#include "../library/cStatReader.hh"
+#include "../library/include/structs.hh"
+#include <functional>
+#include <glib.h>
+#include <string>
+#include <vector>
+
+/*
+An iostat-like table of the monitored devices for --watch.
+
+Every frame reads all devices with a single read of /proc/diskstats and is
+formatted into a buffer sized by open(), then written with one write(), so
+rendering allocates nothing once the first frame has been drawn.
+*/
+class cWatchView
+{
+    public:
+        // totalBytesWritten of the stats file, -1 if unknown
+        void addDevice(std::string const & deviceName,
+            std::string const & serialNumber, gint64 totalBytesWritten);
+        // every disk of /sys/block, by name
+        void addAllDisks(void);
+        // the baseline of the first frame
+        bool open(gint64 monotonicTime);
+        bool renderFrame(gint64 monotonicTime);
+        // opens and renders a frame every intervalMilliseconds, on a fixed
+        // cadence, until one fails, onFrame gets its heap allocations
+        bool run(gint64 intervalMilliseconds,
+            std::function<void(unsigned long allocations)> onFrame);
+
+    private:
+        struct sDevice
+        {
+                std::string deviceName;
+                std::string serialNumber;
+                gint64 totalBytesWritten;
+                gint64 firstWriteSectors;
+                struct sBlockStats previousStats;
+                bool isPresent;
+        };
+
+        std::vector<struct sDevice> _devices;
+        std::vector<struct sDiskStats> _disks;
+        std::string _frame;
+        cStatReader _reader;
+        cStatComputer _computer;
+        gint64 _previousTime = 0;
+        bool _isTerminal = false;
+
+        bool readDevices(void);
+        void foldWrites(struct sDevice* pDevice);
+        void appendLine(const char* pFormat, ...)
+            __attribute__((format(printf, 2, 3)));
+        static void formatBytes(gint64 bytes, char* pText, gsize size);
+};
+
+#endif /* _CWATCHVIEW_H */
@@ -0,0 +1,95 @@
+/* kk-sink-plugin.h */
+#ifndef _KK_SINK_PLUGIN_H
+#define _KK_SINK_PLUGIN_H
+
+/*
+The C interface of the sink plugins of KrillKounter.
+
+A plugin is a shared object listed in the config, which exports
+kk_sink_plugin_get() returning its description. KrillKounter checks
+abi_version and record_size, then calls the plugin from a thread of its
+own: init once, on_batch for every batch of samples, flush when the daemon
+stops and finally shutdown. A plugin which is slow or hangs only loses
+samples, once its queue is full, it never delays sampling. It runs in the
+process of the daemon though, a crash of the plugin stops the daemon.
+
+The records of a batch are the ones queued by KrillKounter, passed as is:
+they are read-only and only valid during the call to on_batch.
+
+The ABI version changes whenever a structure or a call changes, a plugin
+built for another version is refused.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define KK_SINK_PLUGIN_ABI_VERSION 1
+#define KK_SINK_PLUGIN_SYMBOL "kk_sink_plugin_get"
+
+/* the fields of /sys/block/<dev>/stat */
+struct kk_block_stats
+{
+    int64_t read_io;
+    int64_t read_merges;
+    int64_t read_sectors;
+    int64_t read_ticks;
+    int64_t write_io;
+    int64_t write_merges;
+    int64_t write_sectors;
+    int64_t write_ticks;
+    int64_t in_flight;
+    int64_t io_ticks;
+    int64_t time_in_queue;
+    int64_t discard_io;
+    int64_t discard_merges;
+    int64_t discard_sectors;
+    int64_t discard_ticks;
+};
+
+/* a sample of a device and the interval since its previous sample */
+struct kk_device_record
+{
+    char device_name[32];
+    char serial_number[64];
+    int64_t monotonic_time; /* microseconds */
+    int64_t real_time;      /* microseconds since the epoch */
+    int64_t disk_seq;
+    struct kk_block_stats stats; /* counters of the kernel */
+    int64_t interval; /* microseconds since the previous sample, 0 if first */
+    struct kk_block_stats delta; /* 0 if first, in_flight is the current value */
+    int64_t read_io;       /* reads completed in the interval */
+    int64_t write_io;      /* writes completed in the interval */
+    int64_t read_await;    /* average time per read, microseconds */
+    int64_t write_await;   /* average time per write, microseconds */
+    int64_t request_size;  /* average bytes per read or write */
+};
+
+struct kk_sink_plugin
+{
+    uint32_t abi_version; /* KK_SINK_PLUGIN_ABI_VERSION */
+    uint32_t record_size; /* sizeof(struct kk_device_record) */
+    const char* name;
+
+    /* options is the "options" string of the config, "" if none. The plugin
+       stores its state in *state. Returns 0 on success */
+    int (*init)(void** state, const char* options);
+    /* Returns 0 on success, the records are logged as lost otherwise */
+    int (*on_batch)(void* state, const struct kk_device_record* records,
+        size_t count);
+    /* may be NULL, returns 0 on success */
+    int (*flush)(void* state);
+    /* may be NULL, the state is not used afterwards */
+    void (*shutdown)(void* state);
+};
+
+typedef const struct kk_sink_plugin* (*kk_sink_plugin_get_t)(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _KK_SINK_PLUGIN_H */
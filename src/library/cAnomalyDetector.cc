@@ -0,0 +1,114 @@
+#include "cAnomalyDetector.hh"
+
+#include "include/structs.hh"
+
+#include <algorithm>
+#include <cmath>
+
+// smallest deviation a value is compared against, per metric
+static constexpr std::array<double, cAnomalyDetector::METRIC_COUNT>
+    CONST_MIN_DEVIATION = { 1000.0, 1000.0, 50.0, 0.0 };
+// and relative to the mean, so slow devices need a larger excursion
+constexpr double CONST_MIN_RELATIVE_DEVIATION = 0.1;
+
+// public functions
+
+guint cAnomalyDetector::evaluate(struct sBlockStats* pPreviousStats,
+    struct sBlockStats* pCurrentStats, gint64 elapsedUs, double threshold,
+    std::array<struct sAnomaly, METRIC_COUNT>* pAnomalies)
+{
+    auto readIo     = pCurrentStats->readIo - pPreviousStats->readIo;
+    auto writeIo    = pCurrentStats->writeIo - pPreviousStats->writeIo;
+    auto readTicks  = pCurrentStats->readTicks - pPreviousStats->readTicks;
+    auto writeTicks = pCurrentStats->writeTicks - pPreviousStats->writeTicks;
+    auto ioTicks    = pCurrentStats->ioTicks - pPreviousStats->ioTicks;
+
+    // counters going backwards means the device was reset, skip the interval
+    if (elapsedUs <= 0 || readIo < 0 || writeIo < 0 || readTicks < 0
+        || writeTicks < 0 || ioTicks < 0)
+    {
+        return 0;
+    }
+
+    // ticks are reported in milliseconds
+    gint64 busy = std::min<gint64>((ioTicks * 1000 * 1000) / elapsedUs, 1000);
+    guint count = 0;
+
+    // nothing completed while busy all along, the estimators are left alone
+    if (readIo == 0 && writeIo == 0 && pCurrentStats->inFlight > 0
+        && busy >= CONST_STALL_BUSY)
+    {
+        (*pAnomalies)[count++] = { METRIC_STALL, busy, 0, 0 };
+        return count;
+    }
+
+    if (readIo > 0
+        && update(METRIC_READ_AWAIT, (readTicks * 1000) / readIo, threshold,
+            &(*pAnomalies)[count]))
+    {
+        count++;
+    }
+    if (writeIo > 0
+        && update(METRIC_WRITE_AWAIT, (writeTicks * 1000) / writeIo,
+            threshold, &(*pAnomalies)[count]))
+    {
+        count++;
+    }
+    if (update(METRIC_UTILISATION, busy, threshold, &(*pAnomalies)[count]))
+    {
+        count++;
+    }
+    return count;
+}
+
+const char* cAnomalyDetector::getMetricName(eMetric metric)
+{
+    switch (metric)
+    {
+    case METRIC_READ_AWAIT:
+        return "readAwait";
+    case METRIC_WRITE_AWAIT:
+        return "writeAwait";
+    case METRIC_UTILISATION:
+        return "utilisation";
+    case METRIC_STALL:
+        return "stall";
+    default:
+        return "unknown";
+    }
+}
+
+// private functions
+
+bool cAnomalyDetector::update(
+    eMetric metric, gint64 value, double threshold, struct sAnomaly* pAnomaly)
+{
+    auto pEstimator = &_estimators[metric];
+    double sample   = (double)value;
+    bool anomaly    = false;
+
+    if (pEstimator->count >= CONST_WARMUP_SAMPLES && threshold > 0)
+    {
+        double deviation = std::max({ std::sqrt(pEstimator->variance),
+            pEstimator->mean * CONST_MIN_RELATIVE_DEVIATION,
+            CONST_MIN_DEVIATION[metric] });
+        double limit = pEstimator->mean + threshold * deviation;
+        if (sample > limit)
+        {
+            *pAnomaly = { metric, value, (gint64)pEstimator->mean,
+                (gint64)deviation };
+            anomaly = true;
+            sample  = limit;
+        }
+    }
+
+    // plain average while warming up, exponentially weighted afterwards
+    if (pEstimator->count < CONST_WARMUP_SAMPLES)
+        pEstimator->count++;
+    double alpha = std::max(CONST_EWMA_ALPHA, 1.0 / pEstimator->count);
+    double delta = sample - pEstimator->mean;
+    pEstimator->mean += alpha * delta;
+    pEstimator->variance = (1.0 - alpha)
+        * (pEstimator->variance + alpha * delta * delta);
+    return anomaly;
+}
@@ -0,0 +1,69 @@
+// cAnomalyDetector.hh
+#ifndef _CANOMALYDETECTOR_H
+#define _CANOMALYDETECTOR_H
+
+#include <array>
+#include <glib.h>
+
+struct sBlockStats;
+
+/*
+Streaming detector of write stalls and latency anomalies of one device.
+
+Every metric keeps an exponentially weighted mean and variance of its
+per-interval values, so memory and time per sample are constant. Once
+CONST_WARMUP_SAMPLES intervals have been seen, a value exceeding the mean
+by more than threshold deviations is an anomaly. The deviation is floored
+per metric so a quiet device doesn't alert on noise, and anomalous values
+are clamped to the threshold before they are folded in, so a stall does
+not become the new baseline. A stall, io in flight for the whole interval
+without any completing, needs no baseline.
+*/
+class cAnomalyDetector
+{
+    public:
+        enum eMetric
+        {
+            METRIC_READ_AWAIT,   // microseconds per read
+            METRIC_WRITE_AWAIT,  // microseconds per write
+            METRIC_UTILISATION,  // per mille of the interval the device was busy
+            METRIC_STALL,        // per mille busy with nothing completed
+            METRIC_COUNT
+        };
+
+        struct sAnomaly
+        {
+                eMetric metric;
+                gint64 value;
+                gint64 mean;
+                gint64 deviation;
+        };
+
+        static constexpr double CONST_EWMA_ALPHA   = 1.0 / 32;
+        static constexpr guint CONST_WARMUP_SAMPLES = 32;
+        // busy time of a stalled interval, per mille
+        static constexpr gint64 CONST_STALL_BUSY    = 900;
+
+        // anomalies of the interval between two samples, elapsedUs apart
+        guint evaluate(struct sBlockStats* pPreviousStats,
+            struct sBlockStats* pCurrentStats, gint64 elapsedUs,
+            double threshold,
+            std::array<struct sAnomaly, METRIC_COUNT>* pAnomalies);
+        void reset(void) { _estimators = {}; }
+
+        static const char* getMetricName(eMetric metric);
+
+    private:
+        struct sEstimator
+        {
+                double mean;
+                double variance;
+                guint count;
+        };
+
+        std::array<struct sEstimator, METRIC_COUNT> _estimators = {};
+        bool update(eMetric metric, gint64 value, double threshold,
+            struct sAnomaly* pAnomaly);
+};
+
+#endif /* _CANOMALYDETECTOR_H */
@@ -0,0 +1,325 @@
+#include "cCgroupCollector.hh"
+#include "../utils/log-event.hh"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+// each group holds a descriptor open
+constexpr gsize CONST_MAX_CGROUPS = 1024;
+constexpr gsize CONST_IO_STAT_BUFFER_SIZE = 4096;
+
+// counters restart at 0 when a group is re-created
+static guint64 getDelta(guint64 current, guint64 previous)
+{
+    return current >= previous ? current - previous : current;
+}
+
+// destructor
+
+cCgroupCollector::~cCgroupCollector()
+{
+    for (auto const & [cgroupPath, cgroup] : _cgroups)
+    {
+        if (cgroup.ioStatFd >= 0)
+        {
+            close(cgroup.ioStatFd);
+        }
+    }
+    if (_inotifyFd >= 0)
+    {
+        close(_inotifyFd);
+    }
+}
+
+// public functions
+
+bool cCgroupCollector::open(std::string rootPath)
+{
+    if (!std::filesystem::exists(rootPath + "/cgroup.controllers"))
+    {
+        LOG_EVENT(LOG_ERR, "[%s] is not a cgroup v2 hierarchy\n",
+            rootPath.c_str());
+        return false; // failure
+    }
+
+    _inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (_inotifyFd < 0)
+    {
+        LOG_EVENT(LOG_ERR, "Failed to create cgroup watch, %s",
+            strerror(errno));
+        return false; // failure
+    }
+
+    // the only full walk, later changes arrive as events
+    _rootPath = rootPath;
+    addCgroup("");
+    LOG_EVENT(LOG_INFO, "Watching %zu cgroups\n", _cgroups.size());
+    return true; // success
+}
+
+bool cCgroupCollector::setDevices(std::vector<std::string> const & deviceNames)
+{
+    // io.stat is keyed by the disk, never by a partition
+    _devices.clear();
+    _pendingDeltas.clear(); // their device indexes are stale
+    for (guint i = 0; i < deviceNames.size(); i++)
+    {
+        auto ifs = std::ifstream("/sys/block/" + deviceNames[i] + "/dev");
+        unsigned int majorNumber = 0;
+        unsigned int minorNumber = 0;
+        char separator = 0;
+        if (!(ifs >> majorNumber >> separator >> minorNumber))
+        {
+            LOG_EVENT(LOG_WARNING, "Failed to read the device number of [%s]\n",
+                deviceNames[i].c_str());
+            continue;
+        }
+        _devices.push_back({ makedev(majorNumber, minorNumber), i });
+    }
+    return true; // success
+}
+
+void cCgroupCollector::handleEvents(void)
+{
+    alignas(struct inotify_event) char buffer[4096];
+    ssize_t length;
+    while ((length = read(_inotifyFd, buffer, sizeof(buffer))) > 0)
+    {
+        for (char* pPosition = buffer; pPosition < buffer + length;)
+        {
+            auto pEvent = (struct inotify_event*)pPosition;
+            pPosition += sizeof(struct inotify_event) + pEvent->len;
+
+            auto watch = _watches.find(pEvent->wd);
+            if (watch == _watches.end())
+            {
+                continue;
+            }
+            if (pEvent->mask & IN_IGNORED)
+            {
+                _watches.erase(watch);
+                continue;
+            }
+
+            auto cgroupPath = watch->second.cgroupPath;
+            if (watch->second.isEvents)
+            {
+                // keep what the group did before it goes away
+                auto cgroup = _cgroups.find(cgroupPath);
+                if (cgroup != _cgroups.end() && !isPopulated(cgroupPath))
+                {
+                    readCgroup(cgroupPath, &cgroup->second, &_pendingDeltas);
+                }
+                continue;
+            }
+
+            if (!(pEvent->mask & IN_ISDIR) || pEvent->len == 0)
+            {
+                continue;
+            }
+            auto childPath = cgroupPath.empty()
+                ? std::string(pEvent->name)
+                : cgroupPath + "/" + pEvent->name;
+            if (pEvent->mask & IN_CREATE)
+            {
+                addCgroup(childPath);
+            }
+            else if (pEvent->mask & IN_DELETE)
+            {
+                removeCgroup(childPath);
+            }
+        }
+    }
+}
+
+bool cCgroupCollector::sample(std::vector<struct sCgroupIoDelta>* pDeltas)
+{
+    // Return the io of every group since the previous sample
+
+    pDeltas->swap(_pendingDeltas);
+    _pendingDeltas.clear();
+    if (_inotifyFd < 0)
+    {
+        return false; // failure
+    }
+
+    for (auto &[cgroupPath, cgroup] : _cgroups)
+    {
+        readCgroup(cgroupPath, &cgroup, pDeltas);
+    }
+    return true; // success
+}
+
+// private functions
+
+void cCgroupCollector::addCgroup(std::string cgroupPath)
+{
+    if (_cgroups.contains(cgroupPath))
+    {
+        return;
+    }
+    if (_cgroups.size() >= CONST_MAX_CGROUPS)
+    {
+        LOG_EVENT(LOG_WARNING, "Too many cgroups, [%s] is not collected\n",
+            cgroupPath.c_str());
+        return;
+    }
+
+    auto directory = _rootPath + "/" + cgroupPath;
+    struct sCgroup cgroup;
+    // watched before listing, so no child created meanwhile is missed
+    cgroup.dirWatch = inotify_add_watch(_inotifyFd, directory.c_str(),
+        IN_CREATE | IN_DELETE | IN_ONLYDIR);
+    if (cgroup.dirWatch < 0)
+    {
+        return; // gone already
+    }
+    _watches[cgroup.dirWatch] = { .cgroupPath = cgroupPath, .isEvents = false };
+
+    // the root group has neither file
+    cgroup.eventWatch = inotify_add_watch(
+        _inotifyFd, (directory + "/cgroup.events").c_str(), IN_MODIFY);
+    if (cgroup.eventWatch >= 0)
+    {
+        _watches[cgroup.eventWatch]
+            = { .cgroupPath = cgroupPath, .isEvents = true };
+    }
+    cgroup.ioStatFd
+        = ::open((directory + "/io.stat").c_str(), O_RDONLY | O_CLOEXEC);
+
+    // the current counters are the baseline, not new io
+    std::vector<struct sCgroupIoDelta> ignored;
+    readCgroup(cgroupPath, &cgroup, &ignored);
+    _cgroups[cgroupPath] = cgroup;
+
+    std::error_code error;
+    for (auto const & entry :
+        std::filesystem::directory_iterator(directory, error))
+    {
+        if (entry.is_directory(error))
+        {
+            addCgroup(cgroupPath.empty()
+                    ? entry.path().filename().string()
+                    : cgroupPath + "/" + entry.path().filename().string());
+        }
+    }
+}
+
+void cCgroupCollector::removeCgroup(std::string cgroupPath)
+{
+    auto cgroup = _cgroups.find(cgroupPath);
+    if (cgroup == _cgroups.end())
+    {
+        return;
+    }
+
+    // the watches are dropped by the kernel, their IN_IGNORED clears them
+    if (cgroup->second.ioStatFd >= 0)
+    {
+        close(cgroup->second.ioStatFd);
+    }
+    _cgroups.erase(cgroup);
+}
+
+void cCgroupCollector::readCgroup(std::string const & cgroupPath,
+    struct sCgroup* pCgroup, std::vector<struct sCgroupIoDelta>* pDeltas)
+{
+    if (pCgroup->ioStatFd < 0)
+    {
+        return;
+    }
+
+    char buffer[CONST_IO_STAT_BUFFER_SIZE];
+    ssize_t length = pread(pCgroup->ioStatFd, buffer, sizeof(buffer) - 1, 0);
+    if (length <= 0)
+    {
+        return;
+    }
+    buffer[length] = '\0';
+
+    // "maj:min rbytes=.. wbytes=.. rios=.. wios=.. dbytes=.. dios=.."
+    char* pSave = nullptr;
+    for (char* pLine = strtok_r(buffer, "\n", &pSave); pLine != nullptr;
+         pLine = strtok_r(nullptr, "\n", &pSave))
+    {
+        char* pEnd;
+        unsigned int majorNumber = strtoul(pLine, &pEnd, 10);
+        if (*pEnd != ':')
+        {
+            continue;
+        }
+        unsigned int minorNumber = strtoul(pEnd + 1, &pEnd, 10);
+        dev_t device = makedev(majorNumber, minorNumber);
+
+        auto monitored = std::find_if(_devices.begin(), _devices.end(),
+            [device](auto const & entry) { return entry.first == device; });
+        if (monitored == _devices.end())
+        {
+            continue;
+        }
+
+        struct sCgroupIo counters = {};
+        for (char* pField = strchr(pEnd, ' '); pField != nullptr;
+             pField = strchr(pField + 1, ' '))
+        {
+            char* pValue = strchr(pField, '=');
+            if (pValue == nullptr)
+            {
+                break;
+            }
+            std::string_view key(pField + 1, pValue - pField - 1);
+            guint64 value = strtoull(pValue + 1, nullptr, 10);
+            if (key == "rbytes")
+                counters.rbytes = value;
+            else if (key == "wbytes")
+                counters.wbytes = value;
+            else if (key == "rios")
+                counters.rios = value;
+            else if (key == "wios")
+                counters.wios = value;
+            else if (key == "dbytes")
+                counters.dbytes = value;
+        }
+
+        auto &previous = pCgroup->counters[device];
+        struct sCgroupIo delta = {
+            .rbytes = getDelta(counters.rbytes, previous.rbytes),
+            .wbytes = getDelta(counters.wbytes, previous.wbytes),
+            .rios   = getDelta(counters.rios, previous.rios),
+            .wios   = getDelta(counters.wios, previous.wios),
+            .dbytes = getDelta(counters.dbytes, previous.dbytes),
+        };
+        previous = counters;
+
+        if (delta.rbytes || delta.wbytes || delta.rios || delta.wios
+            || delta.dbytes)
+        {
+            pDeltas->push_back({ .cgroupPath = cgroupPath,
+                .deviceIndex = monitored->second,
+                .io = delta });
+        }
+    }
+}
+
+bool cCgroupCollector::isPopulated(std::string const & cgroupPath)
+{
+    auto ifs = std::ifstream(_rootPath + "/" + cgroupPath + "/cgroup.events");
+    std::string key;
+    int value = 0;
+    while (ifs >> key >> value)
+    {
+        if (key == "populated")
+        {
+            return value != 0;
+        }
+    }
+    return false;
+}
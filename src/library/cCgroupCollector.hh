@@ -0,0 +1,71 @@
+// cCgroupCollector.hh
+#ifndef _CCGROUPCOLLECTOR_H
+#define _CCGROUPCOLLECTOR_H
+
+#include "include/structs.hh"
+#include <glib.h>
+#include <map>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+constexpr std::string_view CONST_CGROUP_ROOT = "/sys/fs/cgroup";
+
+struct sCgroupIoDelta
+{
+        std::string cgroupPath; // relative to the cgroup root
+        guint deviceIndex; // into the names given to setDevices()
+        struct sCgroupIo io;
+};
+
+/*
+Collects io.stat of every cgroup v2 group.
+
+The tree is walked once, afterwards groups are added and removed from
+inotify events on their directories, and cgroup.events tells when a group
+empties so its last counters are read before it goes away. io.stat of each
+group is kept open and re-read with pread. Counters of a parent include its
+children, as in the kernel.
+*/
+class cCgroupCollector
+{
+    public:
+        ~cCgroupCollector();
+        bool open(std::string rootPath = std::string(CONST_CGROUP_ROOT));
+        bool isOpen(void) const { return _inotifyFd >= 0; }
+        int getEventFd(void) const { return _inotifyFd; }
+        bool setDevices(std::vector<std::string> const & deviceNames);
+        void handleEvents(void);
+        bool sample(std::vector<struct sCgroupIoDelta>* pDeltas);
+
+    private:
+        struct sCgroup
+        {
+                int ioStatFd   = -1;
+                int dirWatch   = -1;
+                int eventWatch = -1;
+                // last raw counters by disk
+                std::map<dev_t, struct sCgroupIo> counters;
+        };
+        struct sWatch
+        {
+                std::string cgroupPath;
+                bool isEvents; // cgroup.events rather than the directory
+        };
+
+        std::string _rootPath;
+        int _inotifyFd = -1;
+        std::map<std::string, struct sCgroup> _cgroups;
+        std::map<int, struct sWatch> _watches;
+        std::vector<std::pair<dev_t, guint>> _devices;
+        // read from groups which emptied or went away between samples
+        std::vector<struct sCgroupIoDelta> _pendingDeltas;
+
+        void addCgroup(std::string cgroupPath);
+        void removeCgroup(std::string cgroupPath);
+        void readCgroup(std::string const & cgroupPath,
+            struct sCgroup* pCgroup, std::vector<struct sCgroupIoDelta>* pDeltas);
+        bool isPopulated(std::string const & cgroupPath);
+};
+
+#endif /* _CCGROUPCOLLECTOR_H */
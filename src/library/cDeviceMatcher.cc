@@ -0,0 +1,269 @@
+#include "cDeviceMatcher.hh"
+#include "../utils/log-event.hh"
+
+#include <dirent.h>
+#include <filesystem>
+#include <fnmatch.h>
+#include <fstream>
+#include <string.h>
+
+// constructor and destructor
+
+cDeviceMatcher::cDeviceMatcher(const char* pSysBlockPath)
+    : _sysBlockPath(pSysBlockPath)
+{
+}
+
+// public functions
+
+bool cDeviceMatcher::setMatchers(
+    std::vector<struct sDeviceMatchConfig> const & matchers)
+{
+    // compile once, devices are matched against these on every refresh
+    std::vector<struct sCompiledMatcher> compiled;
+    for (auto const & matcher : matchers)
+    {
+        struct sCompiledMatcher entry = { .config = matcher };
+        if (matcher.isRegex)
+        {
+            try
+            {
+                entry.regex = std::regex(matcher.pattern, std::regex::optimize);
+            }
+            catch (const std::regex_error& error)
+            {
+                LOG_EVENT(LOG_ERR, "Invalid regex [%s]: %s\n",
+                    matcher.pattern.c_str(), error.what());
+                return false; // failure
+            }
+        }
+        else
+        {
+            entry.isGlob = matcher.pattern.find_first_of("*?[")
+                != std::string::npos;
+        }
+        compiled.push_back(entry);
+    }
+
+    _matchers = compiled;
+    // every known device has to be evaluated again
+    _devices.clear();
+    refresh();
+    return true; // success
+}
+
+bool cDeviceMatcher::refresh(void)
+{
+    // Return true if the set of matched devices changed
+
+    DIR* pDirectory = opendir(_sysBlockPath.c_str());
+    if (pDirectory == nullptr)
+    {
+        LOG_EVENT(LOG_ERR, "Failed to open %s, %s", _sysBlockPath.c_str(),
+            strerror(errno));
+        return false; // no change
+    }
+
+    bool changed = false;
+    std::map<std::string, struct sEnumeratedDevice> devices;
+    struct dirent* pEntry;
+    while ((pEntry = readdir(pDirectory)) != nullptr)
+    {
+        if (pEntry->d_name[0] == '.')
+        {
+            continue;
+        }
+
+        // only devices which weren't known before are evaluated
+        std::string deviceName = pEntry->d_name;
+        auto known = _devices.find(deviceName);
+        if (known != _devices.end())
+        {
+            devices[deviceName] = known->second;
+            continue;
+        }
+
+        struct sEnumeratedDevice device;
+        if (evaluate(deviceName, &device))
+        {
+            LOG_EVENT(LOG_INFO, "[%s] matches the config\n",
+                device.devicePath.c_str());
+            changed = true;
+        }
+        devices[deviceName] = device;
+    }
+    closedir(pDirectory);
+
+    for (auto const & [deviceName, device] : _devices)
+    {
+        if (!devices.contains(deviceName) && !device.devicePath.empty())
+        {
+            changed = true;
+        }
+    }
+
+    _devices = devices;
+    return changed;
+}
+
+void cDeviceMatcher::forget(std::string deviceName)
+{
+    // evaluated again on the next refresh, e.g. once new media is inserted
+    _devices.erase(deviceName);
+}
+
+std::vector<std::string> cDeviceMatcher::getDevicePaths(void)
+{
+    std::vector<std::string> paths;
+    for (auto const & [deviceName, device] : _devices)
+    {
+        if (!device.devicePath.empty())
+        {
+            paths.push_back(device.devicePath);
+        }
+    }
+    return paths;
+}
+
+gint64 cDeviceMatcher::getUpdateRate(std::string const & devicePath)
+{
+    for (auto const & [deviceName, device] : _devices)
+    {
+        if (device.devicePath == devicePath)
+        {
+            return device.updateRate;
+        }
+    }
+    return 0; // not overridden
+}
+
+bool cDeviceMatcher::getTransport(std::string deviceName, std::string* pValue)
+{
+    // derived from the bus the disk hangs off, as lsblk does
+    std::error_code error;
+    auto sysfsPath = std::filesystem::canonical(
+        _sysBlockPath + "/" + deviceName, error);
+    if (error)
+    {
+        return false; // failure
+    }
+
+    std::string path = sysfsPath;
+    if (path.find("/usb") != std::string::npos)
+        *pValue = "usb";
+    else if (path.find("/mmc_host/") != std::string::npos)
+        *pValue = "mmc";
+    else if (path.find("/nvme/") != std::string::npos)
+        *pValue = "nvme";
+    else if (path.find("/ata") != std::string::npos)
+        *pValue = "sata";
+    else if (path.find("/virtio") != std::string::npos)
+        *pValue = "virtio";
+    else if (path.find("/virtual/") != std::string::npos)
+        *pValue = "virtual";
+    else
+        *pValue = "";
+    return true; // success
+}
+
+// private functions
+
+bool cDeviceMatcher::evaluate(
+    std::string deviceName, struct sEnumeratedDevice* pDevice)
+{
+    for (auto& matcher : _matchers)
+    {
+        if (matchesPattern(&matcher, deviceName, &pDevice->devicePath)
+            && matchesAttributes(&matcher, deviceName))
+        {
+            pDevice->updateRate = matcher.config.updateRate;
+            return true; // match
+        }
+    }
+    pDevice->devicePath.clear();
+    return false; // no match
+}
+
+bool cDeviceMatcher::matchesPattern(struct sCompiledMatcher* pMatcher,
+    std::string deviceName, std::string* pDevicePath)
+{
+    auto devicePath = "/dev/" + deviceName;
+
+    // no pattern matches every device, leaving it to the attributes
+    if (pMatcher->config.pattern.empty())
+    {
+        *pDevicePath = devicePath;
+        return true; // match
+    }
+
+    if (pMatcher->config.isRegex)
+    {
+        if (!std::regex_search(devicePath, pMatcher->regex))
+        {
+            return false; // no match
+        }
+        *pDevicePath = devicePath;
+        return true; // match
+    }
+
+    if (pMatcher->isGlob)
+    {
+        if (fnmatch(pMatcher->config.pattern.c_str(), devicePath.c_str(),
+                FNM_PATHNAME) != 0)
+        {
+            return false; // no match
+        }
+        *pDevicePath = devicePath;
+        return true; // match
+    }
+
+    // literal paths may be symlinks, e.g. /dev/disk/by-id/...
+    std::error_code error;
+    auto target = std::filesystem::canonical(pMatcher->config.pattern, error);
+    if (error || target != devicePath)
+    {
+        return false; // no match
+    }
+    *pDevicePath = pMatcher->config.pattern;
+    return true; // match
+}
+
+bool cDeviceMatcher::matchesAttributes(
+    struct sCompiledMatcher* pMatcher, std::string deviceName)
+{
+    for (auto const & [attribute, expected] : pMatcher->config.attributes)
+    {
+        std::string value;
+        bool found = attribute == "transport"
+            ? getTransport(deviceName, &value)
+            : getAttribute(deviceName, attribute, &value);
+        if (!found || value != expected)
+        {
+            return false; // no match
+        }
+    }
+    return true; // match
+}
+
+bool cDeviceMatcher::getAttribute(
+    std::string deviceName, std::string attribute, std::string* pValue)
+{
+    // attributes are relative to /sys/block/<dev>, e.g. queue/rotational
+    if (attribute.find("..") != std::string::npos)
+    {
+        return false; // failure
+    }
+
+    auto ifs = std::ifstream(
+        _sysBlockPath + "/" + deviceName + "/" + attribute);
+    if (ifs.is_open() != true)
+    {
+        return false; // failure
+    }
+    std::getline(ifs, *pValue);
+
+    // sysfs values are often padded, e.g. device/vendor
+    auto end = pValue->find_last_not_of(" \t");
+    pValue->erase(end == std::string::npos ? 0 : end + 1);
+    return true; // success
+}
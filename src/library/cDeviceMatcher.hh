@@ -0,0 +1,52 @@
+// cDeviceMatcher.hh
+#ifndef _CDEVICEMATCHER_H
+#define _CDEVICEMATCHER_H
+
+#include "include/structs.hh"
+
+#include <map>
+#include <regex>
+#include <string>
+#include <vector>
+
+class cDeviceMatcher
+{
+    public:
+        // pSysBlockPath is a directory laid out as /sys/block for tests
+        explicit cDeviceMatcher(const char* pSysBlockPath = "/sys/block");
+        bool setMatchers(std::vector<struct sDeviceMatchConfig> const & matchers);
+        bool refresh(void);
+        void forget(std::string deviceName);
+        std::vector<std::string> getDevicePaths(void);
+        gint64 getUpdateRate(std::string const & devicePath);
+        bool getTransport(std::string deviceName, std::string* pValue);
+
+    private:
+        struct sCompiledMatcher
+        {
+                struct sDeviceMatchConfig config;
+                bool isGlob = false;
+                std::regex regex;
+        };
+
+        struct sEnumeratedDevice
+        {
+                std::string devicePath; // empty if not matched
+                gint64 updateRate = 0; // of the first matching entry
+        };
+
+        std::string _sysBlockPath;
+        std::vector<struct sCompiledMatcher> _matchers;
+        // enumeration cache of /sys/block, by device name
+        std::map<std::string, struct sEnumeratedDevice> _devices;
+        bool evaluate(
+            std::string deviceName, struct sEnumeratedDevice* pDevice);
+        bool matchesPattern(struct sCompiledMatcher* pMatcher,
+            std::string deviceName, std::string* pDevicePath);
+        bool matchesAttributes(
+            struct sCompiledMatcher* pMatcher, std::string deviceName);
+        bool getAttribute(std::string deviceName, std::string attribute,
+            std::string* pValue);
+};
+
+#endif /* _CDEVICEMATCHER_H */
@@ -0,0 +1,123 @@
+#include "cHistogram.hh"
+
+// public functions
+
+void cHistogram::record(guint64 value) { recordMultiple(value, 1); }
+
+void cHistogram::recordMultiple(guint64 value, guint64 count)
+{
+    _buckets[getBucketIndex(value)] += count;
+    _count += count;
+    if (value > _max)
+    {
+        _max = value;
+    }
+}
+
+void cHistogram::merge(const cHistogram& other)
+{
+    for (guint i = 0; i < CONST_BUCKET_COUNT; i++)
+    {
+        _buckets[i] += other._buckets[i];
+    }
+    _count += other._count;
+    if (other._max > _max)
+    {
+        _max = other._max;
+    }
+}
+
+void cHistogram::reset(void)
+{
+    _buckets.fill(0);
+    _count = 0;
+    _max   = 0;
+}
+
+guint64 cHistogram::getValueAtPercentile(double percentile) const
+{
+    if (_count == 0)
+    {
+        return 0;
+    }
+
+    // rank of the requested sample, 1 based
+    guint64 rank = (guint64)((percentile / 100.0) * _count + 0.5);
+    if (rank < 1)
+    {
+        rank = 1;
+    }
+    else if (rank > _count)
+    {
+        rank = _count;
+    }
+
+    guint64 seen = 0;
+    for (guint i = 0; i < CONST_BUCKET_COUNT; i++)
+    {
+        seen += _buckets[i];
+        if (seen >= rank)
+        {
+            // report the highest value equivalent to the bucket
+            auto value = getBucketUpperBound(i);
+            return value < _max ? value : _max;
+        }
+    }
+    return _max;
+}
+
+guint64 cHistogram::getBucket(guint index) const
+{
+    return index < CONST_BUCKET_COUNT ? _buckets[index] : 0;
+}
+
+bool cHistogram::setBucket(guint index, guint64 count)
+{
+    if (index >= CONST_BUCKET_COUNT)
+    {
+        return false; // failure
+    }
+    _count          = _count - _buckets[index] + count;
+    _buckets[index] = count;
+    return true; // success
+}
+
+guint cHistogram::getBucketIndex(guint64 value)
+{
+    if (value < CONST_LINEAR_LIMIT)
+    {
+        return (guint)value;
+    }
+
+    // position of the most significant bit, at least CONST_SUB_BUCKET_BITS + 1
+    guint msb = 63 - __builtin_clzll(value);
+    if (msb >= CONST_MAX_VALUE_BITS)
+    {
+        return CONST_BUCKET_COUNT - 1;
+    }
+
+    // keep the CONST_SUB_BUCKET_BITS + 1 most significant bits
+    guint shift = msb - CONST_SUB_BUCKET_BITS;
+    return shift * CONST_SUB_BUCKETS + (guint)(value >> shift);
+}
+
+guint64 cHistogram::getBucketLowerBound(guint index)
+{
+    if (index < CONST_LINEAR_LIMIT)
+    {
+        return index;
+    }
+    guint shift = index / CONST_SUB_BUCKETS - 1;
+    guint64 sub = index % CONST_SUB_BUCKETS + CONST_SUB_BUCKETS;
+    return sub << shift;
+}
+
+guint64 cHistogram::getBucketUpperBound(guint index)
+{
+    if (index < CONST_LINEAR_LIMIT)
+    {
+        return index;
+    }
+    guint shift = index / CONST_SUB_BUCKETS - 1;
+    return getBucketLowerBound(index) + ((guint64)1 << shift) - 1;
+}
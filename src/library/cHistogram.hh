@@ -0,0 +1,53 @@
+// cHistogram.hh
+#ifndef _CHISTOGRAM_H
+#define _CHISTOGRAM_H
+
+#include <array>
+#include <glib.h>
+
+/*
+Fixed-size log-linear (HDR style) histogram.
+
+Values below CONST_LINEAR_LIMIT get a bucket each, above that every power of
+two is split into CONST_SUB_BUCKETS linear sub-buckets, which bounds the
+relative error of any reported value to 1 / CONST_SUB_BUCKETS. Recording is
+O(1), the memory footprint is constant and two histograms can be merged by
+adding their buckets.
+*/
+class cHistogram
+{
+    public:
+        static constexpr guint CONST_SUB_BUCKET_BITS = 4;
+        static constexpr guint CONST_SUB_BUCKETS     = 1 << CONST_SUB_BUCKET_BITS;
+        static constexpr guint CONST_LINEAR_LIMIT    = 2 * CONST_SUB_BUCKETS;
+        // largest value with its own bucket, anything above is clamped
+        static constexpr guint CONST_MAX_VALUE_BITS  = 40;
+        static constexpr guint CONST_BUCKET_COUNT
+            = (CONST_MAX_VALUE_BITS - CONST_SUB_BUCKET_BITS + 1)
+            * CONST_SUB_BUCKETS;
+
+        void record(guint64 value);
+        void recordMultiple(guint64 value, guint64 count);
+        void merge(const cHistogram& other);
+        void reset(void);
+
+        guint64 getCount(void) const { return _count; }
+        guint64 getMax(void) const { return _max; }
+        guint64 getValueAtPercentile(double percentile) const;
+
+        // raw bucket access, used to persist and restore a histogram
+        guint64 getBucket(guint index) const;
+        bool setBucket(guint index, guint64 count);
+        void setMax(guint64 max) { _max = max; }
+
+        static guint getBucketIndex(guint64 value);
+        static guint64 getBucketLowerBound(guint index);
+        static guint64 getBucketUpperBound(guint index);
+
+    private:
+        std::array<guint64, CONST_BUCKET_COUNT> _buckets = {};
+        guint64 _count = 0;
+        guint64 _max   = 0;
+};
+
+#endif /* _CHISTOGRAM_H */
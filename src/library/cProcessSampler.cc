@@ -0,0 +1,316 @@
+#include "cProcessSampler.hh"
+#include "../utils/log-event.hh"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+// bit per device when a process is mapped
+constexpr guint CONST_MAX_DEVICES = 64;
+constexpr gsize CONST_DIRENT_BUFFER_SIZE = 4096;
+
+struct sLinuxDirent64
+{
+        ino64_t d_ino;
+        off64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[];
+};
+
+// raw getdents64, opendir() would allocate for every directory
+static long readDirectory(int fd, char* pBuffer, gsize size)
+{
+    return syscall(SYS_getdents64, fd, pBuffer, size);
+}
+
+static gssize readFile(int dirFd, const char* pPath, char* pBuffer, gsize size)
+{
+    int fd = openat(dirFd, pPath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    gssize length = read(fd, pBuffer, size - 1);
+    close(fd);
+    if (length >= 0)
+    {
+        pBuffer[length] = '\0';
+    }
+    return length;
+}
+
+static bool readDeviceNumber(std::filesystem::path path, dev_t* pDevice)
+{
+    auto ifs = std::ifstream(path / "dev");
+    unsigned int majorNumber = 0;
+    unsigned int minorNumber = 0;
+    char separator = 0;
+    if (!(ifs >> majorNumber >> separator >> minorNumber) || separator != ':')
+    {
+        return false; // failure
+    }
+    *pDevice = makedev(majorNumber, minorNumber);
+    return true; // success
+}
+
+// destructor
+
+cProcessSampler::~cProcessSampler()
+{
+    if (_procFd >= 0)
+    {
+        close(_procFd);
+    }
+}
+
+// public functions
+
+bool cProcessSampler::setDevices(std::vector<std::string> const & deviceNames)
+{
+    if (_procFd < 0)
+    {
+        _procFd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (_procFd < 0)
+        {
+            LOG_EVENT(LOG_ERR, "Failed to open /proc, %s", strerror(errno));
+            return false; // failure
+        }
+    }
+
+    if (deviceNames.size() > CONST_MAX_DEVICES)
+    {
+        LOG_EVENT(LOG_WARNING, "Writes to %zu devices past the first %u are "
+            "not attributed", deviceNames.size() - CONST_MAX_DEVICES,
+            CONST_MAX_DEVICES);
+    }
+
+    // files live on partitions, which are accounted to their disk
+    _devices.clear();
+    for (guint i = 0; i < deviceNames.size() && i < CONST_MAX_DEVICES; i++)
+    {
+        std::filesystem::path diskPath = "/sys/block/" + deviceNames[i];
+        dev_t device;
+        if (!readDeviceNumber(diskPath, &device))
+        {
+            LOG_EVENT(LOG_WARNING, "Failed to read the device number of [%s]",
+                deviceNames[i].c_str());
+            continue;
+        }
+        _devices.push_back({ device, i });
+
+        std::error_code error;
+        for (auto const & entry :
+            std::filesystem::directory_iterator(diskPath, error))
+        {
+            if (std::filesystem::exists(entry.path() / "partition")
+                && readDeviceNumber(entry.path(), &device))
+            {
+                _devices.push_back({ device, i });
+            }
+        }
+    }
+    return true; // success
+}
+
+bool cProcessSampler::sample(std::vector<struct sProcessWrite>* pWrites)
+{
+    // Return the bytes written by each process since the previous sample
+
+    pWrites->clear();
+    if (_procFd < 0)
+    {
+        return false; // failure
+    }
+
+    // the first scan only sets the baselines
+    bool primed = _generation > 0;
+    _generation++;
+
+    char buffer[CONST_DIRENT_BUFFER_SIZE];
+    lseek(_procFd, 0, SEEK_SET);
+    long length;
+    while ((length = readDirectory(_procFd, buffer, sizeof(buffer))) > 0)
+    {
+        for (long offset = 0; offset < length;)
+        {
+            auto pEntry = (struct sLinuxDirent64*)(buffer + offset);
+            offset += pEntry->d_reclen;
+
+            char* pEnd;
+            pid_t pid = strtol(pEntry->d_name, &pEnd, 10);
+            if (pid <= 0 || *pEnd != '\0')
+            {
+                continue;
+            }
+
+            // the process may exit at any point, it's then skipped
+            int pidFd = openat(
+                _procFd, pEntry->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (pidFd < 0)
+            {
+                continue;
+            }
+
+            guint64 startTime  = 0;
+            guint64 writeBytes = 0;
+            char name[cTopK::CONST_NAME_LENGTH];
+            if (!readProcess(pidFd, &startTime, &writeBytes, name))
+            {
+                close(pidFd);
+                continue;
+            }
+
+            auto [baseline, inserted] = _baselines.try_emplace(pid);
+            guint64 delta = 0;
+            if (inserted || baseline->second.startTime != startTime)
+            {
+                // started since the previous scan, all its writes are new
+                delta = primed ? writeBytes : 0;
+            }
+            else if (writeBytes > baseline->second.writeBytes)
+            {
+                delta = writeBytes - baseline->second.writeBytes;
+            }
+            baseline->second = { .startTime = startTime,
+                .writeBytes = writeBytes,
+                .generation = _generation };
+
+            if (delta > 0 && !_devices.empty())
+            {
+                mapProcess(pidFd, delta, name, pWrites);
+            }
+            close(pidFd);
+        }
+    }
+    if (length < 0)
+    {
+        LOG_EVENT(LOG_ERR, "Failed to read /proc, %s", strerror(errno));
+        return false; // failure
+    }
+
+    // forget the processes which have exited
+    std::erase_if(_baselines, [this](auto const & entry) {
+        return entry.second.generation != _generation;
+    });
+    return true; // success
+}
+
+// private functions
+
+bool cProcessSampler::readProcess(
+    int pidFd, guint64* pStartTime, guint64* pWriteBytes, char* pName)
+{
+    // stat: "pid (comm) state ppid ...", comm may contain spaces and ')'
+    char buffer[512];
+    if (readFile(pidFd, "stat", buffer, sizeof(buffer)) <= 0)
+    {
+        return false; // failure
+    }
+    char* pOpen  = strchr(buffer, '(');
+    char* pClose = strrchr(buffer, ')');
+    if (pOpen == nullptr || pClose == nullptr || pClose < pOpen)
+    {
+        return false; // failure
+    }
+    g_strlcpy(pName, pOpen + 1,
+        std::min<gsize>(pClose - pOpen, cTopK::CONST_NAME_LENGTH));
+
+    // starttime is field 22, the 20th after the comm
+    char* pField = pClose + 1;
+    for (int i = 0; i < 19 && pField != nullptr; i++)
+    {
+        pField = strchr(pField + 1, ' ');
+    }
+    if (pField == nullptr)
+    {
+        return false; // failure
+    }
+    *pStartTime = strtoull(pField, nullptr, 10);
+
+    // io: bytes which reached the storage layer, less truncated pages
+    if (readFile(pidFd, "io", buffer, sizeof(buffer)) <= 0)
+    {
+        return false; // failure
+    }
+    char* pWrite     = strstr(buffer, "\nwrite_bytes: ");
+    char* pCancelled = strstr(buffer, "\ncancelled_write_bytes: ");
+    if (pWrite == nullptr || pCancelled == nullptr)
+    {
+        return false; // failure
+    }
+    guint64 written   = strtoull(pWrite + strlen("\nwrite_bytes: "), nullptr, 10);
+    guint64 cancelled = strtoull(
+        pCancelled + strlen("\ncancelled_write_bytes: "), nullptr, 10);
+    *pWriteBytes = written > cancelled ? written - cancelled : 0;
+    return true; // success
+}
+
+void cProcessSampler::mapProcess(int pidFd, guint64 bytes, const char* pName,
+    std::vector<struct sProcessWrite>* pWrites)
+{
+    int fdDirFd = openat(pidFd, "fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fdDirFd < 0)
+    {
+        return;
+    }
+
+    // the disks the process has regular files open on
+    guint64 deviceMask = 0;
+    char buffer[CONST_DIRENT_BUFFER_SIZE];
+    long length;
+    while ((length = readDirectory(fdDirFd, buffer, sizeof(buffer))) > 0)
+    {
+        for (long offset = 0; offset < length;)
+        {
+            auto pEntry = (struct sLinuxDirent64*)(buffer + offset);
+            offset += pEntry->d_reclen;
+            if (pEntry->d_name[0] == '.')
+            {
+                continue;
+            }
+
+            struct stat info;
+            guint index;
+            if (fstatat(fdDirFd, pEntry->d_name, &info, 0) == 0
+                && S_ISREG(info.st_mode) && findDevice(info.st_dev, &index))
+            {
+                deviceMask |= (guint64)1 << index;
+            }
+        }
+    }
+    close(fdDirFd);
+
+    int deviceCount = __builtin_popcountll(deviceMask);
+    for (guint index = 0; deviceMask != 0; index++, deviceMask >>= 1)
+    {
+        if (deviceMask & 1)
+        {
+            struct sProcessWrite write = { .deviceIndex = index,
+                .bytes = bytes / deviceCount };
+            g_strlcpy(write.name, pName, cTopK::CONST_NAME_LENGTH);
+            pWrites->push_back(write);
+        }
+    }
+}
+
+bool cProcessSampler::findDevice(dev_t device, guint* pIndex)
+{
+    for (auto const & [number, index] : _devices)
+    {
+        if (number == device)
+        {
+            *pIndex = index;
+            return true; // success
+        }
+    }
+    return false; // failure
+}
@@ -0,0 +1,56 @@
+// cProcessSampler.hh
+#ifndef _CPROCESSSAMPLER_H
+#define _CPROCESSSAMPLER_H
+
+#include "cTopK.hh"
+#include <glib.h>
+#include <string>
+#include <sys/types.h>
+#include <unordered_map>
+#include <vector>
+
+struct sProcessWrite
+{
+        char name[cTopK::CONST_NAME_LENGTH];
+        guint deviceIndex; // into the names given to setDevices()
+        guint64 bytes;
+};
+
+/*
+Attributes writes to processes from /proc/<pid>/io.
+
+Each scan reads write_bytes of every process and reports the growth since
+the previous scan. A process is mapped to the monitored disks it has
+regular files open on, its bytes are split evenly between them. The /proc
+directory descriptor is reused and nothing is allocated per process once
+its baseline exists.
+*/
+class cProcessSampler
+{
+    public:
+        ~cProcessSampler();
+        bool setDevices(std::vector<std::string> const & deviceNames);
+        bool sample(std::vector<struct sProcessWrite>* pWrites);
+
+    private:
+        struct sBaseline
+        {
+                guint64 startTime; // tells a reused pid apart
+                guint64 writeBytes;
+                guint generation;  // last scan the process was seen in
+        };
+
+        int _procFd = -1;
+        guint _generation = 0;
+        std::unordered_map<pid_t, struct sBaseline> _baselines;
+        // st_dev of the disks and their partitions, by device index
+        std::vector<std::pair<dev_t, guint>> _devices;
+
+        bool readProcess(int pidFd, guint64* pStartTime, guint64* pWriteBytes,
+            char* pName);
+        void mapProcess(int pidFd, guint64 bytes, const char* pName,
+            std::vector<struct sProcessWrite>* pWrites);
+        bool findDevice(dev_t device, guint* pIndex);
+};
+
+#endif /* _CPROCESSSAMPLER_H */
@@ -0,0 +1,171 @@
+#include "cQueueDepthSampler.hh"
+#include "../utils/log-event.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// the lowest priority, polling must not compete with the io it observes
+constexpr int CONST_POLL_NICE = 19;
+
+// destructor
+
+cQueueDepthSampler::~cQueueDepthSampler()
+{
+    stop();
+    for (auto &pDevice : _devices)
+        close(pDevice->fd);
+}
+
+// public functions
+
+bool cQueueDepthSampler::addDevice(std::string const & deviceName)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto &pDevice : _devices)
+    {
+        if (pDevice->deviceName == deviceName)
+            return true; // already polled
+    }
+
+    // "<reads> <writes>", read again from offset 0 at every poll
+    auto path = "/sys/block/" + deviceName + "/inflight";
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        LOG_EVENT(LOG_ERR, "Unable to open [%s]: %s\n", path.c_str(),
+            strerror(errno));
+        return false; // failure
+    }
+
+    auto pDevice = std::make_unique<struct sDevice>();
+    pDevice->deviceName = deviceName;
+    pDevice->fd         = fd;
+    _devices.push_back(std::move(pDevice));
+    return true; // success
+}
+
+void cQueueDepthSampler::removeDevice(std::string const & deviceName)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto it = _devices.begin(); it != _devices.end(); it++)
+    {
+        if ((*it)->deviceName == deviceName)
+        {
+            close((*it)->fd);
+            _devices.erase(it);
+            return;
+        }
+    }
+}
+
+bool cQueueDepthSampler::start(guint intervalMilliseconds)
+{
+    if (_thread.joinable() || intervalMilliseconds == 0)
+        return false; // failure
+
+    _isStopping = false;
+    _thread = std::thread([this, intervalMilliseconds]() {
+        // signals are left to the main loop
+        sigset_t signals;
+        sigfillset(&signals);
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+        if (setpriority(PRIO_PROCESS, syscall(SYS_gettid), CONST_POLL_NICE) != 0)
+            LOG_EVENT(LOG_WARNING, "Unable to lower the priority of the "
+                "queue depth sampler: %s\n", strerror(errno));
+
+        auto interval = std::chrono::milliseconds(intervalMilliseconds);
+        auto deadline = std::chrono::steady_clock::now();
+        while (true)
+        {
+            poll();
+            // polls missed while starved are skipped, not caught up
+            deadline = std::max(deadline + interval,
+                std::chrono::steady_clock::now());
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (_wakeup.wait_until(lock, deadline, [this]() {
+                    return _isStopping;
+                }))
+                break;
+        }
+    });
+    return true; // success
+}
+
+void cQueueDepthSampler::stop(void)
+{
+    if (!_thread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _isStopping = true;
+    }
+    _wakeup.notify_all();
+    _thread.join();
+}
+
+bool cQueueDepthSampler::isRunning(void)
+{
+    return _thread.joinable();
+}
+
+bool cQueueDepthSampler::takeInterval(
+    std::string const & deviceName, struct sQueueDepth* pDepth)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto &pDevice : _devices)
+    {
+        if (pDevice->deviceName != deviceName)
+            continue;
+
+        *pDepth = pDevice->depth;
+        pDepth->meanDepthMilli = pDevice->weightedTime > 0
+            ? pDevice->weightedDepth * 1000 / pDevice->weightedTime : 0;
+        pDevice->depth         = {};
+        pDevice->weightedDepth = 0;
+        pDevice->weightedTime  = 0;
+        return true; // success
+    }
+    return false; // not polled
+}
+
+// private functions
+
+void cQueueDepthSampler::poll(void)
+{
+    char text[64];
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto now = g_get_monotonic_time();
+    for (auto &pDevice : _devices)
+    {
+        auto length = pread(pDevice->fd, text, sizeof(text) - 1, 0);
+        if (length <= 0)
+            continue; // removed, until removeDevice()
+        text[length] = '\0';
+        char* pEnd;
+        auto reads  = strtoll(text, &pEnd, 10);
+        auto writes = strtoll(pEnd, nullptr, 10);
+        gint64 depth = reads + writes;
+
+        // the depth read stands for the time since the previous poll
+        if (pDevice->previousTime != 0)
+        {
+            pDevice->weightedDepth += depth * (now - pDevice->previousTime);
+            pDevice->weightedTime  += now - pDevice->previousTime;
+        }
+        pDevice->previousTime = now;
+
+        auto pDepth = &pDevice->depth;
+        pDepth->polls++;
+        pDepth->peakDepth = std::max(pDepth->peakDepth, depth);
+        pDepth->histogram.record(depth);
+    }
+}
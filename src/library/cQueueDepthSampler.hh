@@ -0,0 +1,57 @@
+// cQueueDepthSampler.hh
+#ifndef _CQUEUEDEPTHSAMPLER_H
+#define _CQUEUEDEPTHSAMPLER_H
+
+#include "include/structs.hh"
+#include <condition_variable>
+#include <glib.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+Polls the requests in flight of block devices far more often than their
+counters are sampled.
+
+A thread running at the lowest priority reads /sys/block/<dev>/inflight of
+every device each interval with pread() on a descriptor kept open, and
+accumulates per device the time-weighted mean depth, the peak and a
+histogram of the depth of each poll. takeInterval() hands them over and
+starts the next interval. Polling allocates nothing.
+*/
+class cQueueDepthSampler
+{
+    public:
+        ~cQueueDepthSampler();
+        bool addDevice(std::string const & deviceName);
+        void removeDevice(std::string const & deviceName);
+        bool start(guint intervalMilliseconds);
+        void stop(void);
+        bool isRunning(void);
+        // false if the device isn't polled
+        bool takeInterval(
+            std::string const & deviceName, struct sQueueDepth* pDepth);
+
+    private:
+        struct sDevice
+        {
+                std::string deviceName;
+                int fd;
+                gint64 previousTime; // of the previous poll
+                gint64 weightedDepth; // depth times microseconds
+                gint64 weightedTime;  // microseconds
+                struct sQueueDepth depth;
+        };
+
+        std::vector<std::unique_ptr<struct sDevice>> _devices;
+        std::mutex _mutex;
+        std::thread _thread;
+        std::condition_variable _wakeup;
+        bool _isStopping = false;
+
+        void poll(void);
+};
+
+#endif /* _CQUEUEDEPTHSAMPLER_H */
@@ -43,7 +43,8 @@ void cStatComputer::updateStats(struct sBlockStats* pPreviousStats,
     pOutputStats->writeMerges += pCurrentStats->writeMerges - pPreviousStats->writeMerges;
     pOutputStats->writeSectors += pCurrentStats->writeSectors - pPreviousStats->writeSectors;
     pOutputStats->writeTicks += pCurrentStats->writeTicks - pPreviousStats->writeTicks;
-    pOutputStats->inFlight += pCurrentStats->inFlight - pPreviousStats->inFlight;
+    // a gauge, not a counter
+    pOutputStats->inFlight = pCurrentStats->inFlight;
     pOutputStats->ioTicks += pCurrentStats->ioTicks - pPreviousStats->ioTicks;
     pOutputStats->timeInQueue += pCurrentStats->timeInQueue - pPreviousStats->timeInQueue;
     pOutputStats->discardIo += pCurrentStats->discardIo - pPreviousStats->discardIo;
@@ -51,3 +52,57 @@ void cStatComputer::updateStats(struct sBlockStats* pPreviousStats,
     pOutputStats->discardSectors += pCurrentStats->discardSectors - pPreviousStats->discardSectors;
     pOutputStats->discardTicks += pCurrentStats->discardTicks - pPreviousStats->discardTicks;
 }
+
+void cStatComputer::getIntervalMetrics(struct sBlockStats* pPreviousStats,
+    struct sBlockStats* pCurrentStats, uint sectorSize,
+    struct sIntervalMetrics* pMetrics)
+{
+    auto readTicks    = pCurrentStats->readTicks - pPreviousStats->readTicks;
+    auto writeTicks   = pCurrentStats->writeTicks - pPreviousStats->writeTicks;
+    auto readSectors  = pCurrentStats->readSectors - pPreviousStats->readSectors;
+    auto writeSectors = pCurrentStats->writeSectors - pPreviousStats->writeSectors;
+
+    pMetrics->readIo  = pCurrentStats->readIo - pPreviousStats->readIo;
+    pMetrics->writeIo = pCurrentStats->writeIo - pPreviousStats->writeIo;
+
+    // ticks are reported in milliseconds
+    pMetrics->readAwaitUs = pMetrics->readIo > 0
+        ? (readTicks * 1000) / pMetrics->readIo : 0;
+    pMetrics->writeAwaitUs = pMetrics->writeIo > 0
+        ? (writeTicks * 1000) / pMetrics->writeIo : 0;
+
+    auto totalIo = pMetrics->readIo + pMetrics->writeIo;
+    pMetrics->averageRequestSize = totalIo > 0
+        ? ((readSectors + writeSectors) * sectorSize) / totalIo : 0;
+}
+
+bool cStatComputer::updateHistograms(struct sBlockStats* pPreviousStats,
+    struct sBlockStats* pCurrentStats, uint sectorSize,
+    struct sDeviceHistograms* pHistograms)
+{
+    struct sIntervalMetrics metrics;
+    getIntervalMetrics(pPreviousStats, pCurrentStats, sectorSize, &metrics);
+
+    // counters going backwards means the device was reset, skip the interval
+    if (metrics.readIo < 0 || metrics.writeIo < 0
+        || metrics.readAwaitUs < 0 || metrics.writeAwaitUs < 0
+        || metrics.averageRequestSize < 0)
+    {
+        return false; // nothing recorded
+    }
+
+    if (metrics.readIo > 0)
+    {
+        pHistograms->readAwait.record(metrics.readAwaitUs);
+    }
+    if (metrics.writeIo > 0)
+    {
+        pHistograms->writeAwait.record(metrics.writeAwaitUs);
+    }
+    if (metrics.readIo + metrics.writeIo > 0)
+    {
+        pHistograms->requestSize.record(metrics.averageRequestSize);
+        return true; // recorded
+    }
+    return false; // nothing recorded
+}
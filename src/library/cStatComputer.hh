@@ -16,6 +16,12 @@ class cStatComputer
             gint64 previousWriteSectors, gint64 previousTotal);
         void updateStats(struct sBlockStats *pPreviousStats,
             struct sBlockStats *pCurrentStats, struct sBlockStats *pOutputStats);
+        void getIntervalMetrics(struct sBlockStats* pPreviousStats,
+            struct sBlockStats* pCurrentStats, uint sectorSize,
+            struct sIntervalMetrics* pMetrics);
+        bool updateHistograms(struct sBlockStats* pPreviousStats,
+            struct sBlockStats* pCurrentStats, uint sectorSize,
+            struct sDeviceHistograms* pHistograms);
 };
 
 #endif /* _CSTATCOMPUTER_H */
@@ -2,9 +2,57 @@
 #include "../utils/log-event.hh"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <filesystem>
 #include <fstream>
+#include <limits.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+// /sys/block/<dev>/stat and /proc/self/io are a few hundred bytes at most
+constexpr gsize CONST_SMALL_FILE_SIZE = 512;
+constexpr guint CONST_STAT_FIELDS     = 15;
+// /proc/diskstats is about 150 bytes per disk and partition
+constexpr gsize CONST_DISKSTATS_SIZE  = 64 * 1024;
+
+// reads a sysfs or procfs file into pBuffer, NUL terminated, seq_file
+// backed files like /proc/diskstats return about a page per read()
+static bool readSmallFile(const char* pPath, char* pBuffer, gsize size)
+{
+    int fd = open(pPath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false; // failure
+
+    gsize length = 0;
+    bool failed  = false;
+    for (;;)
+    {
+        if (length == size - 1)
+        {
+            // full, anything left to read is an overflow
+            char spare;
+            failed = (read(fd, &spare, 1) != 0);
+            break;
+        }
+        auto count = read(fd, pBuffer + length, size - 1 - length);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+        {
+            failed = (count < 0);
+            break;
+        }
+        length += count;
+    }
+    close(fd);
+    if (failed)
+        return false; // failure
+    pBuffer[length] = '\0';
+    return true; // success
+}
 
 // public functions
 
@@ -52,75 +100,140 @@ bool cStatReader::getSpaceInfo(std::string deviceName, uintmax_t* pValue)
     return true; // success
 }
 
-bool cStatReader::getDiskSeq(std::string deviceName, gint64* pSeq)
+bool cStatReader::getDiskSeq(std::string const & deviceName, gint64* pSeq)
 {
-    // get /sys/block/<dev>/stat
-    auto ifs = std::ifstream("/sys/block/" + deviceName + "/diskseq");
-    if (ifs.is_open() != true)
+    // get /sys/block/<dev>/diskseq
+    char path[PATH_MAX];
+    char line[CONST_SMALL_FILE_SIZE];
+    snprintf(path, sizeof(path), "/sys/block/%s/diskseq", deviceName.c_str());
+    if (!readSmallFile(path, line, sizeof(line)))
     {
         LOG_EVENT(LOG_ERR, "Failed to get device events");
         return false; // failure
     }
-    std::string line;
-    std::getline(ifs, line);
 
-    if (line.empty())
+    if (line[0] == '\0' || line[0] == '\n')
     {
         LOG_EVENT(LOG_ERR, "Device does not exist");
         return false; // failure
     }
 
 
-    *pSeq = (gint64) std::stoul(line);
+    *pSeq = (gint64) strtoull(line, nullptr, 10);
     return *pSeq > 1;
 }
 
-bool cStatReader::getStats(std::string deviceName, struct sBlockStats* pStats)
+bool cStatReader::hasDevice(std::string const & deviceName)
+{
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "/sys/block/%s", deviceName.c_str());
+    return access(path, F_OK) == 0;
+}
+
+bool cStatReader::getStats(
+    std::string const & deviceName, struct sBlockStats* pStats)
 {
     // get /sys/block/<dev>/stat
-    auto ifs = std::ifstream("/sys/block/" + deviceName + "/stat");
-    if (ifs.is_open() != true)
+    char path[PATH_MAX];
+    char line[CONST_SMALL_FILE_SIZE];
+    snprintf(path, sizeof(path), "/sys/block/%s/stat", deviceName.c_str());
+    if (!readSmallFile(path, line, sizeof(line)))
     {
         LOG_EVENT(LOG_ERR, "Failed to get device stats");
         return false; // failure
     }
-    std::string line;
-    std::getline(ifs, line);
 
-    if (line.empty())
+    // carve up data into struct, kernels before 4.18 have no discard fields
+    gint64 values[CONST_STAT_FIELDS] = {};
+    const char* pText = line;
+    guint count = 0;
+    while (count < CONST_STAT_FIELDS)
+    {
+        char* pEnd;
+        values[count] = strtoll(pText, &pEnd, 10);
+        if (pEnd == pText)
+            break;
+        pText = pEnd;
+        count++;
+    }
+
+    if (count == 0)
     {
         LOG_EVENT(LOG_ERR, "Device does not exist");
         return false; // failure
     }
 
-    // carve up data into struct
-    std::istringstream strm(line);
-    std::vector<std::string> vec;
-    std::string s;
+    pStats->readIo         = values[0];
+    pStats->readMerges     = values[1];
+    pStats->readSectors    = values[2];
+    pStats->readTicks      = values[3];
 
-    while (strm >> s)
-        // loop for each string and add to the vector
-        vec.push_back(s);
+    pStats->writeIo        = values[4];
+    pStats->writeMerges    = values[5];
+    pStats->writeSectors   = values[6];
+    pStats->writeTicks     = values[7];
 
-    pStats->readIo         = (gint64) std::stoul(vec[0]);
-    pStats->readMerges     = (gint64) std::stoul(vec[1]);
-    pStats->readSectors    = (gint64) std::stoul(vec[2]);
-    pStats->readTicks      = (gint64) std::stoi(vec[3]);
+    pStats->inFlight       = values[8];
+    pStats->ioTicks        = values[9];
+    pStats->timeInQueue    = values[10];
 
-    pStats->writeIo        = (gint64) std::stoul(vec[4]);
-    pStats->writeMerges    = (gint64) std::stoul(vec[5]);
-    pStats->writeSectors   = (gint64) std::stoul(vec[6]);
-    pStats->writeTicks     = (gint64) std::stoi(vec[7]);
+    pStats->discardIo      = values[11];
+    pStats->discardMerges  = values[12];
+    pStats->discardSectors = values[13];
+    pStats->discardTicks   = values[14];
 
-    pStats->inFlight       = (gint64) std::stoi(vec[8]);
-    pStats->ioTicks        = (gint64) std::stoi(vec[9]);
-    pStats->timeInQueue    = (gint64) std::stoi(vec[10]);
+    return true; // success
+}
 
-    pStats->discardIo      = (gint64) std::stoul(vec[11]);
-    pStats->discardMerges  = (gint64) std::stoul(vec[12]);
-    pStats->discardSectors = (gint64) std::stoul(vec[13]);
-    pStats->discardTicks   = (gint64) std::stoi(vec[14]);
+bool cStatReader::getAllStats(
+    std::vector<struct sDiskStats>* pDisks, const char* pPath)
+{
+    char text[CONST_DISKSTATS_SIZE];
+    if (!readSmallFile(pPath, text, sizeof(text)))
+    {
+        LOG_EVENT(LOG_ERR, "Failed to get disk stats");
+        return false; // failure
+    }
 
+    // "<major> <minor> <name>" then the fields of /sys/block/<dev>/stat,
+    // reusing the entries of the previous call
+    gsize count = 0;
+    for (const char* pLine = text; *pLine != '\0';)
+    {
+        const char* pEnd = strchr(pLine, '\n');
+        if (pEnd == nullptr)
+            break; // truncated
+        char* pText;
+        strtoll(pLine, &pText, 10);
+        strtoll(pText, &pText, 10);
+        pText += strspn(pText, " ");
+        gsize nameLength = strcspn(pText, " \n");
+
+        gint64 values[CONST_STAT_FIELDS] = {};
+        const char* pValue = pText + nameLength;
+        for (guint i = 0; i < CONST_STAT_FIELDS && pValue < pEnd; i++)
+        {
+            char* pNext;
+            values[i] = strtoll(pValue, &pNext, 10);
+            if (pNext == pValue)
+                break;
+            pValue = pNext;
+        }
+        pLine = pEnd + 1;
+
+        if (nameLength == 0
+            || nameLength >= sizeof(((struct sDiskStats*)0)->deviceName))
+            continue;
+        if (count == pDisks->size())
+            pDisks->emplace_back();
+        auto pDisk = &(*pDisks)[count++];
+        memcpy(pDisk->deviceName, pText, nameLength);
+        pDisk->deviceName[nameLength] = '\0';
+        pDisk->stats = { values[0], values[1], values[2], values[3], values[4],
+            values[5], values[6], values[7], values[8], values[9], values[10],
+            values[11], values[12], values[13], values[14] };
+    }
+    pDisks->resize(count);
     return true; // success
 }
 
@@ -151,6 +264,80 @@ bool cStatReader::getSpecs(std::string deviceName, struct sDeviceSpecs* pSpecs)
     return false; // failure
 }
 
+bool cStatReader::getSelfBytesWritten(gint64* pValue)
+{
+    // get /proc/self/io
+    char text[CONST_SMALL_FILE_SIZE];
+    if (!readSmallFile("/proc/self/io", text, sizeof(text)))
+    {
+        LOG_EVENT(LOG_ERR, "Failed to get process io");
+        return false; // failure
+    }
+
+    // "<key>: <value>" per line
+    gint64 writeBytes     = -1;
+    gint64 cancelledBytes = -1;
+    for (const char* pLine = text; pLine != nullptr && *pLine != '\0';)
+    {
+        auto pColon = strchr(pLine, ':');
+        if (pColon == nullptr)
+            break;
+        std::string_view key(pLine, pColon - pLine);
+        if (key == "write_bytes")
+            writeBytes = strtoll(pColon + 1, nullptr, 10);
+        else if (key == "cancelled_write_bytes")
+            cancelledBytes = strtoll(pColon + 1, nullptr, 10);
+        pLine = strchr(pColon, '\n');
+        if (pLine != nullptr)
+            pLine++;
+    }
+
+    if (writeBytes < 0 || cancelledBytes < 0)
+    {
+        LOG_EVENT(LOG_ERR, "Process io is missing write_bytes");
+        return false; // failure
+    }
+
+    // dirty pages truncated before writeback never reach the device
+    *pValue = writeBytes - cancelledBytes;
+    return true; // success
+}
+
+bool cStatReader::getDeviceNameForPath(
+    std::string path, std::string* pDeviceName)
+{
+    // the file itself may not exist yet, fall back to its directory
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+    {
+        auto directory = std::filesystem::path(path).parent_path();
+        if (directory.empty() || stat(directory.c_str(), &info) != 0)
+        {
+            LOG_EVENT(LOG_ERR, "Failed to stat [%s], %s", path.c_str(),
+                strerror(errno));
+            return false; // failure
+        }
+    }
+
+    // filesystems without a backing block device (tmpfs, ...) end here
+    auto sysfsPath = "/sys/dev/block/" + std::to_string(major(info.st_dev))
+        + ":" + std::to_string(minor(info.st_dev));
+    std::error_code error;
+    auto devicePath = std::filesystem::canonical(sysfsPath, error);
+    if (error)
+    {
+        return false; // failure
+    }
+
+    // stats are kept per disk, partitions are accounted to their parent
+    if (std::filesystem::exists(devicePath / "partition"))
+    {
+        devicePath = devicePath.parent_path();
+    }
+    *pDeviceName = devicePath.filename();
+    return true; // success
+}
+
 // private functions
 
 bool cStatReader::getSpecsEmmc(
@@ -7,14 +7,25 @@
 #include <string>
 #include <vector>
 
+// the sample functions are virtual, a recorded trace can stand in for sysfs,
+// they read into buffers on the stack and don't allocate
 class cStatReader
 {
     public:
+        virtual ~cStatReader() = default;
         std::vector<std::string> findDevices(void);
         bool getSpaceInfo(std::string deviceName, uintmax_t* pValue);
-        bool getStats(std::string deviceName, struct sBlockStats* pStats);
-        bool getDiskSeq(std::string deviceName, gint64* pSeq);
+        virtual bool getStats(
+            std::string const & deviceName, struct sBlockStats* pStats);
+        virtual bool getDiskSeq(std::string const & deviceName, gint64* pSeq);
+        virtual bool hasDevice(std::string const & deviceName);
+        // every disk and partition of /proc/diskstats, read whole, fails
+        // past 64 KiB, pPath is a file in the same format for tests
+        bool getAllStats(std::vector<struct sDiskStats>* pDisks,
+            const char* pPath = "/proc/diskstats");
         bool getSpecs(std::string deviceName, struct sDeviceSpecs* pSpecs);
+        bool getSelfBytesWritten(gint64* pValue);
+        bool getDeviceNameForPath(std::string path, std::string* pDeviceName);
 
     private:
         int _sectorSize = 512;
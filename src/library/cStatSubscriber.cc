@@ -0,0 +1,363 @@
+#include "cStatSubscriber.hh"
+#include "../utils/log-event.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+constexpr gint64 CONST_SECTOR_SIZE = 512;
+// deltas an eventfd subscription keeps for takeDeltas(), the oldest go first
+constexpr gsize CONST_MAX_QUEUED_DELTAS = 1024;
+
+// counters since pBaseline, or since they started again from zero
+static void getDelta(struct sBlockStats const * pStats,
+    struct sBlockStats const * pBaseline, struct sBlockStats* pDelta)
+{
+    bool wrapped = pStats->readIo < pBaseline->readIo
+        || pStats->writeIo < pBaseline->writeIo
+        || pStats->discardIo < pBaseline->discardIo;
+    static const struct sBlockStats zero = {};
+    auto pFrom = wrapped ? &zero : pBaseline;
+
+    pDelta->readIo         = pStats->readIo - pFrom->readIo;
+    pDelta->readMerges     = pStats->readMerges - pFrom->readMerges;
+    pDelta->readSectors    = pStats->readSectors - pFrom->readSectors;
+    pDelta->readTicks      = pStats->readTicks - pFrom->readTicks;
+    pDelta->writeIo        = pStats->writeIo - pFrom->writeIo;
+    pDelta->writeMerges    = pStats->writeMerges - pFrom->writeMerges;
+    pDelta->writeSectors   = pStats->writeSectors - pFrom->writeSectors;
+    pDelta->writeTicks     = pStats->writeTicks - pFrom->writeTicks;
+    pDelta->inFlight       = pStats->inFlight;
+    pDelta->ioTicks        = pStats->ioTicks - pFrom->ioTicks;
+    pDelta->timeInQueue    = pStats->timeInQueue - pFrom->timeInQueue;
+    pDelta->discardIo      = pStats->discardIo - pFrom->discardIo;
+    pDelta->discardMerges  = pStats->discardMerges - pFrom->discardMerges;
+    pDelta->discardSectors = pStats->discardSectors - pFrom->discardSectors;
+    pDelta->discardTicks   = pStats->discardTicks - pFrom->discardTicks;
+}
+
+// constructor and destructor
+
+cStatSubscriber::cStatSubscriber(const char* pDiskstatsPath)
+    : _diskstatsPath(pDiskstatsPath)
+{
+}
+
+cStatSubscriber::~cStatSubscriber()
+{
+    stop();
+    for (auto const & subscription : _subscriptions)
+    {
+        if (subscription.eventFd >= 0)
+            close(subscription.eventFd);
+    }
+}
+
+// public functions
+
+int cStatSubscriber::subscribe(std::vector<std::string> const & deviceNames,
+    struct sSubscriptionThresholds thresholds, tCallback callback)
+{
+    if (!callback)
+        return -1; // failure
+    return addSubscription(deviceNames, thresholds, callback, -1);
+}
+
+int cStatSubscriber::subscribe(std::vector<std::string> const & deviceNames,
+    struct sSubscriptionThresholds thresholds, int* pEventFd)
+{
+    int eventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (eventFd < 0)
+    {
+        LOG_EVENT(LOG_ERR, "Failed to create eventfd, %s", strerror(errno));
+        return -1; // failure
+    }
+    int id = addSubscription(deviceNames, thresholds, nullptr, eventFd);
+    if (id < 0)
+    {
+        close(eventFd);
+        return -1; // failure
+    }
+    *pEventFd = eventFd;
+    return id;
+}
+
+bool cStatSubscriber::unsubscribe(int subscriptionId)
+{
+    // waits for a sample calling back on another thread
+    std::lock_guard<std::recursive_mutex> deliveryLock(_deliveryMutex);
+    for (gsize i = 0; i < _deliveryCount; i++)
+    {
+        if (_deliveries[i].id == subscriptionId)
+            _deliveries[i].id = 0;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = std::find_if(_subscriptions.begin(), _subscriptions.end(),
+        [subscriptionId](struct sSubscription const & subscription) {
+            return subscription.id == subscriptionId;
+        });
+    if (it == _subscriptions.end())
+        return false; // not subscribed
+
+    // devices nobody subscribes to any more are no longer compared
+    for (auto index : it->devices)
+        _devices[index].references--;
+    if (it->eventFd >= 0)
+        close(it->eventFd);
+    _subscriptions.erase(it);
+    return true; // success
+}
+
+bool cStatSubscriber::takeDeltas(
+    int subscriptionId, std::vector<struct sStatDelta>* pDeltas)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto &subscription : _subscriptions)
+    {
+        if (subscription.id != subscriptionId)
+            continue;
+
+        // resets the count of the eventfd, the queue is handed over whole
+        guint64 count;
+        if (subscription.eventFd >= 0
+            && read(subscription.eventFd, &count, sizeof(count)) < 0
+            && errno != EAGAIN)
+            LOG_EVENT(LOG_ERR, "Failed to read eventfd, %s", strerror(errno));
+        if (subscription.dropped > 0)
+            LOG_EVENT(LOG_WARNING, "Subscription %d dropped %lu deltas\n",
+                subscriptionId, (gulong)subscription.dropped);
+        subscription.dropped = 0;
+        pDeltas->clear();
+        pDeltas->swap(subscription.queued);
+        return true; // success
+    }
+    return false; // not subscribed
+}
+
+bool cStatSubscriber::sample(void)
+{
+    auto now = g_get_monotonic_time();
+    std::lock_guard<std::recursive_mutex> deliveryLock(_deliveryMutex);
+    if (!_reader.getAllStats(&_disks, _diskstatsPath.c_str()))
+        return false; // failure
+
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    // one comparison of the packed counters per subscribed device
+    for (auto &device : _devices)
+    {
+        device.hasChanged = false;
+        if (device.references == 0)
+            continue;
+
+        auto pDisk = _disks.begin();
+        while (pDisk != _disks.end()
+            && strcmp(pDisk->deviceName, device.deviceName) != 0)
+            pDisk++;
+        if (pDisk == _disks.end())
+        {
+            device.isPresent = false;
+            continue;
+        }
+        if (device.isPresent
+            && memcmp(&pDisk->stats, &device.stats, sizeof(device.stats)) == 0)
+            continue;
+
+        device.hasChanged = device.isPresent;
+        device.isPresent  = true;
+        device.stats      = pDisk->stats;
+    }
+
+    _deliveryCount = 0;
+    for (auto &subscription : _subscriptions)
+        deliver(&subscription, now);
+    lock.unlock();
+
+    // a callback may unsubscribe a later one, which is then skipped
+    for (gsize i = 0; i < _deliveryCount; i++)
+    {
+        if (_deliveries[i].id != 0)
+            _deliveries[i].callback(_deliveries[i].batch);
+    }
+    return true; // success
+}
+
+bool cStatSubscriber::start(guint intervalMilliseconds)
+{
+    if (intervalMilliseconds == 0)
+        return false; // failure
+    if (_thread.joinable())
+    {
+        // only a thread stopped from a callback is left to join
+        std::unique_lock<std::mutex> lock(_mutex);
+        bool isStopping = _isStopping;
+        lock.unlock();
+        if (!isStopping || std::this_thread::get_id() == _thread.get_id())
+            return false; // failure
+        _thread.join();
+    }
+
+    _isStopping = false;
+    _thread = std::thread([this, intervalMilliseconds]() {
+        // signals are left to the main loop
+        sigset_t signals;
+        sigfillset(&signals);
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+        auto interval = std::chrono::milliseconds(intervalMilliseconds);
+        auto deadline = std::chrono::steady_clock::now();
+        while (true)
+        {
+            sample();
+            deadline += interval;
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (_wakeup.wait_until(lock, deadline, [this]() {
+                    return _isStopping;
+                }))
+                break;
+        }
+    });
+    return true; // success
+}
+
+void cStatSubscriber::stop(void)
+{
+    if (!_thread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _isStopping = true;
+    }
+    _wakeup.notify_all();
+
+    // from a callback, the thread ends once it returns
+    if (std::this_thread::get_id() == _thread.get_id())
+        return;
+    _thread.join();
+}
+
+// private functions
+
+int cStatSubscriber::addSubscription(
+    std::vector<std::string> const & deviceNames,
+    struct sSubscriptionThresholds thresholds, tCallback callback,
+    int eventFd)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    struct sSubscription subscription = {
+        .id         = _nextId,
+        .thresholds = thresholds,
+        .callback   = callback,
+        .eventFd    = eventFd,
+    };
+    for (auto const & deviceName : deviceNames)
+    {
+        if (deviceName.empty()
+            || deviceName.size() >= sizeof(((struct sDevice*)0)->deviceName))
+        {
+            LOG_EVENT(LOG_ERR, "Invalid device name [%s]\n",
+                deviceName.c_str());
+            for (auto index : subscription.devices)
+                _devices[index].references--;
+            return -1; // failure
+        }
+        subscription.devices.push_back(addDevice(deviceName));
+    }
+
+    // changes are counted from the last sample, if the device was in it
+    for (auto index : subscription.devices)
+    {
+        auto pDevice = &_devices[index];
+        subscription.baselines.push_back({ .stats = pDevice->stats,
+            .time = g_get_monotonic_time(), .isValid = pDevice->isPresent });
+    }
+    subscription.batch.reserve(subscription.devices.size());
+    _subscriptions.push_back(std::move(subscription));
+    return _nextId++;
+}
+
+guint cStatSubscriber::addDevice(std::string const & deviceName)
+{
+    for (guint i = 0; i < _devices.size(); i++)
+    {
+        if (deviceName == _devices[i].deviceName)
+        {
+            // not compared while unreferenced, the counters may be stale
+            if (_devices[i].references++ == 0)
+                _devices[i].isPresent = false;
+            return i;
+        }
+    }
+
+    struct sDevice device = { .references = 1 };
+    memcpy(device.deviceName, deviceName.c_str(), deviceName.size() + 1);
+    _devices.push_back(device);
+    return _devices.size() - 1;
+}
+
+void cStatSubscriber::deliver(struct sSubscription* pSubscription, gint64 now)
+{
+    pSubscription->batch.clear();
+    for (guint i = 0; i < pSubscription->devices.size(); i++)
+    {
+        auto pDevice   = &_devices[pSubscription->devices[i]];
+        auto pBaseline = &pSubscription->baselines[i];
+        if (!pDevice->isPresent)
+            continue;
+        if (!pBaseline->isValid)
+        {
+            // first seen since subscribing, the next change is delivered
+            *pBaseline = { .stats = pDevice->stats, .time = now, .isValid = true };
+            continue;
+        }
+        if (!pDevice->hasChanged)
+            continue;
+
+        struct sStatDelta delta;
+        getDelta(&pDevice->stats, &pBaseline->stats, &delta.delta);
+        auto io = delta.delta.readIo + delta.delta.writeIo
+            + delta.delta.discardIo;
+        auto bytes = (delta.delta.readSectors + delta.delta.writeSectors
+            + delta.delta.discardSectors) * CONST_SECTOR_SIZE;
+        if (io < pSubscription->thresholds.minIo
+            || bytes < pSubscription->thresholds.minBytes)
+            continue; // accumulates until the thresholds are reached
+
+        memcpy(delta.deviceName, pDevice->deviceName, sizeof(delta.deviceName));
+        delta.time     = now;
+        delta.interval = now - pBaseline->time;
+        pSubscription->batch.push_back(delta);
+        *pBaseline = { .stats = pDevice->stats, .time = now, .isValid = true };
+    }
+    if (pSubscription->batch.empty())
+        return;
+
+    if (pSubscription->callback)
+    {
+        // copied into a slot kept between samples, called by sample()
+        if (_deliveryCount == _deliveries.size())
+            _deliveries.emplace_back();
+        auto pDelivery      = &_deliveries[_deliveryCount++];
+        pDelivery->id       = pSubscription->id;
+        pDelivery->callback = pSubscription->callback;
+        pDelivery->batch    = pSubscription->batch;
+        return;
+    }
+    pSubscription->queued.insert(pSubscription->queued.end(),
+        pSubscription->batch.begin(), pSubscription->batch.end());
+    if (pSubscription->queued.size() > CONST_MAX_QUEUED_DELTAS)
+    {
+        auto excess = pSubscription->queued.size() - CONST_MAX_QUEUED_DELTAS;
+        pSubscription->queued.erase(pSubscription->queued.begin(),
+            pSubscription->queued.begin() + excess);
+        pSubscription->dropped += excess;
+    }
+    guint64 one = 1;
+    if (write(pSubscription->eventFd, &one, sizeof(one)) < 0)
+        LOG_EVENT(LOG_ERR, "Failed to signal eventfd, %s", strerror(errno));
+}
@@ -0,0 +1,129 @@
+// cStatSubscriber.hh
+#ifndef _CSTATSUBSCRIBER_H
+#define _CSTATSUBSCRIBER_H
+
+#include "cStatReader.hh"
+#include "include/structs.hh"
+#include <condition_variable>
+#include <functional>
+#include <glib.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct sStatDelta
+{
+        char deviceName[32];
+        gint64 time;     // g_get_monotonic_time() of the sample
+        gint64 interval; // microseconds since the previous delta
+        struct sBlockStats delta; // inFlight is the current value
+};
+
+// a delta is delivered once both are reached, 0 for any change
+struct sSubscriptionThresholds
+{
+        gint64 minIo;    // reads, writes and discards
+        gint64 minBytes; // read, written and discarded
+};
+
+/*
+Delivers the counters of the devices which changed to subscribers.
+
+A sample reads every disk with a single read of /proc/diskstats and
+compares the packed counters of each subscribed disk with those of the
+previous sample, only the disks which changed are looked at further. Each
+subscription keeps its own baselines, so a change below its thresholds
+accumulates until they are reached. A sample delivers one batch per
+subscription, to a callback or queued behind an eventfd.
+
+Samples are taken by sample() from the loop of the caller, or every
+interval by the thread of start(). Callbacks run on the sampling thread
+once the subscriptions are unlocked, so they may subscribe and unsubscribe,
+and are no longer called once unsubscribe() returns. A callback may call
+stop(), the thread then ends once it returns and is joined by the next
+start(), stop() or the destructor, but must not destroy the subscriber. An
+eventfd subscription keeps the most recent 1024 deltas until they are taken.
+*/
+class cStatSubscriber
+{
+    public:
+        using tCallback
+            = std::function<void(std::vector<struct sStatDelta> const &)>;
+
+        // pDiskstatsPath is a file in the format of /proc/diskstats for tests
+        explicit cStatSubscriber(
+            const char* pDiskstatsPath = "/proc/diskstats");
+        ~cStatSubscriber();
+        // return the subscription id, -1 on failure
+        int subscribe(std::vector<std::string> const & deviceNames,
+            struct sSubscriptionThresholds thresholds, tCallback callback);
+        // the eventfd counts the batches waiting for takeDeltas()
+        int subscribe(std::vector<std::string> const & deviceNames,
+            struct sSubscriptionThresholds thresholds, int* pEventFd);
+        bool unsubscribe(int subscriptionId);
+        bool takeDeltas(
+            int subscriptionId, std::vector<struct sStatDelta>* pDeltas);
+        bool sample(void);
+        bool start(guint intervalMilliseconds);
+        void stop(void);
+
+    private:
+        struct sDevice
+        {
+                char deviceName[32];
+                struct sBlockStats stats;
+                bool isPresent;
+                bool hasChanged; // in the last sample
+                guint references;
+        };
+        struct sBaseline
+        {
+                struct sBlockStats stats;
+                gint64 time;
+                bool isValid;
+        };
+        struct sSubscription
+        {
+                int id;
+                std::vector<guint> devices; // into _devices
+                std::vector<struct sBaseline> baselines;
+                struct sSubscriptionThresholds thresholds;
+                tCallback callback;
+                int eventFd;
+                std::vector<struct sStatDelta> batch;
+                std::vector<struct sStatDelta> queued; // for takeDeltas()
+                guint64 dropped; // since the last takeDeltas()
+        };
+        // a batch for a callback, called once the subscriptions are unlocked
+        struct sDelivery
+        {
+                int id; // 0 once unsubscribed
+                tCallback callback;
+                std::vector<struct sStatDelta> batch;
+        };
+
+        cStatReader _reader;
+        std::string _diskstatsPath;
+        std::vector<struct sDiskStats> _disks;
+        std::vector<struct sDevice> _devices;
+        std::vector<struct sSubscription> _subscriptions;
+        int _nextId = 1;
+        std::mutex _mutex;
+        // held by sample() while calling back, before _mutex
+        std::recursive_mutex _deliveryMutex;
+        std::vector<struct sDelivery> _deliveries;
+        gsize _deliveryCount = 0;
+
+        std::thread _thread;
+        std::condition_variable _wakeup;
+        bool _isStopping = false;
+
+        int addSubscription(std::vector<std::string> const & deviceNames,
+            struct sSubscriptionThresholds thresholds, tCallback callback,
+            int eventFd);
+        guint addDevice(std::string const & deviceName);
+        void deliver(struct sSubscription* pSubscription, gint64 now);
+};
+
+#endif /* _CSTATSUBSCRIBER_H */
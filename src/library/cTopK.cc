@@ -0,0 +1,80 @@
+#include "cTopK.hh"
+
+#include <algorithm>
+#include <string.h>
+
+// public functions
+
+void cTopK::setCapacity(guint capacity)
+{
+    _capacity = std::clamp(capacity, 1u, CONST_MAX_CAPACITY);
+    _size     = std::min(_size, _capacity);
+}
+
+void cTopK::record(const char* pName, guint64 count)
+{
+    auto pItem = find(pName);
+    if (pItem != nullptr)
+    {
+        pItem->count += count;
+        return;
+    }
+
+    if (_size < _capacity)
+    {
+        pItem        = &_items[_size++];
+        pItem->error = 0;
+        pItem->count = count;
+    }
+    else
+    {
+        // evict the lightest, its count bounds what the new name missed
+        pItem = std::min_element(_items.begin(), _items.begin() + _size,
+            [](const struct sItem& a, const struct sItem& b) {
+                return a.count < b.count;
+            });
+        pItem->error = pItem->count;
+        pItem->count += count;
+    }
+    g_strlcpy(pItem->name, pName, CONST_NAME_LENGTH);
+}
+
+bool cTopK::restore(const char* pName, guint64 count, guint64 error)
+{
+    if (_size >= _capacity || find(pName) != nullptr)
+    {
+        return false; // failure
+    }
+
+    auto pItem = &_items[_size++];
+    g_strlcpy(pItem->name, pName, CONST_NAME_LENGTH);
+    pItem->count = count;
+    pItem->error = error;
+    return true; // success
+}
+
+void cTopK::getItems(std::array<struct sItem, CONST_MAX_CAPACITY>* pItems,
+    guint* pSize) const
+{
+    std::copy(_items.begin(), _items.begin() + _size, pItems->begin());
+    std::sort(pItems->begin(), pItems->begin() + _size,
+        [](const struct sItem& a, const struct sItem& b) {
+            return a.count > b.count;
+        });
+    *pSize = _size;
+}
+
+// private functions
+
+struct cTopK::sItem* cTopK::find(const char* pName)
+{
+    for (guint i = 0; i < _size; i++)
+    {
+        // a longer name was stored truncated
+        if (strncmp(_items[i].name, pName, CONST_NAME_LENGTH - 1) == 0)
+        {
+            return &_items[i];
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,47 @@
+// cTopK.hh
+#ifndef _CTOPK_H
+#define _CTOPK_H
+
+#include <array>
+#include <glib.h>
+
+/*
+Space-Saving summary of the heaviest writers.
+
+At most CONST_MAX_CAPACITY names are tracked in place. A name which isn't
+tracked while the summary is full replaces the lightest entry and inherits
+its count as the error, so every reported count over-estimates the true
+one by at most its error and any name heavier than total / capacity is
+guaranteed to be present. Nothing is allocated after construction.
+*/
+class cTopK
+{
+    public:
+        static constexpr guint CONST_MAX_CAPACITY = 32;
+        static constexpr guint CONST_NAME_LENGTH  = 16; // as TASK_COMM_LEN
+
+        struct sItem
+        {
+                char name[CONST_NAME_LENGTH];
+                guint64 count;
+                guint64 error; // upper bound of the over-estimation
+        };
+
+        void setCapacity(guint capacity);
+        void record(const char* pName, guint64 count);
+        bool restore(const char* pName, guint64 count, guint64 error);
+        void reset(void) { _size = 0; }
+
+        guint getSize(void) const { return _size; }
+        // sorted heaviest first
+        void getItems(std::array<struct sItem, CONST_MAX_CAPACITY>* pItems,
+            guint* pSize) const;
+
+    private:
+        std::array<struct sItem, CONST_MAX_CAPACITY> _items = {};
+        guint _size     = 0;
+        guint _capacity = 10;
+        struct sItem* find(const char* pName);
+};
+
+#endif /* _CTOPK_H */
@@ -2,8 +2,14 @@
 #ifndef _STRUCTS_H
 #define _STRUCTS_H
 
+#include "../cAnomalyDetector.hh"
+#include "../cHistogram.hh"
+#include "../cTopK.hh"
+
 #include <glib.h>
+#include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 struct sBlockStatStub
@@ -42,6 +48,73 @@ struct sBlockStats
         }
 };
 
+// a line of /proc/diskstats, the name fits DISK_NAME_LEN of the kernel
+struct sDiskStats
+{
+        char deviceName[32];
+        struct sBlockStats stats;
+};
+
+struct sIntervalMetrics
+{
+        gint64 readIo;
+        gint64 writeIo;
+        gint64 readAwaitUs;  // average time per read, microseconds
+        gint64 writeAwaitUs; // average time per write, microseconds
+        gint64 averageRequestSize; // bytes per read or write
+};
+
+struct sDeviceHistograms
+{
+        cHistogram readAwait;
+        cHistogram writeAwait;
+        cHistogram requestSize;
+        cHistogram queueDepth; // requests in flight at each poll
+};
+
+// requests in flight between two samples, polled from sysfs
+struct sQueueDepth
+{
+        gint64 polls;
+        gint64 meanDepthMilli; // time-weighted mean, in thousandths
+        gint64 peakDepth;
+        cHistogram histogram;  // depth of each poll
+};
+
+struct sTopWriters
+{
+        cTopK interval; // since the previous sample
+        cTopK day;
+        std::string dayDate; // YYYY-MM-DD the day summary belongs to
+};
+
+struct sCgroupIo
+{
+        guint64 rbytes;
+        guint64 wbytes;
+        guint64 rios;
+        guint64 wios;
+        guint64 dbytes;
+
+        inline void operator += (const struct sCgroupIo& a) {
+            rbytes += a.rbytes;
+            wbytes += a.wbytes;
+            rios += a.rios;
+            wios += a.wios;
+            dbytes += a.dbytes;
+        }
+};
+
+struct sAnomalies
+{
+        gint64 count; // since the device was first seen
+        std::string lastTime;
+        std::string lastMetric;
+        gint64 lastValue;
+        gint64 lastMean;
+        gint64 lastDeviation;
+};
+
 struct sDeviceSpecs
 {
         struct sBlockStatStub manfid;
@@ -63,6 +136,23 @@ struct sDeviceEntry
         struct sBlockStats outputStats;
         gint64 totalBytesWritten;
         gint64 diskSeq;
+        struct sDeviceHistograms histograms;
+        bool persistPending; // changed since the stats file was last written
+        gint64 selfBytesWritten; // bytes written by KrillKounter itself
+        gint64 pendingSelfBytes; // own writes not yet seen in stats
+        struct sTopWriters topWriters;
+        // totals per cgroup path, relative to the cgroup root
+        std::map<std::string, struct sCgroupIo> cgroupIo;
+        // start of the window reported over the control socket
+        struct sBlockStats windowStats;
+        gint64 windowDiskSeq;
+        gint64 windowStartTime; // g_get_monotonic_time()
+        // per-interval anomaly detection
+        cAnomalyDetector anomalyDetector;
+        struct sAnomalies anomalies;
+        gint64 sampleTime; // g_get_monotonic_time() of the last sample
+        gint64 lastSeenTime; // wall clock seconds of the last sample
+        struct sQueueDepth queueDepth; // of the last sample interval
 };
 
 struct sJsonDeviceEntry
@@ -73,12 +163,60 @@ struct sJsonDeviceEntry
         struct sBlockStats stats;
         gint64 totalBytesWritten;
         gint64 diskSeq;
+        struct sDeviceHistograms histograms;
+        gint64 selfBytesWritten;
+        struct sTopWriters topWriters;
+        std::map<std::string, struct sCgroupIo> cgroupIo;
+        struct sAnomalies anomalies;
+        gint64 lastSeenTime; // 0 if written before retention existed
+};
+
+struct sDeviceMatchConfig
+{
+        std::string pattern; // literal path or glob, regex if isRegex
+        bool isRegex;
+        gint64 updateRate; // seconds between samples, 0 for sampleInterval
+        // sysfs attributes relative to /sys/block/<dev> and their value
+        std::vector<std::pair<std::string, std::string>> attributes;
+};
+
+// an output of the sink pipeline, 0 or empty for the defaults
+struct sSinkConfig
+{
+        std::string type; // "csv", "openMetrics", "history" or "plugin"
+        std::string path; // written by "csv" and "openMetrics", or loaded
+        std::string options; // passed to the init of a "plugin"
+        gint64 batchSize; // records handed to the sink at once
+        gint64 maxDelay;  // milliseconds a record waits for its batch
+        gint64 queueSize; // records waiting at most
+        std::string overflow; // "dropOldest", "dropNewest" or "block"
+        gint64 size; // records kept by "history"
+
+        bool operator == (struct sSinkConfig const & a) const = default;
 };
 
 struct sJsonDevicesConfig
 {
-        std::vector<std::string> devices;
+        std::vector<struct sDeviceMatchConfig> deviceMatchers;
+        std::vector<std::string> devices; // paths of the matched devices
         std::string statsFilePath;
         gint64 updateRate;
+        gint64 sampleInterval;  // seconds between samples
+        gint64 persistInterval; // seconds between writes to statsFilePath
+        gint64 persistDeltaBytes; // write early after this many new bytes
+        gint64 selfWriteSlackBytes; // counted as own writes after a persist
+        std::string volatileStatsFilePath; // optional, e.g. on /run
+        gint64 topWriters; // processes kept per device, 0 disables
+        bool cgroupStats; // collect io.stat of every cgroup
+        std::string controlSocketPath; // optional, e.g. on /run
+        gint64 anomalyThreshold; // deviations above the mean, 0 disables
+        std::string anomalyHook; // optional command run on an anomaly
+        gint64 anomalyHookInterval; // seconds between two hook runs
+        gint64 statsFilePatches; // in place updates between full writes
+        gint64 retentionDays; // evict serials not seen for longer, 0 never
+        gint64 retentionMaxSerials; // entries kept at most, 0 unlimited
+        std::string archiveFilePath; // where evicted entries go
+        std::vector<struct sSinkConfig> sinks;
+        gint64 queueDepthInterval; // milliseconds between polls, 0 disables
 };
 #endif /* _STRUCTS_H */
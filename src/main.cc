@@ -1,4 +1,6 @@
 #include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
 #include <filesystem>
 #include <glib.h>
 #include <glib-unix.h>
@@ -9,15 +11,48 @@
 #endif
 #include <json-glib/json-glib.h>
 #include <map>
+#include <memory>
+#include <sstream>
 #include <string>
-
+#include <linux/netlink.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+
+#include "daemon/cControlCommands.hh"
+#include "daemon/cControlServer.hh"
+#include "daemon/cCsvSink.hh"
+#include "daemon/cHistorySink.hh"
+#include "daemon/cHookRunner.hh"
 #include "daemon/cJsonParser.hh"
 #include "daemon/cJsonWriter.hh"
-
+#include "daemon/cOpenMetricsSink.hh"
+#include "daemon/cPluginSink.hh"
+#include "daemon/cRetentionPolicy.hh"
+#include "daemon/cSelfStats.hh"
+#include "daemon/cSinkPipeline.hh"
+#include "daemon/cSoakTest.hh"
+#include "daemon/cStatsArchive.hh"
+#include "daemon/cStatsMerger.hh"
+#include "daemon/cStatsPatcher.hh"
+#include "daemon/cTimerWheel.hh"
+#include "daemon/cTraceDecoder.hh"
+#include "daemon/cTraceReplay.hh"
+#include "daemon/cTraceRecorder.hh"
+#include "daemon/cWatchView.hh"
+
+#include "library/cCgroupCollector.hh"
+#include "library/cDeviceMatcher.hh"
+#include "library/cProcessSampler.hh"
+#include "library/cQueueDepthSampler.hh"
 #include "library/cStatComputer.hh"
 #include "library/cStatReader.hh"
 #include "library/include/structs.hh"
 
+#include "utils/alloc-count.hh"
 #include "utils/log-event.hh"
 
 // global variables
@@ -25,13 +60,50 @@ cJsonParser parser;
 cJsonWriter writer;
 cStatReader reader;
 cStatComputer computer;
+cSelfStats selfStats;
+cDeviceMatcher deviceMatcher;
+cProcessSampler processSampler;
+cCgroupCollector cgroupCollector;
+cControlServer controlServer;
+cTimerWheel samplingWheel;
+cTraceRecorder traceRecorder;
+cHookRunner anomalyHook;
+cQueueDepthSampler queueDepthSampler;
+// outputs fed from the samples, the history sink is owned by the pipeline
+cSinkPipeline sinkPipeline;
+cHistorySink* pHistorySink = nullptr;
+
+// block device samples come from sysfs, or from a trace when replaying, or
+// from synthetic devices during a soak
+cStatReader* pSampleReader = &reader;
+bool isReplaying   = false; // a replay or a soak
+gint64 virtualTime = 0; // microseconds, the clock while replaying
 
 std::map<std::string, struct sDeviceEntry> targetDevices;
+// stats files updated in place, by path
+std::map<std::string, cStatsPatcher> statsPatchers;
 struct sJsonDevicesConfig targetConfig;
 
-// converts the update rate to milliseconds
-constexpr int   CONST_RATE_TO_MILLISECONDS   = 1000;
+// converts g_get_real_time() units to timeout milliseconds
+constexpr gint64 CONST_MILLISECONDS_TO_MICROSECONDS = 1000;
+// converts the persist interval to g_get_monotonic_time() units
+constexpr gint64 CONST_SECONDS_TO_MICROSECONDS = 1000000;
+// editors write a file in several steps, reload once they are done
+constexpr guint CONST_RELOAD_DELAY_MILLISECONDS = 500;
 constexpr uint  CONST_SECTOR_SIZE            = 512;
+// seconds between two runs of the anomaly hook
+constexpr gint64 CONST_DEFAULT_ANOMALY_HOOK_INTERVAL = 300;
+// a typical erase block of SD cards and eMMC
+constexpr gint  CONST_DEFAULT_RECORD_CHUNK_BYTES = 128 * 1024;
+// ticks after warming up that --check-allocations must check, the others
+// write a stats file in full or report an anomaly
+constexpr guint64 CONST_MIN_CHECKED_TICKS_PERCENT = 50;
+// cgroups kept per device, transient scopes would grow the stats file forever
+constexpr gsize CONST_MAX_CGROUP_ENTRIES = 64;
+// records kept by a history sink without a size
+constexpr gint64 CONST_DEFAULT_HISTORY_SIZE = 1024;
+// retention is applied once a day
+constexpr gint64 CONST_SECONDS_PER_DAY = 24 * 3600;
 constexpr std::string_view CONST_DEFAULT_CONFIG_PATH    = "/usr/share/KrillKounter/config.json";
 constexpr std::string_view CONST_DEFAULT_STATS_PATH     = "/usr/share/KrillKounter/stats.json";
 
@@ -40,16 +112,68 @@ GError* pError           = nullptr;
 GOptionContext* pContext = nullptr;
 GMainLoop* pLoop         = nullptr;
 guint timeoutId          = 0;
+guint reloadTimeoutId    = 0;
+int configWatchFd        = -1;
+guint refreshTimeoutId   = 0;
+int ueventFd             = -1;
+
+// devices added or with changed media since the last refresh
+std::vector<std::string> changedDeviceNames;
+
+// write attribution, reused every sample
+std::vector<struct sProcessWrite> processWrites;
+std::vector<struct sCgroupIoDelta> cgroupDeltas;
+std::vector<std::string> attributedDevices; // paths by device index
+
+// devices due at the current deadline, reused every wakeup
+std::vector<std::string> dueDevices;
+
+// the volatile file copied by a checkpoint and its temporary copy, both only
+// grow, so checkpoints allocate nothing once they fit
+std::string checkpointContents;
+std::string checkpointTemporaryPath;
+
+// sampling ticks for --check-allocations, writing a stats file in full or
+// reporting an anomaly may allocate
+guint64 tickCount        = 0;
+guint64 checkedTickCount = 0;
+bool tickMayAllocate     = false;
 
 // cli values
 gchar *cliStatsFilePath     = nullptr;
 gchar *cliConfigFilePath    = nullptr;
 gchar *cliDeviceName        = nullptr;
 gchar *cliDevicePath        = nullptr;
+gchar *cliControlSocketPath = nullptr;
+gchar *cliReplayPath        = nullptr;
+gchar *cliGoldenPath        = nullptr;
+gchar *cliRecordPath        = nullptr;
+gint   cliRecordChunkBytes  = CONST_DEFAULT_RECORD_CHUNK_BYTES;
+gchar *cliDecodePath        = nullptr;
+gchar *cliDecodeFormat      = nullptr;
+gchar *cliMergePath         = nullptr;
+gchar *cliMergeOutputPath   = nullptr;
+gchar *cliMergeFormat       = nullptr;
+gint   cliCheckAllocations  = 0;
+gchar *cliArchiveLookup     = nullptr;
+gint   cliWatchInterval     = 0; // milliseconds
+gint   cliSoakTicks         = 0;
 uint   updateRate           = 3600; // seconds
-bool   printBlockDevices    = false;
+gboolean printBlockDevices  = FALSE;
+gboolean selfStatsEnabled   = FALSE;
 std::string configFilePath;
 
+// persistence state
+gint64 lastPersistTime  = 0; // never persisted
+gint64 unpersistedBytes = 0; // bytes written since the last persist
+gint64 lastRetentionTime = 0; // never applied
+
+// block devices holding the stats files, empty if not a block device
+std::string statsDeviceName;
+std::string volatileStatsDeviceName;
+std::string recordDeviceName;
+std::string archiveDeviceName;
+
 // cli arguments
 GOptionEntry options[] = {
     { "config-file", 'c', 0, G_OPTION_ARG_FILENAME,
@@ -64,6 +188,36 @@ GOptionEntry options[] = {
         &updateRate, "update rate of checks (seconds)" },
     { "print-devices", 'p', 0, G_OPTION_ARG_NONE,
         &printBlockDevices, "print all available block devices" },
+    { "self-stats", 'S', 0, G_OPTION_ARG_NONE,
+        &selfStatsEnabled, "time own work, dump it on SIGUSR1" },
+    { "control-socket", 'C', 0, G_OPTION_ARG_FILENAME,
+        &cliControlSocketPath, "control socket path" },
+    { "replay", 0, 0, G_OPTION_ARG_FILENAME,
+        &cliReplayPath, "replay a trace on a virtual clock, then exit" },
+    { "golden", 0, 0, G_OPTION_ARG_FILENAME,
+        &cliGoldenPath, "stats file the replay must produce" },
+    { "record", 0, 0, G_OPTION_ARG_FILENAME,
+        &cliRecordPath, "append every raw sample to a binary trace" },
+    { "record-chunk-size", 0, 0, G_OPTION_ARG_INT,
+        &cliRecordChunkBytes, "bytes per trace append (erase block size)" },
+    { "decode", 0, 0, G_OPTION_ARG_FILENAME,
+        &cliDecodePath, "print a binary trace, then exit" },
+    { "decode-format", 0, 0, G_OPTION_ARG_STRING,
+        &cliDecodeFormat, "csv (default), json or trace" },
+    { "merge", 0, 0, G_OPTION_ARG_FILENAME,
+        &cliMergePath, "merge the stats files under a directory, then exit" },
+    { "merge-output", 0, 0, G_OPTION_ARG_FILENAME,
+        &cliMergeOutputPath, "file the merge is written to (stdout)" },
+    { "merge-format", 0, 0, G_OPTION_ARG_STRING,
+        &cliMergeFormat, "json (default) or binary" },
+    { "check-allocations", 0, 0, G_OPTION_ARG_INT,
+        &cliCheckAllocations, "fail if a tick after the first N allocates" },
+    { "archive-lookup", 0, 0, G_OPTION_ARG_STRING,
+        &cliArchiveLookup, "print the archived entries of a serial number" },
+    { "watch", 0, 0, G_OPTION_ARG_INT,
+        &cliWatchInterval, "print a device table every N ms until stopped" },
+    { "soak", 0, 0, G_OPTION_ARG_INT,
+        &cliSoakTicks, "sample synthetic devices for N ticks, check for leaks" },
     { NULL }
 };
 
@@ -78,39 +232,88 @@ void printAllBlockDevices(void)
     exit(EXIT_SUCCESS);
 }
 
-void getSerialNumber(std::string devicePath)
+bool getSerialNumber(std::string devicePath)
 {
     struct sDeviceSpecs specs;
     if (!targetDevices.contains(devicePath))
     {
         LOG_EVENT(LOG_ERR, "Unable to find [%s] in target devices\n", devicePath.c_str());
-        exit(EXIT_FAILURE);
+        return false; // failure
     }
 
     auto const deviceName = targetDevices[devicePath].deviceName;
     if (!reader.getSpecs(deviceName, &specs))
     {
         LOG_EVENT(LOG_ERR, "Unable to get device serial number\n");
-        exit(EXIT_FAILURE);
+        return false; // failure
     }
     targetDevices[devicePath].serialNumber = specs.serial.value;
+    return true; // success
+}
+
+// g_get_real_time() and g_get_monotonic_time(), or the replay clock
+static gint64 getRealTime(void)
+{
+    return isReplaying ? virtualTime : g_get_real_time();
+}
+
+static gint64 getMonotonicTime(void)
+{
+    return isReplaying ? virtualTime : g_get_monotonic_time();
 }
 
 static std::string getCurrentTimestamp(void)
 {
-    const auto currentTime = std::chrono::system_clock::now();
+    const auto currentTime = isReplaying
+        ? std::chrono::system_clock::time_point(
+            std::chrono::microseconds(virtualTime))
+        : std::chrono::system_clock::now();
 
 #ifdef __cpp_lib_format
     return std::format("{:%d-%m-%Y %H:%M:%OS}", currentTime);
 #else
     auto in_time_t = std::chrono::system_clock::to_time_t(currentTime);
     std::stringstream ss;
-    ss << std::put_time(std::localtime(&in_time_t), "%d-%m-Y %H:%M:%OS");
+    // UTC, as std::format() formats a system_clock time
+    ss << std::put_time(std::gmtime(&in_time_t), "%d-%m-%Y %H:%M:%S");
     return ss.str();
 #endif
 }
 
-gboolean parseConfigFile(void)
+static std::string getCurrentDate(void)
+{
+    char date[sizeof("YYYY-MM-DD")];
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%F", localtime(&now));
+    return date;
+}
+
+void initConfig(struct sJsonDevicesConfig* pConfig)
+{
+    // values from the command line, the config file may override them
+    *pConfig = {};
+    pConfig->updateRate = updateRate;
+    pConfig->statsFilePath = cliStatsFilePath == nullptr
+        ? CONST_DEFAULT_STATS_PATH : (std::string)cliStatsFilePath;
+    if (cliControlSocketPath != nullptr)
+        pConfig->controlSocketPath = cliControlSocketPath;
+}
+
+void applyConfigDefaults(struct sJsonDevicesConfig* pConfig)
+{
+    // sampling defaults to the update rate, persisting to every sample
+    if (pConfig->sampleInterval <= 0)
+        pConfig->sampleInterval = pConfig->updateRate;
+    if (pConfig->persistInterval <= 0)
+        pConfig->persistInterval = pConfig->sampleInterval;
+    if (pConfig->anomalyHookInterval <= 0)
+        pConfig->anomalyHookInterval = CONST_DEFAULT_ANOMALY_HOOK_INTERVAL;
+    // evicted entries are archived next to the stats file
+    if (pConfig->archiveFilePath.empty())
+        pConfig->archiveFilePath = pConfig->statsFilePath + ".archive.gz";
+}
+
+gboolean parseConfigFile(struct sJsonDevicesConfig* pConfig)
 {
     gboolean ret = false; // failure
     if (!parser.openJson(configFilePath))
@@ -118,35 +321,16 @@ gboolean parseConfigFile(void)
         LOG_EVENT(LOG_ERR, "Unable to open config file\n");
         return false;
     }
-    if (!parser.getConfig(&targetConfig))
+    if (!parser.getConfig(pConfig))
     {
         LOG_EVENT(LOG_ERR, "Error processing config file\n");
         goto error;
     }
 
-    if (targetConfig.devices.empty()) {
+    if (pConfig->deviceMatchers.empty()) {
         LOG_EVENT(LOG_INFO, "No devices to monitor in config file\n");
         goto error;
     }
-
-    for (const auto& devicePath : targetConfig.devices) {
-        if (!std::filesystem::exists(devicePath)) {
-            LOG_EVENT(LOG_ERR, "path [%s] does not exist\n", devicePath.c_str());
-            exit(EXIT_FAILURE);
-        }
-
-        if (!std::filesystem::is_block_file(devicePath)) {
-            LOG_EVENT(LOG_ERR, "[%s] is not a block device\n", devicePath.c_str());
-            exit(EXIT_FAILURE);
-        }
-
-        targetDevices.insert({ devicePath,
-            (struct sDeviceEntry) {
-                .deviceName = devicePath.substr(devicePath.find_last_of("/") + 1),
-                .firstSightingDate = getCurrentTimestamp(),
-                .devicePath = devicePath }
-        });
-    }
     ret = true; // success
 
 error:
@@ -158,29 +342,71 @@ error:
     return ret;
 }
 
-void parseStatsFile(void)
+bool resetWindow(struct sDeviceEntry *targetDevice)
+{
+    // the window starts from the live counters, not the last sample
+    if (!pSampleReader->getDiskSeq(targetDevice->deviceName,
+            &targetDevice->windowDiskSeq)
+        || !pSampleReader->getStats(targetDevice->deviceName,
+            &targetDevice->windowStats))
+        return false; // failure
+
+    targetDevice->windowStartTime = getMonotonicTime();
+    return true; // success
+}
+
+bool addTargetDevice(std::string devicePath)
+{
+    if (!std::filesystem::exists(devicePath)) {
+        LOG_EVENT(LOG_ERR, "path [%s] does not exist\n", devicePath.c_str());
+        return false; // failure
+    }
+
+    if (!std::filesystem::is_block_file(devicePath)) {
+        LOG_EVENT(LOG_ERR, "[%s] is not a block device\n", devicePath.c_str());
+        return false; // failure
+    }
+
+    // the path may be a symlink, e.g. /dev/disk/by-id/...
+    std::string deviceName = std::filesystem::canonical(devicePath).filename();
+    targetDevices.insert({ devicePath,
+        (struct sDeviceEntry) {
+            .deviceName = deviceName,
+            .firstSightingDate = getCurrentTimestamp(),
+            .devicePath = devicePath }
+    });
+    resetWindow(&targetDevices[devicePath]);
+    return true; // success
+}
+
+// false if the stats file can't be read, the entries of devicePaths are then
+// partly restored and must not be written back
+bool parseStatsFile(std::string statsFilePath,
+    std::vector<std::string> const & devicePaths)
 {
     // Check if file exists
-    const std::filesystem::path statsFile = targetConfig.statsFilePath;
+    const std::filesystem::path statsFile = statsFilePath;
     if (std::filesystem::exists(statsFile))
     {
-        if (!parser.openJson(targetConfig.statsFilePath))
+        if (!parser.openJson(statsFilePath))
         {
             LOG_EVENT(LOG_ERR, "Unable to open stats file\n");
-            exit(EXIT_FAILURE);
+            return false; // failure
         }
 
         // does entry for device already exist?
+        bool ret = false; // failure
         std::vector<std::string> serialNumbers;
         if (!parser.getSerialNumbers(&serialNumbers))
         {
             LOG_EVENT(
                 LOG_ERR, "Unable to retrieve serial numbers from json file\n");
-            exit(EXIT_FAILURE);
+            goto error;
         }
 
-        for (auto &[devicePath, targetDevice] : targetDevices)
+        for (auto const & devicePath : devicePaths)
         {
+            auto &targetDevice = targetDevices[devicePath];
             if (std::find(serialNumbers.begin(), serialNumbers.end(),
                     targetDevice.serialNumber)
                 != serialNumbers.end())
@@ -190,28 +416,63 @@ void parseStatsFile(void)
                         targetDevice.serialNumber, &targetDevice.outputStats))
                 {
                     LOG_EVENT(LOG_ERR, "Unable to read device stats\n");
-                    exit(EXIT_FAILURE);
+                    goto error;
                 }
 
-                if (!reader.getStats(
+                if (!pSampleReader->getStats(
                         targetDevice.deviceName, &targetDevice.stats))
                 {
                     LOG_EVENT(LOG_ERR, "Unable to read device stats\n");
-                    exit(EXIT_FAILURE);
+                    goto error;
                 }
 
                 if (!parser.getDiskSeq(
                         targetDevice.serialNumber, &targetDevice.diskSeq))
                 {
                     LOG_EVENT(LOG_ERR, "Unable to read disk sequence\n");
-                    exit(EXIT_FAILURE);
+                    goto error;
                 }
 
                 if (!parser.getTotalBytesWritten(targetDevice.serialNumber,
                         &targetDevice.totalBytesWritten))
                 {
                     LOG_EVENT(LOG_ERR, "Unable to read totalBytesWritten\n");
-                    exit(EXIT_FAILURE);
+                    goto error;
+                }
+
+                if (!parser.getSelfBytesWritten(targetDevice.serialNumber,
+                        &targetDevice.selfBytesWritten))
+                {
+                    LOG_EVENT(LOG_ERR, "Unable to read selfBytesWritten\n");
+                    goto error;
+                }
+
+                if (!parser.getHistograms(targetDevice.serialNumber,
+                        &targetDevice.histograms))
+                {
+                    LOG_EVENT(LOG_ERR, "Unable to read histograms\n");
+                    goto error;
+                }
+
+                if (!parser.getTopWriters(targetDevice.serialNumber,
+                        &targetDevice.topWriters))
+                {
+                    LOG_EVENT(LOG_ERR, "Unable to read topWriters\n");
+                    goto error;
+                }
+
+                if (!parser.getCgroupIo(targetDevice.serialNumber,
+                        &targetDevice.cgroupIo))
+                {
+                    LOG_EVENT(LOG_ERR, "Unable to read cgroupIo\n");
+                    goto error;
+                }
+
+                if (!parser.getAnomalies(targetDevice.serialNumber,
+                        &targetDevice.anomalies))
+                {
+                    LOG_EVENT(LOG_ERR, "Unable to read anomalies\n");
+                    goto error;
                 }
 
                 std::string firstSightingDate;
@@ -219,7 +480,7 @@ void parseStatsFile(void)
                         &firstSightingDate))
                 {
                     LOG_EVENT(LOG_ERR, "Unable to read firstSightingDate\n");
-                    exit(EXIT_FAILURE);
+                    goto error;
                 }
                 // Keep the first sighting date from the stats file, if any
                 else if (!firstSightingDate.empty())
@@ -228,7 +489,196 @@ void parseStatsFile(void)
                 }
             }
         }
+
+        ret = true; // success
+
+    error:
+        // the parser is needed again when the config is reloaded
+        parser.closeJson();
+        return ret;
+    }
+    return true; // success
+}
+
+static std::string const & getLatestStatsFilePath(void)
+{
+    // the volatile file is seeded from the persistent one on first write
+    if (!targetConfig.volatileStatsFilePath.empty()
+        && access(targetConfig.volatileStatsFilePath.c_str(), F_OK) == 0)
+        return targetConfig.volatileStatsFilePath;
+    return targetConfig.statsFilePath;
+}
+
+// 0 once /proc/self/io can't be read, e.g. without CONFIG_TASK_IO_ACCOUNTING
+static gint64 getSelfBytesWritten(void)
+{
+    static bool isAccounting = true;
+    gint64 bytesWritten = 0;
+    if (isAccounting && !reader.getSelfBytesWritten(&bytesWritten))
+    {
+        LOG_EVENT(LOG_WARNING, "Unable to read own bytes written, they are "
+            "counted as writes of the devices\n");
+        isAccounting = false;
+    }
+    return bytesWritten;
+}
+
+static void accountSelfWrites(
+    std::string const & deviceName, gint64 bytesWritten)
+{
+    if (deviceName.empty() || bytesWritten <= 0)
+        return;
+
+    // subtracted from the device totals once they show up in its stats
+    for (auto &[devicePath, targetDevice] : targetDevices)
+    {
+        if (targetDevice.deviceName == deviceName)
+            targetDevice.pendingSelfBytes += bytesWritten;
+    }
+}
+
+// false if the file can't be written, e.g. when the disk is full, the
+// entry is then written again by the next persist
+bool writeStats(struct sDeviceEntry *targetDevice,
+    std::string const & inputPath, std::string const & outputPath,
+    bool allowPatch)
+{
+    // only the counters, in place, until the next full write is due
+    bool patching = targetConfig.statsFilePatches > 0;
+    if (patching && allowPatch && inputPath == outputPath)
+    {
+        auto pPatcher = &statsPatchers[outputPath];
+        if (pPatcher->getPatchCount() < targetConfig.statsFilePatches
+            && pPatcher->patch(targetDevice->serialNumber,
+                targetDevice->devicePath, &targetDevice->outputStats,
+                targetDevice->diskSeq, targetDevice->totalBytesWritten,
+                targetDevice->selfBytesWritten))
+            return true; // success
+    }
+
+    tickMayAllocate = true; // the JSON tree of the whole file
+    writer.setFixedWidth(patching);
+    if (!writer.writeJson(inputPath, outputPath, targetDevice->serialNumber,
+            targetDevice->firstSightingDate, targetDevice->devicePath,
+            &targetDevice->outputStats, targetDevice->diskSeq,
+            targetDevice->totalBytesWritten, targetDevice->selfBytesWritten,
+            targetDevice->lastSeenTime, &targetDevice->histograms,
+            &targetDevice->topWriters, &targetDevice->cgroupIo,
+            &targetDevice->anomalies))
+    {
+        LOG_EVENT(LOG_ERR, "Unable to write device stats to [%s]\n",
+            outputPath.c_str());
+        return false; // failure
+    }
+    if (patching)
+        statsPatchers[outputPath].load(outputPath);
+    return true; // success
+}
+
+static void syncStatsPatches(void)
+{
+    // one fdatasync() for all entries patched since the last one
+    for (auto &[statsFilePath, patcher] : statsPatchers)
+        patcher.sync();
+}
+
+static void recordSample(struct sDeviceEntry *targetDevice)
+{
+    if (!traceRecorder.isOpen())
+        return;
+
+    // chunks appended to a monitored device are own writes as well
+    gint64 selfBytesBefore = 0;
+    if (!recordDeviceName.empty())
+        selfBytesBefore = getSelfBytesWritten();
+    traceRecorder.record(targetDevice->deviceName, targetDevice->serialNumber,
+        getMonotonicTime(), getRealTime(), targetDevice->diskSeq,
+        &targetDevice->stats);
+    if (!recordDeviceName.empty())
+        accountSelfWrites(
+            recordDeviceName, getSelfBytesWritten() - selfBytesBefore);
+}
+
+static void detectAnomalies(struct sDeviceEntry *targetDevice,
+    struct sBlockStats* pPreviousStats, gint64 elapsedUs)
+{
+    std::array<struct cAnomalyDetector::sAnomaly,
+        cAnomalyDetector::METRIC_COUNT> anomalies;
+    auto count = targetDevice->anomalyDetector.evaluate(pPreviousStats,
+        &targetDevice->stats, elapsedUs,
+        (double)targetConfig.anomalyThreshold, &anomalies);
+
+    for (guint i = 0; i < count; i++)
+    {
+        tickMayAllocate = true; // strings of the record and the hook
+        auto const & anomaly = anomalies[i];
+        auto metricName = cAnomalyDetector::getMetricName(anomaly.metric);
+        LOG_EVENT(LOG_WARNING,
+            "[%s] %s anomaly: %ld, mean %ld, deviation %ld\n",
+            targetDevice->devicePath.c_str(), metricName, anomaly.value,
+            anomaly.mean, anomaly.deviation);
+
+        auto pAnomalies = &targetDevice->anomalies;
+        pAnomalies->count++;
+        pAnomalies->lastTime      = getCurrentTimestamp();
+        pAnomalies->lastMetric    = metricName;
+        pAnomalies->lastValue     = anomaly.value;
+        pAnomalies->lastMean      = anomaly.mean;
+        pAnomalies->lastDeviation = anomaly.deviation;
+        targetDevice->persistPending = true;
+
+        // the hook runs on its own thread, rate limited
+        if (targetConfig.anomalyHook.empty())
+            continue;
+        anomalyHook.setCommand(targetConfig.anomalyHook,
+            targetConfig.anomalyHookInterval * CONST_SECONDS_TO_MICROSECONDS);
+        anomalyHook.submit({ "KK_DEVICE_PATH=" + targetDevice->devicePath,
+                "KK_DEVICE_NAME=" + targetDevice->deviceName,
+                "KK_SERIAL=" + targetDevice->serialNumber,
+                "KK_METRIC=" + pAnomalies->lastMetric,
+                "KK_VALUE=" + std::to_string(anomaly.value),
+                "KK_MEAN=" + std::to_string(anomaly.mean),
+                "KK_DEVIATION=" + std::to_string(anomaly.deviation) },
+            getMonotonicTime());
+    }
+}
+
+// hands the sample to the sinks, the main loop never waits for them
+static void publishSample(struct sDeviceEntry *targetDevice)
+{
+    if (!sinkPipeline.isRunning())
+        return;
+
+    struct sSampleEvent event;
+    g_strlcpy(event.deviceName, targetDevice->deviceName.c_str(),
+        sizeof(event.deviceName));
+    g_strlcpy(event.serialNumber, targetDevice->serialNumber.c_str(),
+        sizeof(event.serialNumber));
+    event.monotonicTime = getMonotonicTime();
+    event.realTime      = getRealTime();
+    event.diskSeq       = targetDevice->diskSeq;
+    event.stats         = targetDevice->stats;
+
+    // a replay runs ahead of any sink, its samples wait rather than drop
+    while (!sinkPipeline.publish(event) && isReplaying)
+        std::this_thread::yield();
+}
+
+// the queue depth polled since the previous sample
+static void sampleQueueDepth(struct sDeviceEntry *targetDevice)
+{
+    if (!queueDepthSampler.isRunning())
+        return;
+
+    // polled from the next interval on, the first one is only warm-up
+    if (!queueDepthSampler.takeInterval(
+            targetDevice->deviceName, &targetDevice->queueDepth))
+    {
+        queueDepthSampler.addDevice(targetDevice->deviceName);
+        return;
     }
+    targetDevice->histograms.queueDepth.merge(
+        targetDevice->queueDepth.histogram);
 }
 
 void updateStats(struct sDeviceEntry *targetDevice)
@@ -240,132 +690,984 @@ void updateStats(struct sDeviceEntry *targetDevice)
     auto previousStats = targetDevice->stats;
 
     // get sequence
-    if (!reader.getDiskSeq(targetDevice->deviceName, &targetDevice->diskSeq))
+    cPhaseTimer diskSeqTimer(&selfStats, cSelfStats::PHASE_GET_DISK_SEQ);
+    if (!pSampleReader->getDiskSeq(targetDevice->deviceName, &targetDevice->diskSeq))
     {
-        LOG_EVENT(LOG_ERR, "Unable to read device sequence\n");
-        exit(EXIT_FAILURE);
+        // unplugged, it is stopped once the uevent has been processed
+        if (!pSampleReader->hasDevice(targetDevice->deviceName))
+        {
+            LOG_EVENT(LOG_WARNING, "[%s] has been removed\n",
+                targetDevice->devicePath.c_str());
+            targetDevice->diskSeq = previousDiskSeq;
+            return;
+        }
+        // the sample is skipped, the next one may succeed
+        LOG_EVENT(LOG_ERR, "Unable to read device sequence of [%s]\n",
+            targetDevice->devicePath.c_str());
+        targetDevice->diskSeq = previousDiskSeq;
+        return;
     }
+    diskSeqTimer.stop();
 
     // reset previous stats if disk sequence has changed
     if (targetDevice->diskSeq != previousDiskSeq)
         previousStats = {};
 
     // get new values
-    if (!reader.getStats(targetDevice->deviceName, &targetDevice->stats))
+    cPhaseTimer statsTimer(&selfStats, cSelfStats::PHASE_GET_STATS);
+    auto sampledStats = targetDevice->stats;
+    if (!pSampleReader->getStats(targetDevice->deviceName, &targetDevice->stats))
     {
-        LOG_EVENT(LOG_ERR, "Unable to read device stats\n");
-        exit(EXIT_FAILURE);
+        LOG_EVENT(LOG_ERR, "Unable to read device stats of [%s]\n",
+            targetDevice->devicePath.c_str());
+        targetDevice->diskSeq = previousDiskSeq;
+        targetDevice->stats   = sampledStats;
+        return;
     }
+    statsTimer.stop();
+    recordSample(targetDevice);
+    publishSample(targetDevice);
+    sampleQueueDepth(targetDevice);
+    targetDevice->lastSeenTime = getRealTime() / CONST_SECONDS_TO_MICROSECONDS;
+
+    auto previousSampleTime  = targetDevice->sampleTime;
+    targetDevice->sampleTime = getMonotonicTime();
 
     // return if the stats haven't changed
     if (targetDevice->stats == previousStats)
         return;
 
+    cPhaseTimer computeTimer(&selfStats, cSelfStats::PHASE_COMPUTE);
+
     computer.updateStats(&previousStats,
         &targetDevice->stats, &targetDevice->outputStats);
 
+    // only a sample taken on the same disk sequence describes an interval
+    if (!(previousStats == (struct sBlockStats) {}))
+    {
+        computer.updateHistograms(&previousStats, &targetDevice->stats,
+            CONST_SECTOR_SIZE, &targetDevice->histograms);
+
+        if (targetConfig.anomalyThreshold > 0 && previousSampleTime != 0)
+        {
+            detectAnomalies(targetDevice, &previousStats,
+                targetDevice->sampleTime - previousSampleTime);
+        }
+    }
+
 
+    auto previousTotal = targetDevice->totalBytesWritten;
     targetDevice->totalBytesWritten = computer.totalBytesWritten(CONST_SECTOR_SIZE,
         targetDevice->stats.writeSectors, previousStats.writeSectors,
         targetDevice->totalBytesWritten);
+    auto newBytes = targetDevice->totalBytesWritten - previousTotal;
 
-    if (!writer.writeJson(targetConfig.statsFilePath,
-            targetConfig.statsFilePath, targetDevice->serialNumber,
-            targetDevice->firstSightingDate, targetDevice->devicePath,
-            &targetDevice->outputStats, targetDevice->diskSeq,
-            targetDevice->totalBytesWritten))
+    /*
+     * Writes of the stats files by KrillKounter itself are not counted, this
+     * is only important if a stats file is stored on the block device being
+     * monitored. Without this, persisting would be detected as a change of
+     * the stats and cause an infinite loop, see #79
+     */
+    if (targetDevice->pendingSelfBytes > 0)
     {
-        LOG_EVENT(LOG_ERR, "Unable to write device stats to file\n");
-        exit(EXIT_FAILURE);
+        auto selfBytes = std::min(newBytes, targetDevice->pendingSelfBytes);
+        targetDevice->pendingSelfBytes -= selfBytes;
+        newBytes -= selfBytes;
+
+        bool readsChanged = targetDevice->stats.readIo != previousStats.readIo
+            || targetDevice->stats.discardIo != previousStats.discardIo;
+        // filesystem metadata written with the stats file is not in
+        // /proc/self/io, only counted as own writes if configured
+        if (targetDevice->pendingSelfBytes == 0 && !readsChanged
+            && newBytes <= targetConfig.selfWriteSlackBytes)
+        {
+            selfBytes += newBytes;
+            newBytes = 0;
+        }
+
+        targetDevice->selfBytesWritten  += selfBytes;
+        targetDevice->totalBytesWritten -= selfBytes;
     }
 
-    /*
-     * Get new stats here to include the writes to the JSON output file,
-     * this is only important if the stats file is stored on the block device
-     * being monitored. Without this, the next time the function is called,
-     * we will detect the stats changing due to the JSON output and cause an
-     * infinite loop, see #79
-     */
-    if (!reader.getStats(targetDevice->deviceName, &targetDevice->stats))
+    bool externalChange = newBytes > 0
+        || targetDevice->stats.readIo != previousStats.readIo
+        || targetDevice->stats.discardIo != previousStats.discardIo;
+    unpersistedBytes += newBytes;
+    targetDevice->persistPending |= externalChange;
+    computeTimer.stop();
+
+    // the volatile tier follows every sample, it does not wear the device
+    if (!targetConfig.volatileStatsFilePath.empty())
     {
-        LOG_EVENT(LOG_ERR, "Unable to read device stats\n");
-        exit(EXIT_FAILURE);
+        auto selfBytesBefore = getSelfBytesWritten();
+        writeStats(targetDevice, getLatestStatsFilePath(),
+            targetConfig.volatileStatsFilePath, true);
+        syncStatsPatches();
+        accountSelfWrites(volatileStatsDeviceName,
+            getSelfBytesWritten() - selfBytesBefore);
     }
 }
 
-inline void updateAllDeviceStats(void)
+static bool checkpointVolatileStats(void)
 {
-    for (auto const & device : targetConfig.devices)
-        updateStats(&targetDevices[device]);
+    auto pVolatilePath = targetConfig.volatileStatsFilePath.c_str();
+    int fd = open(pVolatilePath, O_RDONLY | O_CLOEXEC);
+    struct stat status;
+    if (fd < 0 || fstat(fd, &status) != 0)
+    {
+        LOG_EVENT(LOG_ERR, "Unable to read [%s]: %s\n", pVolatilePath,
+            strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return false; // failure
+    }
+    checkpointContents.resize(status.st_size);
+    gsize length = 0;
+    while (length < checkpointContents.size())
+    {
+        auto count = read(fd, checkpointContents.data() + length, checkpointContents.size() - length);
+        if (count <= 0)
+            break;
+        length += count;
+    }
+    close(fd);
+
+    // replaced atomically, as g_file_set_contents() would
+    checkpointTemporaryPath.assign(targetConfig.statsFilePath).append(".tmp");
+    fd = open(checkpointTemporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+        0666);
+    bool ret = fd >= 0;
+    gsize written = 0;
+    while (ret && written < length)
+    {
+        auto count = write(fd, checkpointContents.data() + written, length - written);
+        ret = count > 0;
+        written += ret ? count : 0;
+    }
+    ret = ret && fsync(fd) == 0;
+    if (fd >= 0)
+        ret = close(fd) == 0 && ret;
+    ret = ret
+        && rename(checkpointTemporaryPath.c_str(), targetConfig.statsFilePath.c_str()) == 0;
+    if (!ret)
+    {
+        LOG_EVENT(LOG_ERR, "Unable to write [%s]: %s\n",
+            targetConfig.statsFilePath.c_str(), strerror(errno));
+        unlink(checkpointTemporaryPath.c_str());
+    }
+    return ret;
 }
 
-gboolean timerCallback(gpointer data)
+static void applyRetention(void)
 {
-    updateAllDeviceStats();
-    return true;
+    auto now = getMonotonicTime();
+    if (targetConfig.retentionDays <= 0 && targetConfig.retentionMaxSerials <= 0)
+        return;
+    if (lastRetentionTime != 0
+        && now - lastRetentionTime
+            < CONST_SECONDS_PER_DAY * CONST_SECONDS_TO_MICROSECONDS)
+        return;
+    lastRetentionTime = now;
+    tickMayAllocate   = true; // the whole stats file, once a day
+
+    auto statsFilePath = getLatestStatsFilePath();
+    if (access(statsFilePath.c_str(), F_OK) != 0)
+        return; // nothing written yet
+
+    cRetentionPolicy retention(targetConfig.retentionDays,
+        targetConfig.retentionMaxSerials);
+    if (!retention.load(statsFilePath))
+        return;
+
+    // serials of monitored devices are never evicted
+    std::vector<std::string> activeSerials;
+    for (auto const & device : targetConfig.devices)
+        activeSerials.push_back(targetDevices[device].serialNumber);
+    if (!retention.select(activeSerials,
+            getRealTime() / CONST_SECONDS_TO_MICROSECONDS))
+        return;
+
+    // archived first, an entry is never lost between the two files
+    auto selfBytesBefore = getSelfBytesWritten();
+    retention.archive(targetConfig.archiveFilePath);
+    accountSelfWrites(archiveDeviceName,
+        getSelfBytesWritten() - selfBytesBefore);
+    selfBytesBefore = getSelfBytesWritten();
+    retention.rewrite(statsFilePath, targetConfig.statsFilePatches > 0);
+    accountSelfWrites(statsFilePath == targetConfig.statsFilePath
+            ? statsDeviceName : volatileStatsDeviceName,
+        getSelfBytesWritten() - selfBytesBefore);
+
+    // the rewritten file is written in full, then persisted
+    for (auto const & device : targetConfig.devices)
+        targetDevices[device].persistPending = true;
 }
 
-gboolean checkStatsFilePath()
+void persistStats(bool force)
 {
-    FILE *pFile;
-
-    LOG_EVENT(LOG_INFO, "Checking stats path [%s]\n",
-        targetConfig.statsFilePath.c_str());
-    /* if the file is in the root directory or has no directory */
-    auto ret = targetConfig.statsFilePath.find_last_of('/');
-    if (ret == 0 || ret == std::string::npos)
-        return true; // success
+    auto now = getMonotonicTime();
+    bool intervalElapsed = lastPersistTime == 0
+        || now - lastPersistTime
+            >= targetConfig.persistInterval * CONST_SECONDS_TO_MICROSECONDS;
+    bool deltaExceeded = targetConfig.persistDeltaBytes > 0
+        && unpersistedBytes >= targetConfig.persistDeltaBytes;
+
+    if (!force && !intervalElapsed && !deltaExceeded)
+        return;
 
+    applyRetention();
 
-    auto statsDirectory = targetConfig.statsFilePath.substr(0, ret);
-    if (!std::filesystem::exists(statsDirectory)) {
-        std::string command = "mkdir -p " + statsDirectory;
-        pFile = popen(command.c_str(), "r");
-        if (nullptr == pFile)
+    // a forced write, e.g. when stopping, brings patched entries up to date
+    if (force && !statsPatchers.empty())
+    {
+        for (auto const & device : targetConfig.devices)
         {
-            LOG_EVENT(LOG_ERR, "Failed to open pFile, %s", strerror(errno));
-            return false; // failure
+            targetDevices[device].persistPending = true;
+            if (!targetConfig.volatileStatsFilePath.empty())
+                writeStats(&targetDevices[device],
+                    targetConfig.volatileStatsFilePath,
+                    targetConfig.volatileStatsFilePath, false);
         }
+    }
 
-        if (pclose(pFile))
+    bool pending = false;
+    for (auto const & device : targetConfig.devices)
+        pending |= targetDevices[device].persistPending;
+    if (!pending)
+        return;
+
+    LOG_EVENT(LOG_INFO, "Persisting stats to [%s]\n",
+        targetConfig.statsFilePath.c_str());
+
+    auto selfBytesBefore = getSelfBytesWritten();
+
+    if (!targetConfig.volatileStatsFilePath.empty()
+        && checkpointVolatileStats())
+    {
+        for (auto const & device : targetConfig.devices)
+            targetDevices[device].persistPending = false;
+    }
+    else
+    {
+        // an entry which can't be written stays pending for the next persist
+        for (auto const & device : targetConfig.devices)
         {
-            LOG_EVENT(LOG_ERR, "Failed to close pFile, %s", strerror(errno));
-            return false; // failure
+            auto targetDevice = &targetDevices[device];
+            if (targetDevice->persistPending
+                && writeStats(targetDevice, targetConfig.statsFilePath,
+                    targetConfig.statsFilePath, !force))
+                targetDevice->persistPending = false;
         }
-    } else if (!std::filesystem::is_directory(statsDirectory)) {
-        LOG_EVENT(LOG_ERR, "Error, [%s] exists and is not a directory\n", statsDirectory.c_str());
-        return false; // failure
+        syncStatsPatches();
     }
-    LOG_EVENT(LOG_INFO, "[%s] already exists and is a directory\n", statsDirectory.c_str());
-    return true; // success
+
+    accountSelfWrites(statsDeviceName, getSelfBytesWritten() - selfBytesBefore);
+
+    lastPersistTime  = now;
+    unpersistedBytes = 0;
 }
 
-void onExit(void)
+gboolean cgroupEventCallback(gint fd, GIOCondition condition, gpointer pUserData)
 {
-    if (timeoutId)
+    cgroupCollector.handleEvents();
+    return true; // keep watching
+}
+
+void updateWriteAttribution(void)
+{
+    if (targetConfig.topWriters <= 0 && !targetConfig.cgroupStats)
+        return;
+
+    // the tree is walked once, then followed through its events
+    if (targetConfig.cgroupStats && !cgroupCollector.isOpen())
     {
-        g_source_remove(timeoutId);
+        if (cgroupCollector.open())
+            g_unix_fd_add(cgroupCollector.getEventFd(), G_IO_IN,
+                cgroupEventCallback, nullptr);
     }
-    if (pLoop)
+
+    // index of each device in the samples
+    attributedDevices = targetConfig.devices;
+    std::vector<std::string> deviceNames;
+    for (auto const & device : attributedDevices)
+        deviceNames.push_back(targetDevices[device].deviceName);
+    if (targetConfig.topWriters > 0)
+        processSampler.setDevices(deviceNames);
+    if (cgroupCollector.isOpen())
+        cgroupCollector.setDevices(deviceNames);
+}
+
+void sampleCgroups(void)
+{
+    if (!targetConfig.cgroupStats || !cgroupCollector.isOpen())
+        return;
+
+    if (!cgroupCollector.sample(&cgroupDeltas))
+        return;
+    for (auto const & delta : cgroupDeltas)
     {
-        g_main_loop_unref(pLoop);
+        auto &targetDevice = targetDevices[attributedDevices[delta.deviceIndex]];
+        targetDevice.cgroupIo["/" + delta.cgroupPath] += delta.io;
     }
-    parser.closeJson();
-    if (pError)
+
+    // the figures are hierarchical, dropping the groups with the least io
+    // drops leaves first, and their io is still in their parents
+    for (auto const & device : attributedDevices)
     {
-        g_error_free(pError);
+        auto &cgroupIo = targetDevices[device].cgroupIo;
+        while (cgroupIo.size() > CONST_MAX_CGROUP_ENTRIES)
+        {
+            auto getBytes = [](auto const & entry) {
+                return entry.second.rbytes + entry.second.wbytes
+                    + entry.second.dbytes;
+            };
+            cgroupIo.erase(std::min_element(cgroupIo.begin(), cgroupIo.end(),
+                [&getBytes](auto const & a, auto const & b) {
+                    return getBytes(a) < getBytes(b);
+                }));
+        }
     }
-    if (pContext)
+}
+
+void sampleProcessWrites(void)
+{
+    if (targetConfig.topWriters <= 0)
+        return;
+
+    auto today = getCurrentDate();
+    for (auto const & device : attributedDevices)
     {
-        g_option_context_free(pContext);
+        auto &topWriters = targetDevices[device].topWriters;
+        topWriters.interval.setCapacity(targetConfig.topWriters);
+        topWriters.interval.reset();
+        topWriters.day.setCapacity(targetConfig.topWriters);
+        if (topWriters.dayDate != today)
+        {
+            topWriters.day.reset();
+            topWriters.dayDate = today;
+        }
+    }
+
+    if (!processSampler.sample(&processWrites))
+        return;
+    for (auto const & write : processWrites)
+    {
+        auto &topWriters
+            = targetDevices[attributedDevices[write.deviceIndex]].topWriters;
+        topWriters.interval.record(write.name, write.bytes);
+        topWriters.day.record(write.name, write.bytes);
     }
-    LogEventDeinit();
 }
 
-gboolean terminationSignalHandler(gpointer pPendingSignal)
+inline void updateAllDeviceStats(void)
 {
-    /* Stop the main loop from running.
-       It is fine to call the following function here as it is thread-safe.
+    for (auto const & device : targetConfig.devices)
+        updateStats(&targetDevices[device]);
+}
+
+static gint64 getWallClockSeconds(void)
+{
+    return getRealTime() / CONST_SECONDS_TO_MICROSECONDS;
+}
+
+gint64 getSampleInterval(std::string const & devicePath)
+{
+    // a device entry of the config may override the sample interval
+    auto updateRate = deviceMatcher.getUpdateRate(devicePath);
+    return updateRate > 0 ? updateRate : targetConfig.sampleInterval;
+}
+
+gboolean timerCallback(gpointer data);
+void scheduleSampling(void);
+
+void armSamplingTimer(void)
+{
+    if (timeoutId)
+        g_source_remove(timeoutId);
+    timeoutId = 0;
+
+    // a replay moves its clock to the next deadline itself
+    if (isReplaying)
+        return;
+
+    // one wakeup per distinct deadline, however many devices share it
+    gint64 deadline;
+    if (!samplingWheel.getNextDeadline(&deadline))
+        return;
+
+    // no deadline is more than its interval ahead, unless the wall clock
+    // went back, e.g. set by NTP, the deadlines are then aligned again
+    auto now = getWallClockSeconds();
+    if (deadline - now > targetConfig.sampleInterval)
+    {
+        gint64 longestInterval = 0;
+        for (auto const & device : targetConfig.devices)
+            longestInterval
+                = std::max(longestInterval, getSampleInterval(device));
+        if (deadline - now > longestInterval)
+        {
+            LOG_EVENT(LOG_WARNING, "The clock went back, scheduling the "
+                "samples again\n");
+            scheduleSampling();
+            return;
+        }
+    }
+    auto delay = std::max<gint64>(
+        deadline * CONST_SECONDS_TO_MICROSECONDS - g_get_real_time(), 0);
+    timeoutId = g_timeout_add(
+        (delay + CONST_MILLISECONDS_TO_MICROSECONDS - 1)
+            / CONST_MILLISECONDS_TO_MICROSECONDS,
+        timerCallback, pLoop);
+}
+
+static void checkTickAllocations(unsigned long allocations)
+{
+    tickCount++;
+    if (cliCheckAllocations <= 0 || tickCount <= (guint64)cliCheckAllocations
+        || tickMayAllocate)
+        return;
+
+    checkedTickCount++;
+    if (allocations == 0)
+        return;
+    LOG_EVENT(LOG_ERR, "Sampling tick %lu made %lu heap allocations\n",
+        tickCount, allocations);
+    std::cerr << "Sampling tick " << tickCount << " made " << allocations
+              << " heap allocations\n";
+    exit(EXIT_FAILURE);
+}
+
+void sampleDueDevices(gint64 now)
+{
+    auto allocationsBefore = AllocCountGet();
+    tickMayAllocate = false;
+    samplingWheel.advance(now, &dueDevices);
+
+    // devices due at the same second are sampled as one batch
+    if (!dueDevices.empty())
+    {
+        sampleProcessWrites();
+        sampleCgroups();
+        for (auto &device : dueDevices)
+        {
+            updateStats(&targetDevices[device]);
+            auto interval = getSampleInterval(device);
+            // the key is not used again until the next advance()
+            samplingWheel.add(std::move(device),
+                cTimerWheel::getAlignedDeadline(now, interval));
+        }
+        persistStats(false);
+        checkTickAllocations(AllocCountGet() - allocationsBefore);
+    }
+}
+
+gboolean timerCallback(gpointer data)
+{
+    timeoutId = 0;
+    sampleDueDevices(getWallClockSeconds());
+    armSamplingTimer();
+    return false; // armed again for the next deadline
+}
+
+void scheduleSampling(void)
+{
+    // deadlines are multiples of the interval in wall clock time, so
+    // rebuilding the wheel leaves them where they were
+    auto now = getWallClockSeconds();
+    samplingWheel.reset(now);
+    samplingWheel.reserve(targetConfig.devices.size());
+    for (auto const & device : targetConfig.devices)
+    {
+        samplingWheel.add(device,
+            cTimerWheel::getAlignedDeadline(now, getSampleInterval(device)));
+    }
+    armSamplingTimer();
+}
+
+void removeTargetDevice(std::string devicePath)
+{
+    auto targetDevice = &targetDevices[devicePath];
+    LOG_EVENT(LOG_NOTICE, "Stopping [%s]\n", devicePath.c_str());
+
+    // last sample, unless it has been unplugged, only this device is written
+    if (pSampleReader->hasDevice(targetDevice->deviceName))
+        updateStats(targetDevice);
+    // a patched entry is only up to date in its counters
+    if (targetDevice->persistPending
+        || statsPatchers.contains(targetConfig.statsFilePath))
+    {
+        auto selfBytesBefore = getSelfBytesWritten();
+        writeStats(targetDevice, targetConfig.statsFilePath,
+            targetConfig.statsFilePath, false);
+        accountSelfWrites(
+            statsDeviceName, getSelfBytesWritten() - selfBytesBefore);
+    }
+    samplingWheel.remove(devicePath);
+    queueDepthSampler.removeDevice(targetDevice->deviceName);
+    targetDevices.erase(devicePath);
+}
+
+// false if the stats file can't be read, the running devices are then left
+// as they were
+bool applyDevices(std::vector<std::string> const & devicePaths)
+{
+    // identify the new devices, the others keep their in-memory state
+    std::vector<std::string> devices;
+    std::vector<std::string> addedDevices;
+    for (auto const & device : devicePaths)
+    {
+        if (std::find(devices.begin(), devices.end(), device) != devices.end())
+            continue;
+
+        if (!targetDevices.contains(device))
+        {
+            LOG_EVENT(LOG_NOTICE, "Starting [%s]\n", device.c_str());
+            if (!addTargetDevice(device))
+                continue;
+            if (!getSerialNumber(device))
+            {
+                targetDevices.erase(device);
+                continue;
+            }
+            addedDevices.push_back(device);
+        }
+        devices.push_back(device);
+    }
+
+    // restore them before anything running is stopped
+    if (!parseStatsFile(getLatestStatsFilePath(), addedDevices))
+    {
+        LOG_EVENT(LOG_ERR, "Unable to read the stats file, not starting the "
+            "new devices\n");
+        for (auto const & device : addedDevices)
+            targetDevices.erase(device);
+        return false; // failure
+    }
+
+    // stop the devices which are no longer configured
+    std::vector<std::string> removedSerialNumbers;
+    for (auto const & device : targetConfig.devices)
+    {
+        if (std::find(devicePaths.begin(), devicePaths.end(), device)
+            == devicePaths.end())
+        {
+            removedSerialNumbers.push_back(targetDevices[device].serialNumber);
+            removeTargetDevice(device);
+        }
+    }
+    targetConfig.devices = devices;
+
+    // a card which only changed path was just written by its last sample
+    std::vector<std::string> movedDevices;
+    for (auto const & device : addedDevices)
+    {
+        if (std::find(removedSerialNumbers.begin(), removedSerialNumbers.end(),
+                targetDevices[device].serialNumber)
+            != removedSerialNumbers.end())
+            movedDevices.push_back(device);
+    }
+    if (!parseStatsFile(getLatestStatsFilePath(), movedDevices))
+    {
+        LOG_EVENT(LOG_ERR, "Unable to read the stats file, not starting the "
+            "moved devices\n");
+        for (auto const & device : movedDevices)
+        {
+            targetDevices.erase(device);
+            std::erase(targetConfig.devices, device);
+            std::erase(addedDevices, device);
+        }
+    }
+
+    updateWriteAttribution();
+    for (auto const & device : addedDevices)
+        updateStats(&targetDevices[device]);
+
+    // sample intervals may have changed as well
+    scheduleSampling();
+    return true; // success
+}
+
+static void startQueueDepthSampler(void)
+{
+    // the devices are added by their next sample
+    queueDepthSampler.stop();
+    if (targetConfig.queueDepthInterval > 0)
+        queueDepthSampler.start(targetConfig.queueDepthInterval);
+}
+
+void reloadConfig(void)
+{
+    LOG_EVENT(LOG_NOTICE, "Reloading [%s]\n", configFilePath.c_str());
+
+    struct sJsonDevicesConfig newConfig;
+    initConfig(&newConfig);
+    if (!parseConfigFile(&newConfig))
+    {
+        LOG_EVENT(LOG_ERR, "Keeping the current config\n");
+        return;
+    }
+    applyConfigDefaults(&newConfig);
+
+    if (newConfig.statsFilePath != targetConfig.statsFilePath
+        || newConfig.volatileStatsFilePath
+            != targetConfig.volatileStatsFilePath
+        || newConfig.archiveFilePath != targetConfig.archiveFilePath)
+    {
+        LOG_EVENT(LOG_WARNING, "Moving the stats files requires a restart\n");
+        newConfig.statsFilePath = targetConfig.statsFilePath;
+        newConfig.volatileStatsFilePath = targetConfig.volatileStatsFilePath;
+        newConfig.archiveFilePath = targetConfig.archiveFilePath;
+    }
+    if ((newConfig.retentionDays > 0 || newConfig.retentionMaxSerials > 0)
+        && !cStatsArchive::isSupported())
+    {
+        LOG_EVENT(LOG_ERR, "Retention needs a build with zlib, keeping the "
+            "current config\n");
+        return;
+    }
+    if (newConfig.sinks != targetConfig.sinks)
+    {
+        LOG_EVENT(LOG_WARNING, "Changing the sinks requires a restart\n");
+        newConfig.sinks = targetConfig.sinks;
+    }
+    if (newConfig.controlSocketPath != targetConfig.controlSocketPath)
+    {
+        LOG_EVENT(LOG_WARNING, "Moving the control socket requires a restart\n");
+        newConfig.controlSocketPath = targetConfig.controlSocketPath;
+    }
+
+    if (!deviceMatcher.setMatchers(newConfig.deviceMatchers))
+    {
+        LOG_EVENT(LOG_ERR, "Keeping the current config\n");
+        return;
+    }
+
+    newConfig.devices = targetConfig.devices;
+    auto previousConfig = targetConfig;
+    targetConfig = newConfig;
+    if (!applyDevices(deviceMatcher.getDevicePaths()))
+    {
+        LOG_EVENT(LOG_ERR, "Keeping the current config\n");
+        targetConfig = previousConfig;
+        deviceMatcher.setMatchers(targetConfig.deviceMatchers);
+        return;
+    }
+    if (newConfig.queueDepthInterval != previousConfig.queueDepthInterval)
+        startQueueDepthSampler();
+}
+
+// false if the device now holds other media, or can't be read
+static bool isSameMedia(struct sDeviceEntry const * targetDevice)
+{
+    struct sDeviceSpecs specs;
+    gint64 diskSeq;
+    return reader.getSpecs(targetDevice->deviceName, &specs)
+        && specs.serial.value == targetDevice->serialNumber
+        && pSampleReader->getDiskSeq(targetDevice->deviceName, &diskSeq)
+        && diskSeq == targetDevice->diskSeq;
+}
+
+gboolean refreshTimerCallback(gpointer pUserData)
+{
+    refreshTimeoutId = 0;
+
+    // the changed devices are matched again, with their attributes as now
+    std::map<std::string, gint64> updateRates;
+    for (auto const & device : targetConfig.devices)
+        updateRates[device] = deviceMatcher.getUpdateRate(device);
+    for (auto const & deviceName : changedDeviceNames)
+        deviceMatcher.forget(deviceName);
+    bool refreshed = deviceMatcher.refresh();
+
+    // a "change" is mostly a media poll or a partition rescan, only another
+    // card, new media or another matching entry identifies a device again
+    std::vector<std::string> staleDevices;
+    for (auto const & device : targetConfig.devices)
+    {
+        auto targetDevice = &targetDevices[device];
+        if (std::find(changedDeviceNames.begin(), changedDeviceNames.end(),
+                targetDevice->deviceName) == changedDeviceNames.end())
+            continue;
+        if (!isSameMedia(targetDevice)
+            || deviceMatcher.getUpdateRate(device) != updateRates[device])
+            staleDevices.push_back(device);
+    }
+    for (auto const & device : staleDevices)
+    {
+        removeTargetDevice(device);
+        std::erase(targetConfig.devices, device);
+    }
+    changedDeviceNames.clear();
+
+    // devices which failed to start are tried again the next time
+    if (refreshed || !staleDevices.empty())
+        applyDevices(deviceMatcher.getDevicePaths());
+    return false; // one shot
+}
+
+gboolean ueventCallback(gint fd, GIOCondition condition, gpointer pUserData)
+{
+    char buffer[8192];
+    bool refresh = false;
+
+    ssize_t length;
+    while ((length = recv(fd, buffer, sizeof(buffer) - 1, 0)) > 0)
+    {
+        buffer[length] = '\0';
+
+        // "action@devpath" followed by NUL separated KEY=value fields
+        std::string_view action;
+        std::string_view deviceName;
+        bool isBlock = false;
+        bool isDisk  = false;
+        for (char* pField = buffer + strlen(buffer) + 1;
+             pField < buffer + length; pField += strlen(pField) + 1)
+        {
+            std::string_view field = pField;
+            if (field.starts_with("ACTION="))
+                action = field.substr(7);
+            else if (field.starts_with("DEVNAME="))
+                deviceName = field.substr(8);
+            else if (field == "SUBSYSTEM=block")
+                isBlock = true;
+            else if (field == "DEVTYPE=disk")
+                isDisk = true;
+        }
+        if (!isBlock || !isDisk)
+            continue;
+
+        if (action == "add" || action == "change")
+            changedDeviceNames.emplace_back(deviceName);
+        refresh |= action == "add" || action == "remove" || action == "change";
+    }
+
+    // the device set is only enumerated again once events settle
+    if (refresh && refreshTimeoutId == 0)
+        refreshTimeoutId = g_timeout_add(
+            CONST_RELOAD_DELAY_MILLISECONDS, refreshTimerCallback, nullptr);
+    return true; // keep listening
+}
+
+bool watchBlockDevices(void)
+{
+    ueventFd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+        NETLINK_KOBJECT_UEVENT);
+    if (ueventFd < 0)
+    {
+        LOG_EVENT(LOG_ERR, "Failed to create uevent socket, %s",
+            strerror(errno));
+        return false; // failure
+    }
+
+    struct sockaddr_nl address = {};
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = 1; // kernel events
+    if (bind(ueventFd, (struct sockaddr*)&address, sizeof(address)) < 0)
+    {
+        LOG_EVENT(LOG_ERR, "Failed to bind uevent socket, %s",
+            strerror(errno));
+        return false; // failure
+    }
+
+    g_unix_fd_add(ueventFd, G_IO_IN, ueventCallback, nullptr);
+    return true; // success
+}
+
+gboolean reloadTimerCallback(gpointer pUserData)
+{
+    reloadTimeoutId = 0;
+    reloadConfig();
+    return false; // one shot
+}
+
+gboolean configWatchCallback(gint fd, GIOCondition condition, gpointer pUserData)
+{
+    alignas(struct inotify_event) char buffer[4096];
+    auto configFileName = std::filesystem::path(configFilePath).filename();
+    bool changed = false;
+
+    ssize_t length;
+    while ((length = read(fd, buffer, sizeof(buffer))) > 0)
+    {
+        for (char* pEvent = buffer; pEvent < buffer + length;)
+        {
+            auto pInotifyEvent = (struct inotify_event*)pEvent;
+            if (pInotifyEvent->len && configFileName == pInotifyEvent->name)
+                changed = true;
+            pEvent += sizeof(struct inotify_event) + pInotifyEvent->len;
+        }
+    }
+
+    if (changed && reloadTimeoutId == 0)
+        reloadTimeoutId = g_timeout_add(
+            CONST_RELOAD_DELAY_MILLISECONDS, reloadTimerCallback, nullptr);
+    return true; // keep watching
+}
+
+bool watchConfigFile(void)
+{
+    configWatchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (configWatchFd < 0)
+    {
+        LOG_EVENT(LOG_ERR, "Failed to create inotify, %s", strerror(errno));
+        return false; // failure
+    }
+
+    // watch the directory, editors replace the file rather than write it
+    auto directory = std::filesystem::path(configFilePath).parent_path();
+    if (directory.empty())
+        directory = ".";
+    if (inotify_add_watch(configWatchFd, directory.c_str(),
+            IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        LOG_EVENT(LOG_ERR, "Failed to watch [%s], %s", directory.c_str(),
+            strerror(errno));
+        return false; // failure
+    }
+
+    g_unix_fd_add(configWatchFd, G_IO_IN, configWatchCallback, nullptr);
+    return true; // success
+}
+
+gboolean checkStatsFilePath(std::string statsFilePath)
+{
+    FILE *pFile;
+
+    LOG_EVENT(LOG_INFO, "Checking stats path [%s]\n",
+        statsFilePath.c_str());
+    /* if the file is in the root directory or has no directory */
+    auto ret = statsFilePath.find_last_of('/');
+    if (ret == 0 || ret == std::string::npos)
+        return true; // success
+
+
+    auto statsDirectory = statsFilePath.substr(0, ret);
+    if (!std::filesystem::exists(statsDirectory)) {
+        std::string command = "mkdir -p " + statsDirectory;
+        pFile = popen(command.c_str(), "r");
+        if (nullptr == pFile)
+        {
+            LOG_EVENT(LOG_ERR, "Failed to open pFile, %s", strerror(errno));
+            return false; // failure
+        }
+
+        if (pclose(pFile))
+        {
+            LOG_EVENT(LOG_ERR, "Failed to close pFile, %s", strerror(errno));
+            return false; // failure
+        }
+    } else if (!std::filesystem::is_directory(statsDirectory)) {
+        LOG_EVENT(LOG_ERR, "Error, [%s] exists and is not a directory\n", statsDirectory.c_str());
+        return false; // failure
+    }
+    LOG_EVENT(LOG_INFO, "[%s] already exists and is a directory\n", statsDirectory.c_str());
+    return true; // success
+}
+
+static bool startSinks(void)
+{
+    for (auto const & sinkConfig : targetConfig.sinks)
+    {
+        std::unique_ptr<cSink> pSink;
+        cHistorySink* pHistory = nullptr;
+        if (sinkConfig.type == "history")
+        {
+            auto pNewHistory = std::make_unique<cHistorySink>(
+                sinkConfig.size > 0
+                    ? sinkConfig.size : CONST_DEFAULT_HISTORY_SIZE);
+            pHistory = pNewHistory.get();
+            pSink    = std::move(pNewHistory);
+        }
+        else if (sinkConfig.path.empty())
+        {
+            LOG_EVENT(LOG_ERR, "Sink [%s] needs a path\n",
+                sinkConfig.type.c_str());
+            return false; // failure
+        }
+        else if (sinkConfig.type == "plugin")
+        {
+            pSink = std::make_unique<cPluginSink>(
+                sinkConfig.path, sinkConfig.options);
+        }
+        else if (sinkConfig.type != "csv" && sinkConfig.type != "openMetrics")
+        {
+            LOG_EVENT(LOG_ERR, "Unknown sink type [%s]\n",
+                sinkConfig.type.c_str());
+            return false; // failure
+        }
+        else if (checkStatsFilePath(sinkConfig.path) == false)
+        {
+            return false; // failure
+        }
+        else if (sinkConfig.type == "csv")
+        {
+            pSink = std::make_unique<cCsvSink>(sinkConfig.path);
+        }
+        else
+        {
+            pSink = std::make_unique<cOpenMetricsSink>(sinkConfig.path);
+        }
+
+        if (!sinkPipeline.addSink(std::move(pSink), sinkConfig))
+            return false; // failure
+        if (pHistory != nullptr)
+            pHistorySink = pHistory;
+    }
+    sinkPipeline.start();
+    return true; // success
+}
+
+static bool checkRetentionConfig(void)
+{
+    if (targetConfig.retentionDays <= 0 && targetConfig.retentionMaxSerials <= 0)
+        return true; // no retention
+    if (!cStatsArchive::isSupported())
+    {
+        LOG_EVENT(LOG_ERR, "Retention needs a build with zlib\n");
+        return false; // failure
+    }
+    return checkStatsFilePath(targetConfig.archiveFilePath);
+}
+
+void onExit(void)
+{
+    if (timeoutId)
+    {
+        g_source_remove(timeoutId);
+    }
+    if (configWatchFd >= 0)
+    {
+        close(configWatchFd);
+    }
+    if (ueventFd >= 0)
+    {
+        close(ueventFd);
+    }
+    controlServer.close();
+    queueDepthSampler.stop();
+    sinkPipeline.stop();
+    traceRecorder.close();
+    anomalyHook.stop();
+    statsPatchers.clear();
+    if (pLoop)
+    {
+        g_main_loop_unref(pLoop);
+    }
+    if (pError)
+    {
+        g_error_free(pError);
+    }
+    if (pContext)
+    {
+        g_option_context_free(pContext);
+    }
+    LogEventDeinit();
+}
+
+gboolean terminationSignalHandler(gpointer pPendingSignal)
+{
+    /* Stop the main loop from running.
+       It is fine to call the following function here as it is thread-safe.
        Any other non-thread-safe operation should be done outside of this signal
        handler */
     g_main_loop_quit(pLoop);
@@ -381,6 +1683,257 @@ gboolean terminationSignalHandler(gpointer pPendingSignal)
     return false;
 }
 
+gboolean reloadSignalHandler(gpointer pConfigParsed)
+{
+    // devices given with -d or -n have nothing to reload
+    if (*((bool*)pConfigParsed))
+        reloadConfig();
+    else
+        LOG_EVENT(LOG_NOTICE, "No config file to reload\n");
+    return true; // keep the handler
+}
+
+gboolean selfStatsSignalHandler(gpointer pUserData)
+{
+    selfStats.dump();
+    return true; // keep the handler
+}
+
+int mergeStatsFiles(void)
+{
+    cStatsMerger merger;
+    if (!merger.mergeTo(cliMergePath,
+            cliMergeFormat == nullptr ? "json" : cliMergeFormat,
+            cliMergeOutputPath == nullptr ? "" : cliMergeOutputPath))
+        return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
+
+int lookupArchive(void)
+{
+    // the archive of the configured stats file, or next to the -s one
+    initConfig(&targetConfig);
+    if (cliConfigFilePath != nullptr && !parseConfigFile(&targetConfig))
+        return EXIT_FAILURE;
+    applyConfigDefaults(&targetConfig);
+
+    cStatsArchive archive;
+    if (!archive.printLookup(targetConfig.archiveFilePath, cliArchiveLookup))
+        return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
+
+int watchDevices(void)
+{
+    // the devices and totals of the config, -d and -n, or every disk
+    cWatchView view;
+    initConfig(&targetConfig);
+    if (parseConfigFile(&targetConfig)
+        && deviceMatcher.setMatchers(targetConfig.deviceMatchers))
+    {
+        for (auto const & devicePath : deviceMatcher.getDevicePaths())
+        {
+            if (addTargetDevice(devicePath) && getSerialNumber(devicePath))
+                targetConfig.devices.push_back(devicePath);
+        }
+        if (!parseStatsFile(getLatestStatsFilePath(), targetConfig.devices))
+            return EXIT_FAILURE;
+        for (auto const & devicePath : targetConfig.devices)
+        {
+            auto pDevice = &targetDevices[devicePath];
+            view.addDevice(pDevice->deviceName, pDevice->serialNumber,
+                pDevice->totalBytesWritten);
+        }
+    }
+    else if (cliDeviceName != nullptr)
+        view.addDevice(cliDeviceName, "", -1);
+    else
+        view.addAllDisks();
+
+    if (!view.run(cliWatchInterval, checkTickAllocations))
+        return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
+
+// the config of a replay or a soak only provides the stats files, the
+// intervals and the sinks
+static bool loadVirtualConfig(void)
+{
+    initConfig(&targetConfig);
+    if (cliConfigFilePath != nullptr && !parseConfigFile(&targetConfig))
+        return false; // failure
+    applyConfigDefaults(&targetConfig);
+    // the entries of the trace or the soak must not end up in the stats file
+    // of this machine
+    if (targetConfig.statsFilePath == CONST_DEFAULT_STATS_PATH)
+    {
+        std::cerr << "Refusing to write " << CONST_DEFAULT_STATS_PATH
+                  << ", give another stats file with -s or statsFilePath\n";
+        return false; // failure
+    }
+    targetConfig.devices.clear();
+    // processes and cgroups of this machine have no place in a replay
+    targetConfig.topWriters  = 0;
+    targetConfig.cgroupStats = false;
+    targetConfig.queueDepthInterval = 0;
+    // anomalies are detected, but hooks act on this machine
+    targetConfig.anomalyHook.clear();
+
+    if (checkStatsFilePath(targetConfig.statsFilePath) == false)
+        return false; // failure
+    if (!targetConfig.volatileStatsFilePath.empty()
+        && checkStatsFilePath(targetConfig.volatileStatsFilePath) == false)
+        return false; // failure
+    if (!checkRetentionConfig())
+        return false; // failure
+    return startSinks();
+}
+
+// a device of the trace or the soak, its stats file entry is not parsed yet
+static void addVirtualDevice(std::string const & devicePath,
+    std::string const & deviceName, std::string const & serialNumber)
+{
+    targetDevices.insert({ devicePath,
+        (struct sDeviceEntry) {
+            .serialNumber = serialNumber,
+            .deviceName = deviceName,
+            .firstSightingDate = getCurrentTimestamp(),
+            .devicePath = devicePath }
+    });
+    resetWindow(&targetDevices[devicePath]);
+    targetConfig.devices.push_back(devicePath);
+}
+
+// the daemon as driven by the control commands and replays
+class cMainDaemon final : public cDaemon
+{
+    public:
+        std::vector<struct sDeviceEntry*> getDevices(void) override
+        {
+            std::vector<struct sDeviceEntry*> devices;
+            for (auto const & device : targetConfig.devices)
+                devices.push_back(&targetDevices[device]);
+            return devices;
+        }
+        cStatReader* getSampleReader(void) override { return pSampleReader; }
+        gint64 getMonotonicTime(void) override { return ::getMonotonicTime(); }
+        void sampleWriters(void) override
+        {
+            sampleProcessWrites();
+            sampleCgroups();
+        }
+        void sampleDevices(void) override { updateAllDeviceStats(); }
+        void persist(bool force) override { persistStats(force); }
+        bool resetWindow(struct sDeviceEntry* pDevice) override
+        {
+            return ::resetWindow(pDevice);
+        }
+        bool isSamplingQueueDepth(void) override
+        {
+            return queueDepthSampler.isRunning();
+        }
+        cHistorySink* getHistorySink(void) override { return pHistorySink; }
+        void startVirtualClock(cStatReader* pReader, gint64 seconds) override
+        {
+            pSampleReader = pReader;
+            isReplaying   = true;
+            virtualTime   = seconds * CONST_SECONDS_TO_MICROSECONDS;
+        }
+        void setVirtualTime(gint64 seconds) override
+        {
+            virtualTime = seconds * CONST_SECONDS_TO_MICROSECONDS;
+        }
+        bool loadVirtualConfig(void) override { return ::loadVirtualConfig(); }
+        void addVirtualDevice(std::string const & devicePath,
+            std::string const & deviceName,
+            std::string const & serialNumber) override
+        {
+            ::addVirtualDevice(devicePath, deviceName, serialNumber);
+        }
+        void removeDevice(std::string const & devicePath) override
+        {
+            removeTargetDevice(devicePath);
+            std::erase(targetConfig.devices, devicePath);
+        }
+        bool restoreDevices(
+            std::vector<std::string> const & devicePaths) override
+        {
+            return parseStatsFile(getLatestStatsFilePath(), devicePaths);
+        }
+        std::string const & getStatsFilePath(void) override
+        {
+            return targetConfig.statsFilePath;
+        }
+        void scheduleSampling(void) override { ::scheduleSampling(); }
+        void startSampling(std::string const & devicePath,
+            gint64 now) override
+        {
+            updateStats(&targetDevices[devicePath]);
+            samplingWheel.add(devicePath, cTimerWheel::getAlignedDeadline(
+                now, getSampleInterval(devicePath)));
+        }
+        bool getNextDeadline(gint64* pDeadline) override
+        {
+            return samplingWheel.getNextDeadline(pDeadline);
+        }
+        void sampleDueDevices(gint64 deadline) override
+        {
+            ::sampleDueDevices(deadline);
+        }
+        void stopSinks(void) override { sinkPipeline.stop(); }
+};
+
+cMainDaemon mainDaemon;
+cControlCommands controlCommands(&mainDaemon, &writer);
+
+bool startControlServer(void)
+{
+    controlCommands.addCommands(&controlServer);
+    return controlServer.open(targetConfig.controlSocketPath);
+}
+
+int replayTrace(void)
+{
+    cTraceReplay replay(&mainDaemon);
+    if (!replay.run(cliReplayPath))
+        return EXIT_FAILURE;
+
+    if (cliCheckAllocations > 0)
+    {
+        std::cout << "No heap allocations in " << checkedTickCount << " of "
+                  << tickCount << " ticks, the others warmed up, wrote a "
+                  << "stats file in full or reported an anomaly\n";
+        // a check which skipped most ticks proves nothing
+        auto warmTickCount = tickCount > (guint64)cliCheckAllocations
+            ? tickCount - cliCheckAllocations : 0;
+        if (checkedTickCount == 0 || checkedTickCount
+            < warmTickCount * CONST_MIN_CHECKED_TICKS_PERCENT / 100)
+        {
+            std::cerr << "Too few ticks checked for heap allocations, set "
+                      << "statsFilePatches or replay a longer trace\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (cliGoldenPath != nullptr
+        && !cTraceReplay::compareWithGolden(
+            targetConfig.statsFilePath, cliGoldenPath))
+        return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
+
+int soakTest(void)
+{
+    if (cliSoakTicks < 0)
+    {
+        std::cerr << "--soak needs a number of ticks\n";
+        return EXIT_FAILURE;
+    }
+
+    cSoakTest soak(&mainDaemon, &selfStats);
+    return soak.run(cliSoakTicks) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 int main(int argc, char* argv[])
 {
     LogEventInit(basename(argv[0]), 6);
@@ -405,14 +1958,47 @@ int main(int argc, char* argv[])
         printAllBlockDevices();
     }
 
+    selfStats.setEnabled(selfStatsEnabled);
+    writer.setSelfStats(&selfStats);
+
+    if (cliCheckAllocations > 0 && !AllocCountIsEnabled())
+    {
+        LOG_EVENT(LOG_ERR, "--check-allocations needs a build with "
+            "KK_COUNT_ALLOCATIONS\n");
+        return EXIT_FAILURE;
+    }
+
     configFilePath = cliConfigFilePath == nullptr
         ? CONST_DEFAULT_CONFIG_PATH : (std::string)cliConfigFilePath;
 
-    targetConfig.updateRate = updateRate;
-    targetConfig.statsFilePath = cliStatsFilePath == nullptr
-        ? CONST_DEFAULT_STATS_PATH : (std::string)cliStatsFilePath;
+    if (cliReplayPath != nullptr)
+        return replayTrace();
 
-    if (parseConfigFile() == false) {
+    if (cliSoakTicks != 0)
+        return soakTest();
+
+    if (cliMergePath != nullptr)
+        return mergeStatsFiles();
+
+    if (cliArchiveLookup != nullptr)
+        return lookupArchive();
+
+    if (cliWatchInterval != 0)
+        return watchDevices();
+
+    if (cliDecodePath != nullptr)
+    {
+        cTraceDecoder decoder;
+        if (!decoder.open(cliDecodePath)
+            || !decoder.decode(
+                cliDecodeFormat == nullptr ? "csv" : cliDecodeFormat, std::cout))
+            return EXIT_FAILURE;
+        return EXIT_SUCCESS;
+    }
+
+    initConfig(&targetConfig);
+    bool configParsed = parseConfigFile(&targetConfig);
+    if (configParsed == false) {
         if (cliDevicePath == nullptr || cliDeviceName == nullptr) {
             LOG_EVENT(LOG_ERR, "deviceName and devicePath should be present "
                                "if config is missing/invalid");
@@ -425,18 +2011,72 @@ int main(int argc, char* argv[])
                 .devicePath = (std::string )cliDevicePath,
 
             }});
+        targetConfig.devices = { (std::string)cliDevicePath };
+    } else {
+        if (!deviceMatcher.setMatchers(targetConfig.deviceMatchers))
+            exit(EXIT_FAILURE);
+
+        targetConfig.devices = deviceMatcher.getDevicePaths();
+        if (targetConfig.devices.empty())
+            LOG_EVENT(LOG_NOTICE, "No device matches the config yet\n");
+
+        for (const auto& devicePath : targetConfig.devices) {
+            if (!addTargetDevice(devicePath))
+                exit(EXIT_FAILURE);
+        }
     }
 
-    if (checkStatsFilePath() == false)
+    applyConfigDefaults(&targetConfig);
+
+    if (checkStatsFilePath(targetConfig.statsFilePath) == false)
         exit(EXIT_FAILURE);
 
-    for (const auto& device : targetConfig.devices)
+    if (!targetConfig.volatileStatsFilePath.empty()
+        && checkStatsFilePath(targetConfig.volatileStatsFilePath) == false)
+        exit(EXIT_FAILURE);
+
+    // own writes are accounted to the devices holding the stats files
+    if (reader.getDeviceNameForPath(targetConfig.statsFilePath,
+            &statsDeviceName))
+        LOG_EVENT(LOG_INFO, "Stats file is stored on [%s]\n",
+            statsDeviceName.c_str());
+    if (!targetConfig.volatileStatsFilePath.empty())
+        reader.getDeviceNameForPath(targetConfig.volatileStatsFilePath,
+            &volatileStatsDeviceName);
+    if (!checkRetentionConfig())
+        exit(EXIT_FAILURE);
+    reader.getDeviceNameForPath(targetConfig.archiveFilePath,
+        &archiveDeviceName);
+    if (!startSinks())
+        exit(EXIT_FAILURE);
+    startQueueDepthSampler();
+
+    // raw samples for debugging and replays
+    if (cliRecordPath != nullptr)
+    {
+        if (!traceRecorder.open(cliRecordPath, cliRecordChunkBytes))
+            exit(EXIT_FAILURE);
+        reader.getDeviceNameForPath(cliRecordPath, &recordDeviceName);
+    }
+
     {
-        getSerialNumber(device);
+        cPhaseTimer identifyTimer(&selfStats, cSelfStats::PHASE_IDENTIFY);
+        for (const auto& device : targetConfig.devices)
+        {
+            if (!getSerialNumber(device))
+                exit(EXIT_FAILURE);
+        }
     }
 
-    // parse stats json file
-    parseStatsFile();
+    // parse stats json file, the volatile copy is never older than it
+    cPhaseTimer parseTimer(&selfStats, cSelfStats::PHASE_PARSE_STATS_FILE);
+    if (!parseStatsFile(getLatestStatsFilePath(), targetConfig.devices))
+        exit(EXIT_FAILURE);
+    parseTimer.stop();
+
+    // the first process scan only records the baselines
+    updateWriteAttribution();
+    sampleProcessWrites();
 
     // loop & check
     pLoop = g_main_loop_new(nullptr, FALSE);
@@ -449,14 +2089,31 @@ int main(int argc, char* argv[])
     // Register signal handler to service daemon termination requests
     int pendingSignal = 0;
     g_unix_signal_add(SIGTERM, terminationSignalHandler, &pendingSignal);
+    g_unix_signal_add(SIGUSR1, selfStatsSignalHandler, nullptr);
+
+    // Reload the config on SIGHUP or when the file changes, SIGHUP is handled
+    // without a config too, so that it doesn't stop the daemon
+    g_unix_signal_add(SIGHUP, reloadSignalHandler, &configParsed);
+    if (configParsed)
+    {
+        watchConfigFile();
+        watchBlockDevices();
+    }
+
+    // sampling, flushing and state dumps on demand
+    if (!targetConfig.controlSocketPath.empty() && !startControlServer())
+        exit(EXIT_FAILURE);
 
     updateAllDeviceStats();
+    persistStats(false);
 
-    timeoutId = g_timeout_add(targetConfig.updateRate * CONST_RATE_TO_MILLISECONDS, timerCallback, pLoop);
+    scheduleSampling();
     g_main_loop_run(pLoop);
 
     // Save stats when terminating daemon to capture as many writes as possible
     updateAllDeviceStats();
+    persistStats(true);
+    sinkPipeline.stop();
 
     // Continue servicing the pending signal, if any, with its default handler
     if (pendingSignal) {
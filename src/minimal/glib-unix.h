@@ -0,0 +1,14 @@
+// glib-unix.h
+#ifndef _KK_MINIMAL_GLIB_UNIX_H
+#define _KK_MINIMAL_GLIB_UNIX_H
+
+#include "glib.h"
+
+typedef gboolean (*GUnixFDSourceFunc)(
+    gint fd, GIOCondition condition, gpointer pUserData);
+
+guint g_unix_signal_add(gint signum, GSourceFunc handler, gpointer pUserData);
+guint g_unix_fd_add(gint fd, GIOCondition condition,
+    GUnixFDSourceFunc function, gpointer pUserData);
+
+#endif /* _KK_MINIMAL_GLIB_UNIX_H */
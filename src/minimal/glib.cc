@@ -0,0 +1,229 @@
+#include "glib.h"
+#include "gobject.hh"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// errors
+
+void g_set_error(
+    GError** ppError, GQuark domain, gint code, const gchar* pFormat, ...)
+{
+    if (ppError == nullptr)
+    {
+        return;
+    }
+
+    va_list arguments;
+    va_start(arguments, pFormat);
+    gchar* pMessage = nullptr;
+    if (vasprintf(&pMessage, pFormat, arguments) < 0)
+    {
+        pMessage = nullptr;
+    }
+    va_end(arguments);
+
+    auto pError     = (GError*)g_malloc(sizeof(GError));
+    pError->domain  = domain;
+    pError->code    = code;
+    pError->message = pMessage != nullptr ? pMessage : g_strdup("");
+    *ppError        = pError;
+}
+
+void g_error_free(GError* pError)
+{
+    if (pError != nullptr)
+    {
+        free(pError->message);
+        free(pError);
+    }
+}
+
+// memory and strings
+
+gpointer g_malloc(gsize size)
+{
+    // GLib aborts as well, there is no way to carry on
+    gpointer pMemory = malloc(size != 0 ? size : 1);
+    if (pMemory == nullptr)
+    {
+        abort();
+    }
+    return pMemory;
+}
+
+void g_free(gpointer pMemory) { free(pMemory); }
+
+gchar* g_strdup(const gchar* pString)
+{
+    if (pString == nullptr)
+    {
+        return nullptr;
+    }
+    gsize length = strlen(pString) + 1;
+    return (gchar*)memcpy(g_malloc(length), pString, length);
+}
+
+void g_strfreev(gchar** ppStrings)
+{
+    if (ppStrings == nullptr)
+    {
+        return;
+    }
+    for (gchar** ppString = ppStrings; *ppString != nullptr; ppString++)
+    {
+        free(*ppString);
+    }
+    free(ppStrings);
+}
+
+gsize g_strlcpy(gchar* pDestination, const gchar* pSource, gsize size)
+{
+    gsize length = strlen(pSource);
+    if (size > 0)
+    {
+        gsize copied = length < size - 1 ? length : size - 1;
+        memcpy(pDestination, pSource, copied);
+        pDestination[copied] = '\0';
+    }
+    return length;
+}
+
+// objects
+
+void g_object_unref(gpointer pObject)
+{
+    auto pBase = (struct _GObject*)pObject;
+    if (pBase != nullptr && --pBase->refCount == 0)
+    {
+        delete pBase;
+    }
+}
+
+// files
+
+gboolean g_file_get_contents(const gchar* pFileName, gchar** ppContents,
+    gsize* pLength, GError** ppError)
+{
+    int fd = open(pFileName, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        g_set_error(ppError, 0, errno, "Failed to open file “%s”: %s",
+            pFileName, strerror(errno));
+        return FALSE;
+    }
+
+    std::string contents;
+    char buffer[4096];
+    ssize_t length;
+    while ((length = read(fd, buffer, sizeof(buffer))) != 0)
+    {
+        if (length < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            g_set_error(ppError, 0, errno, "Failed to read from file “%s”: %s",
+                pFileName, strerror(errno));
+            close(fd);
+            return FALSE;
+        }
+        contents.append(buffer, length);
+    }
+    close(fd);
+
+    // NUL terminated, as GLib does
+    *ppContents = (gchar*)g_malloc(contents.size() + 1);
+    memcpy(*ppContents, contents.c_str(), contents.size() + 1);
+    if (pLength != nullptr)
+    {
+        *pLength = contents.size();
+    }
+    return TRUE;
+}
+
+gboolean g_file_set_contents(const gchar* pFileName, const gchar* pContents,
+    gssize length, GError** ppError)
+{
+    if (length < 0)
+    {
+        length = strlen(pContents);
+    }
+
+    // written next to the target and renamed over it, as GLib does
+    std::string temporaryPath = std::string(pFileName) + ".XXXXXX";
+    int fd = mkostemp(temporaryPath.data(), O_CLOEXEC);
+    if (fd < 0)
+    {
+        g_set_error(ppError, 0, errno, "Failed to create file “%s”: %s",
+            temporaryPath.c_str(), strerror(errno));
+        return FALSE;
+    }
+    mode_t mask = umask(0);
+    umask(mask);
+    fchmod(fd, 0666 & ~mask);
+
+    const gchar* pPosition = pContents;
+    gssize remaining = length;
+    while (remaining > 0)
+    {
+        ssize_t written = write(fd, pPosition, remaining);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written < 0)
+        {
+            g_set_error(ppError, 0, errno, "Failed to write file “%s”: %s",
+                temporaryPath.c_str(), strerror(errno));
+            close(fd);
+            unlink(temporaryPath.c_str());
+            return FALSE;
+        }
+        pPosition += written;
+        remaining -= written;
+    }
+
+    // the data has to be on disk before the rename replaces the old file
+    if (fsync(fd) != 0 || close(fd) != 0)
+    {
+        g_set_error(ppError, 0, errno, "Failed to write file “%s”: %s",
+            temporaryPath.c_str(), strerror(errno));
+        unlink(temporaryPath.c_str());
+        return FALSE;
+    }
+    if (rename(temporaryPath.c_str(), pFileName) != 0)
+    {
+        g_set_error(ppError, 0, errno,
+            "Failed to rename file “%s” to “%s”: %s", temporaryPath.c_str(),
+            pFileName, strerror(errno));
+        unlink(temporaryPath.c_str());
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// clocks
+
+static gint64 getClockMicroseconds(clockid_t clock)
+{
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return (gint64)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+gint64 g_get_monotonic_time(void)
+{
+    return getClockMicroseconds(CLOCK_MONOTONIC);
+}
+
+gint64 g_get_real_time(void) { return getClockMicroseconds(CLOCK_REALTIME); }
@@ -0,0 +1,149 @@
+// glib.h
+#ifndef _KK_MINIMAL_GLIB_H
+#define _KK_MINIMAL_GLIB_H
+
+/*
+The part of the GLib API KrillKounter uses, for KK_MINIMAL builds.
+
+Only what the daemon and the library call is provided, with the same
+behaviour as GLib for those calls, so the rest of the tree builds
+unchanged. The main loop runs on epoll, timerfd and signalfd.
+*/
+
+// GLib pulls these in as well, the tree relies on it
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+typedef char gchar;
+typedef int gint;
+typedef unsigned int guint;
+typedef int8_t gint8;
+typedef uint8_t guint8;
+typedef int16_t gint16;
+typedef uint16_t guint16;
+typedef int32_t gint32;
+typedef uint32_t guint32;
+typedef int64_t gint64;
+typedef uint64_t guint64;
+typedef long glong;
+typedef unsigned long gulong;
+typedef size_t gsize;
+typedef ssize_t gssize;
+typedef double gdouble;
+typedef gint gboolean;
+typedef void* gpointer;
+typedef const void* gconstpointer;
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#define G_LIKELY(expression) __builtin_expect(!!(expression), 1)
+#define G_UNLIKELY(expression) __builtin_expect(!!(expression), 0)
+#define G_MAXINT64 INT64_MAX
+
+#define G_SOURCE_REMOVE FALSE
+#define G_SOURCE_CONTINUE TRUE
+
+typedef guint32 GQuark;
+
+typedef struct _GError
+{
+        GQuark domain;
+        gint code;
+        gchar* message;
+} GError;
+
+void g_set_error(
+    GError** ppError, GQuark domain, gint code, const gchar* pFormat, ...)
+    __attribute__((format(printf, 4, 5)));
+void g_error_free(GError* pError);
+
+// memory and strings
+gpointer g_malloc(gsize size);
+void g_free(gpointer pMemory);
+gchar* g_strdup(const gchar* pString);
+void g_strfreev(gchar** ppStrings);
+gsize g_strlcpy(gchar* pDestination, const gchar* pSource, gsize size);
+
+// reference counted objects, only the built-in JSON types are objects
+void g_object_unref(gpointer pObject);
+
+// files
+gboolean g_file_get_contents(const gchar* pFileName, gchar** ppContents,
+    gsize* pLength, GError** ppError);
+gboolean g_file_set_contents(const gchar* pFileName, const gchar* pContents,
+    gssize length, GError** ppError);
+
+// clocks, in microseconds
+gint64 g_get_monotonic_time(void);
+gint64 g_get_real_time(void);
+
+// main loop
+typedef gboolean (*GSourceFunc)(gpointer pUserData);
+
+typedef enum
+{
+    G_IO_IN   = 1,
+    G_IO_PRI  = 2,
+    G_IO_OUT  = 4,
+    G_IO_ERR  = 8,
+    G_IO_HUP  = 16,
+    G_IO_NVAL = 32
+} GIOCondition;
+
+typedef struct _GMainContext GMainContext;
+typedef struct _GMainLoop GMainLoop;
+
+GMainLoop* g_main_loop_new(GMainContext* pContext, gboolean isRunning);
+void g_main_loop_run(GMainLoop* pLoop);
+void g_main_loop_quit(GMainLoop* pLoop);
+void g_main_loop_unref(GMainLoop* pLoop);
+guint g_timeout_add(guint interval, GSourceFunc function, gpointer pData);
+gboolean g_source_remove(guint tag);
+
+// command line options
+typedef enum
+{
+    G_OPTION_ARG_NONE,
+    G_OPTION_ARG_STRING,
+    G_OPTION_ARG_INT,
+    G_OPTION_ARG_FILENAME = 4
+} GOptionArg;
+
+typedef struct _GOptionEntry
+{
+        const gchar* long_name;
+        gchar short_name;
+        gint flags;
+        GOptionArg arg;
+        gpointer arg_data;
+        const gchar* description;
+        const gchar* arg_description;
+} GOptionEntry;
+
+typedef struct _GOptionContext GOptionContext;
+
+#define G_OPTION_ERROR 1
+typedef enum
+{
+    G_OPTION_ERROR_UNKNOWN_OPTION,
+    G_OPTION_ERROR_BAD_VALUE,
+    G_OPTION_ERROR_FAILED
+} GOptionError;
+
+GOptionContext* g_option_context_new(const gchar* pParameterString);
+void g_option_context_add_main_entries(GOptionContext* pContext,
+    const GOptionEntry* pEntries, const gchar* pTranslationDomain);
+gboolean g_option_context_parse(GOptionContext* pContext, gint* pArgc,
+    gchar*** pArgv, GError** ppError);
+void g_option_context_free(GOptionContext* pContext);
+
+#endif /* _KK_MINIMAL_GLIB_H */
@@ -0,0 +1,319 @@
+#include "glib-unix.h"
+#include "glib.h"
+
+#include <errno.h>
+#include <map>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+/*
+All sources share one epoll descriptor. A timeout owns a timerfd, signals
+are read from one signalfd whose mask grows with every signal added, and
+file descriptor sources are added as they are.
+
+A signalfd only sees signals which are blocked in every thread: the signal
+is blocked in the thread calling g_unix_signal_add() and in the threads it
+starts afterwards, any thread started before must block every signal itself,
+or the signal takes its default action there. Once the last source of a
+signal is removed, the signal is unblocked in the calling thread and gets its
+default action back, as with GLib.
+*/
+
+struct _GMainLoop
+{
+        bool isRunning;
+};
+
+struct sSource
+{
+        enum eType
+        {
+            TIMEOUT,
+            SIGNAL,
+            FD
+        } type;
+        int fd;     // timerfd, watched fd or the signal number
+        GSourceFunc function;
+        GUnixFDSourceFunc fdFunction;
+        gpointer pUserData;
+};
+
+constexpr int CONST_MAX_EVENTS = 16;
+// epoll data of the shared signalfd, source ids start at 1
+constexpr guint CONST_SIGNAL_FD_TAG = 0;
+
+static int epollFd  = -1;
+static int signalFd = -1;
+static sigset_t signalMask;
+static guint nextSourceId = 1;
+static std::map<guint, struct sSource> sources;
+
+static bool initLoop(void)
+{
+    if (epollFd >= 0)
+    {
+        return true; // success
+    }
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    sigemptyset(&signalMask);
+    return epollFd >= 0;
+}
+
+static guint addSource(struct sSource source, int fd, uint32_t events)
+{
+    if (!initLoop())
+    {
+        return 0; // failure
+    }
+
+    guint id = nextSourceId++;
+    struct epoll_event event = {};
+    event.events   = events;
+    event.data.u32 = id;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+    {
+        return 0; // failure
+    }
+    sources[id] = source;
+    return id;
+}
+
+static void dispatchSignals(void)
+{
+    struct signalfd_siginfo info;
+    while (read(signalFd, &info, sizeof(info)) == sizeof(info))
+    {
+        // copied, the handler may add or remove sources
+        std::map<guint, struct sSource> handlers;
+        for (auto const & [id, source] : sources)
+        {
+            if (source.type == sSource::SIGNAL && source.fd == (int)info.ssi_signo)
+            {
+                handlers[id] = source;
+            }
+        }
+        for (auto const & [id, source] : handlers)
+        {
+            if (!source.function(source.pUserData))
+            {
+                g_source_remove(id);
+            }
+        }
+    }
+}
+
+static bool hasSignalSource(int signum)
+{
+    for (auto const & [id, source] : sources)
+    {
+        if (source.type == sSource::SIGNAL && source.fd == signum)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// the signal is delivered as before it was added, e.g. raise() terminates
+static void releaseSignal(int signum)
+{
+    sigdelset(&signalMask, signum);
+    if (signalFd >= 0)
+    {
+        signalfd(signalFd, &signalMask, SFD_NONBLOCK | SFD_CLOEXEC);
+    }
+    signal(signum, SIG_DFL);
+    sigset_t released;
+    sigemptyset(&released);
+    sigaddset(&released, signum);
+    pthread_sigmask(SIG_UNBLOCK, &released, nullptr);
+}
+
+static void dispatch(guint id, uint32_t events)
+{
+    auto found = sources.find(id);
+    if (found == sources.end())
+    {
+        return; // removed by an earlier callback of this batch
+    }
+    auto source = found->second;
+
+    gboolean keep = TRUE;
+    if (source.type == sSource::TIMEOUT)
+    {
+        uint64_t expirations;
+        if (read(source.fd, &expirations, sizeof(expirations)) < 0)
+        {
+            return; // not expired after all
+        }
+        keep = source.function(source.pUserData);
+    }
+    else
+    {
+        int condition = 0;
+        condition |= events & EPOLLIN ? G_IO_IN : 0;
+        condition |= events & EPOLLPRI ? G_IO_PRI : 0;
+        condition |= events & EPOLLOUT ? G_IO_OUT : 0;
+        condition |= events & EPOLLERR ? G_IO_ERR : 0;
+        condition |= events & EPOLLHUP ? G_IO_HUP : 0;
+        keep = source.fdFunction(
+            source.fd, (GIOCondition)condition, source.pUserData);
+    }
+
+    if (!keep)
+    {
+        g_source_remove(id);
+    }
+}
+
+// public functions
+
+GMainLoop* g_main_loop_new(GMainContext* pContext, gboolean isRunning)
+{
+    if (!initLoop())
+    {
+        return nullptr;
+    }
+    return new GMainLoop { .isRunning = isRunning != FALSE };
+}
+
+void g_main_loop_run(GMainLoop* pLoop)
+{
+    pLoop->isRunning = true;
+    struct epoll_event events[CONST_MAX_EVENTS];
+    while (pLoop->isRunning)
+    {
+        int count = epoll_wait(epollFd, events, CONST_MAX_EVENTS, -1);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            abort(); // nothing could ever wake the loop again
+        }
+        for (int i = 0; i < count && pLoop->isRunning; i++)
+        {
+            if (events[i].data.u32 == CONST_SIGNAL_FD_TAG)
+            {
+                dispatchSignals();
+            }
+            else
+            {
+                dispatch(events[i].data.u32, events[i].events);
+            }
+        }
+    }
+}
+
+void g_main_loop_quit(GMainLoop* pLoop) { pLoop->isRunning = false; }
+
+void g_main_loop_unref(GMainLoop* pLoop) { delete pLoop; }
+
+guint g_timeout_add(guint interval, GSourceFunc function, gpointer pData)
+{
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0)
+    {
+        return 0; // failure
+    }
+
+    // repeats until the callback returns FALSE, 0 fires as soon as possible
+    struct itimerspec timer = {};
+    timer.it_interval.tv_sec  = interval / 1000;
+    timer.it_interval.tv_nsec = (interval % 1000) * 1000000L;
+    timer.it_value            = timer.it_interval;
+    if (interval == 0)
+    {
+        timer.it_value.tv_nsec = 1;
+    }
+    timerfd_settime(fd, 0, &timer, nullptr);
+
+    guint id = addSource({ .type = sSource::TIMEOUT,
+                             .fd = fd,
+                             .function = function,
+                             .pUserData = pData },
+        fd, EPOLLIN);
+    if (id == 0)
+    {
+        close(fd);
+    }
+    return id;
+}
+
+guint g_unix_signal_add(gint signum, GSourceFunc handler, gpointer pUserData)
+{
+    if (!initLoop())
+    {
+        return 0; // failure
+    }
+
+    // delivered through the signalfd only, threads started later inherit it
+    sigaddset(&signalMask, signum);
+    pthread_sigmask(SIG_BLOCK, &signalMask, nullptr);
+    bool isNew = signalFd < 0;
+    signalFd = signalfd(signalFd, &signalMask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signalFd < 0)
+    {
+        return 0; // failure
+    }
+    if (isNew)
+    {
+        struct epoll_event event = {};
+        event.events   = EPOLLIN;
+        event.data.u32 = CONST_SIGNAL_FD_TAG;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, signalFd, &event);
+    }
+
+    guint id = nextSourceId++;
+    sources[id] = { .type = sSource::SIGNAL,
+        .fd = signum,
+        .function = handler,
+        .pUserData = pUserData };
+    return id;
+}
+
+guint g_unix_fd_add(gint fd, GIOCondition condition,
+    GUnixFDSourceFunc function, gpointer pUserData)
+{
+    uint32_t events = 0;
+    events |= condition & G_IO_IN ? EPOLLIN : 0;
+    events |= condition & G_IO_PRI ? EPOLLPRI : 0;
+    events |= condition & G_IO_OUT ? EPOLLOUT : 0;
+    return addSource({ .type = sSource::FD,
+                         .fd = fd,
+                         .fdFunction = function,
+                         .pUserData = pUserData },
+        fd, events);
+}
+
+gboolean g_source_remove(guint tag)
+{
+    auto found = sources.find(tag);
+    if (found == sources.end())
+    {
+        return FALSE;
+    }
+
+    auto source = found->second;
+    sources.erase(found);
+    if (source.type == sSource::TIMEOUT)
+    {
+        close(source.fd);
+    }
+    else if (source.type == sSource::FD)
+    {
+        // the descriptor stays open, it belongs to the caller
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, source.fd, nullptr);
+    }
+    else if (!hasSignalSource(source.fd))
+    {
+        releaseSignal(source.fd);
+    }
+    return TRUE;
+}
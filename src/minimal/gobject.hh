@@ -0,0 +1,12 @@
+// gobject.hh
+#ifndef _KK_MINIMAL_GOBJECT_H
+#define _KK_MINIMAL_GOBJECT_H
+
+// base of the built-in objects released with g_object_unref()
+struct _GObject
+{
+        virtual ~_GObject() = default;
+        int refCount = 1;
+};
+
+#endif /* _KK_MINIMAL_GOBJECT_H */
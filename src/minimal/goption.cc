@@ -0,0 +1,187 @@
+#include "glib.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+struct _GOptionContext
+{
+        std::string parameterString;
+        std::vector<GOptionEntry> entries;
+};
+
+static void printHelp(GOptionContext* pContext, const gchar* pProgramName)
+{
+    printf("Usage:\n  %s [OPTION...] %s\n\n", pProgramName,
+        pContext->parameterString.c_str());
+    printf("Help Options:\n  -h, --help%*sShow help options\n\n", 20, "");
+    printf("Application Options:\n");
+    for (auto const &entry : pContext->entries)
+    {
+        std::string option = entry.short_name
+            ? std::string("-") + entry.short_name + ", --" + entry.long_name
+            : std::string("--") + entry.long_name;
+        if (entry.arg != G_OPTION_ARG_NONE && entry.arg_description)
+        {
+            option += std::string("=") + entry.arg_description;
+        }
+        printf("  %-28s %s\n", option.c_str(),
+            entry.description ? entry.description : "");
+    }
+    printf("\n");
+}
+
+static bool setValue(GOptionEntry const &entry, std::string const &option,
+    const gchar* pValue, GError** ppError)
+{
+    switch (entry.arg)
+    {
+        case G_OPTION_ARG_NONE:
+            *(gboolean*)entry.arg_data = TRUE;
+            break;
+        case G_OPTION_ARG_INT:
+        {
+            char* pEnd;
+            errno     = 0;
+            long value = strtol(pValue, &pEnd, 0);
+            if (errno != 0 || pEnd == pValue || *pEnd != '\0'
+                || value != (gint)value)
+            {
+                g_set_error(ppError, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+                    "Cannot parse integer value “%s” for %s", pValue,
+                    option.c_str());
+                return false; // failure
+            }
+            *(gint*)entry.arg_data = (gint)value;
+            break;
+        }
+        case G_OPTION_ARG_STRING:
+        case G_OPTION_ARG_FILENAME:
+            g_free(*(gchar**)entry.arg_data);
+            *(gchar**)entry.arg_data = g_strdup(pValue);
+            break;
+    }
+    return true; // success
+}
+
+GOptionContext* g_option_context_new(const gchar* pParameterString)
+{
+    return new GOptionContext { .parameterString
+        = pParameterString ? pParameterString : "" };
+}
+
+void g_option_context_add_main_entries(GOptionContext* pContext,
+    const GOptionEntry* pEntries, const gchar* pTranslationDomain)
+{
+    for (; pEntries->long_name; pEntries++)
+    {
+        pContext->entries.push_back(*pEntries);
+    }
+}
+
+gboolean g_option_context_parse(
+    GOptionContext* pContext, gint* pArgc, gchar*** pArgv, GError** ppError)
+{
+    gchar** argv = *pArgv;
+    gint kept    = 1;
+
+    for (gint i = 1; i < *pArgc; i++)
+    {
+        std::string argument = argv[i];
+        if (argument == "--")
+        {
+            // everything after it is left to the caller
+            while (++i < *pArgc)
+            {
+                argv[kept++] = argv[i];
+            }
+            break;
+        }
+        if (argument.size() < 2 || argument[0] != '-')
+        {
+            argv[kept++] = argv[i];
+            continue;
+        }
+        if (argument == "-h" || argument == "--help" || argument == "-?")
+        {
+            printHelp(pContext, argv[0]);
+            exit(0);
+        }
+
+        // --name=value, --name value, -c value or -cvalue
+        const GOptionEntry* pEntry = nullptr;
+        const gchar* pValue        = nullptr;
+        std::string option;
+        if (argument[1] == '-')
+        {
+            auto equals = argument.find('=');
+            option      = argument.substr(0, equals);
+            for (auto const &entry : pContext->entries)
+            {
+                if (option.compare(2, std::string::npos, entry.long_name) == 0)
+                {
+                    pEntry = &entry;
+                }
+            }
+            if (equals != std::string::npos)
+            {
+                pValue = argv[i] + equals + 1;
+            }
+        }
+        else
+        {
+            option = argument.substr(0, 2);
+            for (auto const &entry : pContext->entries)
+            {
+                if (entry.short_name == argument[1])
+                {
+                    pEntry = &entry;
+                }
+            }
+            if (argument.size() > 2)
+            {
+                pValue = argv[i] + 2;
+            }
+        }
+
+        if (!pEntry)
+        {
+            g_set_error(ppError, G_OPTION_ERROR,
+                G_OPTION_ERROR_UNKNOWN_OPTION, "Unknown option %s",
+                argument.c_str());
+            return FALSE;
+        }
+        if (pEntry->arg == G_OPTION_ARG_NONE)
+        {
+            if (pValue)
+            {
+                g_set_error(ppError, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+                    "Unexpected argument to %s", option.c_str());
+                return FALSE;
+            }
+        }
+        else if (!pValue)
+        {
+            if (i + 1 >= *pArgc)
+            {
+                g_set_error(ppError, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+                    "Missing argument for %s", option.c_str());
+                return FALSE;
+            }
+            pValue = argv[++i];
+        }
+        if (!setValue(*pEntry, option, pValue, ppError))
+        {
+            return FALSE;
+        }
+    }
+
+    argv[kept] = nullptr;
+    *pArgc     = kept;
+    return TRUE;
+}
+
+void g_option_context_free(GOptionContext* pContext) { delete pContext; }
@@ -0,0 +1,1130 @@
+#include "gobject.hh"
+#include "json-glib/json-glib.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define JSON_ERROR 2
+
+// deeper documents are rejected rather than overflowing the stack
+constexpr int CONST_MAX_DEPTH = 512;
+
+struct _JsonNode : _GObject
+{
+        enum eValueType
+        {
+            INT,
+            DOUBLE,
+            BOOLEAN,
+            STRING
+        };
+
+        JsonNodeType type;
+        eValueType valueType = INT;
+        gint64 intValue      = 0;
+        gdouble doubleValue  = 0;
+        std::string stringValue;
+        // objects keep their members in insertion order, as json-glib does
+        std::vector<std::string> names;
+        std::vector<JsonNode*> children;
+
+        explicit _JsonNode(JsonNodeType nodeType) : type(nodeType) {}
+        ~_JsonNode()
+        {
+            for (auto pChild : children)
+            {
+                json_node_unref(pChild);
+            }
+        }
+
+        // takes the reference of pNode
+        void setMember(std::string const &name, JsonNode* pNode)
+        {
+            for (size_t i = 0; i < names.size(); i++)
+            {
+                if (names[i] == name)
+                {
+                    json_node_unref(children[i]);
+                    children[i] = pNode;
+                    return;
+                }
+            }
+            names.push_back(name);
+            children.push_back(pNode);
+        }
+
+        JsonNode* getMember(const gchar* pName)
+        {
+            for (size_t i = 0; i < names.size(); i++)
+            {
+                if (names[i] == pName)
+                {
+                    return children[i];
+                }
+            }
+            return nullptr;
+        }
+};
+
+struct _JsonParser : _GObject
+{
+        JsonNode* pRoot = nullptr;
+        ~_JsonParser()
+        {
+            if (pRoot)
+            {
+                json_node_unref(pRoot);
+            }
+        }
+};
+
+struct _JsonReader : _GObject
+{
+        JsonNode* pRoot = nullptr;
+        // the root followed by every member or element read into
+        std::vector<JsonNode*> path;
+        GError* pError = nullptr;
+        ~_JsonReader()
+        {
+            if (pRoot)
+            {
+                json_node_unref(pRoot);
+            }
+            g_error_free(pError);
+        }
+};
+
+struct _JsonBuilder : _GObject
+{
+        JsonNode* pRoot = nullptr;
+        std::vector<JsonNode*> open;
+        std::string memberName;
+        ~_JsonBuilder() { json_builder_reset(this); }
+};
+
+struct _JsonGenerator : _GObject
+{
+        JsonNode* pRoot = nullptr;
+        bool isPretty   = false;
+        guint indent    = 2;
+        ~_JsonGenerator()
+        {
+            if (pRoot)
+            {
+                json_node_unref(pRoot);
+            }
+        }
+};
+
+static const char* getTypeName(JsonNode* pNode)
+{
+    if (pNode == nullptr)
+    {
+        return "NULL";
+    }
+    switch (pNode->type)
+    {
+        case JSON_NODE_OBJECT:
+            return "JsonObject";
+        case JSON_NODE_ARRAY:
+            return "JsonArray";
+        case JSON_NODE_NULL:
+            return "NULL";
+        case JSON_NODE_VALUE:
+            break;
+    }
+    switch (pNode->valueType)
+    {
+        case _JsonNode::INT:
+            return "gint64";
+        case _JsonNode::DOUBLE:
+            return "gdouble";
+        case _JsonNode::BOOLEAN:
+            return "gboolean";
+        case _JsonNode::STRING:
+            break;
+    }
+    return "gchararray";
+}
+
+// nodes
+
+JsonNodeType json_node_get_node_type(JsonNode* pNode) { return pNode->type; }
+
+JsonArray* json_node_get_array(JsonNode* pNode)
+{
+    return pNode != nullptr && pNode->type == JSON_NODE_ARRAY ? pNode : nullptr;
+}
+
+JsonObject* json_node_get_object(JsonNode* pNode)
+{
+    return pNode != nullptr && pNode->type == JSON_NODE_OBJECT ? pNode : nullptr;
+}
+
+const gchar* json_node_get_string(JsonNode* pNode)
+{
+    if (pNode == nullptr || pNode->type != JSON_NODE_VALUE
+        || pNode->valueType != _JsonNode::STRING)
+    {
+        return nullptr;
+    }
+    return pNode->stringValue.c_str();
+}
+
+gint64 json_node_get_int(JsonNode* pNode)
+{
+    if (pNode == nullptr || pNode->type != JSON_NODE_VALUE)
+    {
+        return 0;
+    }
+    switch (pNode->valueType)
+    {
+        case _JsonNode::INT:
+        case _JsonNode::BOOLEAN:
+            return pNode->intValue;
+        case _JsonNode::DOUBLE:
+            return (gint64)pNode->doubleValue;
+        case _JsonNode::STRING:
+            break;
+    }
+    return 0;
+}
+
+JsonNode* json_node_ref(JsonNode* pNode)
+{
+    pNode->refCount++;
+    return pNode;
+}
+
+void json_node_unref(JsonNode* pNode) { g_object_unref(pNode); }
+
+guint json_array_get_length(JsonArray* pArray)
+{
+    return pArray->children.size();
+}
+
+// parser
+
+class cTextParser
+{
+    public:
+        cTextParser(const gchar* pData, size_t length)
+            : _pText(pData), _pEnd(pData + length)
+        {
+        }
+
+        JsonNode* parseDocument(std::string* pMessage)
+        {
+            skipSpace();
+            if (_pText == _pEnd)
+            {
+                *pMessage = "Empty document";
+                return nullptr;
+            }
+            JsonNode* pNode = parseValue(0);
+            skipSpace();
+            if (pNode != nullptr && _pText != _pEnd)
+            {
+                json_node_unref(pNode);
+                pNode      = nullptr;
+                _message = "Unexpected data after the root value";
+            }
+            if (pNode == nullptr)
+            {
+                *pMessage = std::to_string(_line) + ":"
+                    + std::to_string(_pText - _pLineStart + 1)
+                    + ": Parse error: " + _message;
+            }
+            return pNode;
+        }
+
+    private:
+        void skipSpace()
+        {
+            while (_pText < _pEnd
+                && (*_pText == ' ' || *_pText == '\t' || *_pText == '\n'
+                    || *_pText == '\r'))
+            {
+                if (*_pText == '\n')
+                {
+                    _line++;
+                    _pLineStart = _pText + 1;
+                }
+                _pText++;
+            }
+        }
+
+        bool skipWord(const char* pWord)
+        {
+            size_t length = strlen(pWord);
+            if ((size_t)(_pEnd - _pText) < length
+                || memcmp(_pText, pWord, length) != 0)
+            {
+                return false; // failure
+            }
+            _pText += length;
+            return true; // success
+        }
+
+        JsonNode* fail(const char* pMessage, JsonNode* pPartial = nullptr)
+        {
+            _message = pMessage;
+            if (pPartial)
+            {
+                json_node_unref(pPartial);
+            }
+            return nullptr;
+        }
+
+        JsonNode* parseValue(int depth)
+        {
+            if (depth > CONST_MAX_DEPTH)
+            {
+                return fail("Too deeply nested");
+            }
+            skipSpace();
+            if (_pText == _pEnd)
+            {
+                return fail("Unexpected end of data");
+            }
+
+            switch (*_pText)
+            {
+                case '{':
+                    return parseObject(depth);
+                case '[':
+                    return parseArray(depth);
+                case '"':
+                {
+                    auto pNode = new JsonNode(JSON_NODE_VALUE);
+                    pNode->valueType = _JsonNode::STRING;
+                    if (!parseString(&pNode->stringValue))
+                    {
+                        return fail(_message.c_str(), pNode);
+                    }
+                    return pNode;
+                }
+                case 't':
+                case 'f':
+                {
+                    bool value = *_pText == 't';
+                    if (!skipWord(value ? "true" : "false"))
+                    {
+                        return fail("Invalid literal");
+                    }
+                    auto pNode       = new JsonNode(JSON_NODE_VALUE);
+                    pNode->valueType = _JsonNode::BOOLEAN;
+                    pNode->intValue  = value;
+                    return pNode;
+                }
+                case 'n':
+                    if (!skipWord("null"))
+                    {
+                        return fail("Invalid literal");
+                    }
+                    return new JsonNode(JSON_NODE_NULL);
+                default:
+                    return parseNumber();
+            }
+        }
+
+        JsonNode* parseNumber()
+        {
+            const char* pStart = _pText;
+            bool isInteger     = true;
+            if (_pText < _pEnd && *_pText == '-')
+            {
+                _pText++;
+            }
+            while (_pText < _pEnd
+                && (isdigit((unsigned char)*_pText) || *_pText == '.'
+                    || *_pText == 'e' || *_pText == 'E' || *_pText == '+'
+                    || *_pText == '-'))
+            {
+                isInteger &= isdigit((unsigned char)*_pText) != 0;
+                _pText++;
+            }
+
+            std::string number(pStart, _pText);
+            if (number.empty() || number == "-")
+            {
+                return fail("Unexpected character");
+            }
+
+            char* pNumberEnd;
+            auto pNode = new JsonNode(JSON_NODE_VALUE);
+            if (isInteger)
+            {
+                pNode->intValue = strtoll(number.c_str(), &pNumberEnd, 10);
+            }
+            else
+            {
+                pNode->valueType   = _JsonNode::DOUBLE;
+                pNode->doubleValue = strtod(number.c_str(), &pNumberEnd);
+            }
+            if (*pNumberEnd != '\0')
+            {
+                return fail("Invalid number", pNode);
+            }
+            return pNode;
+        }
+
+        bool parseHex(unsigned* pValue)
+        {
+            if (_pEnd - _pText < 4)
+            {
+                return false; // failure
+            }
+            *pValue = 0;
+            for (int i = 0; i < 4; i++, _pText++)
+            {
+                int digit = *_pText;
+                *pValue <<= 4;
+                if (isdigit(digit))
+                    *pValue |= digit - '0';
+                else if (digit >= 'a' && digit <= 'f')
+                    *pValue |= digit - 'a' + 10;
+                else if (digit >= 'A' && digit <= 'F')
+                    *pValue |= digit - 'A' + 10;
+                else
+                    return false; // failure
+            }
+            return true; // success
+        }
+
+        static void appendUtf8(std::string* pString, unsigned codePoint)
+        {
+            if (codePoint < 0x80)
+            {
+                *pString += (char)codePoint;
+            }
+            else if (codePoint < 0x800)
+            {
+                *pString += (char)(0xc0 | (codePoint >> 6));
+                *pString += (char)(0x80 | (codePoint & 0x3f));
+            }
+            else if (codePoint < 0x10000)
+            {
+                *pString += (char)(0xe0 | (codePoint >> 12));
+                *pString += (char)(0x80 | ((codePoint >> 6) & 0x3f));
+                *pString += (char)(0x80 | (codePoint & 0x3f));
+            }
+            else
+            {
+                *pString += (char)(0xf0 | (codePoint >> 18));
+                *pString += (char)(0x80 | ((codePoint >> 12) & 0x3f));
+                *pString += (char)(0x80 | ((codePoint >> 6) & 0x3f));
+                *pString += (char)(0x80 | (codePoint & 0x3f));
+            }
+        }
+
+        bool parseString(std::string* pValue)
+        {
+            _pText++; // opening quote
+            while (_pText < _pEnd && *_pText != '"')
+            {
+                if ((unsigned char)*_pText < 0x20)
+                {
+                    _message = "Control character in string";
+                    return false; // failure
+                }
+                if (*_pText != '\\')
+                {
+                    *pValue += *_pText++;
+                    continue;
+                }
+
+                if (++_pText == _pEnd)
+                {
+                    break;
+                }
+                char escaped = *_pText++;
+                switch (escaped)
+                {
+                    case '"':
+                    case '\\':
+                    case '/':
+                        *pValue += escaped;
+                        break;
+                    case 'b':
+                        *pValue += '\b';
+                        break;
+                    case 'f':
+                        *pValue += '\f';
+                        break;
+                    case 'n':
+                        *pValue += '\n';
+                        break;
+                    case 'r':
+                        *pValue += '\r';
+                        break;
+                    case 't':
+                        *pValue += '\t';
+                        break;
+                    case 'u':
+                    {
+                        unsigned codePoint;
+                        if (!parseHex(&codePoint))
+                        {
+                            _message = "Invalid unicode escape";
+                            return false; // failure
+                        }
+                        // a high surrogate must be followed by a low one
+                        if (codePoint >= 0xd800 && codePoint < 0xdc00)
+                        {
+                            unsigned low;
+                            if (!skipWord("\\u") || !parseHex(&low)
+                                || low < 0xdc00 || low >= 0xe000)
+                            {
+                                _message = "Invalid surrogate pair";
+                                return false; // failure
+                            }
+                            codePoint = 0x10000 + ((codePoint - 0xd800) << 10)
+                                + (low - 0xdc00);
+                        }
+                        appendUtf8(pValue, codePoint);
+                        break;
+                    }
+                    default:
+                        _message = "Invalid escape";
+                        return false; // failure
+                }
+            }
+            if (_pText == _pEnd)
+            {
+                _message = "Unterminated string";
+                return false; // failure
+            }
+            _pText++; // closing quote
+            return true; // success
+        }
+
+        JsonNode* parseObject(int depth)
+        {
+            auto pNode = new JsonNode(JSON_NODE_OBJECT);
+            _pText++;
+            skipSpace();
+            if (_pText < _pEnd && *_pText == '}')
+            {
+                _pText++;
+                return pNode;
+            }
+
+            while (true)
+            {
+                skipSpace();
+                std::string name;
+                if (_pText == _pEnd || *_pText != '"')
+                {
+                    return fail("Expected a member name", pNode);
+                }
+                if (!parseString(&name))
+                {
+                    return fail(_message.c_str(), pNode);
+                }
+                skipSpace();
+                if (_pText == _pEnd || *_pText != ':')
+                {
+                    return fail("Expected ':'", pNode);
+                }
+                _pText++;
+                JsonNode* pMember = parseValue(depth + 1);
+                if (pMember == nullptr)
+                {
+                    return fail(_message.c_str(), pNode);
+                }
+                pNode->setMember(name, pMember);
+
+                skipSpace();
+                if (_pText < _pEnd && *_pText == ',')
+                {
+                    _pText++;
+                    continue;
+                }
+                if (_pText < _pEnd && *_pText == '}')
+                {
+                    _pText++;
+                    return pNode;
+                }
+                return fail("Expected ',' or '}'", pNode);
+            }
+        }
+
+        JsonNode* parseArray(int depth)
+        {
+            auto pNode = new JsonNode(JSON_NODE_ARRAY);
+            _pText++;
+            skipSpace();
+            if (_pText < _pEnd && *_pText == ']')
+            {
+                _pText++;
+                return pNode;
+            }
+
+            while (true)
+            {
+                JsonNode* pElement = parseValue(depth + 1);
+                if (pElement == nullptr)
+                {
+                    return fail(_message.c_str(), pNode);
+                }
+                pNode->children.push_back(pElement);
+
+                skipSpace();
+                if (_pText < _pEnd && *_pText == ',')
+                {
+                    _pText++;
+                    continue;
+                }
+                if (_pText < _pEnd && *_pText == ']')
+                {
+                    _pText++;
+                    return pNode;
+                }
+                return fail("Expected ',' or ']'", pNode);
+            }
+        }
+
+        const gchar* _pText;
+        const gchar* _pEnd;
+        const gchar* _pLineStart = _pText;
+        int _line                = 1;
+        std::string _message;
+};
+
+JsonParser* json_parser_new(void) { return new JsonParser(); }
+
+gboolean json_parser_load_from_data(
+    JsonParser* pParser, const gchar* pData, gssize length, GError** ppError)
+{
+    if (pParser->pRoot)
+    {
+        json_node_unref(pParser->pRoot);
+        pParser->pRoot = nullptr;
+    }
+
+    std::string message;
+    cTextParser parser(pData, length < 0 ? strlen(pData) : (size_t)length);
+    pParser->pRoot = parser.parseDocument(&message);
+    if (pParser->pRoot == nullptr)
+    {
+        g_set_error(ppError, JSON_ERROR, 0, "%s", message.c_str());
+        return FALSE;
+    }
+    return TRUE;
+}
+
+gboolean json_parser_load_from_file(
+    JsonParser* pParser, const gchar* pFileName, GError** ppError)
+{
+    gchar* pContents;
+    gsize length;
+    if (!g_file_get_contents(pFileName, &pContents, &length, ppError))
+    {
+        return FALSE;
+    }
+
+    GError* pError = nullptr;
+    gboolean ret = json_parser_load_from_data(pParser, pContents, length, &pError);
+    g_free(pContents);
+    if (!ret)
+    {
+        // prefixed with the file name, as json-glib does
+        g_set_error(ppError, JSON_ERROR, 0, "%s:%s", pFileName, pError->message);
+        g_error_free(pError);
+    }
+    return ret;
+}
+
+JsonNode* json_parser_get_root(JsonParser* pParser) { return pParser->pRoot; }
+
+// reader
+
+static gboolean setReaderError(JsonReader* pReader, const gchar* pFormat,
+    const gchar* pArgument)
+{
+    g_set_error(&pReader->pError, JSON_ERROR, 0, pFormat, pArgument);
+    return FALSE;
+}
+
+static JsonNode* getCurrent(JsonReader* pReader)
+{
+    return pReader->path.empty() ? nullptr : pReader->path.back();
+}
+
+JsonReader* json_reader_new(JsonNode* pRoot)
+{
+    auto pReader = new JsonReader();
+    if (pRoot)
+    {
+        pReader->pRoot = json_node_ref(pRoot);
+        pReader->path.push_back(pRoot);
+    }
+    return pReader;
+}
+
+const GError* json_reader_get_error(JsonReader* pReader)
+{
+    return pReader->pError;
+}
+
+gboolean json_reader_read_member(JsonReader* pReader, const gchar* pName)
+{
+    if (pReader->pError)
+    {
+        return FALSE;
+    }
+
+    JsonNode* pCurrent = getCurrent(pReader);
+    if (pCurrent == nullptr || pCurrent->type != JSON_NODE_OBJECT)
+    {
+        return setReaderError(pReader,
+            "The current node is of type “%s”, but an object was expected.",
+            getTypeName(pCurrent));
+    }
+    JsonNode* pMember = pCurrent->getMember(pName);
+    if (pMember == nullptr)
+    {
+        return setReaderError(pReader,
+            "The member “%s” is not defined in the object at the current "
+            "position.",
+            pName);
+    }
+    pReader->path.push_back(pMember);
+    return TRUE;
+}
+
+static void endReaderLevel(JsonReader* pReader)
+{
+    // a failed read did not move, the error is cleared instead
+    if (pReader->pError)
+    {
+        g_error_free(pReader->pError);
+        pReader->pError = nullptr;
+        return;
+    }
+    if (pReader->path.size() > 1)
+    {
+        pReader->path.pop_back();
+    }
+}
+
+void json_reader_end_member(JsonReader* pReader) { endReaderLevel(pReader); }
+
+gboolean json_reader_read_element(JsonReader* pReader, guint index)
+{
+    if (pReader->pError)
+    {
+        return FALSE;
+    }
+
+    JsonNode* pCurrent = getCurrent(pReader);
+    if (pCurrent == nullptr
+        || (pCurrent->type != JSON_NODE_ARRAY
+            && pCurrent->type != JSON_NODE_OBJECT))
+    {
+        return setReaderError(pReader,
+            "The current node is of type “%s”, but an array or an object "
+            "was expected.",
+            getTypeName(pCurrent));
+    }
+    if (index >= pCurrent->children.size())
+    {
+        std::string indexText = std::to_string(index);
+        return setReaderError(pReader,
+            "The index “%s” is greater than the size of the array at the "
+            "current position.",
+            indexText.c_str());
+    }
+    pReader->path.push_back(pCurrent->children[index]);
+    return TRUE;
+}
+
+void json_reader_end_element(JsonReader* pReader) { endReaderLevel(pReader); }
+
+gint json_reader_count_elements(JsonReader* pReader)
+{
+    JsonNode* pCurrent = getCurrent(pReader);
+    if (pReader->pError)
+    {
+        return -1;
+    }
+    if (pCurrent == nullptr || pCurrent->type != JSON_NODE_ARRAY)
+    {
+        setReaderError(pReader,
+            "The current position holds a “%s” and not an array",
+            getTypeName(pCurrent));
+        return -1;
+    }
+    return pCurrent->children.size();
+}
+
+gint json_reader_count_members(JsonReader* pReader)
+{
+    JsonNode* pCurrent = getCurrent(pReader);
+    if (pReader->pError)
+    {
+        return -1;
+    }
+    if (pCurrent == nullptr || pCurrent->type != JSON_NODE_OBJECT)
+    {
+        setReaderError(pReader,
+            "The current position holds a “%s” and not an object",
+            getTypeName(pCurrent));
+        return -1;
+    }
+    return pCurrent->children.size();
+}
+
+gchar** json_reader_list_members(JsonReader* pReader)
+{
+    if (json_reader_count_members(pReader) < 0)
+    {
+        return nullptr;
+    }
+
+    auto &names   = getCurrent(pReader)->names;
+    auto ppMembers = (gchar**)g_malloc((names.size() + 1) * sizeof(gchar*));
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        ppMembers[i] = g_strdup(names[i].c_str());
+    }
+    ppMembers[names.size()] = nullptr;
+    return ppMembers;
+}
+
+gboolean json_reader_is_array(JsonReader* pReader)
+{
+    JsonNode* pCurrent = getCurrent(pReader);
+    return pCurrent != nullptr && pCurrent->type == JSON_NODE_ARRAY;
+}
+
+gboolean json_reader_is_object(JsonReader* pReader)
+{
+    JsonNode* pCurrent = getCurrent(pReader);
+    return pCurrent != nullptr && pCurrent->type == JSON_NODE_OBJECT;
+}
+
+gboolean json_reader_is_value(JsonReader* pReader)
+{
+    JsonNode* pCurrent = getCurrent(pReader);
+    return pCurrent != nullptr
+        && (pCurrent->type == JSON_NODE_VALUE
+            || pCurrent->type == JSON_NODE_NULL);
+}
+
+JsonNode* json_reader_get_value(JsonReader* pReader)
+{
+    if (pReader->pError)
+    {
+        return nullptr;
+    }
+    if (!json_reader_is_value(pReader))
+    {
+        setReaderError(pReader,
+            "The current position holds a “%s” and not a value",
+            getTypeName(getCurrent(pReader)));
+        return nullptr;
+    }
+    return getCurrent(pReader);
+}
+
+JsonNode* json_reader_get_current_node(JsonReader* pReader)
+{
+    return pReader->pError ? nullptr : getCurrent(pReader);
+}
+
+gint64 json_reader_get_int_value(JsonReader* pReader)
+{
+    return json_node_get_int(json_reader_get_value(pReader));
+}
+
+const gchar* json_reader_get_string_value(JsonReader* pReader)
+{
+    JsonNode* pValue = json_reader_get_value(pReader);
+    if (pValue == nullptr)
+    {
+        return nullptr;
+    }
+    if (json_node_get_string(pValue) == nullptr)
+    {
+        setReaderError(pReader,
+            "The current position holds a “%s” and not a string",
+            getTypeName(pValue));
+        return nullptr;
+    }
+    return json_node_get_string(pValue);
+}
+
+// builder
+
+static void addToBuilder(JsonBuilder* pBuilder, JsonNode* pNode)
+{
+    if (pBuilder->open.empty())
+    {
+        if (pBuilder->pRoot)
+        {
+            json_node_unref(pBuilder->pRoot);
+        }
+        pBuilder->pRoot = pNode;
+        return;
+    }
+
+    JsonNode* pParent = pBuilder->open.back();
+    if (pParent->type == JSON_NODE_OBJECT)
+    {
+        pParent->setMember(pBuilder->memberName, pNode);
+        pBuilder->memberName.clear();
+    }
+    else
+    {
+        pParent->children.push_back(pNode);
+    }
+}
+
+JsonBuilder* json_builder_new(void) { return new JsonBuilder(); }
+
+JsonBuilder* json_builder_begin_object(JsonBuilder* pBuilder)
+{
+    auto pNode = new JsonNode(JSON_NODE_OBJECT);
+    addToBuilder(pBuilder, pNode);
+    pBuilder->open.push_back(pNode);
+    return pBuilder;
+}
+
+JsonBuilder* json_builder_end_object(JsonBuilder* pBuilder)
+{
+    if (pBuilder->open.empty() || pBuilder->open.back()->type != JSON_NODE_OBJECT)
+    {
+        return nullptr;
+    }
+    pBuilder->open.pop_back();
+    return pBuilder;
+}
+
+JsonBuilder* json_builder_begin_array(JsonBuilder* pBuilder)
+{
+    auto pNode = new JsonNode(JSON_NODE_ARRAY);
+    addToBuilder(pBuilder, pNode);
+    pBuilder->open.push_back(pNode);
+    return pBuilder;
+}
+
+JsonBuilder* json_builder_end_array(JsonBuilder* pBuilder)
+{
+    if (pBuilder->open.empty() || pBuilder->open.back()->type != JSON_NODE_ARRAY)
+    {
+        return nullptr;
+    }
+    pBuilder->open.pop_back();
+    return pBuilder;
+}
+
+JsonBuilder* json_builder_set_member_name(
+    JsonBuilder* pBuilder, const gchar* pName)
+{
+    pBuilder->memberName = pName;
+    return pBuilder;
+}
+
+JsonBuilder* json_builder_add_int_value(JsonBuilder* pBuilder, gint64 value)
+{
+    auto pNode      = new JsonNode(JSON_NODE_VALUE);
+    pNode->intValue = value;
+    addToBuilder(pBuilder, pNode);
+    return pBuilder;
+}
+
+JsonBuilder* json_builder_add_string_value(
+    JsonBuilder* pBuilder, const gchar* pValue)
+{
+    auto pNode         = new JsonNode(JSON_NODE_VALUE);
+    pNode->valueType   = _JsonNode::STRING;
+    pNode->stringValue = pValue != nullptr ? pValue : "";
+    addToBuilder(pBuilder, pNode);
+    return pBuilder;
+}
+
+JsonNode* json_builder_get_root(JsonBuilder* pBuilder)
+{
+    if (pBuilder->pRoot == nullptr || !pBuilder->open.empty())
+    {
+        return nullptr;
+    }
+    return json_node_ref(pBuilder->pRoot);
+}
+
+void json_builder_reset(JsonBuilder* pBuilder)
+{
+    if (pBuilder->pRoot)
+    {
+        json_node_unref(pBuilder->pRoot);
+    }
+    pBuilder->pRoot = nullptr;
+    pBuilder->open.clear();
+    pBuilder->memberName.clear();
+}
+
+// generator
+
+static void appendEscaped(std::string* pBuffer, std::string const &text)
+{
+    for (unsigned char character : text)
+    {
+        switch (character)
+        {
+            case '"':
+                *pBuffer += "\\\"";
+                break;
+            case '\\':
+                *pBuffer += "\\\\";
+                break;
+            case '\b':
+                *pBuffer += "\\b";
+                break;
+            case '\f':
+                *pBuffer += "\\f";
+                break;
+            case '\n':
+                *pBuffer += "\\n";
+                break;
+            case '\r':
+                *pBuffer += "\\r";
+                break;
+            case '\t':
+                *pBuffer += "\\t";
+                break;
+            default:
+                if (character < 0x20)
+                {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", character);
+                    *pBuffer += escaped;
+                }
+                else
+                {
+                    *pBuffer += (char)character;
+                }
+        }
+    }
+}
+
+static void appendValue(std::string* pBuffer, JsonNode* pNode)
+{
+    char number[32];
+    switch (pNode->valueType)
+    {
+        case _JsonNode::INT:
+            snprintf(number, sizeof(number), "%lld", (long long)pNode->intValue);
+            *pBuffer += number;
+            break;
+        case _JsonNode::DOUBLE:
+            snprintf(number, sizeof(number), "%.17g", pNode->doubleValue);
+            *pBuffer += number;
+            // doubles are kept apart from integers
+            if (strpbrk(number, ".eEn") == nullptr)
+            {
+                *pBuffer += ".0";
+            }
+            break;
+        case _JsonNode::BOOLEAN:
+            *pBuffer += pNode->intValue ? "true" : "false";
+            break;
+        case _JsonNode::STRING:
+            *pBuffer += '"';
+            appendEscaped(pBuffer, pNode->stringValue);
+            *pBuffer += '"';
+            break;
+    }
+}
+
+static void appendNode(JsonGenerator* pGenerator, std::string* pBuffer,
+    guint level, const std::string* pName, JsonNode* pNode)
+{
+    bool isPretty = pGenerator->isPretty;
+    if (isPretty)
+    {
+        pBuffer->append(level * pGenerator->indent, ' ');
+    }
+    if (pName)
+    {
+        *pBuffer += '"';
+        appendEscaped(pBuffer, *pName);
+        *pBuffer += isPretty ? "\" : " : "\":";
+    }
+
+    if (pNode->type == JSON_NODE_NULL)
+    {
+        *pBuffer += "null";
+        return;
+    }
+    if (pNode->type == JSON_NODE_VALUE)
+    {
+        appendValue(pBuffer, pNode);
+        return;
+    }
+
+    bool isObject = pNode->type == JSON_NODE_OBJECT;
+    *pBuffer += isObject ? '{' : '[';
+    if (isPretty)
+    {
+        *pBuffer += '\n';
+    }
+    for (size_t i = 0; i < pNode->children.size(); i++)
+    {
+        appendNode(pGenerator, pBuffer, level + 1,
+            isObject ? &pNode->names[i] : nullptr, pNode->children[i]);
+        if (i + 1 != pNode->children.size())
+        {
+            *pBuffer += ',';
+        }
+        if (isPretty)
+        {
+            *pBuffer += '\n';
+        }
+    }
+    if (isPretty)
+    {
+        pBuffer->append(level * pGenerator->indent, ' ');
+    }
+    *pBuffer += isObject ? '}' : ']';
+}
+
+JsonGenerator* json_generator_new(void) { return new JsonGenerator(); }
+
+void json_generator_set_pretty(JsonGenerator* pGenerator, gboolean isPretty)
+{
+    pGenerator->isPretty = isPretty;
+}
+
+void json_generator_set_indent(JsonGenerator* pGenerator, guint indentLevel)
+{
+    pGenerator->indent = indentLevel;
+}
+
+void json_generator_set_root(JsonGenerator* pGenerator, JsonNode* pNode)
+{
+    if (pGenerator->pRoot)
+    {
+        json_node_unref(pGenerator->pRoot);
+    }
+    pGenerator->pRoot = pNode ? json_node_ref(pNode) : nullptr;
+}
+
+gchar* json_generator_to_data(JsonGenerator* pGenerator, gsize* pLength)
+{
+    std::string buffer;
+    if (pGenerator->pRoot)
+    {
+        appendNode(pGenerator, &buffer, 0, nullptr, pGenerator->pRoot);
+    }
+    if (pLength)
+    {
+        *pLength = buffer.size();
+    }
+    return g_strdup(buffer.c_str());
+}
@@ -0,0 +1,93 @@
+// json-glib.h
+#ifndef _KK_MINIMAL_JSON_GLIB_H
+#define _KK_MINIMAL_JSON_GLIB_H
+
+/*
+The part of the json-glib API KrillKounter uses, for KK_MINIMAL builds.
+
+The reader keeps json-glib's error semantics: a failed read leaves the
+position unchanged and sets an error, which the next end_member() or
+end_element() clears instead of moving up. The generator writes the same
+text as json-glib, so stats files are interchangeable between builds.
+*/
+
+#include <glib.h>
+
+// everything the daemon needs is available
+#define JSON_CHECK_VERSION(major, minor, micro) 1
+
+typedef enum
+{
+    JSON_NODE_OBJECT,
+    JSON_NODE_ARRAY,
+    JSON_NODE_VALUE,
+    JSON_NODE_NULL
+} JsonNodeType;
+
+typedef struct _JsonNode JsonNode;
+// arrays and objects are nodes, their accessors take the node itself
+typedef struct _JsonNode JsonArray;
+typedef struct _JsonNode JsonObject;
+typedef struct _JsonParser JsonParser;
+typedef struct _JsonReader JsonReader;
+typedef struct _JsonBuilder JsonBuilder;
+typedef struct _JsonGenerator JsonGenerator;
+
+// nodes
+JsonNodeType json_node_get_node_type(JsonNode* pNode);
+JsonArray* json_node_get_array(JsonNode* pNode);
+JsonObject* json_node_get_object(JsonNode* pNode);
+const gchar* json_node_get_string(JsonNode* pNode);
+gint64 json_node_get_int(JsonNode* pNode);
+JsonNode* json_node_ref(JsonNode* pNode);
+void json_node_unref(JsonNode* pNode);
+guint json_array_get_length(JsonArray* pArray);
+
+// parser
+JsonParser* json_parser_new(void);
+gboolean json_parser_load_from_file(
+    JsonParser* pParser, const gchar* pFileName, GError** ppError);
+gboolean json_parser_load_from_data(JsonParser* pParser, const gchar* pData,
+    gssize length, GError** ppError);
+JsonNode* json_parser_get_root(JsonParser* pParser);
+
+// reader
+JsonReader* json_reader_new(JsonNode* pRoot);
+const GError* json_reader_get_error(JsonReader* pReader);
+gboolean json_reader_read_member(JsonReader* pReader, const gchar* pName);
+void json_reader_end_member(JsonReader* pReader);
+gboolean json_reader_read_element(JsonReader* pReader, guint index);
+void json_reader_end_element(JsonReader* pReader);
+gint json_reader_count_elements(JsonReader* pReader);
+gint json_reader_count_members(JsonReader* pReader);
+gchar** json_reader_list_members(JsonReader* pReader);
+gboolean json_reader_is_array(JsonReader* pReader);
+gboolean json_reader_is_object(JsonReader* pReader);
+gboolean json_reader_is_value(JsonReader* pReader);
+JsonNode* json_reader_get_value(JsonReader* pReader);
+JsonNode* json_reader_get_current_node(JsonReader* pReader);
+gint64 json_reader_get_int_value(JsonReader* pReader);
+const gchar* json_reader_get_string_value(JsonReader* pReader);
+
+// builder
+JsonBuilder* json_builder_new(void);
+JsonBuilder* json_builder_begin_object(JsonBuilder* pBuilder);
+JsonBuilder* json_builder_end_object(JsonBuilder* pBuilder);
+JsonBuilder* json_builder_begin_array(JsonBuilder* pBuilder);
+JsonBuilder* json_builder_end_array(JsonBuilder* pBuilder);
+JsonBuilder* json_builder_set_member_name(
+    JsonBuilder* pBuilder, const gchar* pName);
+JsonBuilder* json_builder_add_int_value(JsonBuilder* pBuilder, gint64 value);
+JsonBuilder* json_builder_add_string_value(
+    JsonBuilder* pBuilder, const gchar* pValue);
+JsonNode* json_builder_get_root(JsonBuilder* pBuilder);
+void json_builder_reset(JsonBuilder* pBuilder);
+
+// generator
+JsonGenerator* json_generator_new(void);
+void json_generator_set_pretty(JsonGenerator* pGenerator, gboolean isPretty);
+void json_generator_set_indent(JsonGenerator* pGenerator, guint indentLevel);
+void json_generator_set_root(JsonGenerator* pGenerator, JsonNode* pNode);
+gchar* json_generator_to_data(JsonGenerator* pGenerator, gsize* pLength);
+
+#endif /* _KK_MINIMAL_JSON_GLIB_H */
@@ -0,0 +1,108 @@
+#include "alloc-count.hh"
+
+#include <errno.h>
+#include <new>
+#include <stdlib.h>
+
+#ifdef KK_COUNT_ALLOCATIONS
+
+/*
+malloc() and friends are defined here and forward to the allocator of
+glibc, the dynamic linker resolves every library of the process to these
+definitions rather than those of libc.so. operator new is replaced as
+well, so it is counted even if the C++ runtime doesn't allocate through
+malloc().
+*/
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pMemory, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* pMemory);
+}
+
+// per thread, e.g. the log drain thread allocates in syslog(); initial-exec
+// as a TLS block allocated on first use would recurse into malloc()
+static thread_local unsigned long allocationCount
+    __attribute__((tls_model("initial-exec")));
+
+static void countAllocation(void)
+{
+    allocationCount++;
+}
+
+extern "C" void* malloc(size_t size)
+{
+    countAllocation();
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size)
+{
+    countAllocation();
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pMemory, size_t size)
+{
+    countAllocation();
+    return __libc_realloc(pMemory, size);
+}
+
+extern "C" void free(void* pMemory) { __libc_free(pMemory); }
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size)
+{
+    countAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void** ppMemory, size_t alignment, size_t size)
+{
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+    countAllocation();
+    *ppMemory = __libc_memalign(alignment, size);
+    return *ppMemory == nullptr ? ENOMEM : 0;
+}
+
+void* operator new(size_t size)
+{
+    auto pMemory = malloc(size == 0 ? 1 : size);
+    if (pMemory == nullptr)
+        throw std::bad_alloc();
+    return pMemory;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return malloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void* pMemory) noexcept { free(pMemory); }
+
+void operator delete[](void* pMemory) noexcept { free(pMemory); }
+
+void operator delete(void* pMemory, size_t) noexcept { free(pMemory); }
+
+void operator delete[](void* pMemory, size_t) noexcept { free(pMemory); }
+
+bool AllocCountIsEnabled(void) { return true; }
+
+unsigned long AllocCountGet(void) { return allocationCount; }
+
+#else
+
+bool AllocCountIsEnabled(void) { return false; }
+
+unsigned long AllocCountGet(void) { return 0; }
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef _ALLOC_COUNT_H
+#define _ALLOC_COUNT_H
+
+/* Built with -DKK_COUNT_ALLOCATIONS=ON, every operator new, malloc(),
+   calloc(), realloc() and aligned allocation of the process is counted per
+   thread, so a test run can tell whether a piece of code allocates.
+   Otherwise the count stays 0 */
+
+bool AllocCountIsEnabled(void);
+// allocations made by the calling thread so far
+unsigned long AllocCountGet(void);
+
+#endif /*_ALLOC_COUNT_H */
@@ -1,23 +1,207 @@
 #include <glib.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdarg>
 #include <iostream>
+#include <mutex>
+#include <pthread.h>
+#include <signal.h>
+#include <thread>
 
 #include "log-event.hh"
 
+/*
+Messages are formatted on the calling thread into a preallocated ring of
+records and handed to syslog by a background thread. They are formatted by
+the caller rather than the drain thread because the arguments, e.g. the
+c_str() of a temporary, don't outlive the call. The ring is a bounded
+multi-producer queue in which every slot carries a sequence number
+(D. Vyukov), producers never block: a message is dropped and counted when
+the ring is full or the rate limit of the drain thread is exceeded. Errors
+are never dropped, with the ring full they are written by the caller, ahead
+of the messages still queued. Messages are truncated to
+CONST_LOG_MESSAGE_SIZE - 1 bytes.
+
+The drain thread sleeps without a timeout while the ring is empty. The
+first message queued after it went to sleep wakes it, it then lets the
+burst gather for CONST_LOG_BATCH_DELAY, so a burst costs one wakeup.
+*/
+
+constexpr unsigned int CONST_LOG_RING_SIZE    = 128; // power of two
+constexpr unsigned int CONST_LOG_MESSAGE_SIZE = 480;
+constexpr unsigned int CONST_LOG_RATE_PER_SECOND = 50;
+constexpr unsigned int CONST_LOG_RATE_BURST      = 200;
+constexpr auto CONST_LOG_BATCH_DELAY = std::chrono::milliseconds(50);
+// dropped messages are reported at most this often
+constexpr auto CONST_LOG_DROP_REPORT_PERIOD = std::chrono::seconds(1);
+
+struct sLogRecord
+{
+        std::atomic<unsigned long> sequence;
+        int level;
+        int line;
+        const char* pFunc;
+        char message[CONST_LOG_MESSAGE_SIZE];
+};
+
 static int currentLevel = LOG_INFO;
 
+static sLogRecord logRing[CONST_LOG_RING_SIZE];
+static std::atomic<unsigned long> enqueuePosition;
+static unsigned long dequeuePosition;
+static std::atomic<unsigned long> droppedMessages;
+static std::atomic<bool> drainRunning;
+static std::atomic<bool> drainWaiting;
+static std::mutex drainMutex;
+static std::condition_variable drainWakeup;
+static std::thread drainThread;
+
+static bool dequeueRecord(sLogRecord** ppRecord)
+{
+    auto pRecord  = &logRing[dequeuePosition & (CONST_LOG_RING_SIZE - 1)];
+    auto sequence = pRecord->sequence.load(std::memory_order_acquire);
+    if (sequence != dequeuePosition + 1)
+    {
+        return false; // empty
+    }
+    *ppRecord = pRecord;
+    return true; // success
+}
+
+static void releaseRecord(sLogRecord* pRecord)
+{
+    pRecord->sequence.store(
+        dequeuePosition + CONST_LOG_RING_SIZE, std::memory_order_release);
+    dequeuePosition++;
+}
+
+static void drainLog(void)
+{
+    // signals are left to the main loop
+    sigset_t signals;
+    sigfillset(&signals);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    auto tokens         = (double)CONST_LOG_RATE_BURST;
+    auto lastRefill     = std::chrono::steady_clock::now();
+    unsigned long reportedDrops = 0;
+    auto lastDropReport = lastRefill;
+
+    while (true)
+    {
+        bool running = drainRunning.load(std::memory_order_acquire);
+
+        auto now = std::chrono::steady_clock::now();
+        tokens += std::chrono::duration<double>(now - lastRefill).count()
+            * CONST_LOG_RATE_PER_SECOND;
+        if (tokens > CONST_LOG_RATE_BURST)
+            tokens = CONST_LOG_RATE_BURST;
+        lastRefill = now;
+
+        sLogRecord* pRecord;
+        while (dequeueRecord(&pRecord))
+        {
+            // errors are never rate limited
+            if (tokens >= 1.0 || pRecord->level <= LOG_ERR || !running)
+            {
+                syslog(pRecord->level, "[%s:%d]: %s", pRecord->pFunc,
+                    pRecord->line, pRecord->message);
+                tokens -= 1.0;
+            }
+            else
+            {
+                droppedMessages.fetch_add(1, std::memory_order_relaxed);
+            }
+            releaseRecord(pRecord);
+        }
+
+        auto dropped = droppedMessages.load(std::memory_order_relaxed);
+        if (dropped != reportedDrops
+            && (now - lastDropReport >= CONST_LOG_DROP_REPORT_PERIOD
+                || !running))
+        {
+            lastDropReport = now;
+            syslog(LOG_WARNING, "%lu log messages dropped",
+                dropped - reportedDrops);
+            reportedDrops = dropped;
+        }
+
+        if (!running)
+            break;
+
+        // a message published after the check finds drainWaiting set, a
+        // pending drop report bounds the wait
+        {
+            std::unique_lock<std::mutex> lock(drainMutex);
+            while (drainRunning.load(std::memory_order_acquire))
+            {
+                drainWaiting.store(true, std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (dequeueRecord(&pRecord))
+                    break;
+                if (droppedMessages.load(std::memory_order_relaxed)
+                    == reportedDrops)
+                    drainWakeup.wait(lock);
+                else if (drainWakeup.wait_until(lock,
+                             lastDropReport + CONST_LOG_DROP_REPORT_PERIOD)
+                    == std::cv_status::timeout)
+                    break;
+            }
+            drainWaiting.store(false, std::memory_order_relaxed);
+        }
+        if (drainRunning.load(std::memory_order_acquire))
+            std::this_thread::sleep_for(CONST_LOG_BATCH_DELAY);
+    }
+}
+
+static void wakeDrain(void)
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (drainWaiting.exchange(false, std::memory_order_seq_cst))
+    {
+        std::lock_guard<std::mutex> lock(drainMutex);
+        drainWakeup.notify_one();
+    }
+}
+
 void LogEventInit(const char* pName, int logLevel)
 {
     openlog(pName, LOG_CONS | LOG_PID | LOG_NDELAY, LOG_USER);
     currentLevel = logLevel;
+
+    for (unsigned long i = 0; i < CONST_LOG_RING_SIZE; i++)
+    {
+        logRing[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    enqueuePosition.store(0, std::memory_order_relaxed);
+    dequeuePosition = 0;
+
+    drainRunning.store(true, std::memory_order_release);
+    drainThread = std::thread(drainLog);
 }
 
 void LogEventDeinit(void)
 {
+    if (drainThread.joinable())
+    {
+        // the drain thread flushes what is left before it exits
+        drainRunning.store(false, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(drainMutex);
+            drainWakeup.notify_one();
+        }
+        drainThread.join();
+    }
     closelog();
 }
 
+unsigned long LogEventGetDropped(void)
+{
+    return droppedMessages.load(std::memory_order_relaxed);
+}
+
 void LogEventFunction(int logLevel, const char* pFunc, const int line, const char* pFormat, ...)
 {
     if (G_UNLIKELY(logLevel <= currentLevel))
@@ -25,13 +209,60 @@ void LogEventFunction(int logLevel, const char* pFunc, const int line, const cha
         va_list args;
         va_start(args, pFormat);
 
-        char message[4096];
+        // not initialised, e.g. used through the library only
+        if (!drainRunning.load(std::memory_order_acquire))
+        {
+            char message[CONST_LOG_MESSAGE_SIZE];
+            vsnprintf(message, sizeof(message), pFormat, args);
+            va_end(args);
+            syslog(logLevel, "[%s:%d]: %s", pFunc, line, message);
+            return;
+        }
 
-        vsnprintf(message, sizeof(message), pFormat, args);
+        // claim a slot
+        sLogRecord* pRecord;
+        auto position = enqueuePosition.load(std::memory_order_relaxed);
+        while (true)
+        {
+            pRecord       = &logRing[position & (CONST_LOG_RING_SIZE - 1)];
+            auto sequence = pRecord->sequence.load(std::memory_order_acquire);
+            auto difference = (long)(sequence - position);
+            if (difference == 0)
+            {
+                if (enqueuePosition.compare_exchange_weak(
+                        position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (difference < 0)
+            {
+                // ring full, an error is written at the cost of a syscall
+                if (logLevel <= LOG_ERR)
+                {
+                    char message[CONST_LOG_MESSAGE_SIZE];
+                    vsnprintf(message, sizeof(message), pFormat, args);
+                    syslog(logLevel, "[%s:%d]: %s", pFunc, line, message);
+                }
+                else
+                {
+                    droppedMessages.fetch_add(1, std::memory_order_relaxed);
+                }
+                va_end(args);
+                return;
+            }
+            else
+            {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
 
+        pRecord->level = logLevel;
+        pRecord->line  = line;
+        pRecord->pFunc = pFunc;
+        vsnprintf(pRecord->message, sizeof(pRecord->message), pFormat, args);
         va_end(args);
 
-        syslog(logLevel, "[%s:%d]: %s", pFunc, line, message);
-
+        // publish
+        pRecord->sequence.store(position + 1, std::memory_order_release);
+        wakeDrain();
     }
-}
\ No newline at end of file
+}
@@ -4,10 +4,23 @@
 #include <stdio.h>
 #include <syslog.h>
 
-#define LOG_EVENT(level, format, ...) LogEventFunction(level, __func__, __LINE__, format, ##__VA_ARGS__)
+/* Messages less severe than KK_LOG_LEVEL_MAX are removed at compile time,
+   set it with -DKK_LOG_LEVEL_MAX=<syslog level> when configuring */
+#ifndef KK_LOG_LEVEL_MAX
+#define KK_LOG_LEVEL_MAX LOG_DEBUG
+#endif
+
+#define LOG_EVENT(level, format, ...)                                         \
+    do                                                                        \
+    {                                                                         \
+        if constexpr ((level) <= KK_LOG_LEVEL_MAX)                            \
+            LogEventFunction(level, __func__, __LINE__, format, ##__VA_ARGS__); \
+    } while (0)
 
 void LogEventInit(const char* pName, int logLevel);
 void LogEventDeinit(void);
-void LogEventFunction(int logLevel, const char* pFunc, const int line, const char* pFormat, ...);
+void LogEventFunction(int logLevel, const char* pFunc, const int line, const char* pFormat, ...)
+    __attribute__((format(printf, 4, 5)));
+unsigned long LogEventGetDropped(void);
 
 #endif /*_LOG_EVENT_H */
@@ -0,0 +1,80 @@
+#include "trace-codec.hh"
+
+#include <array>
+
+// public functions
+
+void TraceCodecPutVarint(std::string* pBuffer, guint64 value)
+{
+    while (value >= 0x80)
+    {
+        pBuffer->push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    pBuffer->push_back((char)value);
+}
+
+bool TraceCodecGetVarint(
+    const guint8** ppData, const guint8* pEnd, guint64* pValue)
+{
+    guint64 value = 0;
+    for (guint shift = 0; shift < 64; shift += 7)
+    {
+        if (*ppData >= pEnd)
+            return false; // failure, truncated
+        guint8 byte = *(*ppData)++;
+        value |= (guint64)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            *pValue = value;
+            return true; // success
+        }
+    }
+    return false; // failure, too long
+}
+
+void TraceCodecPutUint16(std::string* pBuffer, guint16 value)
+{
+    for (guint i = 0; i < 2; i++)
+        pBuffer->push_back((char)(value >> (8 * i)));
+}
+
+void TraceCodecPutUint32(std::string* pBuffer, guint32 value)
+{
+    // little endian, traces are read on other machines
+    for (guint i = 0; i < 4; i++)
+        pBuffer->push_back((char)(value >> (8 * i)));
+}
+
+void TraceCodecPutUint64(std::string* pBuffer, guint64 value)
+{
+    for (guint i = 0; i < 8; i++)
+        pBuffer->push_back((char)(value >> (8 * i)));
+}
+
+guint32 TraceCodecGetUint32(const guint8* pData)
+{
+    return pData[0] | (pData[1] << 8) | (pData[2] << 16)
+        | ((guint32)pData[3] << 24);
+}
+
+guint32 TraceCodecCrc32(const void* pData, gsize length)
+{
+    static const auto table = [] {
+        std::array<guint32, 256> entries;
+        for (guint32 i = 0; i < 256; i++)
+        {
+            guint32 crc = i;
+            for (guint bit = 0; bit < 8; bit++)
+                crc = crc & 1 ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+            entries[i] = crc;
+        }
+        return entries;
+    }();
+
+    guint32 crc = 0xffffffff;
+    auto pBytes = (const guint8*)pData;
+    for (gsize i = 0; i < length; i++)
+        crc = table[(crc ^ pBytes[i]) & 0xff] ^ (crc >> 8);
+    return crc ^ 0xffffffff;
+}
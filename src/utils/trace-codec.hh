@@ -0,0 +1,30 @@
+#ifndef _TRACE_CODEC_H
+#define _TRACE_CODEC_H
+
+#include <glib.h>
+#include <string>
+
+/* Building blocks of the binary trace written by --record and of the binary
+   dump: LEB128 varints, zig-zag mapping of signed values, little endian
+   integers and CRC-32 (IEEE 802.3) */
+
+inline guint64 TraceCodecZigZag(gint64 value)
+{
+    return ((guint64)value << 1) ^ (guint64)(value >> 63);
+}
+
+inline gint64 TraceCodecUnZigZag(guint64 value)
+{
+    return (gint64)(value >> 1) ^ -(gint64)(value & 1);
+}
+
+void TraceCodecPutVarint(std::string* pBuffer, guint64 value);
+bool TraceCodecGetVarint(
+    const guint8** ppData, const guint8* pEnd, guint64* pValue);
+void TraceCodecPutUint16(std::string* pBuffer, guint16 value);
+void TraceCodecPutUint32(std::string* pBuffer, guint32 value);
+void TraceCodecPutUint64(std::string* pBuffer, guint64 value);
+guint32 TraceCodecGetUint32(const guint8* pData);
+guint32 TraceCodecCrc32(const void* pData, gsize length);
+
+#endif /*_TRACE_CODEC_H */
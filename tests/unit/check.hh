@@ -0,0 +1,23 @@
+// check.hh
+#ifndef _CHECK_H
+#define _CHECK_H
+
+#include <stdio.h>
+
+// failed checks are printed and counted, a test exits with CHECK_RESULT()
+static int checkFailures = 0;
+
+#define CHECK(condition)                                                   \
+    do                                                                     \
+    {                                                                      \
+        if (!(condition))                                                  \
+        {                                                                  \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__,        \
+                __LINE__, #condition);                                     \
+            checkFailures++;                                               \
+        }                                                                  \
+    } while (0)
+
+#define CHECK_RESULT() ((checkFailures == 0) ? 0 : 1)
+
+#endif /* _CHECK_H */
@@ -0,0 +1,118 @@
+// cDeviceMatcher patterns, attributes and refreshes on a fake /sys/block
+#include "check.hh"
+#include "library/cDeviceMatcher.hh"
+
+#include <filesystem>
+#include <fstream>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+// a disk under devicePath of the fake sysfs, linked from its block directory
+static void addDisk(std::string const & root, std::string const & devicePath,
+    std::string const & rotational, std::string const & vendor)
+{
+    auto deviceName = std::filesystem::path(devicePath).filename().string();
+    std::filesystem::create_directories(
+        root + "/devices/" + devicePath + "/queue");
+    std::filesystem::create_directories(
+        root + "/devices/" + devicePath + "/device");
+    std::ofstream(root + "/devices/" + devicePath + "/queue/rotational")
+        << rotational << "\n";
+    std::ofstream(root + "/devices/" + devicePath + "/device/vendor")
+        << vendor << "\n";
+    std::filesystem::create_directory_symlink(
+        "../devices/" + devicePath, root + "/block/" + deviceName);
+}
+
+static struct sDeviceMatchConfig makeMatcher(std::string const & pattern,
+    bool isRegex, gint64 updateRate,
+    std::vector<std::pair<std::string, std::string>> const & attributes = {})
+{
+    return { .pattern = pattern, .isRegex = isRegex, .updateRate = updateRate,
+        .attributes = attributes };
+}
+
+int main(void)
+{
+    char directory[] = "/tmp/test-device-matcher.XXXXXX";
+    if (mkdtemp(directory) == nullptr)
+        return 1;
+    std::string root = directory;
+    std::filesystem::create_directories(root + "/block");
+    addDisk(root, "pci0000:00/usb1/1-1/host0/block/sdx", "1", "ACME    ");
+    addDisk(root, "pci0000:00/nvme/nvme0/nvme0n1", "0", "");
+    addDisk(root, "virtual/block/null", "0", "");
+    auto blockPath = root + "/block";
+    cDeviceMatcher matcher(blockPath.c_str());
+    std::vector<std::string> paths;
+
+    // globs and regexes match /dev/<name>
+    CHECK(matcher.setMatchers({ makeMatcher("/dev/sd*", false, 5) }));
+    paths = matcher.getDevicePaths();
+    CHECK(paths == std::vector<std::string>({ "/dev/sdx" }));
+    CHECK(matcher.getUpdateRate("/dev/sdx") == 5);
+    CHECK(matcher.getUpdateRate("/dev/nvme0n1") == 0);
+
+    CHECK(matcher.setMatchers({ makeMatcher("nvme[0-9]+n1$", true, 0) }));
+    paths = matcher.getDevicePaths();
+    CHECK(paths == std::vector<std::string>({ "/dev/nvme0n1" }));
+
+    CHECK(!matcher.setMatchers({ makeMatcher("([", true, 0) }));
+
+    // a literal path is resolved and reported as configured
+    CHECK(matcher.setMatchers({ makeMatcher("/dev/null", false, 0) }));
+    paths = matcher.getDevicePaths();
+    CHECK(paths == std::vector<std::string>({ "/dev/null" }));
+
+    // the transport comes from the bus in the sysfs path
+    std::string transport;
+    CHECK(matcher.getTransport("sdx", &transport) && transport == "usb");
+    CHECK(matcher.getTransport("nvme0n1", &transport) && transport == "nvme");
+    CHECK(matcher.getTransport("null", &transport) && transport == "virtual");
+    CHECK(!matcher.getTransport("sdy", &transport));
+
+    // attributes match without the padding of sysfs and all must match
+    CHECK(matcher.setMatchers(
+        { makeMatcher("", false, 0, { { "transport", "usb" } }) }));
+    paths = matcher.getDevicePaths();
+    CHECK(paths == std::vector<std::string>({ "/dev/sdx" }));
+    CHECK(matcher.setMatchers({ makeMatcher("", false, 0,
+        { { "queue/rotational", "0" }, { "transport", "nvme" } }) }));
+    paths = matcher.getDevicePaths();
+    CHECK(paths == std::vector<std::string>({ "/dev/nvme0n1" }));
+    CHECK(matcher.setMatchers(
+        { makeMatcher("", false, 0, { { "device/vendor", "ACME" } }) }));
+    paths = matcher.getDevicePaths();
+    CHECK(paths == std::vector<std::string>({ "/dev/sdx" }));
+    CHECK(matcher.setMatchers(
+        { makeMatcher("", false, 0, { { "../sdx/queue/rotational", "1" } }) }));
+    CHECK(matcher.getDevicePaths().empty());
+
+    // the first matching entry sets the update rate
+    CHECK(matcher.setMatchers(
+        { makeMatcher("/dev/sd*", false, 5), makeMatcher("", false, 7) }));
+    paths = matcher.getDevicePaths();
+    CHECK(paths == std::vector<std::string>(
+        { "/dev/null", "/dev/nvme0n1", "/dev/sdx" }));
+    CHECK(matcher.getUpdateRate("/dev/sdx") == 5);
+    CHECK(matcher.getUpdateRate("/dev/nvme0n1") == 7);
+
+    // a refresh reports plugged and unplugged devices only
+    CHECK(!matcher.refresh());
+    addDisk(root, "pci0000:00/usb2/2-1/host1/block/sdy", "1", "");
+    CHECK(matcher.refresh());
+    CHECK(matcher.getUpdateRate("/dev/sdy") == 5);
+    CHECK(!matcher.refresh());
+    std::filesystem::remove(root + "/block/sdy");
+    CHECK(matcher.refresh());
+    CHECK(matcher.getUpdateRate("/dev/sdy") == 0);
+    CHECK(matcher.getDevicePaths().size() == 3);
+
+    // a forgotten device is evaluated again, as when its media changed
+    matcher.forget("sdx");
+    CHECK(matcher.refresh());
+
+    std::filesystem::remove_all(root);
+    return CHECK_RESULT();
+}
@@ -0,0 +1,92 @@
+// cHistogram bucket bounds, percentiles and merging
+#include "check.hh"
+#include "library/cHistogram.hh"
+
+// every value lands in a bucket whose bounds hold it within the relative error
+static void checkBucket(guint64 value)
+{
+    auto index = cHistogram::getBucketIndex(value);
+    auto lower = cHistogram::getBucketLowerBound(index);
+    auto upper = cHistogram::getBucketUpperBound(index);
+    CHECK(index < cHistogram::CONST_BUCKET_COUNT);
+    CHECK(lower <= value && value <= upper);
+    CHECK((upper - lower) * cHistogram::CONST_SUB_BUCKETS <= lower);
+}
+
+int main(void)
+{
+    // the buckets cover every value up to the largest one without a gap
+    CHECK(cHistogram::getBucketLowerBound(0) == 0);
+    for (guint i = 1; i < cHistogram::CONST_BUCKET_COUNT; i++)
+    {
+        CHECK(cHistogram::getBucketLowerBound(i)
+            == cHistogram::getBucketUpperBound(i - 1) + 1);
+        CHECK(cHistogram::getBucketIndex(cHistogram::getBucketLowerBound(i))
+            == i);
+    }
+    auto maxValue = ((guint64)1 << cHistogram::CONST_MAX_VALUE_BITS) - 1;
+    CHECK(cHistogram::getBucketUpperBound(cHistogram::CONST_BUCKET_COUNT - 1)
+        == maxValue);
+
+    // linear below the limit, then around every power of two
+    for (guint64 value = 0; value < 4 * cHistogram::CONST_LINEAR_LIMIT; value++)
+        checkBucket(value);
+    for (guint bit = 5; bit < cHistogram::CONST_MAX_VALUE_BITS; bit++)
+    {
+        auto power = (guint64)1 << bit;
+        checkBucket(power - 1);
+        checkBucket(power);
+        checkBucket(power + 1);
+        checkBucket(power + power / 3);
+    }
+    for (guint64 value = 1000; value < 10000000; value = value * 17 / 13)
+        checkBucket(value);
+
+    // anything larger is clamped into the last bucket
+    CHECK(cHistogram::getBucketIndex(maxValue + 1)
+        == cHistogram::CONST_BUCKET_COUNT - 1);
+    CHECK(cHistogram::getBucketIndex(~(guint64)0)
+        == cHistogram::CONST_BUCKET_COUNT - 1);
+
+    // percentiles report the upper bound of the bucket, at most the maximum
+    cHistogram histogram;
+    CHECK(histogram.getValueAtPercentile(50.0) == 0);
+    for (guint64 value = 1; value <= 1000; value++)
+        histogram.record(value);
+    CHECK(histogram.getCount() == 1000);
+    CHECK(histogram.getMax() == 1000);
+    auto p50 = histogram.getValueAtPercentile(50.0);
+    CHECK(p50 >= 500 && p50 <= 500 + 500 / cHistogram::CONST_SUB_BUCKETS);
+    auto p99 = histogram.getValueAtPercentile(99.0);
+    CHECK(p99 >= 990 && p99 <= 1000);
+    CHECK(histogram.getValueAtPercentile(100.0) == 1000);
+    CHECK(histogram.getValueAtPercentile(0.0) == 1);
+
+    // merging adds the buckets and keeps the larger maximum
+    cHistogram other;
+    other.recordMultiple(5000, 1000);
+    histogram.merge(other);
+    CHECK(histogram.getCount() == 2000);
+    CHECK(histogram.getMax() == 5000);
+    CHECK(histogram.getValueAtPercentile(25.0)
+        <= 500 + 500 / cHistogram::CONST_SUB_BUCKETS);
+    CHECK(histogram.getValueAtPercentile(75.0) == 5000);
+
+    // restoring the buckets restores the count
+    cHistogram restored;
+    for (guint i = 0; i < cHistogram::CONST_BUCKET_COUNT; i++)
+        CHECK(restored.setBucket(i, histogram.getBucket(i)));
+    restored.setMax(histogram.getMax());
+    CHECK(restored.getCount() == histogram.getCount());
+    CHECK(restored.getValueAtPercentile(50.0)
+        == histogram.getValueAtPercentile(50.0));
+    CHECK(!restored.setBucket(cHistogram::CONST_BUCKET_COUNT, 1));
+    CHECK(restored.getBucket(cHistogram::CONST_BUCKET_COUNT) == 0);
+
+    restored.reset();
+    CHECK(restored.getCount() == 0);
+    CHECK(restored.getMax() == 0);
+    CHECK(restored.getValueAtPercentile(99.0) == 0);
+
+    return CHECK_RESULT();
+}
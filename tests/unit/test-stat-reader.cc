@@ -0,0 +1,93 @@
+// cStatReader::getAllStats() on diskstats text longer than a page
+#include "check.hh"
+#include "library/cStatReader.hh"
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// one line of /proc/diskstats per device, about 60 bytes each
+static std::string makeDiskstats(guint count)
+{
+    std::string text;
+    char line[256];
+    for (guint i = 0; i < count; i++)
+    {
+        snprintf(line, sizeof(line),
+            "%4u %7u sdx%u %u 0 %u 0 %u 0 %u 0 0 0 0 0 0 0 0 0 0\n", 8,
+            i, i, i, i + 1, i + 2, i + 3);
+        text += line;
+    }
+    return text;
+}
+
+static void checkDisks(std::vector<struct sDiskStats> const & disks, guint count)
+{
+    CHECK(disks.size() == count);
+    for (guint i = 0; i < disks.size() && i < count; i++)
+    {
+        std::string name = "sdx" + std::to_string(i);
+        CHECK(name == disks[i].deviceName);
+        CHECK(disks[i].stats.readIo == i);
+        CHECK(disks[i].stats.readSectors == i + 1);
+        CHECK(disks[i].stats.writeIo == i + 2);
+        CHECK(disks[i].stats.writeSectors == i + 3);
+    }
+}
+
+static bool writeFile(const char* pPath, std::string const & text)
+{
+    FILE* pFile = fopen(pPath, "w");
+    if (pFile == nullptr)
+        return false; // failure
+    fwrite(text.data(), 1, text.size(), pFile);
+    return (fclose(pFile) == 0);
+}
+
+int main(void)
+{
+    char directory[] = "/tmp/test-stat-reader.XXXXXX";
+    if (mkdtemp(directory) == nullptr)
+        return 1;
+    std::string file = std::string(directory) + "/diskstats";
+    std::string fifo = std::string(directory) + "/fifo";
+    cStatReader reader;
+    std::vector<struct sDiskStats> disks;
+
+    // a regular file of several pages
+    std::string text = makeDiskstats(400);
+    CHECK(text.size() > 4 * 4096);
+    CHECK(writeFile(file.c_str(), text));
+    CHECK(reader.getAllStats(&disks, file.c_str()));
+    checkDisks(disks, 400);
+
+    // a seq_file returns about a page per read, so does a slow pipe
+    CHECK(mkfifo(fifo.c_str(), 0600) == 0);
+    std::thread writer([&]() {
+        FILE* pFile = fopen(fifo.c_str(), "w");
+        for (gsize offset = 0; offset < text.size(); offset += 4000)
+        {
+            fwrite(text.data() + offset, 1,
+                std::min<gsize>(4000, text.size() - offset), pFile);
+            fflush(pFile);
+            usleep(2000);
+        }
+        fclose(pFile);
+    });
+    CHECK(reader.getAllStats(&disks, fifo.c_str()));
+    writer.join();
+    checkDisks(disks, 400);
+
+    // longer than the buffer fails rather than dropping devices
+    CHECK(writeFile(file.c_str(), makeDiskstats(3000)));
+    CHECK(!reader.getAllStats(&disks, file.c_str()));
+
+    unlink(fifo.c_str());
+    unlink(file.c_str());
+    rmdir(directory);
+    return CHECK_RESULT();
+}
@@ -0,0 +1,170 @@
+// cStatSubscriber delivery, thresholds, the eventfd queue and stop()
+#include "check.hh"
+#include "library/cStatSubscriber.hh"
+
+#include <atomic>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+constexpr guint CONST_DEVICES = 400; // several pages of diskstats
+
+static std::string diskstatsPath;
+
+// every device reads nothing, writes grow with io and sectors of the device
+static void writeDiskstats(guint device, gint64 writeIo, gint64 writeSectors)
+{
+    std::string temporaryPath = diskstatsPath + ".tmp";
+    FILE* pFile = fopen(temporaryPath.c_str(), "w");
+    for (guint i = 0; i < CONST_DEVICES; i++)
+    {
+        fprintf(pFile, "%4u %7u sdx%u 0 0 0 0 %ld 0 %ld 0 0 0 0 0 0 0 0\n", 8,
+            i, i, (i == device) ? (long)writeIo : 0L,
+            (i == device) ? (long)writeSectors : 0L);
+    }
+    fclose(pFile);
+    rename(temporaryPath.c_str(), diskstatsPath.c_str());
+}
+
+static void checkCallbacks(void)
+{
+    cStatSubscriber subscriber(diskstatsPath.c_str());
+    std::vector<struct sStatDelta> received;
+    int batches = 0;
+    auto callback = [&](std::vector<struct sStatDelta> const & batch) {
+        received = batch;
+        batches++;
+    };
+
+    // the last device is well past the first page of the file
+    guint last = CONST_DEVICES - 1;
+    writeDiskstats(last, 10, 80);
+    int id = subscriber.subscribe({ "sdx" + std::to_string(last) }, {}, callback);
+    CHECK(id > 0);
+    CHECK(subscriber.sample());
+    CHECK(batches == 0); // the first sample is the baseline
+
+    writeDiskstats(last, 15, 120);
+    CHECK(subscriber.sample());
+    CHECK(batches == 1);
+    CHECK(received.size() == 1);
+    if (received.size() == 1)
+    {
+        CHECK(received[0].deviceName == "sdx" + std::to_string(last));
+        CHECK(received[0].delta.writeIo == 5);
+        CHECK(received[0].delta.writeSectors == 40);
+    }
+
+    // unchanged counters deliver nothing
+    CHECK(subscriber.sample());
+    CHECK(batches == 1);
+
+    // below the thresholds the changes add up
+    CHECK(subscriber.unsubscribe(id));
+    CHECK(!subscriber.unsubscribe(id));
+    id = subscriber.subscribe({ "sdx" + std::to_string(last) },
+        { .minIo = 10, .minBytes = 0 }, callback);
+    CHECK(subscriber.sample());
+    writeDiskstats(last, 20, 160);
+    CHECK(subscriber.sample());
+    CHECK(batches == 1);
+    writeDiskstats(last, 25, 200);
+    CHECK(subscriber.sample());
+    CHECK(batches == 2);
+    if (received.size() == 1)
+    {
+        CHECK(received[0].delta.writeIo == 10);
+        CHECK(received[0].delta.writeSectors == 80);
+    }
+
+    // not called any more once unsubscribed
+    CHECK(subscriber.unsubscribe(id));
+    writeDiskstats(last, 100, 800);
+    CHECK(subscriber.sample());
+    CHECK(batches == 2);
+}
+
+static void checkEventFd(void)
+{
+    cStatSubscriber subscriber(diskstatsPath.c_str());
+    int eventFd = -1;
+    int id = subscriber.subscribe({ "sdx7" }, {}, &eventFd);
+    CHECK(id > 0);
+    CHECK(eventFd >= 0);
+
+    writeDiskstats(7, 0, 0);
+    CHECK(subscriber.sample());
+    struct pollfd pollFd = { .fd = eventFd, .events = POLLIN };
+    CHECK(poll(&pollFd, 1, 0) == 0);
+
+    // past 1024 deltas the oldest are dropped
+    for (gint64 i = 1; i <= 1100; i++)
+    {
+        writeDiskstats(7, i, i * 8);
+        CHECK(subscriber.sample());
+    }
+    CHECK(poll(&pollFd, 1, 0) == 1);
+    std::vector<struct sStatDelta> deltas;
+    CHECK(subscriber.takeDeltas(id, &deltas));
+    CHECK(deltas.size() == 1024);
+    if (deltas.size() == 1024)
+    {
+        CHECK(deltas.back().delta.writeIo == 1);
+        CHECK(deltas.back().delta.writeSectors == 8);
+    }
+    CHECK(poll(&pollFd, 1, 0) == 0);
+    CHECK(subscriber.takeDeltas(id, &deltas));
+    CHECK(deltas.empty());
+    CHECK(!subscriber.takeDeltas(id + 1, &deltas));
+}
+
+static void checkStopFromCallback(void)
+{
+    cStatSubscriber subscriber(diskstatsPath.c_str());
+    std::atomic<int> batches = 0;
+    gint64 writeIo = 1;
+    writeDiskstats(3, writeIo, 8);
+    subscriber.subscribe({ "sdx3" }, {},
+        [&](std::vector<struct sStatDelta> const &) {
+            batches++;
+            subscriber.stop();
+        });
+    CHECK(subscriber.start(1));
+
+    // the thread stops itself at the first delta
+    for (int i = 0; i < 1000 && batches == 0; i++)
+    {
+        writeDiskstats(3, ++writeIo, 8);
+        usleep(2000);
+    }
+    CHECK(batches == 1);
+    for (int i = 0; i < 20; i++)
+    {
+        writeDiskstats(3, ++writeIo, 8);
+        usleep(2000);
+    }
+    CHECK(batches == 1);
+
+    // the stopped thread is joined by the next start()
+    CHECK(subscriber.start(1));
+    subscriber.stop();
+}
+
+int main(void)
+{
+    char directory[] = "/tmp/test-stat-subscriber.XXXXXX";
+    if (mkdtemp(directory) == nullptr)
+        return 1;
+    diskstatsPath = std::string(directory) + "/diskstats";
+
+    checkCallbacks();
+    checkEventFd();
+    checkStopFromCallback();
+
+    unlink(diskstatsPath.c_str());
+    rmdir(directory);
+    return CHECK_RESULT();
+}
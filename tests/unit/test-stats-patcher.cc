@@ -0,0 +1,180 @@
+// cStatsPatcher field scan, padding and patches in place
+#include "check.hh"
+#include "daemon/cStatsPatcher.hh"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdlib.h>
+#include <string>
+
+static const char* CONST_STATS_NAMES[] = { "readIo", "readMerges",
+    "readSectors", "readTicks", "writeIo", "writeMerges", "writeSectors",
+    "writeTicks", "inFlight", "ioTicks", "timeInQueue", "discardIo",
+    "discardMerges", "discardSectors", "discardTicks" };
+
+// an entry as cJsonWriter generates it, counters from base upwards
+static std::string makeEntry(std::string const & serialNumber,
+    std::string const & previousPath, gint64 base)
+{
+    std::string text = "    \"" + serialNumber + "\" : {\n"
+        + "        \"firstSightingDate\" : \"14-11-2023 22:13:20\",\n"
+        + "        \"previousPath\" : \"" + previousPath + "\",\n"
+        + "        \"previousStats\" : {\n";
+    for (guint i = 0; i < 15; i++)
+    {
+        text += "            \"" + std::string(CONST_STATS_NAMES[i]) + "\" : "
+            + std::to_string(base + i) + (i < 14 ? ",\n" : "\n");
+    }
+    text += "        },\n"
+        "        \"diskSeq\" : " + std::to_string(base + 15) + ",\n"
+        "        \"totalBytesWritten\" : " + std::to_string(base + 16) + ",\n"
+        "        \"selfBytesWritten\" : " + std::to_string(base + 17) + ",\n"
+        "        \"lastSeenTime\" : 1731535980,\n"
+        "        \"histograms\" : {\n"
+        "            \"writeAwait\" : {\n"
+        "                \"count\" : 3,\n"
+        "                \"buckets\" : [\n"
+        "                    [\n"
+        "                        127,\n"
+        "                        3\n"
+        "                    ]\n"
+        "                ]\n"
+        "            }\n"
+        "        }\n"
+        "    }";
+    return text;
+}
+
+static std::string makeStats(void)
+{
+    return "{\n" + makeEntry("0xabcd1234", "/dev/mmcblk0", 100) + ",\n"
+        + makeEntry("SD-2", "/dev/sdb", 2000) + ",\n"
+        + "    \"_meta\" : {\n        \"readIo\" : 7\n    }\n}\n";
+}
+
+static std::string readFile(std::string const & path)
+{
+    std::ifstream ifs(path);
+    std::stringstream text;
+    text << ifs.rdbuf();
+    return text.str();
+}
+
+static void writeFile(std::string const & path, std::string const & text)
+{
+    std::ofstream(path) << text;
+}
+
+static std::string removeSpaces(std::string text)
+{
+    std::erase_if(text, [](char c) { return c == ' '; });
+    return text;
+}
+
+// the value of name, the first after the given offset, and its field width
+static bool findField(std::string const & text, std::string const & name,
+    gsize from, gint64* pValue, gsize* pWidth)
+{
+    auto position = text.find("\"" + name + "\" :", from);
+    if (position == std::string::npos)
+        return false;
+    auto start = position + name.size() + 4;
+    auto end   = text.find_first_of(",\n", start);
+    *pValue    = strtoll(text.c_str() + start, nullptr, 10);
+    *pWidth    = end - start;
+    return true;
+}
+
+int main(void)
+{
+    char directory[] = "/tmp/test-stats-patcher.XXXXXX";
+    if (mkdtemp(directory) == nullptr)
+        return 1;
+    std::string path = std::string(directory) + "/stats.json";
+
+    // only the counters of the entries are padded, the rest is unchanged
+    auto text = makeStats();
+    std::string padded;
+    cStatsPatcher::padFields(text, &padded);
+    CHECK(removeSpaces(padded) == removeSpaces(text));
+    gint64 value;
+    gsize width;
+    for (auto pName : CONST_STATS_NAMES)
+    {
+        CHECK(findField(padded, pName, 0, &value, &width)
+            && width == 1 + cStatsPatcher::CONST_FIELD_WIDTH);
+    }
+    CHECK(findField(padded, "totalBytesWritten", 0, &value, &width)
+        && value == 116 && width == 1 + cStatsPatcher::CONST_FIELD_WIDTH);
+    CHECK(findField(padded, "lastSeenTime", 0, &value, &width)
+        && width == 1 + 10);
+    CHECK(findField(padded, "count", 0, &value, &width) && width == 1 + 1);
+    CHECK(findField(padded, "readIo", padded.find("_meta"), &value, &width)
+        && value == 7 && width == 1 + 1);
+
+    // changed counters are overwritten in place, the size stays the same
+    writeFile(path, padded);
+    cStatsPatcher patcher;
+    CHECK(patcher.load(path));
+    struct sBlockStats stats = {};
+    stats.readIo       = 100;
+    stats.readMerges   = 101;
+    stats.readSectors  = 102;
+    stats.readTicks    = 103;
+    stats.writeIo      = 123456789012;
+    stats.writeMerges  = 105;
+    stats.writeSectors = 106;
+    stats.writeTicks   = 107;
+    stats.inFlight     = 0;
+    stats.ioTicks      = 109;
+    stats.timeInQueue  = 110;
+    stats.discardIo    = 111;
+    stats.discardMerges  = 112;
+    stats.discardSectors = 113;
+    stats.discardTicks   = 114;
+    CHECK(patcher.patch("0xabcd1234", "/dev/mmcblk0", &stats, 115,
+        G_MAXINT64, -1));
+    CHECK(patcher.sync());
+    CHECK(patcher.getPatchCount() == 1);
+    auto patched = readFile(path);
+    CHECK(patched.size() == padded.size());
+    CHECK(findField(patched, "writeIo", 0, &value, &width)
+        && value == 123456789012);
+    CHECK(findField(patched, "inFlight", 0, &value, &width) && value == 0);
+    CHECK(findField(patched, "readIo", 0, &value, &width) && value == 100);
+    CHECK(findField(patched, "totalBytesWritten", 0, &value, &width)
+        && value == G_MAXINT64);
+    CHECK(findField(patched, "selfBytesWritten", 0, &value, &width)
+        && value == -1);
+    CHECK(findField(patched, "writeIo", patched.find("SD-2"), &value, &width)
+        && value == 2004);
+
+    // unchanged counters aren't written, nothing is synced
+    CHECK(patcher.patch("0xabcd1234", "/dev/mmcblk0", &stats, 115,
+        G_MAXINT64, -1));
+    CHECK(patcher.sync());
+    CHECK(patcher.getPatchCount() == 1);
+
+    // an unknown serial number, another path or a replaced file need a
+    // full write
+    CHECK(!patcher.patch("SD-3", "/dev/sdb", &stats, 1, 2, 3));
+    CHECK(!patcher.patch("SD-2", "/dev/sdc", &stats, 1, 2, 3));
+    CHECK(patcher.patch("SD-2", "/dev/sdb", &stats, 1, 2, 3));
+    std::string replacedPath = path + ".new";
+    writeFile(replacedPath, padded);
+    std::filesystem::rename(replacedPath, path);
+    CHECK(!patcher.patch("SD-2", "/dev/sdb", &stats, 4, 5, 6));
+    CHECK(readFile(path) == padded);
+
+    // counters too narrow to patch, as written before padding
+    writeFile(path, text);
+    CHECK(patcher.load(path));
+    CHECK(!patcher.patch("0xabcd1234", "/dev/mmcblk0", &stats, 1, 2, 3));
+    CHECK(readFile(path) == text);
+
+    patcher.close();
+    CHECK(!patcher.load(path + ".missing"));
+    std::filesystem::remove_all(directory);
+    return CHECK_RESULT();
+}
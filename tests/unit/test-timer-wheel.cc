@@ -0,0 +1,142 @@
+// cTimerWheel deadlines, cascades and catch up against the pending timers
+#include "check.hh"
+#include "daemon/cTimerWheel.hh"
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+// timers not yet due, by key
+using tPending = std::map<std::string, gint64>;
+
+static bool getEarliest(tPending const & pending, gint64* pDeadline)
+{
+    if (pending.empty())
+        return false;
+    *pDeadline = std::min_element(pending.begin(), pending.end(),
+        [](auto const & a, auto const & b) { return a.second < b.second; })
+        ->second;
+    return true;
+}
+
+// advances to now and checks that exactly the timers due by then expired
+static void checkAdvance(cTimerWheel* pWheel, tPending* pPending, gint64 now)
+{
+    std::vector<std::string> due;
+    pWheel->advance(now, &due);
+    std::sort(due.begin(), due.end());
+    std::vector<std::string> expected;
+    for (auto it = pPending->begin(); it != pPending->end();)
+    {
+        if (it->second <= now)
+        {
+            expected.push_back(it->first);
+            it = pPending->erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
+    CHECK(due == expected);
+}
+
+int main(void)
+{
+    // deadlines are the next multiple of the interval
+    CHECK(cTimerWheel::getAlignedDeadline(0, 10) == 10);
+    CHECK(cTimerWheel::getAlignedDeadline(9, 10) == 10);
+    CHECK(cTimerWheel::getAlignedDeadline(10, 10) == 20);
+    CHECK(cTimerWheel::getAlignedDeadline(1700000003, 60) == 1700000040);
+    CHECK(cTimerWheel::getAlignedDeadline(1700000003, 0) == 1700000004);
+
+    // timers on every level, up to 48 days ahead, jumping from deadline to
+    // deadline as the daemon does, each expires at its second
+    cTimerWheel wheel;
+    tPending pending;
+    gint64 now = 1700000003;
+    wheel.reset(now);
+    wheel.reserve(8);
+    guint32 random = 12345;
+    for (guint i = 0; i < 2000; i++)
+    {
+        random = random * 1103515245 + 12345;
+        auto bits = 1 + (random >> 8) % 22;
+        random = random * 1103515245 + 12345;
+        auto deadline = now + 1
+            + (gint64)((random >> 4) % ((guint32)1 << bits));
+        auto key = "timer" + std::to_string(i);
+        wheel.add(key, deadline);
+        pending[key] = deadline;
+    }
+    gint64 deadline;
+    gint64 expected;
+    guint steps = 0;
+    while (wheel.getNextDeadline(&deadline))
+    {
+        CHECK(getEarliest(pending, &expected) && deadline == expected);
+        if (deadline != expected || ++steps > 5000)
+            break;
+        now = deadline;
+        checkAdvance(&wheel, &pending, now);
+    }
+    CHECK(pending.empty());
+
+    // re-added on an interval as the sampling does, every timer stays in step
+    wheel.reset(now);
+    for (gint64 interval : { 1, 7, 60, 3600, 86400 })
+    {
+        auto key = "every" + std::to_string(interval);
+        pending[key] = cTimerWheel::getAlignedDeadline(now, interval);
+        wheel.add(key, pending[key]);
+    }
+    auto end = now + 2 * 86400;
+    while (wheel.getNextDeadline(&deadline) && deadline <= end)
+    {
+        CHECK(getEarliest(pending, &expected) && deadline == expected);
+        std::vector<std::string> due;
+        wheel.advance(deadline, &due);
+        for (auto const & key : due)
+        {
+            CHECK(pending[key] == deadline);
+            auto interval = std::stoll(key.substr(5));
+            CHECK(deadline % interval == 0);
+            pending[key] = cTimerWheel::getAlignedDeadline(deadline, interval);
+            wheel.add(key, pending[key]);
+        }
+    }
+
+    // removed timers never expire, overdue ones expire on the next tick
+    for (auto const & [key, keyDeadline] : pending)
+        wheel.remove(key);
+    pending.clear();
+    CHECK(!wheel.getNextDeadline(&deadline));
+    wheel.add("overdue", end - 100);
+    pending["overdue"] = end + 1;
+    CHECK(wheel.getNextDeadline(&deadline) && deadline == end - 100);
+    now = end;
+    checkAdvance(&wheel, &pending, now);
+    std::vector<std::string> due;
+    wheel.advance(now + 1, &due);
+    CHECK(due == std::vector<std::string>({ "overdue" }));
+    pending.erase("overdue");
+
+    // a jump longer than a catch up, e.g. after a suspend, expires
+    // everything due at once and keeps the rest, even beyond the last level
+    wheel.add("later", now + 40 * 86400);
+    pending["later"] = now + 40 * 86400;
+    wheel.add("parked", now + 300 * 86400);
+    pending["parked"] = now + 300 * 86400;
+    now += 10 * 86400;
+    checkAdvance(&wheel, &pending, now);
+    CHECK(pending.size() == 2);
+    CHECK(wheel.getNextDeadline(&deadline) && deadline == now + 30 * 86400);
+    checkAdvance(&wheel, &pending, deadline);
+    CHECK(wheel.getNextDeadline(&deadline) && deadline == now + 290 * 86400);
+    checkAdvance(&wheel, &pending, deadline);
+    CHECK(pending.empty());
+    CHECK(!wheel.getNextDeadline(&deadline));
+
+    return CHECK_RESULT();
+}
@@ -0,0 +1,116 @@
+// cTopK eviction and error bounds
+#include "check.hh"
+#include "library/cTopK.hh"
+
+#include <map>
+#include <string.h>
+#include <string>
+
+static const struct cTopK::sItem* findItem(
+    std::array<struct cTopK::sItem, cTopK::CONST_MAX_CAPACITY> const & items,
+    guint size, const char* pName)
+{
+    for (guint i = 0; i < size; i++)
+    {
+        if (strcmp(items[i].name, pName) == 0)
+            return &items[i];
+    }
+    return nullptr;
+}
+
+int main(void)
+{
+    std::array<struct cTopK::sItem, cTopK::CONST_MAX_CAPACITY> items;
+    guint size;
+
+    // the capacity is clamped to what fits in place
+    cTopK topK;
+    topK.setCapacity(0);
+    topK.record("a", 1);
+    topK.record("b", 1);
+    CHECK(topK.getSize() == 1);
+    topK.setCapacity(1000);
+    for (guint i = 0; i < 2 * cTopK::CONST_MAX_CAPACITY; i++)
+        topK.record(std::to_string(i).c_str(), 1);
+    CHECK(topK.getSize() == cTopK::CONST_MAX_CAPACITY);
+
+    // exact until full, then the lightest is evicted and its count is the
+    // error of the newcomer
+    topK.reset();
+    CHECK(topK.getSize() == 0);
+    topK.setCapacity(3);
+    topK.record("a", 10);
+    topK.record("b", 5);
+    topK.record("c", 1);
+    topK.record("b", 2);
+    topK.record("d", 2);
+    topK.getItems(&items, &size);
+    CHECK(size == 3);
+    CHECK(strcmp(items[0].name, "a") == 0 && items[0].count == 10
+        && items[0].error == 0);
+    CHECK(strcmp(items[1].name, "b") == 0 && items[1].count == 7
+        && items[1].error == 0);
+    CHECK(strcmp(items[2].name, "d") == 0 && items[2].count == 3
+        && items[2].error == 1);
+    CHECK(findItem(items, size, "c") == nullptr);
+
+    // heavy writers among many light ones are kept, every count
+    // over-estimates by at most its error, which is at most total / capacity
+    topK.reset();
+    topK.setCapacity(10);
+    std::map<std::string, guint64> truth;
+    guint64 total = 0;
+    for (guint i = 0; i < 5000; i++)
+    {
+        auto name = "light" + std::to_string(i % 700);
+        topK.record(name.c_str(), 1);
+        truth[name] += 1;
+        total += 1;
+        if (i % 10 == 0)
+        {
+            auto heavyName = "heavy" + std::to_string(i % 3);
+            topK.record(heavyName.c_str(), 20);
+            truth[heavyName] += 20;
+            total += 20;
+        }
+    }
+    topK.getItems(&items, &size);
+    CHECK(size == 10);
+    for (guint i = 0; i < size; i++)
+    {
+        auto trueCount = truth[items[i].name];
+        CHECK(items[i].count >= trueCount);
+        CHECK(items[i].count - items[i].error <= trueCount);
+        CHECK(items[i].error <= total / 10);
+        if (i > 0)
+            CHECK(items[i - 1].count >= items[i].count);
+    }
+    for (auto pName : { "heavy0", "heavy1", "heavy2" })
+    {
+        CHECK(truth[pName] > total / 10);
+        CHECK(findItem(items, size, pName) != nullptr);
+    }
+
+    // names longer than a comm are truncated and still found again
+    topK.reset();
+    topK.setCapacity(2);
+    topK.record("a-very-long-process-name", 1);
+    topK.record("a-very-long-process-name", 1);
+    topK.record("x", 1);
+    topK.getItems(&items, &size);
+    CHECK(size == 2);
+    CHECK(strlen(items[0].name) == cTopK::CONST_NAME_LENGTH - 1);
+    CHECK(items[0].count == 2 && items[0].error == 0);
+
+    // restoring refuses duplicates and a full summary
+    topK.reset();
+    CHECK(topK.restore("a", 5, 1));
+    CHECK(!topK.restore("a", 6, 0));
+    CHECK(topK.restore("b", 3, 0));
+    CHECK(!topK.restore("c", 1, 0));
+    topK.record("a", 1);
+    topK.getItems(&items, &size);
+    CHECK(size == 2 && items[0].count == 6 && items[0].error == 1);
+
+    return CHECK_RESULT();
+}